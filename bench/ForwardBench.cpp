@@ -0,0 +1,933 @@
+// ]oH (ForwardAudioData / ForwardAudioDataBlock Ɗe]֐) ̃}CNx`}[NB
+// Windows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -Isrc bench/ForwardBench.cpp src/ForwardKernels.cpp src/LevelMeter.cpp -o forward_bench
+//   ./forward_bench [`l\̈ꕔ]
+//
+// `l\E]֐E͌`EubN̑傫E`̑gɁA
+// 1t[̎ԂƁAo͂킹шo͂B
+// āA`l\ςs̓] (MixFunction) AVLC ̂悤ɕʂ̃pXŕϊĂ]ꍇƔׂB
+// āAPlay() ŕϊăOɏꍇ (ConvertAudioDataBlock / ForwardPlanarData) ́APlay() ƕ`̎Ԃo͂B
+// āAꕔ܂͑SĂ̏o͂̏ꍇ́APlay() ł̖̌o (ScanAudioDataBlock) Ɠ]̎Ԃo͂B
+// ŌɁAʂ̌v]֐ōsꍇƁA]ɏo͂ǂݒꍇƁAEhlX܂ŋ߂ꍇ̎ԂAvȂꍇɑ΂鑝ƂƂɏo͂B
+// AVX2EAVX-512 ̔ėp̓]֐ꂼɂāA]֐Ōvꍇ̑ (kMeterBudget  kMeterWideBudget) 𒴂 1 ԂB
+// vlƍȂꍇAK ̃EhlX EBU Tech 3341 ̐g̒lOꍇ 1 ԂB
+// ]Ƀq[v̊mہE (operator new / delete  block_Release) NĂ΁AŌɕ񍐂 1 ԂB
+
+#include "ChannelLayouts.h"
+#include "ForwardAudioData.h"
+#include "ForwardKernels.h"
+#include "ForwardLayouts.h"
+#include "LevelMeter.h"
+#include "ObjectLayout.h"
+#include "PlanarRing.h"
+#include "SpscQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+// vlc_block.h  block_t ̂A]oHg^
+struct block_t
+{
+	uint8_t *p_buffer;
+	size_t i_buffer;
+	unsigned i_nb_samples;
+};
+
+// q[v̉񐔁B]̌vB
+static std::atomic<bool> count_heap_operations;
+static std::atomic<uint64_t> heap_operations;
+
+static void CountHeapOperation()
+{
+	if (count_heap_operations.load(std::memory_order_relaxed))
+		heap_operations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *operator new(size_t size)
+{
+	CountHeapOperation();
+
+	if (void *p = malloc(size? size: 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	if (p)
+		CountHeapOperation();
+
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+// ubN̓x`}[NŎg񂷂̂ŁAȂB
+// VLC ł free ɑ̂ŁAq[vƂĐB
+static void block_Release(block_t *)
+{
+	CountHeapOperation();
+}
+
+// aout_sys_t ̂A]oHg^
+struct BenchSys
+{
+	struct
+	{
+		uint8_t i_channels;
+		unsigned i_bytes_per_frame;
+	} input_format_;
+
+	SpscQueue<QueuedBlock<block_t>> audio_data_queue_ {1 << 17};
+	SpscQueue<block_t *> released_blocks_ {1 << 18};
+	std::atomic<int64_t> audio_data_frames_;
+	uint8_t output_channels_;
+	std::array<uint8_t, kMaxForwardChannels> channel_reorder_table_;
+	DeinterleaveFunction deinterleave_;
+	MixFunction mix_;
+	std::array<float, kMaxForwardChannels * kMaxMixInputChannels> mix_matrix_;
+	ScanSilenceFunction scan_silence_;
+	std::array<uint32_t, kMaxForwardChannels> output_sources_;
+	PlanarRing planar_ring_;
+	MeasureLevelsFunction measure_levels_;
+};
+
+struct Layout
+{
+	const char *name;
+	unsigned channels;
+	std::array<uint8_t, kMaxForwardChannels> reorder;
+	DeinterleaveFunction layout_function;
+};
+
+static constexpr Layout MakeLayout(const ChannelLayout& layout)
+{
+	return Layout {layout.name, CountLayoutChannels(layout.mask), MakeLayoutReorder(kInputChannelOrder, kOutputChannelOrder, layout.mask), layout.deinterleave};
+}
+
+// ܂ލ\BVLC 3 ͂o͂ȂA͂IuWFNg̏ɕł̂ƂĕւȂŌvB
+template <size_t... Index>
+static constexpr Layout MakeObjectLayout(const char *name, std::index_sequence<Index...>)
+{
+	return Layout {name, sizeof...(Index), MakeIdentityReorder(), LayoutKernel<Index...>::Deinterleave};
+}
+
+// mss.cpp p̓]֐`l\ (kChannelLayouts) ƁA܂ލ\
+template <size_t... Index>
+static constexpr std::array<Layout, sizeof...(Index) + 2> MakeLayouts(std::index_sequence<Index...>)
+{
+	return {{
+		MakeLayout(kChannelLayouts[Index])...,
+		MakeObjectLayout("7.1.4", std::make_index_sequence<12>()),
+		MakeObjectLayout("7.1.4.4", std::make_index_sequence<16>())
+	}};
+}
+
+static constexpr auto kLayouts = MakeLayouts(std::make_index_sequence<std::size(kChannelLayouts)>());
+
+struct Format
+{
+	const char *name;
+	SampleFormat format;
+	unsigned sample_bytes;
+};
+
+static const Format kFormats[] =
+{
+	{"fl32", SampleFormat::kFloat32, 4},
+	{"s16n", SampleFormat::kSigned16, 2},
+	{"s24n", SampleFormat::kSigned24, 3},
+	{"s32n", SampleFormat::kSigned32, 4}
+};
+
+// ubN̑傫Bzero_between ^ȂAeubN̊Ԃ i_nb_samples  0 ̃ubNށB
+struct BlockPattern
+{
+	const char *name;
+	unsigned frames;
+	bool zero_between;
+};
+
+static const BlockPattern kBlockPatterns[] =
+{
+	{"1", 1, false},
+	{"16+0", 16, true},
+	{"256", 256, false},
+	{"1024", 1024, false},
+	{"4096", 4096, false}
+};
+
+static const unsigned kPeriodFrames[] = {441, 480, 1024};
+
+// s̓]v`l̑g
+struct MixCase
+{
+	const char *name;
+	unsigned in_channels;
+	unsigned out_channels;
+};
+
+static const MixCase kMixCases[] =
+{
+	{"2.0>7.0", 2, 7},
+	{"2.1>7.1", 3, 8},
+	{"6.1>7.1", 7, 8},
+	{"8.1>7.1", 9, 8},
+	{"2.1>7.1.4", 3, 12},
+	{"7.1>7.1.4", 8, 12},
+	{"8.1>7.1.4.4", 9, 16}
+};
+
+static constexpr unsigned kMixPeriodFrames = 480;
+
+// ǑvɎgubN̑傫ƕ`
+static constexpr unsigned kRingBlockFrames = 1024;
+static constexpr unsigned kRingPeriodFrames = 480;
+
+// ̌v 0 ɂóBo͂̕т L, R, C, LFE, ... ŁAback ͖2B
+struct SilenceCase
+{
+	const char *name;
+	bool lfe;
+	bool back;
+	bool all;
+};
+
+static const SilenceCase kSilenceCases[] =
+{
+	{"none", false, false, false},
+	{"lfe", true, false, false},
+	{"lfe+back", true, true, false},
+	{"all", false, false, true}
+};
+
+static const char *const kSilenceLayouts[] = {"5.1", "7.1", "7.1.4"};
+
+static const char *kSimdLevelNames[] = {"scalar", "sse2", "avx2", "avx512"};
+
+// ʂ̌v@BkFused ͓]֐ŁAkPostPass ͓] measure_levels_ ŏo͂ǂݒČvB
+// kLoudness  kFused ɉāALevelMeter  K ̃tB^ʂB
+enum class Metering
+{
+	kOff,
+	kFused,
+	kPostPass,
+	kLoudness
+};
+
+// v̎Ԃv`l\
+static const char *const kMeterLayouts[] = {"2.0", "5.1", "7.1", "7.1.4"};
+
+// vl̏ƍɎg`lƃt[ (SIMD ̒[c悤)
+static const unsigned kCheckChannels[] = {1, 2, 3, 4, 6, 8, 12, 17};
+static constexpr size_t kCheckFrames = 1021;
+
+// EBU Tech 3341 ̐g (1kHzA-23dBFS ̃XeI) ƁAEhlX̋e덷
+static constexpr double kReferenceFrequency = 1000.0;
+static constexpr double kReferenceLoudness = -23.0;
+static constexpr double kLoudnessTolerance = 0.1;
+
+// ]֐ł̌v (peakERMS) ɂ鑝̏ƁAvȂꍇƌ݂Ɍv񐔁EꍇɌv蒼񐔁B
+// ڕW kMeterBudget (10%) AĂ̂ AVX-512  kMeterBudgetChannels ȉ̃`l̏ꍇŁA
+// AVX2 ƁA7.1.4 ̂悤Ƀ`l̑ AVX-512 ł 10`30% x邱ƂB͖ڕWɓ͂Ȃ̂ŁA
+// ލso邽߂ kMeterWideBudget Ŕ肵AڕW𒴂͎sɂ񍐂B
+static constexpr double kMeterBudget = 0.10;
+static constexpr double kMeterWideBudget = 0.35;
+static constexpr unsigned kMeterBudgetChannels = 8;
+static constexpr int kMeterRounds = 5;
+static constexpr int kMeterBudgetRetries = 3;
+
+// 1̌vœ]t[ (48kHz 1b)
+static constexpr size_t kTotalFrames = 48000;
+static constexpr int kRepeats = 5;
+
+// s|Ȃꍇ́Ao͖Ɋ^̓`l
+static void SetOutputSources(BenchSys *sys)
+{
+	sys->output_sources_.fill(0);
+
+	for (unsigned channel=0; channel<sys->output_channels_; ++channel)
+		sys->output_sources_[channel] = 1u << sys->channel_reorder_table_[channel];
+}
+
+// ͂ kTotalFrames ̃ubNɕăL[ɐς݁A`ɓ]鎞ԂvB
+// metering  kOff łȂ΁A`ɉʂv (kLoudness ̏ꍇ meter ɓn)B
+static double Measure(BenchSys *sys, std::vector<block_t>& blocks, std::vector<uint8_t>& input, const BlockPattern& pattern, unsigned period, std::vector<float>& output,
+	Metering metering = Metering::kOff, LevelMeter *meter = nullptr)
+{
+	float *planes[kMaxForwardChannels] {};
+	double best = 0.0;
+
+	for (unsigned channel=0; channel<sys->output_channels_; ++channel)
+		planes[channel] = output.data() + channel * period;
+
+	for (int repeat=0; repeat<kRepeats; ++repeat)
+	{
+		blocks.clear();
+
+		for (size_t frame=0; frame<kTotalFrames; frame += pattern.frames)
+		{
+			const unsigned frames = static_cast<unsigned>(std::min<size_t>(pattern.frames, kTotalFrames - frame));
+			uint8_t *p = input.data() + frame * sys->input_format_.i_bytes_per_frame;
+
+			blocks.push_back(block_t {p, frames * sys->input_format_.i_bytes_per_frame, frames});
+			if (pattern.zero_between)
+				blocks.push_back(block_t {p, 0, 0});
+		}
+
+		for (auto& block: blocks)
+			sys->audio_data_queue_.Push(QueuedBlock<block_t> {&block, ScanAudioDataBlock(sys, &block)});
+
+		sys->audio_data_frames_.store(kTotalFrames, std::memory_order_relaxed);
+
+		count_heap_operations.store(true, std::memory_order_relaxed);
+		const auto begin = std::chrono::steady_clock::now();
+
+		for (size_t frame=0; frame<kTotalFrames; frame += period)
+		{
+			const size_t frames = std::min<size_t>(period, kTotalFrames - frame);
+			const bool fused = (Metering::kFused == metering) || (Metering::kLoudness == metering);
+			float *buffers[kMaxForwardChannels];
+			ChannelLevels levels {};
+
+			std::copy(planes, planes + kMaxForwardChannels, buffers);
+			ForwardAudioData(buffers, sys, frames, nullptr, fused? &levels: nullptr);
+
+			if (Metering::kPostPass == metering)
+				sys->measure_levels_(planes, sys->output_channels_, frames, &levels);
+			if (Metering::kLoudness == metering)
+				meter->AddPeriod(levels, planes, frames);
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+		count_heap_operations.store(false, std::memory_order_relaxed);
+		const double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+
+		if ((0 == repeat) || (ns < best))
+			best = ns;
+
+		// Play() ɑ鑤ŁAԂꂽubN
+		while (block_t **front = sys->released_blocks_.Front())
+		{
+			block_Release(*front);
+			sys->released_blocks_.Pop();
+		}
+
+		while (sys->audio_data_queue_.Front())
+			sys->audio_data_queue_.Pop();
+	}
+
+	return best;
+}
+
+// VLC ̃`lϊ̂悤ɁAC^[[û܂܍s|Ĉꎞobt@ɏ
+static void MixInterleaved(float *dst, const float *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames)
+{
+	for (size_t frame=0; frame<frames; ++frame)
+	{
+		for (unsigned out=0; out<out_channels; ++out)
+		{
+			float sum = 0.0f;
+
+			for (unsigned in=0; in<in_channels; ++in)
+				sum += matrix[out * in_channels + in] * src[in];
+
+			dst[out] = sum;
+		}
+
+		src += in_channels;
+		dst += out_channels;
+	}
+}
+
+// s̓]Afused ^Ȃ MixFunction ŒځAUȂꎞobt@oRČvB1t[̎ԂԂB
+static double MeasureMix(const MixCase& mix_case, const std::vector<float>& input, const float *matrix, SimdLevel level, bool fused)
+{
+	const MixFunction mix = SelectMixFunction(level, SampleFormat::kFloat32);
+	const DeinterleaveFunction deinterleave = SelectDeinterleaveFunction(level, SampleFormat::kFloat32);
+	static constexpr std::array<uint8_t, kMaxForwardChannels> kIdentity = MakeIdentityReorder();
+	std::vector<float> intermediate(static_cast<size_t>(mix_case.out_channels) * kMixPeriodFrames);
+	std::vector<float> output(static_cast<size_t>(mix_case.out_channels) * kMixPeriodFrames);
+	float *buffers[kMaxForwardChannels] {};
+	double best = 0.0;
+
+	for (unsigned channel=0; channel<mix_case.out_channels; ++channel)
+		buffers[channel] = output.data() + channel * kMixPeriodFrames;
+
+	for (int repeat=0; repeat<kRepeats; ++repeat)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+
+		for (size_t frame=0; frame<kTotalFrames; frame += kMixPeriodFrames)
+		{
+			const size_t frames = std::min<size_t>(kMixPeriodFrames, kTotalFrames - frame);
+			const float *src = input.data() + frame * mix_case.in_channels;
+
+			if (fused)
+			{
+				mix(buffers, src, matrix, mix_case.in_channels, mix_case.out_channels, frames, nullptr, nullptr);
+			}
+			else
+			{
+				MixInterleaved(intermediate.data(), src, matrix, mix_case.in_channels, mix_case.out_channels, frames);
+				deinterleave(buffers, intermediate.data(), kIdentity.data(), mix_case.out_channels, frames, nullptr, nullptr);
+			}
+		}
+
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+		if ((0 == repeat) || (ns < best))
+			best = ns;
+	}
+
+	return best / kTotalFrames;
+}
+
+// Play() ŕϊăOɏԂƁA`ŃOʂԂvB1t[̎ԂԂB
+// O1b傫ĂAPlay() őSďĂ`őSēǂށB
+static std::pair<double, double> MeasureRing(BenchSys *sys, std::vector<uint8_t>& input, std::vector<float>& output)
+{
+	float *planes[kMaxForwardChannels] {};
+	double best_play = 0.0;
+	double best_stream = 0.0;
+
+	for (unsigned channel=0; channel<sys->output_channels_; ++channel)
+		planes[channel] = output.data() + channel * kRingPeriodFrames;
+
+	for (int repeat=0; repeat<kRepeats; ++repeat)
+	{
+		sys->planar_ring_.Clear();
+		sys->audio_data_frames_.store(0, std::memory_order_relaxed);
+
+		count_heap_operations.store(true, std::memory_order_relaxed);
+		const auto begin = std::chrono::steady_clock::now();
+
+		for (size_t frame=0; frame<kTotalFrames; frame += kRingBlockFrames)
+		{
+			const unsigned frames = static_cast<unsigned>(std::min<size_t>(kRingBlockFrames, kTotalFrames - frame));
+			const block_t block {input.data() + frame * sys->input_format_.i_bytes_per_frame, frames * sys->input_format_.i_bytes_per_frame, frames};
+
+			ConvertAudioDataBlock(sys, &block, ScanAudioDataBlock(sys, &block), []() { return true; });
+		}
+
+		const auto middle = std::chrono::steady_clock::now();
+
+		for (size_t frame=0; frame<kTotalFrames; frame += kRingPeriodFrames)
+		{
+			float *buffers[kMaxForwardChannels];
+
+			std::copy(planes, planes + kMaxForwardChannels, buffers);
+			ForwardPlanarData(buffers, sys, std::min<size_t>(kRingPeriodFrames, kTotalFrames - frame), nullptr);
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+		count_heap_operations.store(false, std::memory_order_relaxed);
+
+		const double play = std::chrono::duration<double, std::nano>(middle - begin).count();
+		const double stream = std::chrono::duration<double, std::nano>(end - middle).count();
+
+		if ((0 == repeat) || (play < best_play))
+			best_play = play;
+		if ((0 == repeat) || (stream < best_stream))
+			best_stream = stream;
+	}
+
+	return std::make_pair(best_play / kTotalFrames, best_stream / kTotalFrames);
+}
+
+// levels A܂ꂽ dst Ōv蒼lƍ𒲂ׂB
+// s[N͓l̐ΒlȂ̂ňvAa͐ώZ̏ɂ덷B
+static bool CompareLevels(const ChannelLevels& levels, float *const *dst, unsigned channels, size_t frames)
+{
+	ChannelLevels expected {};
+	MeasureLevelsScalar(dst, channels, frames, &expected);
+
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		if (levels.peak[channel] != expected.peak[channel])
+			return false;
+		if (std::fabs(levels.energy[channel] - expected.energy[channel]) > expected.energy[channel] * 1.0e-5)
+			return false;
+	}
+
+	return true;
+}
+
+// e߃ZbgE͌`E`l̓]֐ƍs̓]Ap̓]֐߂vlƍB
+// o 1  nullptr ɂāA܂Ȃ`lvlɍȂƂm߂BȂԂB
+static int CheckLevels(SimdLevel top_level, std::mt19937& random)
+{
+	static constexpr std::array<uint8_t, kMaxForwardChannels> kIdentity = MakeIdentityReorder();
+	static constexpr unsigned kMixInputChannels = 3;
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> gain_distribution(0.0f, 1.0f);
+	std::vector<uint8_t> input;
+	std::vector<float> gain(kCheckFrames);
+	std::vector<float> matrix(kMaxForwardChannels * kMixInputChannels);
+	std::vector<float> output(kMaxForwardChannels * kCheckFrames);
+	int failures = 0;
+
+	for (auto& value: gain)
+		value = gain_distribution(random);
+	for (auto& value: matrix)
+		value = distribution(random);
+
+	auto check = [&](const char *kind, const char *name, const char *format, unsigned channels, auto forward)
+	{
+		float *dst[kMaxForwardChannels] {};
+
+		for (unsigned channel=0; channel<channels; ++channel)
+			dst[channel] = (1 == channel)? nullptr: output.data() + channel * kCheckFrames;
+
+		for (const float *g: {static_cast<const float *>(nullptr), static_cast<const float *>(gain.data())})
+		{
+			ChannelLevels levels {};
+
+			forward(dst, g, &levels);
+			if (!CompareLevels(levels, dst, channels, kCheckFrames) || (levels.peak[1] != 0.0f) || (levels.energy[1] != 0.0))
+			{
+				printf("levels mismatch: %s %s %s %u channels%s\n", kind, name, format, channels, g? " with gain": "");
+				++failures;
+			}
+		}
+	};
+
+	for (const auto& format: kFormats)
+	{
+		// ͂͗LȒlɂĂ
+		input.assign(kCheckFrames * kMaxForwardChannels * format.sample_bytes, 0);
+		if (SampleFormat::kFloat32 == format.format)
+		{
+			for (size_t i=0; i<kCheckFrames * kMaxForwardChannels; ++i)
+			{
+				const float value = distribution(random);
+				memcpy(input.data() + i * 4, &value, 4);
+			}
+		}
+		else
+		{
+			for (auto& byte: input)
+				byte = static_cast<uint8_t>(random());
+		}
+
+		for (int level=0; level<=static_cast<int>(top_level); ++level)
+		{
+			const DeinterleaveFunction deinterleave = SelectDeinterleaveFunction(static_cast<SimdLevel>(level), format.format);
+			const MixFunction mix = SelectMixFunction(static_cast<SimdLevel>(level), format.format);
+
+			for (unsigned channels: kCheckChannels)
+			{
+				check("deinterleave", kSimdLevelNames[level], format.name, channels, [&](float *const *dst, const float *g, ChannelLevels *levels)
+				{
+					deinterleave(dst, input.data(), kIdentity.data(), channels, kCheckFrames, g, levels);
+				});
+
+				check("mix", kSimdLevelNames[level], format.name, channels, [&](float *const *dst, const float *g, ChannelLevels *levels)
+				{
+					mix(dst, input.data(), matrix.data(), kMixInputChannels, channels, kCheckFrames, g, levels);
+				});
+			}
+		}
+
+		if (SampleFormat::kFloat32 != format.format)
+			continue;
+
+		for (const auto& layout: kLayouts)
+		{
+			check("layout", layout.name, format.name, layout.channels, [&](float *const *dst, const float *g, ChannelLevels *levels)
+			{
+				layout.layout_function(dst, input.data(), layout.reorder.data(), layout.channels, kCheckFrames, g, levels);
+			});
+		}
+	}
+
+	return failures;
+}
+
+// EBU Tech 3341 ̐g` LevelMeter ɓnAEhlXƃs[NERMS _lɂȂ邩𒲂ׂB
+// V[g^[̑ߓň̒lŖ܂悤A4bnB
+static bool CheckLoudness(unsigned rate)
+{
+	const uint32_t objects = ObjectBit(ObjectChannel::kFrontLeft)| ObjectBit(ObjectChannel::kFrontRight);
+	const double amplitude = std::pow(10.0, kReferenceLoudness / 20.0);
+	const size_t period = rate / 100;
+	const MeasureLevelsFunction measure_levels = SelectMeasureLevelsFunction(DetectSimdLevel());
+	std::vector<float> plane(period);
+	LevelMeter meter;
+
+	meter.Reset(objects, rate, true);
+
+	for (size_t frame=0; frame<static_cast<size_t>(rate) * 4; frame += period)
+	{
+		for (size_t n=0; n<period; ++n)
+			plane[n] = static_cast<float>(amplitude * std::sin(2.0 * 3.14159265358979323846 * kReferenceFrequency * (frame + n) / rate));
+
+		const float *planes[] = {plane.data(), plane.data()};
+		ChannelLevels levels {};
+
+		measure_levels(planes, 2, period, &levels);
+		meter.AddPeriod(levels, planes, period);
+	}
+
+	const LevelMeter::Snapshot snapshot = meter.Load();
+	printf("%-11s %-10u %10.2f %10.2f %10.4f %10.4f\n", "sine", rate, snapshot.momentary, snapshot.short_term, snapshot.peak[0], snapshot.rms[0]);
+
+	return (std::fabs(snapshot.momentary - kReferenceLoudness) <= kLoudnessTolerance)
+		&& (std::fabs(snapshot.short_term - kReferenceLoudness) <= kLoudnessTolerance)
+		&& (std::fabs(snapshot.peak[0] - amplitude) <= amplitude * 1.0e-3)
+		&& (std::fabs(snapshot.rms[0] - amplitude / std::sqrt(2.0)) <= amplitude * 1.0e-3);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filter = (argc > 1)? argv[1]: nullptr;
+	const SimdLevel top_level = DetectSimdLevel();
+	std::vector<block_t> blocks;
+	std::vector<uint8_t> input;
+	std::vector<float> output;
+	std::mt19937 random;
+	BenchSys sys;
+
+	sys.measure_levels_ = SelectMeasureLevelsFunction(top_level);
+	blocks.reserve(kTotalFrames * 2);
+	printf("%-11s %-10s %-5s %-6s %6s %10s %8s\n", "layout", "kernel", "input", "block", "period", "ns/frame", "GB/s");
+
+	for (const auto& layout: kLayouts)
+	{
+		if (filter && !strstr(layout.name, filter))
+			continue;
+
+		const unsigned channels = layout.channels;
+
+		for (const auto& format: kFormats)
+		{
+			// ͂͗LȒlɂĂ (float ̔񐳋KȂǂŒxȂȂ悤)
+			input.assign(kTotalFrames * channels * format.sample_bytes, 0);
+			if (SampleFormat::kFloat32 == format.format)
+			{
+				std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+				for (size_t i=0; i<kTotalFrames * channels; ++i)
+				{
+					const float value = distribution(random);
+					memcpy(input.data() + i * 4, &value, 4);
+				}
+			}
+			else
+			{
+				for (auto& byte: input)
+					byte = static_cast<uint8_t>(random());
+			}
+
+			// ėp̓]֐ scalar ƁA CPU ̍ŏʂ̖߃ZbgBfloat ͂ł͐p̓]֐vB
+			std::vector<std::pair<const char *, DeinterleaveFunction>> kernels;
+			kernels.emplace_back(kSimdLevelNames[0], SelectDeinterleaveFunction(SimdLevel::kScalar, format.format));
+			if (SimdLevel::kScalar != top_level)
+				kernels.emplace_back(kSimdLevelNames[static_cast<int>(top_level)], SelectDeinterleaveFunction(top_level, format.format));
+			if (SampleFormat::kFloat32 == format.format)
+				kernels.emplace_back("layout", layout.layout_function);
+
+			sys.input_format_.i_channels = static_cast<uint8_t>(channels);
+			sys.input_format_.i_bytes_per_frame = channels * format.sample_bytes;
+			sys.output_channels_ = static_cast<uint8_t>(channels);
+			sys.channel_reorder_table_ = layout.reorder;
+			sys.mix_ = nullptr;
+			sys.scan_silence_ = SelectScanSilenceFunction(top_level, format.format);
+			SetOutputSources(&sys);
+
+			for (const auto& kernel: kernels)
+			{
+				sys.deinterleave_ = kernel.second;
+
+				for (const auto& pattern: kBlockPatterns)
+				{
+					for (unsigned period: kPeriodFrames)
+					{
+						output.assign(static_cast<size_t>(channels) * period, 0.0f);
+
+						const double ns = Measure(&sys, blocks, input, pattern, period, output);
+						const double bytes = static_cast<double>(kTotalFrames) * channels * (format.sample_bytes + sizeof (float));
+
+						printf("%-11s %-10s %-5s %-6s %6u %10.3f %8.2f\n", layout.name, kernel.first, format.name, pattern.name, period, ns / kTotalFrames, bytes / ns);
+					}
+				}
+			}
+		}
+	}
+
+	printf("\n%-11s %-10s %10s %10s\n", "mix", "kernel", "fused", "two-pass");
+
+	for (const auto& mix_case: kMixCases)
+	{
+		if (filter && !strstr(mix_case.name, filter))
+			continue;
+
+		std::vector<float> input(kTotalFrames * mix_case.in_channels);
+		std::vector<float> matrix(mix_case.out_channels * mix_case.in_channels);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		for (auto& value: input)
+			value = distribution(random);
+		for (auto& value: matrix)
+			value = distribution(random);
+
+		for (SimdLevel level: {SimdLevel::kScalar, top_level})
+		{
+			printf("%-11s %-10s %10.3f %10.3f\n", mix_case.name, kSimdLevelNames[static_cast<int>(level)],
+				MeasureMix(mix_case, input, matrix.data(), level, true), MeasureMix(mix_case, input, matrix.data(), level, false));
+
+			if (SimdLevel::kScalar == top_level)
+				break;
+		}
+	}
+
+	// O float ݂̂ŌvB̓͂ł Play() ̎Ԃϊ̕A`͕ςȂB
+	printf("\n%-11s %-10s %10s %10s\n", "ring", "kernel", "play", "stream");
+
+	for (const auto& layout: kLayouts)
+	{
+		if (filter && !strstr(layout.name, filter))
+			continue;
+
+		const unsigned channels = layout.channels;
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		input.assign(kTotalFrames * channels * sizeof (float), 0);
+		for (size_t i=0; i<kTotalFrames * channels; ++i)
+		{
+			const float value = distribution(random);
+			memcpy(input.data() + i * 4, &value, 4);
+		}
+
+		sys.input_format_.i_channels = static_cast<uint8_t>(channels);
+		sys.input_format_.i_bytes_per_frame = channels * sizeof (float);
+		sys.output_channels_ = static_cast<uint8_t>(channels);
+		sys.channel_reorder_table_ = layout.reorder;
+		sys.deinterleave_ = layout.layout_function;
+		sys.mix_ = nullptr;
+		sys.scan_silence_ = SelectScanSilenceFunction(top_level, SampleFormat::kFloat32);
+		SetOutputSources(&sys);
+		sys.planar_ring_.Reset(channels, kTotalFrames + kRingBlockFrames);
+		output.assign(static_cast<size_t>(channels) * kRingPeriodFrames, 0.0f);
+
+		const std::pair<double, double> ns = MeasureRing(&sys, input, output);
+
+		printf("%-11s %-10s %10.3f %10.3f\n", layout.name, "layout", ns.first, ns.second);
+	}
+
+	// ̏o͂͌oɉ 0 Ŗ߂镪̂ŁASĉꍇƂ̍]ŏȂԂɂȂ
+	printf("\n%-11s %-10s %10s %10s\n", "silence", "outputs", "scan", "forward");
+
+	for (const char *layout_name: kSilenceLayouts)
+	{
+		if (filter && !strstr(layout_name, filter))
+			continue;
+
+		const Layout& layout = *std::find_if(std::begin(kLayouts), std::end(kLayouts), [layout_name](const Layout& l) { return 0 == strcmp(l.name, layout_name); });
+		const unsigned channels = layout.channels;
+		const BlockPattern pattern {"1024", kRingBlockFrames, false};
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		sys.input_format_.i_channels = static_cast<uint8_t>(channels);
+		sys.input_format_.i_bytes_per_frame = channels * sizeof (float);
+		sys.output_channels_ = static_cast<uint8_t>(channels);
+		sys.channel_reorder_table_ = layout.reorder;
+		sys.deinterleave_ = layout.layout_function;
+		sys.mix_ = nullptr;
+		sys.scan_silence_ = SelectScanSilenceFunction(top_level, SampleFormat::kFloat32);
+		SetOutputSources(&sys);
+		output.assign(static_cast<size_t>(channels) * kRingPeriodFrames, 0.0f);
+
+		for (const auto& silence: kSilenceCases)
+		{
+			uint32_t silent_outputs = silence.all? (1u << channels) - 1: 0;
+			if (silence.lfe)
+				silent_outputs |= 1u << 3;
+			if (silence.back)
+				silent_outputs |= 3u << (channels - 2);
+
+			input.assign(kTotalFrames * channels * sizeof (float), 0);
+			for (size_t frame=0; frame<kTotalFrames; ++frame)
+			{
+				for (unsigned channel=0; channel<channels; ++channel)
+				{
+					if (silent_outputs & (1u << channel))
+						continue;
+
+					const float value = distribution(random);
+					memcpy(input.data() + (frame * channels + layout.reorder[channel]) * 4, &value, 4);
+				}
+			}
+
+			double best_scan = 0.0;
+
+			for (int repeat=0; repeat<kRepeats; ++repeat)
+			{
+				uint32_t active = 0;
+				const auto begin = std::chrono::steady_clock::now();
+
+				for (size_t frame=0; frame<kTotalFrames; frame += kRingBlockFrames)
+				{
+					const unsigned frames = static_cast<unsigned>(std::min<size_t>(kRingBlockFrames, kTotalFrames - frame));
+					const block_t block {input.data() + frame * sys.input_format_.i_bytes_per_frame, frames * sys.input_format_.i_bytes_per_frame, frames};
+
+					active |= ScanAudioDataBlock(&sys, &block);
+				}
+
+				const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+				if (active & silent_outputs)
+					printf("silence not detected: %s %s\n", layout.name, silence.name);
+				if ((0 == repeat) || (ns < best_scan))
+					best_scan = ns;
+			}
+
+			const double forward = Measure(&sys, blocks, input, pattern, kRingPeriodFrames, output);
+
+			printf("%-11s %-10s %10.3f %10.3f\n", layout.name, silence.name, best_scan / kTotalFrames, forward / kTotalFrames);
+		}
+	}
+
+	// vl͕` 0 ɂ ChannelLevels ɐώZBloudness  LevelMeter ɓn K ̃tB^ʂ܂ł܂߂B
+	// ėp̓]֐͂ CPU ŎgSĂ̖߃ZbgŌvAoff  fused ͓]֐Ōv̗LςB
+	// selected  Start() IԑgŁASIMD g CPU ł͍ŏʂ̖߃Zbg̍sƓ]֐ɂȂB
+	// SIMD gȂ CPU łAvȂꍇ͐p̓]֐ɂȂ (p̓]֐͐ώZlWX^ɒuȂ̂ŁAvƂ͎gȂ)B
+	// ώZlWX^ɒuČv AVX2EAVX-512 ̍s𔻒肵AkMeterBudget 𒴂ꍇ͖ڕWɓ͂ȂƂ񍐂A
+	// ̍s̏ (AVX-512  kMeterBudgetChannels ȉȂ kMeterBudgetAȊO kMeterWideBudget) 𒴂ΎsƂB
+	// SSE2 ܂ł͏񂾏o͂ǂݒ̂ŁA͎Qlɏo͂邾ɂB
+	printf("\n%-11s %-10s %10s %10s %7s %10s %7s %10s %7s\n", "meter", "kernel", "off", "fused", "+%", "post-pass", "+%", "loudness", "+%");
+	int over_budget = 0;
+
+	for (const char *layout_name: kMeterLayouts)
+	{
+		if (filter && !strstr(layout_name, filter))
+			continue;
+
+		const Layout& layout = *std::find_if(std::begin(kLayouts), std::end(kLayouts), [layout_name](const Layout& l) { return 0 == strcmp(l.name, layout_name); });
+		const unsigned channels = layout.channels;
+		const BlockPattern pattern {"1024", kRingBlockFrames, false};
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		LevelMeter meter;
+
+		input.assign(kTotalFrames * channels * sizeof (float), 0);
+		for (size_t i=0; i<kTotalFrames * channels; ++i)
+		{
+			const float value = distribution(random);
+			memcpy(input.data() + i * 4, &value, 4);
+		}
+
+		sys.input_format_.i_channels = static_cast<uint8_t>(channels);
+		sys.input_format_.i_bytes_per_frame = channels * sizeof (float);
+		sys.output_channels_ = static_cast<uint8_t>(channels);
+		sys.channel_reorder_table_ = layout.reorder;
+		sys.mix_ = nullptr;
+		sys.scan_silence_ = SelectScanSilenceFunction(top_level, SampleFormat::kFloat32);
+		SetOutputSources(&sys);
+		output.assign(static_cast<size_t>(channels) * kRingPeriodFrames, 0.0f);
+
+		// vȂꍇƌvꍇ̓]֐Bbudget  0 łȂ fused ̑̒lƔׂB
+		struct MeterKernel
+		{
+			const char *name;
+			DeinterleaveFunction off;
+			DeinterleaveFunction metered;
+			double budget;
+		};
+
+		std::vector<MeterKernel> kernels;
+		for (int level=0; level<=static_cast<int>(top_level); ++level)
+		{
+			const SimdLevel simd_level = static_cast<SimdLevel>(level);
+			const DeinterleaveFunction function = SelectDeinterleaveFunction(simd_level, SampleFormat::kFloat32);
+			const double budget = (simd_level < SimdLevel::kAvx2)? 0.0:
+				((SimdLevel::kAvx512 == simd_level) && (channels <= kMeterBudgetChannels))? kMeterBudget: kMeterWideBudget;
+
+			kernels.push_back({kSimdLevelNames[level], function, function, budget});
+		}
+
+		const DeinterleaveFunction selected = SelectDeinterleaveFunction(top_level, SampleFormat::kFloat32);
+		kernels.push_back({"selected", (SimdLevel::kScalar == top_level)? layout.layout_function: selected, selected, 0.0});
+
+		for (const auto& kernel: kernels)
+		{
+			auto measure = [&](Metering metering, LevelMeter *level_meter = nullptr)
+			{
+				sys.deinterleave_ = (Metering::kOff == metering)? kernel.off: kernel.metered;
+				return Measure(&sys, blocks, input, pattern, kRingPeriodFrames, output, metering, level_meter) / kTotalFrames;
+			};
+
+			meter.Reset((1u << channels) - 1, 48000, true);
+
+			// ͐ % ŁAČvƐɌvLbVg̗h炬ŕsɂȂB
+			// off  fused ݂ɌvĂꂼ̍ŏAꍇ͍XɌv蒼ėh炬ɂ鎸sB
+			double off = measure(Metering::kOff);
+			double fused = measure(Metering::kFused);
+
+			for (int round=1; round<kMeterRounds + ((0.0 < kernel.budget)? kMeterBudgetRetries: 0); ++round)
+			{
+				if ((round >= kMeterRounds) && (fused <= off * (1.0 + kMeterBudget)))
+					break;
+
+				off = std::min(off, measure(Metering::kOff));
+				fused = std::min(fused, measure(Metering::kFused));
+			}
+
+			const double post_pass = measure(Metering::kPostPass);
+			const double loudness = measure(Metering::kLoudness, &meter);
+
+			printf("%-11s %-10s %10.3f %10.3f %7.1f %10.3f %7.1f %10.3f %7.1f\n", layout.name, kernel.name,
+				off, fused, (fused / off - 1.0) * 100.0, post_pass, (post_pass / off - 1.0) * 100.0, loudness, (loudness / off - 1.0) * 100.0);
+
+			if ((0.0 < kernel.budget) && (fused > off * (1.0 + kernel.budget)))
+			{
+				printf("  fused metering exceeds the %.0f%% budget: %s %s\n", kernel.budget * 100.0, layout.name, kernel.name);
+				++over_budget;
+			}
+			else if ((0.0 < kernel.budget) && (fused > off * (1.0 + kMeterBudget)))
+				printf("  fused metering misses the %.0f%% target: %s %s\n", kMeterBudget * 100.0, layout.name, kernel.name);
+		}
+	}
+
+	printf("\n%-11s %-10s %10s %10s %10s %10s\n", "loudness", "rate", "momentary", "short-term", "peak", "rms");
+
+	bool levels_matched = (0 == CheckLevels(top_level, random));
+	for (unsigned rate: {44100u, 48000u})
+	{
+		if (!CheckLoudness(rate))
+		{
+			printf("loudness out of tolerance at %uHz\n", rate);
+			levels_matched = false;
+		}
+	}
+
+	const uint64_t operations = heap_operations.load(std::memory_order_relaxed);
+	if (operations)
+	{
+		printf("heap operations while forwarding: %llu\n", static_cast<unsigned long long>(operations));
+		return 1;
+	}
+
+	if (over_budget)
+	{
+		printf("%d kernel(s) exceed the metering budget\n", over_budget);
+		return 1;
+	}
+
+	return levels_matched? 0: 1;
+}
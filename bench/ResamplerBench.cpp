@@ -0,0 +1,219 @@
+// ̃TvO[gϊ (Resampler) ̃}CNx`}[NB
+// Windows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -Isrc bench/ResamplerBench.cpp src/Resampler.cpp src/ForwardKernels.cpp -o resampler_bench
+//   ./resampler_bench [ïꕔ]
+//
+// iE[g̑gE`lE߃ZbgɁA] (ւ float ւ̕ϊ) ƕϊ킹
+// 1o̓t[̎ԂAϊȂ]̏ꍇƕׂďo͂B
+// level ͓]֐̖߃ZbgAkernel ͕ϊɎۂɎg֐̖߃Zbg (AVX-512 łϊ AVX2 ̊֐g)B
+// iɁA1kHz ̐gϊƂ̐MΎGo͂B
+
+#include "ForwardKernels.h"
+#include "ForwardLayouts.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Quality
+{
+	const char *name;
+	ResamplerQuality quality;
+};
+
+static const Quality kQualities[] =
+{
+	{"low-latency", ResamplerQuality::kLowLatency},
+	{"balanced", ResamplerQuality::kBalanced},
+	{"high", ResamplerQuality::kHigh}
+};
+
+struct Rates
+{
+	unsigned input;
+	unsigned output;
+};
+
+static const Rates kRates[] =
+{
+	{44100, 48000},
+	{48000, 96000}
+};
+
+static const unsigned kChannels[] = {2, 6, 8, 12, 16};
+
+static const char *kSimdLevelNames[] = {"scalar", "sse2", "avx2", "avx512"};
+
+// 1̌vōo͂ 1bA` 10ms
+static constexpr int kRepeats = 5;
+static constexpr unsigned kPeriodMilliseconds = 10;
+
+// ϊɓ͂]ďo͂B͂ float ̃C^[[uŁA`ɕKvȕ]B
+// o̓t[ԂB
+static size_t Run(Resampler *resampler, DeinterleaveFunction deinterleave, const uint8_t *reorder, const std::vector<float>& input, unsigned channels, unsigned period, size_t output_frames, std::vector<float> *output)
+{
+	std::vector<float> planes_storage(static_cast<size_t>(channels) * period);
+	size_t read = 0;
+	size_t written = 0;
+
+	while (written < output_frames)
+	{
+		const size_t frames = std::min<size_t>(period, output_frames - written);
+		const size_t input_frames = std::min(resampler->RequiredInputFrames(frames), input.size() / channels - read);
+		float *planes[kMaxForwardChannels];
+		float *buffers[kMaxForwardChannels] {};
+
+		resampler->InputPlanes(planes);
+		deinterleave(planes, input.data() + read * channels, reorder, channels, input_frames, nullptr, nullptr);
+		resampler->CommitInput(input_frames);
+		read += input_frames;
+
+		const size_t available = resampler->AvailableOutputFrames(frames);
+		if (!available)
+			break;
+
+		for (unsigned channel=0; channel<channels; ++channel)
+			buffers[channel] = output? output->data() + channel * output_frames + written: planes_storage.data() + channel * period;
+
+		resampler->Process(buffers, available, nullptr);
+		written += available;
+	}
+
+	return written;
+}
+
+// ϊȂꍇ̓]̎
+static double MeasureForward(DeinterleaveFunction deinterleave, const uint8_t *reorder, const std::vector<float>& input, unsigned channels, unsigned period, size_t frames)
+{
+	std::vector<float> output(static_cast<size_t>(channels) * period);
+	double best = 0.0;
+
+	for (int repeat=0; repeat<kRepeats; ++repeat)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+
+		for (size_t frame=0; frame<frames; frame += period)
+		{
+			float *buffers[kMaxForwardChannels] {};
+
+			for (unsigned channel=0; channel<channels; ++channel)
+				buffers[channel] = output.data() + channel * period;
+
+			deinterleave(buffers, input.data() + frame * channels, reorder, channels, std::min<size_t>(period, frames - frame), nullptr, nullptr);
+		}
+
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+		if ((0 == repeat) || (ns < best))
+			best = ns;
+	}
+
+	return best / frames;
+}
+
+// 1kHz ̐gϊAz̏o͂Ƃ̍MΎG (dB) ߂Bオ̕͏B
+static double MeasureSnr(ResamplerQuality quality, const Rates& rates)
+{
+	const double frequency = 1000.0;
+	std::vector<float> input(rates.input);
+	std::vector<float> output(rates.output);
+	Resampler resampler;
+
+	for (size_t i=0; i<input.size(); ++i)
+		input[i] = static_cast<float>(0.5 * std::sin(2.0 * 3.14159265358979323846 * frequency * i / rates.input));
+
+	static constexpr std::array<uint8_t, kMaxForwardChannels> kIdentity = MakeIdentityReorder();
+
+	resampler.Reset(rates.input, rates.output, 1, quality, DetectSimdLevel(), rates.output / 100);
+	const size_t written = Run(&resampler, SelectDeinterleaveFunction(SimdLevel::kScalar, SampleFormat::kFloat32), kIdentity.data(), input, 1, rates.output / 100, output.size(), &output);
+
+	double signal = 0.0;
+	double noise = 0.0;
+
+	for (size_t i=rates.output / 10; i<written - resampler.Taps() * 4; ++i)
+	{
+		const double expected = 0.5 * std::sin(2.0 * 3.14159265358979323846 * frequency * i / rates.output);
+
+		signal += expected * expected;
+		noise += (output[i] - expected) * (output[i] - expected);
+	}
+
+	return 10.0 * std::log10(signal / noise);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filter = (argc > 1)? argv[1]: nullptr;
+	const SimdLevel top_level = DetectSimdLevel();
+	std::mt19937 random;
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<SimdLevel> levels {SimdLevel::kScalar};
+	Resampler resampler;
+
+	if (SimdLevel::kScalar != top_level)
+		levels.push_back(top_level);
+
+	static constexpr std::array<uint8_t, kMaxForwardChannels> kReorder = MakeIdentityReorder();
+
+	printf("%-11s %-11s %3s %-7s %-7s %4s %12s %12s %8s\n", "quality", "rates", "ch", "level", "kernel", "taps", "ns/frame", "forward", "SNR(dB)");
+
+	for (const auto& quality: kQualities)
+	{
+		if (filter && !strstr(quality.name, filter))
+			continue;
+
+		for (const auto& rates: kRates)
+		{
+			const double snr = MeasureSnr(quality.quality, rates);
+			const unsigned period = rates.output * kPeriodMilliseconds / 1000;
+			char rates_name[24];
+
+			snprintf(rates_name, sizeof (rates_name), "%u>%u", rates.input / 100, rates.output / 100);
+
+			for (unsigned channels: kChannels)
+			{
+				// o1bɁAϊ킪ǂ݂镪̗]TB]̏ꍇ͏o͂Ɠt[ǂށB
+				const size_t input_frames = std::max(rates.input, rates.output) * 11 / 10;
+				std::vector<float> input(input_frames * channels);
+
+				for (auto& value: input)
+					value = distribution(random);
+
+				for (SimdLevel level: levels)
+				{
+					const DeinterleaveFunction deinterleave = SelectDeinterleaveFunction(level, SampleFormat::kFloat32);
+					double best = 0.0;
+
+					resampler.Reset(rates.input, rates.output, channels, quality.quality, level, period);
+
+					for (int repeat=0; repeat<kRepeats; ++repeat)
+					{
+						resampler.Clear();
+
+						const auto begin = std::chrono::steady_clock::now();
+						Run(&resampler, deinterleave, kReorder.data(), input, channels, period, rates.output, nullptr);
+						const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+						if ((0 == repeat) || (ns < best))
+							best = ns;
+					}
+
+					const double forward = MeasureForward(deinterleave, kReorder.data(), input, channels, period, rates.output);
+
+					printf("%-11s %-11s %3u %-7s %-7s %4u %12.3f %12.3f %8.1f\n", quality.name, rates_name, channels, kSimdLevelNames[static_cast<int>(level)],
+						kSimdLevelNames[static_cast<int>(resampler.KernelLevel())], resampler.Taps(), best / rates.output, forward, snr);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
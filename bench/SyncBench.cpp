@@ -0,0 +1,913 @@
+// TimeGet() ԂfBC̐x̃x`}[NB
+// Windows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc -Itest/vlc bench/SyncBench.cpp src/AudioProcessThread.cpp src/SimulatedBackend.cpp src/PortableWin32.cpp src/VirtualAudioDevice.cpp src/ClockModel.cpp src/PrebufferController.cpp src/Resampler.cpp src/TimeStretcher.cpp src/ForwardKernels.cpp src/LevelMeter.cpp src/TraceRecorder.cpp -o sync_bench
+//   ./sync_bench [ViÏꕔ]
+//
+// I[fBIXbh̏ (AudioProcessSteps) ̂܂܎gAo͐ VirtualAudioDevice ̉zvœ RenderBackend ɂāA
+// `̒ʒmER}h̒ʒmE҂̎Ԑ؂z̏ɂ̃Xbhi߂BVLC Ɠ StartEPlayETimeGetEPauseEFlush ĂԁB
+// Play() ̓x mss.cpp  TimeGet() Ɠ GetDelay() ĂсÃubN̐擪ۂɍĐꂽfoCẌʒu狁߂^̃fBCƔׂB
+// N̗h炬EfoCX̎v̂E̒̕ϓEGetPosition ̗h炬̑g (ViI) ɁA
+// fBČ덷̕SʐƁAtbVEĊJ̌Ɍ덷e͈͂Ɏ܂܂ł̎Ԃo͂B
+// āAtbV̗ Fast Flush ̗LEœAĐ̃tbVɂ Flush() ߂܂ŁEtbVOɃfoCX֓nς݂̉
+// I܂ŁEtbV̍ŏ̃ubNn߂܂ł̎Ԃo͂BFast Flush ł̓Xg[~߂Anς݂̎𖳉ɂ̂ŁA
+// Đ̎̎c͖߂BFast Flush gȂꍇ́AZbg̍ĊJ kReactivationTime ̂ƂB
+// ͎ԂƊ֌WȂiނ̂Ŏs͒ZԂŏIAȂ猋ʂɂȂB
+// ԂƑŜ̌덷܂ł̎ԂViȈ𒴂Ă΁AŌɕ񍐂 1 Ԃ (sœ̗򉻂o邽)B
+
+#include "AudioProcessThread.h"
+#include "ClockModel.h"
+#include "VirtualAudioDevice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <random>
+#include <vector>
+
+struct Scenario
+{
+	const char *name;
+	unsigned period_frames;		// 1̃t[ (ő)
+	double period_variation;	// Ƀt[炷ő̊
+	double jitter;				// N̒x̕W΍ (b)
+	double drift_ppm;			// foCX̎v̐i
+	double position_noise;		// GetPosition  qpc_position ̗h炬̕W΍ (b)
+	unsigned block_frames;		// Play() ɓ͂ubÑt[
+	double arrival_jitter;		// ubN̓̒x̕W΍ (b)
+	double max_steady_p99;		// Ԃ̌덷̐Βl 99 Sʐ̏ (}CNb)
+	double max_settle;			// tbVEĊJ܂ł̎Ԃ̏ (b)
+	double max_p99;				// Ŝ̌덷̐Βl 99 Sʐ̏ (}CNb)
+	double max_error;			// Ŝ̌덷̐Βl̍ő̏ (}CNb)
+};
+
+// Ŝ̌덷̑傫́Aꎞ~̃tbVEA_[̌ɐǂ݂̖ڕW܂ŗߒԂ̖⍇ł
+// (Đ̍ȃtbV̌1ߒȂ)Bǂݒ TimeGet() ̓L[̎ۂ̐[ԂA
+// ڕW܂܂łɖ߂閳́A܂ĂfBCɕ\B܂Ƃ߂ē͂ꍇ͖ڕWɗ܂̂Ō덷͏A
+// Ԃœ͂ꍇ͂̊ (őŐǂ݂̖ڕW̕) Z񍐂BVLC ̗͂ߒ TimeGet() ̕ωƂČč킹̂ŁA
+// ̌덷͎cAő傫B
+
+static const Scenario kScenarios[] =
+{
+	{"ideal",		480,	0.0,	0.0,		0.0,	0.0,		1024,	0.0,		100.0,	0.25,	5000.0,	30000.0},
+	{"jitter",		480,	0.0,	0.002,		0.0,	0.0,		1024,	0.004,		100.0,	0.25,	5000.0,	30000.0},
+	{"drift-fast",	480,	0.0,	0.0,		300.0,	0.0,		1024,	0.0,		150.0,	0.25,	5000.0,	30000.0},
+	{"drift-slow",	480,	0.0,	0.0,		-300.0,	0.0,		1024,	0.0,		150.0,	0.25,	5000.0,	30000.0},
+	{"variable",	1056,	0.5,	0.0005,		0.0,	0.0,		1152,	0.002,		100.0,	0.30,	5000.0,	30000.0},
+	{"noisy-clock",	480,	0.0,	0.0,		0.0,	0.0002,		1024,	0.0,		300.0,	0.25,	5000.0,	30000.0},
+	{"stress",		1056,	0.5,	0.002,		-300.0,	0.0002,		1152,	0.004,		400.0,	0.35,	5000.0,	30000.0},
+};
+
+static constexpr unsigned kRate = 48000;
+static constexpr unsigned kChannels = 2;
+static constexpr double kDuration = 120.0;
+
+// tbVEĊJ̌ VLC ɑĂ镪 (b)
+static constexpr double kLead = 0.1;
+
+// Ƃ݂Ȃ덷 (}CNb)
+static constexpr double kSettleTolerance = 1000.0;
+
+// JnEtbVEĊJ炱 (b) ̖⍇AԂ̌덷ƂĕʂɏWv
+static constexpr double kSteadyAfter = 0.5;
+
+static constexpr double kUnderrunProbability = 0.001;
+
+// Wait Timeout ̊l (~b)
+static constexpr DWORD kWaitTimeout = 10;
+
+// Play() ɓnubÑv[̏̐
+static constexpr unsigned kPoolBlocks = 64;
+
+// Xg[ZbgĂĊJ܂łɁAIuWFNg̗LƃGW̍ĎnŖȂ (b)B
+// @őlł͂ȂA\ms xƌ񂾂́BȃtbV͂𕥂ȂB
+static constexpr double kReactivationTime = 0.02;
+
+// QPC ɑ鎞̌_ (b)BGetPosition ̗h炬ŕɂȂȂ悤ɂ炷B
+static constexpr double kQpcOrigin = 10.0;
+
+enum class EventKind
+{
+	kStart,
+	kFlush,
+	kResume
+};
+
+// 덷WvԁBStartEtbVEĊJ̓xɎn܂B
+struct Window
+{
+	EventKind kind;
+	double begin;
+};
+
+struct Sample
+{
+	size_t window;
+	double time;
+	double error;		// 񍐂fBC - ^̃fBC (}CNb)
+	double delay;		// ^̃fBC (}CNb)
+};
+
+// Đ̃tbV̎ (b)BVLC  Flush() ĂłAI[fBIXbhKpĖ߂܂ (applied)A
+// tbVOɃfoCX֓nς݂̉I܂ (old_end)AtbV̍ŏ̃ubNn߂܂ (window ̍ŏ̖⍇)B
+struct FlushTiming
+{
+	double posted;
+	double applied;
+	double old_end;
+	size_t window;
+};
+
+// VLC Ă΂鑤ƁAI[fBIXbh̕`z̏ɓB
+// I[fBIXbh̏ AudioProcessSteps ̂܂܎gAo͐ɂ͉zœ VirtualBackend ^B
+class SyncHarness
+{
+public:
+	SyncHarness(const Scenario& scenario, uint32_t seed, bool fast_flush);
+	~SyncHarness();
+
+	void Run(double duration);
+
+	const std::vector<Window>& Windows() const { return windows_; }
+	const std::vector<Sample>& Samples() const { return samples_; }
+	const std::vector<FlushTiming>& Flushes() const { return flushes_; }
+	uint64_t Underruns() const { return sys_->underruns_.load(); }
+
+private:
+	// TimeGet() ̖⍇Bsample ͎ Play() t[̒ʂԍAplayed ͖⍇_̐^̍ĐʒuB
+	// offset ͓]ꂽ̐擪̈ʒuŁA̍Đn܂܂Ō܂ȂB
+	struct Query
+	{
+		size_t window;
+		double time;
+		int64_t sample;
+		double played;
+		int64_t reported;
+		int64_t offset;
+	};
+
+	struct Action
+	{
+		double time;
+		enum { kFlush, kPause, kResume } type;
+	};
+
+	// SimulatedBackend Ɠ VirtualAudioDevice o͐ƂČB͎Ԃł͂ȂAn[lX̉z now_ gB
+	// ̒ʒm̓Cxg̑Ƀn[lX̋N̗\ (wake_pending_) ɂB
+	class VirtualBackend : public RenderBackend
+	{
+	public:
+		explicit VirtualBackend(SyncHarness *harness) : harness_(harness), reactivated_(false) {}
+
+		HANDLE StreamEvent() const override { return nullptr; }
+		UINT64 DeviceFrequency() const override { return kRate; }
+		UINT32 MaxFrameCount() const override { return harness_->device_.MaxPeriodFrames(); }
+		HRESULT Start() override;
+		HRESULT Stop() override;
+		HRESULT Reset() override;
+		HRESULT ActivateObjects() override { reactivated_ = true; return S_OK; }
+		HRESULT SilencePending() override;
+		HRESULT BeginUpdating(UINT32 *frames) override;
+		float *GetBuffer(unsigned channel) override { return harness_->device_.Buffer(channel); }
+		HRESULT EndUpdating() override;
+		HRESULT GetPosition(UINT64 *device_position, UINT64 *qpc_position) override;
+		HRESULT SetVolume(float) override { return S_OK; }
+
+	private:
+		SyncHarness *harness_;
+
+		// ZbgėL̍ŏ Start() ́AkReactivationTime xčĐn܂
+		bool reactivated_;
+	};
+
+	void ScheduleActions(double duration);
+
+	// VLC Ă΂鑤
+	void Start(double time);
+	void Play(double time, unsigned frames);
+	int64_t TimeGet(double time) const;
+	void PostCommand(double time, AudioCommand::Type type, bool flag);
+
+	// I[fBIXbhNBstep Ă񂾌A񂾎ɓ⍇UB
+	template <typename Step>
+	void RunStep(double time, Step step);
+	bool FlushCompleted();
+
+	void AdvancePeriod(double time);
+	void BeginWindow(EventKind kind, double time);
+	void RestartSource(double time);
+	int64_t Qpc(double time) const;
+
+	const Scenario& scenario_;
+	std::mt19937 random_;
+	std::normal_distribution<double> normal_;
+	VirtualAudioDevice device_;
+	const double frame_rate_;
+
+	// I[fBIXbh̏Ԃ sys_  steps_ 
+	std::unique_ptr<aout_sys_t> sys_;
+	std::unique_ptr<AudioProcessSteps> steps_;
+	double now_;
+
+	// Play() ɓnubNBg͑SēŁAꂽ̂g񂷁BȂΑ₷B
+	std::vector<float> silence_;
+	std::deque<block_t> blocks_;
+
+	// zfoCX̎̑Bwake_pending_ Ȃ wake_time_ ɋNB
+	// R}h̎҂ĂԂ́Acommand_deadline_ ɑ҂̎Ԑ؂ŋNB
+	bool wake_pending_;
+	double wake_time_;
+	double command_deadline_;
+
+	// Play() t[̒ʂԍBL[ɎcĂ镪 (audio_data_frames_) O͓]̂ĂB
+	int64_t played_total_;
+
+	// ⍇͒ʂԍ̏ɕԁBperiod_queries_ ͏ݍς݂ōĐO̎ɓ⍇B
+	// period_committed_ ͒ʒmς݂̎܂ꂽAcommitted_in_step_ ͒ŐNŏ񂾂B
+	std::deque<Query> queries_;
+	std::vector<Query> period_queries_;
+	bool period_committed_;
+	bool committed_in_step_;
+
+	// VLC Bsource_origin_ ubNԂőBꎞ~ƃtbV̊҂̊Ԃ͑ȂB
+	bool vlc_paused_;
+	std::future<HRESULT> flush_completed_;
+	double source_origin_;
+	uint64_t source_blocks_;
+	double next_arrival_;
+	double pause_time_;
+
+	// Đ̃tbVŁAnς݂̉܂邩ǂBplaying_old_ ͍Đ̎Apending_old_ ͏ݍς݂ōĐO̎
+	// tbVỎ܂ނBtracking_old_ ̓tbV𑗂ĂAtbVỎI܂ŁB
+	bool tracking_old_;
+	bool playing_old_;
+	bool pending_old_;
+
+	std::vector<Action> actions_;
+	std::vector<Window> windows_;
+	std::vector<Sample> samples_;
+	std::vector<FlushTiming> flushes_;
+};
+
+static VirtualAudioDeviceParameters MakeDeviceParameters(const Scenario& scenario, uint32_t seed);
+static double Percentile(std::vector<double> values, double p);
+static void PrintFlushLatency(const SyncHarness& harness);
+
+// ꂽubNBblock_Release()  VLC ł free ɑ邪Ał̓n[lX̃v[ɖ߂B
+static std::vector<block_t *> free_blocks;
+
+void block_Release(block_t *block)
+{
+	free_blocks.push_back(block);
+}
+
+
+SyncHarness::SyncHarness(const Scenario& scenario, uint32_t seed, bool fast_flush)
+	: scenario_(scenario),
+	random_(seed),
+	normal_(0.0, 1.0),
+	device_(MakeDeviceParameters(scenario, seed)),
+	frame_rate_(kRate * (1.0 + scenario.drift_ppm * 1.0e-6)),
+	sys_(std::make_unique<aout_sys_t>()),
+	now_(0.0),
+	silence_(static_cast<size_t>(scenario.block_frames) * kChannels, 0.0f),
+	blocks_(kPoolBlocks),
+	wake_pending_(false),
+	wake_time_(0.0),
+	command_deadline_(INFINITY),
+	played_total_(0),
+	period_committed_(false),
+	committed_in_step_(false),
+	vlc_paused_(false),
+	source_origin_(0.0),
+	source_blocks_(0),
+	next_arrival_(0.0),
+	pause_time_(0.0),
+	tracking_old_(false),
+	playing_old_(false),
+	pending_old_(false)
+{
+	aout_sys_t *sys = sys_.get();
+	const SimdLevel level = DetectSimdLevel();
+
+	// Start() ̐ݒōŝƓݒɂBQPC  ClockModel Ɠ 100ns PʂŐB
+	sys->input_format_ = {};
+	sys->input_format_.i_rate = kRate;
+	sys->input_format_.i_channels = kChannels;
+	sys->input_format_.i_bytes_per_frame = kChannels * sizeof(float);
+	sys->output_format_ = {};
+	sys->output_format_.nSamplesPerSec = kRate;
+	sys->output_format_.nChannels = kChannels;
+
+	sys->mix_mode_ = MixMode::kOff;
+	sys->mix_ = nullptr;
+	sys->output_objects_ = ObjectBit(ObjectChannel::kFrontLeft)| ObjectBit(ObjectChannel::kFrontRight);
+	sys->output_channels_ = kChannels;
+	sys->channel_reorder_table_ = {0, 1};
+	sys->deinterleave_ = SelectDeinterleaveFunction(level, SampleFormat::kFloat32);
+	sys->scan_silence_ = SelectScanSilenceFunction(level, SampleFormat::kFloat32);
+	sys->output_sources_ = {1, 2};
+	sys->convert_on_play_ = false;
+	sys->resampler_quality_ = ResamplerQuality::kOff;
+	sys->meter_mode_ = MeterMode::kOff;
+
+	sys->wait_timeout_ = kWaitTimeout;
+	sys->fast_flush_ = fast_flush;
+	sys->flush_wait_ = 0;
+	sys->stop_wait_ = 0;
+	sys->underrun_probability_ = kUnderrunProbability;
+	sys->latency_target_frames_ = 0;
+	sys->volume_mode_ = VolumeMode::kStreamVolume;
+	sys->volume_ = 1.0f;
+	sys->mute_ = false;
+
+	sys->qpc_frequency_.QuadPart = kClockUnitsPerSecond;
+	sys->clock_snapshot_.Store(ClockSnapshot {E_FAIL, {}, 0.0f, 0.0f});
+	sys->statistics_.Reset();
+
+	for (auto& event: sys->events_)
+		event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	free_blocks.clear();
+	for (auto& block: blocks_)
+		free_blocks.push_back(&block);
+}
+
+SyncHarness::~SyncHarness()
+{
+	aout_sys_t *sys = sys_.get();
+
+	if (steps_)
+		steps_->Finish();
+
+	while (QueuedBlock<block_t> *front = sys->audio_data_queue_.Front())
+	{
+		block_Release(front->block);
+		sys->audio_data_queue_.Pop();
+	}
+
+	ReleaseRetiredBlocks(sys);
+	ReleaseRetiredCommands(sys);
+
+	for (auto& event: sys->events_)
+		CloseHandle(event);
+}
+
+// bɃtbV (V[N) AXꎞ~Bꎞ~ɃtbV邱ƂB
+void SyncHarness::ScheduleActions(double duration)
+{
+	std::uniform_real_distribution<double> flush_interval(4.0, 10.0);
+	std::uniform_real_distribution<double> pause_length(0.1, 2.0);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	double time = 2.0;
+
+	while (time < duration - 4.0)
+	{
+		time += flush_interval(random_);
+
+		if (unit(random_) < 0.6)
+		{
+			actions_.push_back({time, Action::kFlush});
+			continue;
+		}
+
+		const double length = pause_length(random_);
+		actions_.push_back({time, Action::kPause});
+
+		if (unit(random_) < 0.3)
+			actions_.push_back({time + length / 2, Action::kFlush});
+
+		actions_.push_back({time + length, Action::kResume});
+		time += length;
+	}
+}
+
+void SyncHarness::Run(double duration)
+{
+	ScheduleActions(duration);
+	Start(0.0);
+
+	size_t action = 0;
+
+	while (true)
+	{
+		// ɋN̂́AfoCX̎̎n߁ENER}h̑҂̎Ԑ؂EubN̓EVLC ̑̂ł
+		const double advance_time = (device_.Running() && !wake_pending_)? device_.NextPeriodTime(): INFINITY;
+		const double wake_time = wake_pending_? wake_time_: INFINITY;
+		const double arrival_time = (vlc_paused_ || flush_completed_.valid())? INFINITY: next_arrival_;
+		const double action_time = (action < actions_.size())? actions_[action].time: INFINITY;
+		const double time = std::min({advance_time, wake_time, command_deadline_, arrival_time, action_time});
+
+		if (time >= duration)
+			break;
+
+		now_ = time;
+
+		if (time == advance_time)
+		{
+			AdvancePeriod(time);
+		}
+		else if (time == wake_time)
+		{
+			wake_pending_ = false;
+			RunStep(time, [this]() { return steps_->OnStreamEvent(); });
+		}
+		else if (time == command_deadline_)
+		{
+			RunStep(time, [this]() { return steps_->OnTimeout(); });
+		}
+		else if (time == arrival_time)
+		{
+			Play(time, scenario_.block_frames);
+
+			++source_blocks_;
+			const double nominal = source_origin_ + (static_cast<double>(source_blocks_) * scenario_.block_frames / kRate - kLead);
+			next_arrival_ = std::max(time, nominal + std::abs(normal_(random_)) * scenario_.arrival_jitter);
+		}
+		else
+		{
+			// Flush() ̓tbV̊܂ VLC ҂Bꎞ~EĊJ͑҂ȂB
+			switch (actions_[action].type)
+			{
+			case Action::kFlush:
+				PostCommand(time, AudioCommand::kFlush, false);
+				break;
+
+			case Action::kPause:
+				vlc_paused_ = true;
+				pause_time_ = time;
+				PostCommand(time, AudioCommand::kPause, true);
+				break;
+
+			case Action::kResume:
+			{
+				vlc_paused_ = false;
+				source_origin_ += time - pause_time_;
+				next_arrival_ += time - pause_time_;
+
+				// ~̃R}h͂ɓKpBĊJ̑Oɑꎞ~܂KpĂȂ΁A܂Ƃ߂đŏB
+				const bool stopped = !device_.Running();
+				PostCommand(time, AudioCommand::kPause, false);
+
+				if (stopped && device_.Running())
+					BeginWindow(EventKind::kResume, time);
+				break;
+			}
+			}
+
+			++action;
+		}
+	}
+}
+
+void SyncHarness::Start(double time)
+{
+	steps_ = std::make_unique<AudioProcessSteps>(sys_.get());
+	steps_->Initialize(std::make_unique<VirtualBackend>(this));
+	steps_->Start();
+
+	BeginWindow(EventKind::kStart, time);
+	RestartSource(time);
+}
+
+// mss.cpp  Play() Ɠ菇ŃubNς
+void SyncHarness::Play(double time, unsigned frames)
+{
+	aout_sys_t *sys = sys_.get();
+
+	// VLC ̓ubNnOɃfBC⍇B̃ubN̐擪Đ܂ł̎ԂƔׂB
+	queries_.push_back({windows_.size() - 1, time, played_total_, device_.PlayedFrames(time), TimeGet(time), 0});
+
+	ReleaseRetiredBlocks(sys);
+
+	if (free_blocks.empty())
+	{
+		blocks_.emplace_back();
+		free_blocks.push_back(&blocks_.back());
+	}
+
+	block_t *block = free_blocks.back();
+	free_blocks.pop_back();
+
+	*block = {};
+	block->p_buffer = reinterpret_cast<uint8_t *>(silence_.data());
+	block->i_buffer = silence_.size() * sizeof(float);
+	block->i_nb_samples = frames;
+
+	const uint32_t active_objects = ScanAudioDataBlock(sys, block);
+	sys->audio_data_queue_.Push(QueuedBlock<block_t> {block, active_objects});
+	sys->audio_data_frames_.fetch_add(frames, std::memory_order_release);
+
+	played_total_ += frames;
+}
+
+// mss.cpp  TimeGet() Ɠ GetDelay() ŋ߂
+int64_t SyncHarness::TimeGet(double time) const
+{
+	int64_t delay = 0;
+
+	GetDelay(sys_.get(), Qpc(time), &delay);
+
+	return delay;
+}
+
+// R}h𑗂ƁAI[fBIXbh͂ɋN
+void SyncHarness::PostCommand(double time, AudioCommand::Type type, bool flag)
+{
+	std::future<HRESULT> completed = ::PostCommand(sys_.get(), type, 0.0f, flag);
+
+	if (AudioCommand::kFlush == type)
+	{
+		flush_completed_ = std::move(completed);
+
+		// ĐȂAĐ̎Əݍς݂̎ɂ̓tbVỎĂ
+		if (!vlc_paused_)
+		{
+			flushes_.push_back({time, NAN, time, 0});
+			tracking_old_ = true;
+			playing_old_ = device_.Running();
+			pending_old_ = period_committed_;
+		}
+	}
+
+	RunStep(time, [this]() { return steps_->OnCommandPosted(); });
+}
+
+template <typename Step>
+void SyncHarness::RunStep(double time, Step step)
+{
+	aout_sys_t *sys = sys_.get();
+	const int64_t consumed = played_total_ - sys->audio_data_frames_.load();
+
+	committed_in_step_ = false;
+	step();
+
+	// ҂ĂR}h΁AAudioProcessThread() Ɠ҂ɎԐ݂
+	command_deadline_ = steps_->CommandsPending()? time + sys->wait_timeout_ / 1000.0: INFINITY;
+
+	// tbV VLC ҂Ă̂ŁA瑗蒼Bꎞ~͂ɓKpAĊJĂ瑗n߂B
+	if (FlushCompleted())
+	{
+		RestartSource(vlc_paused_? pause_time_: time);
+
+		if (!vlc_paused_)
+		{
+			BeginWindow(EventKind::kFlush, time);
+			flushes_.back().applied = time;
+			flushes_.back().window = windows_.size() - 1;
+		}
+	}
+
+	if (flush_completed_.valid())
+		return;
+
+	// ]t[ɓ⍇́A̎̍Đn܂Ƃɐ^̃fBC܂
+	if (committed_in_step_)
+	{
+		const int64_t forwarded = played_total_ - sys->audio_data_frames_.load();
+
+		while (!queries_.empty() && (queries_.front().sample < forwarded))
+		{
+			Query query = queries_.front();
+			queries_.pop_front();
+
+			query.offset = query.sample - consumed;
+			period_queries_.push_back(query);
+		}
+	}
+}
+
+// tbVĂ΁AL[ɂ̖⍇̂Ă true Ԃ (̃t[͍ĐȂ)
+bool SyncHarness::FlushCompleted()
+{
+	if (!flush_completed_.valid() || (std::future_status::ready != flush_completed_.wait_for(std::chrono::seconds(0))))
+		return false;
+
+	flush_completed_.get();
+	queries_.clear();
+
+	return true;
+}
+
+HRESULT SyncHarness::VirtualBackend::Start()
+{
+	VirtualAudioDevice& device = harness_->device_;
+
+	if (device.Running())
+		return S_OK;
+
+	device.Start(harness_->now_ + (reactivated_? kReactivationTime: 0.0));
+	reactivated_ = false;
+
+	// ~߂Oɒʒm܂܂ĂȂ΁A߂Ēʒm
+	if (device.PeriodWritable())
+	{
+		harness_->wake_pending_ = true;
+		harness_->wake_time_ = harness_->now_;
+	}
+
+	return S_OK;
+}
+
+HRESULT SyncHarness::VirtualBackend::Stop()
+{
+	VirtualAudioDevice& device = harness_->device_;
+
+	if (device.Running())
+		device.Stop(harness_->now_);
+
+	// ʒmς݂̎́A~߂foCXł͏߂ȂBĊJƂɉ߂ĒʒmB
+	harness_->wake_pending_ = false;
+
+	return S_OK;
+}
+
+// Xg[̃ZbgBfoCXɓnς݂̕ĐȂB
+HRESULT SyncHarness::VirtualBackend::Reset()
+{
+	if (harness_->tracking_old_)
+	{
+		if (harness_->playing_old_)
+			harness_->flushes_.back().old_end = harness_->now_;
+
+		harness_->playing_old_ = false;
+		harness_->pending_old_ = false;
+	}
+
+	harness_->device_.Reset();
+	harness_->period_queries_.clear();
+	harness_->period_committed_ = false;
+
+	return S_OK;
+}
+
+// ݍς݂ōĐO̎𖳉ɂBtbVỎ͍Đ̎̏I܂ŖB
+HRESULT SyncHarness::VirtualBackend::SilencePending()
+{
+	if (harness_->tracking_old_)
+		harness_->pending_old_ = false;
+
+	harness_->device_.SilencePending();
+
+	return S_OK;
+}
+
+HRESULT SyncHarness::VirtualBackend::BeginUpdating(UINT32 *frames)
+{
+	if (!harness_->device_.Running())
+		return E_FAIL;
+
+	*frames = harness_->device_.PeriodFrames();
+
+	return S_OK;
+}
+
+// SimulatedBackend ƓAĊJ̒ʒmɏ񂾏ꍇ (tbVł̃Zbg) ɁA2xNȂ悤ʒm
+HRESULT SyncHarness::VirtualBackend::EndUpdating()
+{
+	// tbVKpOɏ񂾎́AL[ɂtbVỎ܂
+	if (harness_->tracking_old_)
+		harness_->pending_old_ = harness_->flush_completed_.valid() && (std::future_status::ready != harness_->flush_completed_.wait_for(std::chrono::seconds(0)));
+
+	harness_->device_.CommitPeriod();
+	harness_->period_committed_ = true;
+	harness_->committed_in_step_ = true;
+	harness_->wake_pending_ = false;
+
+	return S_OK;
+}
+
+// zfoCX͎̎n߂̍ĐʒuA̎ƂƂɕԂ
+HRESULT SyncHarness::VirtualBackend::GetPosition(UINT64 *device_position, UINT64 *qpc_position)
+{
+	const double noise = harness_->normal_(harness_->random_) * harness_->scenario_.position_noise;
+
+	*device_position = harness_->device_.Position();
+	*qpc_position = harness_->Qpc(harness_->device_.PositionTime() + noise);
+
+	return S_OK;
+}
+
+// ̎n߁Bݍς݂̎̍Đn܂Äʒu⍇t[̃foCẌʒu܂B
+void SyncHarness::AdvancePeriod(double time)
+{
+	const bool committed = period_committed_;
+
+	// tbVỎ܂ގIAݍς݂̎̍Đn܂
+	if (tracking_old_)
+	{
+		if (playing_old_)
+			flushes_.back().old_end = time;
+
+		playing_old_ = committed && pending_old_;
+		pending_old_ = false;
+		tracking_old_ = playing_old_ || flush_completed_.valid();
+	}
+
+	wake_time_ = std::max(time, device_.AdvancePeriod());
+	wake_pending_ = true;
+	period_committed_ = false;
+
+	if (!committed)
+		return;
+
+	const double start = static_cast<double>(device_.Position());
+
+	for (const Query& query: period_queries_)
+	{
+		const double actual = (start + query.offset - query.played) / frame_rate_ * 1.0e6;
+		samples_.push_back({query.window, query.time, static_cast<double>(query.reported) - actual, actual});
+	}
+
+	period_queries_.clear();
+}
+
+void SyncHarness::BeginWindow(EventKind kind, double time)
+{
+	windows_.push_back({kind, time});
+}
+
+// tbVEJn̒́AVLC ǂ݂̕܂Ƃ߂đ
+void SyncHarness::RestartSource(double time)
+{
+	source_origin_ = time;
+	source_blocks_ = 0;
+	next_arrival_ = time;
+}
+
+int64_t SyncHarness::Qpc(double time) const
+{
+	return std::llround((time + kQpcOrigin) * kClockUnitsPerSecond);
+}
+
+static VirtualAudioDeviceParameters MakeDeviceParameters(const Scenario& scenario, uint32_t seed)
+{
+	VirtualAudioDeviceParameters parameters;
+
+	parameters.rate = kRate;
+	parameters.channels = kChannels;
+	parameters.period_frames = scenario.period_frames;
+	parameters.period_variation = scenario.period_variation;
+	parameters.jitter = scenario.jitter;
+	parameters.drift_ppm = scenario.drift_ppm;
+	parameters.seed = seed;
+
+	return parameters;
+}
+
+static double Percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+
+	const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+
+	return values[index];
+}
+
+// Đ̃tbVɂāAFlush() Ăł߂܂ (apply)AtbVOɓnς݂̉I܂ (old)A
+// tbV̍ŏ̃ubNn߂܂ (new) ̎ (~b) ̒lƍőo͂
+static void PrintFlushLatency(const SyncHarness& harness)
+{
+	const std::vector<Sample>& samples = harness.Samples();
+	std::vector<double> applied;
+	std::vector<double> old_end;
+	std::vector<double> new_audible;
+
+	// Ԃ̍ŏ̖⍇AtbV̍ŏ̃ubN
+	std::vector<const Sample *> first(harness.Windows().size(), nullptr);
+
+	for (const auto& sample: samples)
+	{
+		if (!first[sample.window])
+			first[sample.window] = &sample;
+	}
+
+	for (const auto& flush: harness.Flushes())
+	{
+		if (std::isnan(flush.applied))
+			continue;
+
+		applied.push_back(flush.applied - flush.posted);
+		old_end.push_back(flush.old_end - flush.posted);
+
+		if (const Sample *sample = first[flush.window])
+			new_audible.push_back(sample->time + sample->delay * 1.0e-6 - flush.posted);
+	}
+
+	printf("%7zu %6.1fms %6.1fms %6.1fms %6.1fms %6.1fms %6.1fms\n", applied.size(),
+		Percentile(applied, 0.5) * 1000.0, Percentile(applied, 1.0) * 1000.0,
+		Percentile(old_end, 0.5) * 1000.0, Percentile(old_end, 1.0) * 1000.0,
+		Percentile(new_audible, 0.5) * 1000.0, Percentile(new_audible, 1.0) * 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filter = (argc > 1)? argv[1]: nullptr;
+	int failures = 0;
+
+	printf("%-12s %7s %8s %8s %8s %8s %8s %8s %9s %9s %9s %9s %6s\n", "scenario", "queries", "p50(us)", "p95(us)", "p99(us)", "max(us)", "bias(us)", "steady99",
+		"flush50", "flushmax", "resume50", "resumemax", "xruns");
+
+	for (const auto& scenario: kScenarios)
+	{
+		if (filter && !strstr(scenario.name, filter))
+			continue;
+
+		SyncHarness harness(scenario, 1, true);
+		harness.Run(kDuration);
+
+		const std::vector<Window>& windows = harness.Windows();
+		const std::vector<Sample>& samples = harness.Samples();
+		std::vector<double> errors;
+		std::vector<double> steady_errors;
+		double bias = 0.0;
+
+		for (const auto& sample: samples)
+		{
+			errors.push_back(std::abs(sample.error));
+			bias += sample.error;
+
+			if (sample.time - windows[sample.window].begin >= kSteadyAfter)
+				steady_errors.push_back(std::abs(sample.error));
+		}
+
+		if (!samples.empty())
+			bias /= samples.size();
+
+		// ԖɁAe͈͂OꂽŌ̖⍇܂ł̎ԂԂƂBԂ̏I܂ŊOĂ΁AԂ̒ƂB
+		std::vector<double> settle(windows.size(), 0.0);
+		std::vector<double> window_end(windows.size(), kDuration);
+
+		for (size_t i=0; i+1<windows.size(); ++i)
+			window_end[i] = windows[i + 1].begin;
+
+		for (const auto& sample: samples)
+		{
+			if (std::abs(sample.error) > kSettleTolerance)
+				settle[sample.window] = std::max(settle[sample.window], sample.time - windows[sample.window].begin);
+		}
+
+		std::vector<double> flush_settle;
+		std::vector<double> resume_settle;
+
+		for (size_t i=0; i<windows.size(); ++i)
+		{
+			if (EventKind::kFlush == windows[i].kind)
+				flush_settle.push_back(settle[i]);
+			else if (EventKind::kResume == windows[i].kind)
+				resume_settle.push_back(settle[i]);
+		}
+
+		const double p99 = Percentile(errors, 0.99);
+		const double max_error = Percentile(errors, 1.0);
+		const double steady_p99 = Percentile(steady_errors, 0.99);
+		const double settle_max = std::max(Percentile(flush_settle, 1.0), Percentile(resume_settle, 1.0));
+
+		printf("%-12s %7zu %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f %7.1fms %7.1fms %7.1fms %7.1fms %6llu\n", scenario.name, samples.size(),
+			Percentile(errors, 0.5), Percentile(errors, 0.95), p99, max_error, bias, steady_p99,
+			Percentile(flush_settle, 0.5) * 1000.0, Percentile(flush_settle, 1.0) * 1000.0,
+			Percentile(resume_settle, 0.5) * 1000.0, Percentile(resume_settle, 1.0) * 1000.0,
+			static_cast<unsigned long long>(harness.Underruns()));
+
+		if ((steady_p99 > scenario.max_steady_p99) || (settle_max > scenario.max_settle) || (p99 > scenario.max_p99) || (max_error > scenario.max_error))
+		{
+			printf("  %s exceeds the limits (steady p99 %.0fus, settle %.1fms, p99 %.0fus, max %.0fus)\n", scenario.name, scenario.max_steady_p99, scenario.max_settle * 1000.0,
+				scenario.max_p99, scenario.max_error);
+			++failures;
+		}
+	}
+
+	// tbV̗AFast Flush L () ƖɂĔׂ
+	printf("\n%-12s %-5s %7s %8s %8s %8s %8s %8s %8s\n", "scenario", "flush", "flushes", "apply50", "applymax", "old50", "oldmax", "new50", "newmax");
+
+	for (const auto& scenario: kScenarios)
+	{
+		if (filter && !strstr(scenario.name, filter))
+			continue;
+
+		for (const bool fast_flush: {true, false})
+		{
+			SyncHarness harness(scenario, 1, fast_flush);
+			harness.Run(kDuration);
+
+			printf("%-12s %-5s ", scenario.name, fast_flush? "fast": "full");
+			PrintFlushLatency(harness);
+		}
+	}
+
+	if (failures)
+	{
+		printf("%d scenario(s) exceed the limits\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
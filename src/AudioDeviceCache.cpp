@@ -0,0 +1,310 @@
+#include "AudioDeviceCache.h"
+#include "DeviceCache.h"
+
+#include <functiondiscoverykeys_devpkey.h>
+#include <spatialaudioclient.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <wil/com.h>
+
+// MMDevice API ŗ񋓂BďõXbh COM ̏ԂɈ˂Ȃ悤A񋓂͕ʃXbhōsB
+class MMDeviceSource : public DeviceCache<WAVEFORMATEX>::Source
+{
+public:
+	bool EnumerateDevices(std::vector<DeviceCache<WAVEFORMATEX>::Device>& devices) override;
+	bool EnumerateFormats(const std::wstring& device_id, std::vector<WAVEFORMATEX>& formats) override;
+};
+
+// Gh|Cg̒ǉE폜EԂvpeB̕ωŁALbV𖳌ɂB
+// ʒm MMDevice API ̃Xbh͂̂ŁAł̓ubNȂB
+class EndpointNotificationClient : public IMMNotificationClient
+{
+public:
+	explicit EndpointNotificationClient(DeviceCache<WAVEFORMATEX> *cache);
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR device_id, DWORD new_state) override;
+	HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR device_id) override;
+	HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR device_id) override;
+	HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR default_device_id) override;
+	HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR device_id, const PROPERTYKEY key) override;
+
+private:
+	std::atomic<ULONG> references_;
+	DeviceCache<WAVEFORMATEX> *cache_;
+};
+
+static MMDeviceSource device_source;
+static DeviceCache<WAVEFORMATEX> device_cache(&device_source);
+
+// ύXʒḿAp̊ԂXbhœo^EB
+// o^Ɏg MMDeviceEnumerator g悤ÃXbh MTA ۂĂB
+// acquired_count  notification_thread  acquired_mutex ŎB
+static std::mutex acquired_mutex;
+static int acquired_count;
+static std::thread notification_thread;
+static wil::unique_handle notification_stop_event;
+static std::atomic<bool> notification_registered;
+
+static void NotificationThread(HANDLE stop_event);
+static std::string CreateUtf8StringFromWideCharString(LPCWCH wide_char_string);
+
+
+void AcquireAudioDeviceCache()
+{
+	std::lock_guard<std::mutex> lock(acquired_mutex);
+
+	if (0 != acquired_count++)
+		return;
+
+	notification_stop_event.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+	if (notification_stop_event.get())
+		notification_thread = std::thread(NotificationThread, notification_stop_event.get());
+}
+
+void ReleaseAudioDeviceCache()
+{
+	std::lock_guard<std::mutex> lock(acquired_mutex);
+
+	if (0 != --acquired_count)
+		return;
+
+	if (notification_thread.joinable())
+	{
+		SetEvent(notification_stop_event.get());
+		notification_thread.join();
+	}
+
+	notification_stop_event.reset();
+}
+
+void MakeDeviceIdTable(std::vector<std::string>& ids, std::vector<std::string>& descs)
+{
+	// ύXʒm󂯂ĂȂԂ̃LbV͐MpłȂ
+	if (!notification_registered.load(std::memory_order_acquire))
+		device_cache.Invalidate();
+
+	for (const auto& device: device_cache.Devices())
+	{
+		ids.push_back(device.id);
+		descs.push_back(device.description);
+	}
+}
+
+void GetSupportedFormats(std::vector<WAVEFORMATEX>& formats, const std::wstring& device_id)
+{
+	if (!notification_registered.load(std::memory_order_acquire))
+		device_cache.Invalidate();
+
+	formats = device_cache.Formats(device_id);
+}
+
+bool MMDeviceSource::EnumerateDevices(std::vector<DeviceCache<WAVEFORMATEX>::Device>& devices)
+{
+	bool succeeded = false;
+
+	std::thread t([&]()
+		{
+			if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED| COINIT_DISABLE_OLE1DDE)))
+				return;
+
+			try
+			{
+				wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
+				wil::com_ptr<IMMDeviceCollection> device_collection;
+				UINT device_count;
+
+				device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>();
+				THROW_IF_FAILED(device_enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, device_collection.put()));
+				THROW_IF_FAILED(device_collection->GetCount(&device_count));
+
+				for (UINT item_index=0; item_index<device_count; ++item_index)
+				{
+					wil::com_ptr<IMMDevice> device;
+					wil::unique_cotaskmem_string device_id;
+					wil::com_ptr<IPropertyStore> properties;
+					wil::unique_prop_variant friendly_name;
+
+					THROW_IF_FAILED(device_collection->Item(item_index, &device));
+					THROW_IF_FAILED(device->GetId(device_id.put()));
+					THROW_IF_FAILED(device->OpenPropertyStore(STGM_READ, properties.put()));
+					THROW_IF_FAILED(properties->GetValue(PKEY_Device_FriendlyName, &friendly_name));
+
+					devices.push_back({CreateUtf8StringFromWideCharString(device_id.get()), CreateUtf8StringFromWideCharString(friendly_name.pwszVal)});
+				}
+
+				succeeded = true;
+			}
+			catch (wil::ResultException& e)
+			{
+			}
+
+			CoUninitialize();
+		});
+
+	t.join();
+
+	return succeeded;
+}
+
+bool MMDeviceSource::EnumerateFormats(const std::wstring& device_id, std::vector<WAVEFORMATEX>& formats)
+{
+	bool succeeded = false;
+
+	std::thread t([&]()
+		{
+			if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED| COINIT_DISABLE_OLE1DDE)))
+				return;
+
+			try
+			{
+				wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
+				wil::com_ptr<IMMDevice> device;
+				wil::com_ptr<ISpatialAudioClient> client;
+				wil::com_ptr<IAudioFormatEnumerator> enumerator;
+				UINT32 format_counts;
+
+				device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>(CLSCTX_INPROC_SERVER);
+				THROW_IF_FAILED(device_enumerator->GetDevice(device_id.c_str(), device.put()));
+				THROW_IF_FAILED(device->Activate(__uuidof(ISpatialAudioClient), CLSCTX_INPROC_SERVER, nullptr, client.put_void()));
+				THROW_IF_FAILED(client->GetSupportedAudioObjectFormatEnumerator(enumerator.put()));
+				THROW_IF_FAILED(enumerator->GetCount(&format_counts));
+
+				for (UINT32 index=0; index<format_counts; ++index)
+				{
+					WAVEFORMATEX *format;
+
+					if (SUCCEEDED(enumerator->GetFormat(index, &format)))
+						formats.push_back(*format);
+				}
+
+				succeeded = true;
+			}
+			catch (wil::ResultException& e)
+			{
+			}
+
+			CoUninitialize();
+		});
+
+	t.join();
+
+	return succeeded;
+}
+
+EndpointNotificationClient::EndpointNotificationClient(DeviceCache<WAVEFORMATEX> *cache)
+	: references_(1), cache_(cache)
+{
+}
+
+HRESULT STDMETHODCALLTYPE EndpointNotificationClient::QueryInterface(REFIID iid, void **object)
+{
+	if ((__uuidof(IUnknown) == iid) || (__uuidof(IMMNotificationClient) == iid))
+	{
+		AddRef();
+		*object = static_cast<IMMNotificationClient *>(this);
+		return S_OK;
+	}
+
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE EndpointNotificationClient::AddRef()
+{
+	return references_.fetch_add(1) + 1;
+}
+
+ULONG STDMETHODCALLTYPE EndpointNotificationClient::Release()
+{
+	const ULONG references = references_.fetch_sub(1) - 1;
+
+	if (!references)
+		delete this;
+
+	return references;
+}
+
+HRESULT STDMETHODCALLTYPE EndpointNotificationClient::OnDeviceStateChanged(LPCWSTR device_id, DWORD new_state)
+{
+	cache_->Invalidate();
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE EndpointNotificationClient::OnDeviceAdded(LPCWSTR device_id)
+{
+	cache_->Invalidate();
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE EndpointNotificationClient::OnDeviceRemoved(LPCWSTR device_id)
+{
+	cache_->Invalidate();
+	return S_OK;
+}
+
+// ̃foCX͈ꗗɂtH[}bgɂeȂ
+HRESULT STDMETHODCALLTYPE EndpointNotificationClient::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR default_device_id)
+{
+	return S_OK;
+}
+
+// O̕ύX̂قẢ̐ؑւvpeB̕ωƂē͂
+HRESULT STDMETHODCALLTYPE EndpointNotificationClient::OnPropertyValueChanged(LPCWSTR device_id, const PROPERTYKEY key)
+{
+	cache_->Invalidate();
+	return S_OK;
+}
+
+static void NotificationThread(HANDLE stop_event)
+{
+	if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED| COINIT_DISABLE_OLE1DDE)))
+		return;
+
+	try
+	{
+		wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
+
+		device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>(CLSCTX_INPROC_SERVER);
+
+		EndpointNotificationClient *client = new EndpointNotificationClient(&device_cache);
+
+		if (SUCCEEDED(device_enumerator->RegisterEndpointNotificationCallback(client)))
+		{
+			// o^ĂȂԂ̕ω͕Ȃ̂ŁAo^_ŖɂĂ
+			device_cache.Invalidate();
+			notification_registered.store(true, std::memory_order_release);
+
+			WaitForSingleObject(stop_event, INFINITE);
+
+			notification_registered.store(false, std::memory_order_release);
+			device_enumerator->UnregisterEndpointNotificationCallback(client);
+		}
+
+		client->Release();
+	}
+	catch (wil::ResultException& e)
+	{
+	}
+
+	CoUninitialize();
+}
+
+static std::string CreateUtf8StringFromWideCharString(LPCWCH wide_char_string)
+{
+	int result_chars = WideCharToMultiByte(CP_UTF8, 0, wide_char_string, -1, nullptr, 0, nullptr, nullptr);
+	if (!result_chars)
+		return std::string();
+
+	std::unique_ptr<CHAR []> buffer(new CHAR[result_chars]);
+	WideCharToMultiByte(CP_UTF8, 0, wide_char_string, -1, buffer.get(), result_chars, nullptr, nullptr);
+
+	return std::string(buffer.get());
+}
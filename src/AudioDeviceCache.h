@@ -0,0 +1,18 @@
+#pragma once
+
+#include "depends.h"
+
+#include <Windows.h>
+#include <mmdeviceapi.h>
+
+#include <string>
+#include <vector>
+
+// o̓foCẌꗗƁAefoCX ISpatialAudioClient ΉtH[}bgAvZXŜŃLbVB
+// Open()  AcquireAudioDeviceCache()AClose()  ReleaseAudioDeviceCache() ĂԁB
+// p̊Ԃ̓Gh|Cg̕ύXʒmł̂݃LbV𖳌ɂApłȂԂ͖⍇̓xɗ񋓂B
+void AcquireAudioDeviceCache();
+void ReleaseAudioDeviceCache();
+
+void MakeDeviceIdTable(std::vector<std::string>& ids, std::vector<std::string>& descs);
+void GetSupportedFormats(std::vector<WAVEFORMATEX>& formats, const std::wstring& device_id);
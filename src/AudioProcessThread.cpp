@@ -1,54 +1,255 @@
 #include "AudioProcessThread.h"
+#include "ClockModel.h"
+#include "ForwardAudioData.h"
+#include "PrebufferController.h"
+#include "RenderBackend.h"
+#include "Resampler.h"
+#include "SimulatedBackend.h"
+#include "TimeStretcher.h"
+
+#if defined(_WIN32)
+#include "SpatialAudioBackend.h"
+#endif
 
 #include <algorithm>
 #include <array>
-#include <utility>
+#include <cmath>
+#include <memory>
 #include <vector>
 
-#include <wil/com.h>
-
 struct LocalVariables
 {
-	wil::com_ptr<IMMDevice> device_;
-	wil::com_ptr<ISpatialAudioClient> spatioal_audio_client_;
-	wil::com_ptr<ISpatialAudioObjectRenderStream> spatial_render_stream_;
-	std::array<wil::com_ptr<ISpatialAudioObject>, 8> spacial_audio_objects_;
-	wil::unique_handle stream_event_;
-	wil::com_ptr<IAudioClock> audio_clock_;
-	wil::com_ptr<IAudioStreamVolume> audio_stream_volume_;
-	UINT64 device_frequency_;
+	std::unique_ptr<RenderBackend> backend_;
+
+	// R}hŎw肳ꂽ
+	float volume_;
+	bool mute_;
+	bool pause_;
+	bool commands_pending_;
+
+	// `̍XVɎsƂ邩B̏ꍇ̃tbV̓Xg[ZbgB
+	bool stream_failed_;
+
+	// A_[̌vp
+	// data_started_ ͊JnEtbV1̃f[^Aunderrun_ ͒O̎sĂB
+	bool data_started_;
+	bool underrun_;
+
+	// ǂ
+	// prebuffering_ ̊Ԃ́AL[ɖڕW̃t[܂܂œ]ɖoB
+	// queued_frames_ ͑O̎̏Ił̃L[̃t[B
+	// draining_ ̊ (VLC Ō܂ōĐ̂҂Ă) ́AL[ɂ镪ǂ݂ɏoB
+	PrebufferController prebuffer_;
+	bool prebuffering_;
+	bool draining_;
+	int64_t queued_frames_;
+
+	// vpBOɕ`ŋN (0 Ȃ疢v) ƁA̎̃t[B
+	LONGLONG last_wake_qpc_;
+	UINT32 last_period_frames_;
+
+	// 1̍őt[B`ɃmۂȂ悤Ãobt@͂̑傫ŊmۂĂB
+	UINT32 max_frames_;
+
+	// \tgEFA
+	// gain_ ͒O̎̏IŊ|Ă{Again_table_ ͍̎̃t[̔{B
+	// gain_table_constant_  gain_table_ ̐擪牽t[ gain_ Ŗ܂Ă邩B
+	float gain_;
+	std::vector<float> gain_table_;
+	size_t gain_table_constant_;
+
+	// ̃TvO[gϊBresampling_  false Ȃ͂Əo͂̃[g͓B
+	// resampler_trim_ ͒x̐؋l߂̂߂ɕϊ̔ɉĂ ppm (0 Ȃ؋l߂ĂȂ)B
+	// resampler_trimmed_ ͐؋l߂͂̃t[̂Atrimmed_frames_ ɂ܂ĂȂ[B
+	Resampler resampler_;
+	bool resampling_;
+	double resampler_trim_;
+	double resampler_trimmed_;
+
+	// x̐؋l߂ɎgԐLkBtrimming_  false ȂgȂB[gϊꍇgȂB
+	TimeStretcher stretcher_;
+	bool trimming_;
+
+	// GetPosition() ̌ʂ𕽊Đʒu
+	ClockModel clock_model_;
 };
 
-static bool CreateLocalVariables(LocalVariables *local_obj, aout_sys_t *sys);
+// wԂňŏ̔{ (-100dB)B0 ͑ΐȂ̂ŁA͍Ō̃t[ 0 ɂB
+static constexpr float kMinimumRampGain = 1.0e-5f;
+
+// x̐؋l߂̑BڕW𒴂 kCatchUpSeconds bŏ鑬AkMinimumTrim  kMaximumTrim ̊ԂɎ߂B
+// ؋l߂͖ڕW kTrimStartFraction Ăn߁AڕW܂Ŗ߂~߂B
+static constexpr double kCatchUpSeconds = 3.0;
+static constexpr double kMinimumTrim = 0.02;
+static constexpr double kMaximumTrim = 0.10;
+static constexpr double kTrimStartFraction = 0.25;
+
+// ̕ϊŃ[gϊĂԂ́AԐLk̑ɕϊ̔ő kMaximumResamplerTrimPpm ߂Ēx؋l߂B
+// ŏオ̂ŁAȂx (0.2% Ŗ3Zg) ɗ߂B̕AڕWɖ߂܂ł͎ԐLk蒷B
+static constexpr double kMaximumResamplerTrimPpm = 2000.0;
+
+static bool CreateLocalVariables(LocalVariables *local_obj, aout_sys_t *sys, std::unique_ptr<RenderBackend> backend);
 static void ReleaseLocalVariables(LocalVariables *local_obj);
-static HRESULT CreateSpatialAudioObjects(std::array<wil::com_ptr<ISpatialAudioObject>, 8>& spacial_audio_objects, wil::com_ptr<ISpatialAudioObjectRenderStream>& spatial_render_stream, uint16_t physical_channels);
-static void ReleaseSpatialAudioObjects(LocalVariables *local_obj);
 
+static bool ProcessCommands(aout_sys_t *sys, LocalVariables *local_obj);
 static void Stream(aout_sys_t *sys, LocalVariables *local_obj);
 static void GetPosition(aout_sys_t *sys, LocalVariables *local_obj);
 static void Pause(aout_sys_t *sys, LocalVariables *local_obj);
 static void Flush(aout_sys_t *sys, LocalVariables *local_obj);
-static void Volume(aout_sys_t *sys, LocalVariables *local_obj);
+static void Drain(aout_sys_t *sys, LocalVariables *local_obj);
+static HRESULT Volume(LocalVariables *local_obj);
+static const float *PrepareGain(const aout_sys_t *sys, LocalVariables *local_obj, size_t frames);
+static void StartPrebuffering(aout_sys_t *sys, LocalVariables *local_obj, int64_t frames);
+static void ForwardQueuedData(float *buffers[kMaxForwardChannels], aout_sys_t *sys, size_t frames, const float *gain, ChannelLevels *levels);
+static size_t ForwardResampledData(float *buffers[kMaxForwardChannels], aout_sys_t *sys, LocalVariables *local_obj, size_t frames, size_t input_frames);
+static void TrimLatency(const aout_sys_t *sys, LocalVariables *local_obj, int64_t queued_frames, size_t frames);
+static void TrimResampledLatency(const aout_sys_t *sys, LocalVariables *local_obj, int64_t queued_frames, size_t frames);
+static size_t ForwardStretchedData(float *buffers[kMaxForwardChannels], aout_sys_t *sys, LocalVariables *local_obj, size_t frames, size_t input_frames);
 
-static void ForwardAudioData(float *buffers[8], aout_sys_t *sys, size_t frames);
-static void ForwardAudioDataBlock(float *const buffers[8], aout_sys_t *sys, block_t *block, size_t frames);
 static void StreamWait(const aout_sys_t *sys, const LocalVariables *local_obj, int wait_loops);
+static LONGLONG QpcNow();
+static void RecordWake(aout_sys_t *sys, LocalVariables *local_obj);
+static void CloseEvents(aout_sys_t *sys);
+
+
+bool StartAudioProcessThread(aout_sys_t *sys)
+{
+	sys->audio_data_frames_ = 0;
+	sys->frames_written_ = 0;
+	sys->resampler_frames_ = 0;
+	sys->stretcher_frames_ = 0;
+	sys->trimmed_frames_ = 0;
+	sys->prebuffer_frames_ = 0;
+	sys->prebuffer_target_ = 0;
+	sys->underruns_ = 0;
+	sys->padded_frames_ = 0;
+	sys->period_frames_ = 0;
+	sys->render_failed_ = false;
+	QueryPerformanceFrequency(&sys->qpc_frequency_);
+	sys->clock_snapshot_.Store(ClockSnapshot {E_FAIL, {}, 0.0f, 0.0f});
+	sys->statistics_.Reset();
+
+	sys->events_.fill(nullptr);
+	for (auto& event: sys->events_)
+	{
+		event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (!event)
+		{
+			CloseEvents(sys);
+			return false;
+		}
+	}
+
+	sys->thread_initialized_ = false;
+	sys->audio_process_thread_ = std::thread(AudioProcessThread, sys);
+	WaitForSingleObject(sys->events_[aout_sys_t::kThreadInitialized], INFINITE);
+
+	if (!sys->thread_initialized_)
+	{
+		sys->audio_process_thread_.join();
+		CloseEvents(sys);
+		return false;
+	}
+
+	return true;
+}
+
+void StopAudioProcessThread(aout_sys_t *sys)
+{
+	PostCommand(sys, AudioCommand::kStop, 0.0f, false);
+	sys->audio_process_thread_.join();
+	sys->thread_initialized_ = false;
+
+	// ~ɓ͂R}h͓KpȂ܂ܔj
+	for (AudioCommand *command=sys->commands_.TakeAll(); command; )
+	{
+		AudioCommand *next = command->next_;
+		delete command;
+		command = next;
+	}
+
+	// I[fBIXbh͏IĂ̂ŁAŏ҂ƂăL[ɂ
+	while (QueuedBlock<block_t> *front = sys->audio_data_queue_.Front())
+	{
+		block_Release(front->block);
+		sys->audio_data_queue_.Pop();
+	}
+
+	ReleaseRetiredBlocks(sys);
+	ReleaseRetiredCommands(sys);
+	CloseEvents(sys);
+}
+
+std::future<HRESULT> PostCommand(aout_sys_t *sys, AudioCommand::Type type, float volume, bool flag)
+{
+	ReleaseRetiredCommands(sys);
+
+	AudioCommand *command = new AudioCommand;
+	command->type = type;
+	command->volume = volume;
+	command->flag = flag;
+
+	std::future<HRESULT> completed = command->completed.get_future();
+	command->posted_qpc = QpcNow();
+
+	// t󂾂ƂN΁A܂Ă镪͂܂Ƃ߂ď
+	if (sys->commands_.Post(command))
+		SetEvent(sys->events_[aout_sys_t::kCommandPosted]);
+
+	return completed;
+}
+
+bool GetDelay(const aout_sys_t *sys, LONGLONG now_qpc, int64_t *delay)
+{
+	// I[fBIXbhJĐʒuĝŁAXbhԂ̑ҍ͕sv
+	const ClockSnapshot clock = sys->clock_snapshot_.Load();
+	if (FAILED(clock.result))
+		return false;
+
+	// ݍς݂̕͏o͂́AL[ƕϊƎԐLkɗ܂Ă镪͓͂̃TvO[gŐB
+	// ǂݒL[̎ۂ̐[ԂB܂܂ł̖͏ݍς݂̕ƂČォ\AVLC ͂̊Ԃ̗ߒč킹B
+	// ԐLkő߂ɏ镪́Aݍς݂̕ۂ菭Ȃ邱ƂŔfB
+	const int64_t pending_frames = sys->audio_data_frames_.load(std::memory_order_relaxed)
+		+ sys->resampler_frames_.load(std::memory_order_relaxed) + sys->stretcher_frames_.load(std::memory_order_relaxed);
+	const int64_t written_frames = sys->frames_written_.load(std::memory_order_relaxed);
+
+	// ̎ GetPosition  qpc_position Ɠ 100ns PʂȂ̂ŁAQPC ̃JEg낦ĂĐʒu܂Ői߂
+	const int64_t now = ScaleTicks(now_qpc, kClockUnitsPerSecond, sys->qpc_frequency_.QuadPart);
+
+	*delay = ClockModel::Delay(clock.estimate, now, written_frames, sys->output_format_.nSamplesPerSec, pending_frames, sys->input_format_.i_rate);
 
+	return true;
+}
+
+void ReleaseRetiredBlocks(aout_sys_t *sys)
+{
+	while (block_t **front = sys->released_blocks_.Front())
+	{
+		block_Release(*front);
+		sys->released_blocks_.Pop();
+	}
+}
+
+void ReleaseRetiredCommands(aout_sys_t *sys)
+{
+	while (AudioCommand **front = sys->retired_commands_.Front())
+	{
+		delete *front;
+		sys->retired_commands_.Pop();
+	}
+}
 
 void AudioProcessThread(aout_sys_t *sys)
 {
 	bool thread_initialized = false;
+	bool do_exit = false;
 	HRESULT com_result;
-	LocalVariables local;
+	AudioProcessSteps steps(sys);
 
 	enum
 	{
 		kStream,
-		kStop,
-		kGetPosition,
-		kPause,
-		kFlush,
-		kVolume,
+		kCommand,
 		kEventsNum
 	};
 	HANDLE events[kEventsNum] {nullptr};
@@ -56,349 +257,791 @@ void AudioProcessThread(aout_sys_t *sys)
 	com_result = CoInitializeEx(nullptr, COINIT_MULTITHREADED| COINIT_DISABLE_OLE1DDE);
 	if (SUCCEEDED(com_result))
 	{
-		thread_initialized = CreateLocalVariables(&local, sys);
+		thread_initialized = steps.Initialize();
 
-		events[kStream] = local.stream_event_.get();
-		events[kStop] = sys->events_[aout_sys_t::kStopRequest];
-		events[kGetPosition] = sys->events_[aout_sys_t::kGetPositionRequest];
-		events[kPause] = sys->events_[aout_sys_t::kPauseRequest];
-		events[kFlush] = sys->events_[aout_sys_t::kFlushRequest];
-		events[kVolume] = sys->events_[aout_sys_t::kVolumeRequest];
+		if (thread_initialized)
+			events[kStream] = steps.Backend()->StreamEvent();
+		events[kCommand] = sys->events_[aout_sys_t::kCommandPosted];
 	}
 
 	sys->thread_initialized_ = thread_initialized;
 	SetEvent(sys->events_[aout_sys_t::kThreadInitialized]);
 
-	bool do_exit = false;
-
 	if (!thread_initialized)
 		goto EXIT;
 
-	local.spatial_render_stream_->Start();
+	steps.Start();
 
 	while (!do_exit)
 	{
-		DWORD wait_result = WaitForMultipleObjects(kEventsNum, events, FALSE, sys->wait_timeout_);
+		// ҋ@ɋNKv͂ȂAfoCX~܂ĂR}h͏ł悤ÃR}hԂԐ݂
+		DWORD wait_result = WaitForMultipleObjects(kEventsNum, events, FALSE, steps.CommandsPending()? sys->wait_timeout_: INFINITE);
 
 		switch (wait_result)
 		{
 		case WAIT_OBJECT_0 + kStream:
-			Stream(sys, &local);
-			break;
-
-		case WAIT_OBJECT_0 + kStop:
-			do_exit = true;
-			break;
-
-		case WAIT_OBJECT_0 + kGetPosition:
-			GetPosition(sys, &local);
+			do_exit = !steps.OnStreamEvent();
 			break;
 
-		case WAIT_OBJECT_0 + kPause:
-			Pause(sys, &local);
+		case WAIT_OBJECT_0 + kCommand:
+			do_exit = !steps.OnCommandPosted();
 			break;
 
-		case WAIT_OBJECT_0 + kFlush:
-			Flush(sys, &local);
-			break;
-
-		case WAIT_OBJECT_0 + kVolume:
-			Volume(sys, &local);
+		case WAIT_TIMEOUT:
+			do_exit = !steps.OnTimeout();
 			break;
 		}
 	}
 
-	StreamWait(sys, &local, sys->stop_wait_);
-	local.spatial_render_stream_->Stop();
-	local.spatial_render_stream_->Reset();
-	ReleaseLocalVariables(&local);
-	
+	steps.Finish();
+
 EXIT:
 	CoUninitialize();
 }
 
-bool CreateLocalVariables(LocalVariables *local_obj, aout_sys_t *sys)
-{
-	try
-	{
-		wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
-		wil::com_ptr<IMMDevice> device;
-		wil::com_ptr<ISpatialAudioClient> client;
-		wil::com_ptr<ISpatialAudioObjectRenderStream> stream;
-		wil::com_ptr<IAudioClock> audio_clock;
-		wil::com_ptr<IAudioStreamVolume> audio_stream_volume;
-		PROPVARIANT stream_property;
-		SpatialAudioObjectRenderStreamActivationParams stream_parameter {};
-		wil::unique_handle stream_event;
-
-		device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>(CLSCTX_INPROC_SERVER);
-		THROW_IF_FAILED(device_enumerator->GetDevice(sys->device_id_.c_str(), &device));
-		THROW_IF_FAILED(device->Activate(__uuidof(ISpatialAudioClient), CLSCTX_INPROC_SERVER, nullptr, client.put_void()));
-
-		stream_event.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
-		THROW_IF_NULL_ALLOC(stream_event.get());
-
-		stream_parameter.ObjectFormat = &sys->output_format_;
-		stream_parameter.StaticObjectTypeMask =
-			AudioObjectType_FrontLeft| AudioObjectType_FrontRight|
-			AudioObjectType_FrontCenter|
-			AudioObjectType_LowFrequency|
-			AudioObjectType_BackLeft| AudioObjectType_BackRight|
-			AudioObjectType_SideLeft| AudioObjectType_SideRight;
-		stream_parameter.MinDynamicObjectCount = 0;
-		stream_parameter.MaxDynamicObjectCount = 0;
-		stream_parameter.Category = AudioCategory_Movie;
-		stream_parameter.EventHandle = stream_event.get();
-		stream_parameter.NotifyObject = nullptr;
-
-		PropVariantInit(&stream_property);
-		stream_property.vt = VT_BLOB;
-		stream_property.blob.cbSize = sizeof (stream_parameter);
-		stream_property.blob.pBlobData = reinterpret_cast<BYTE *>(&stream_parameter);
-
-		THROW_IF_FAILED(client->ActivateSpatialAudioStream(&stream_property, IID_PPV_ARGS(&stream)));
-		THROW_IF_FAILED(stream->GetService(IID_PPV_ARGS(&audio_clock)));
-		THROW_IF_FAILED(audio_clock->GetFrequency(&local_obj->device_frequency_));
-		THROW_IF_FAILED(stream->GetService(IID_PPV_ARGS(&audio_stream_volume)));
-		THROW_IF_FAILED(CreateSpatialAudioObjects(local_obj->spacial_audio_objects_, stream, sys->input_format_.i_physical_channels));
-
-		local_obj->device_ = device;
-		local_obj->spatioal_audio_client_ = client;
-		local_obj->spatial_render_stream_ = stream;
-		local_obj->audio_clock_ = audio_clock;
-		local_obj->audio_stream_volume_ = audio_stream_volume;
-		local_obj->stream_event_ = std::move(stream_event);
-	}
-	catch (wil::ResultException& e)
-	{
+AudioProcessSteps::AudioProcessSteps(aout_sys_t *sys)
+	: sys_(sys),
+	local_(std::make_unique<LocalVariables>())
+{
+	LocalVariables& local = *local_;
+
+	local.volume_ = sys->volume_;
+	local.mute_ = sys->mute_;
+	local.pause_ = false;
+	local.commands_pending_ = false;
+	local.stream_failed_ = false;
+	local.data_started_ = false;
+	local.underrun_ = false;
+	local.gain_ = local.mute_? 0.0f: local.volume_;
+	local.gain_table_constant_ = 0;
+	local.prebuffering_ = false;
+	local.draining_ = false;
+	local.queued_frames_ = 0;
+	local.last_wake_qpc_ = 0;
+	local.last_period_frames_ = 0;
+	local.max_frames_ = 0;
+	local.resampling_ = false;
+	local.resampler_trim_ = 0.0;
+	local.resampler_trimmed_ = 0.0;
+	local.trimming_ = false;
+
+	// v܂ł 20ms Aőł 500ms ڕWɂ
+	local.prebuffer_.Reset(sys->underrun_probability_, sys->input_format_.i_rate / 50, sys->input_format_.i_rate / 2);
+}
+
+AudioProcessSteps::~AudioProcessSteps() = default;
+
+bool AudioProcessSteps::Initialize(std::unique_ptr<RenderBackend> backend)
+{
+	if (!CreateLocalVariables(local_.get(), sys_, std::move(backend)))
 		return false;
-	}
+
+	sys_->trace_.Record(TraceEvent::kStart, QpcNow(), sys_->output_channels_, sys_->input_format_.i_rate, sys_->output_format_.nSamplesPerSec,
+		local_->backend_->DeviceFrequency(), std::llround(sys_->underrun_probability_ * 1.0e6));
 
 	return true;
 }
 
-void ReleaseLocalVariables(LocalVariables *local_obj)
+void AudioProcessSteps::Start()
 {
-	ReleaseSpatialAudioObjects(local_obj);
-	local_obj->device_.reset();
-	local_obj->spatioal_audio_client_.reset();
-	local_obj->spatial_render_stream_.reset();
-	local_obj->audio_clock_.reset();
-	local_obj->audio_stream_volume_.reset();
-	local_obj->stream_event_.reset();
-}
-
-static HRESULT CreateSpatialAudioObjects(std::array<wil::com_ptr<ISpatialAudioObject>, 8>& spacial_audio_objects, wil::com_ptr<ISpatialAudioObjectRenderStream>& spatial_render_stream, uint16_t physical_channels)
-{
-	std::array<wil::com_ptr<ISpatialAudioObject>, 8> temp_spacial_audio_objects;
-	std::vector<AudioObjectType> avilable_channel_types;
-	static constexpr std::pair<uint32_t, AudioObjectType> channel_type_relations[]
-	{
-		std::make_pair(AOUT_CHAN_LEFT, AudioObjectType_FrontLeft),
-		std::make_pair(AOUT_CHAN_RIGHT, AudioObjectType_FrontRight),
-		std::make_pair(AOUT_CHAN_CENTER, AudioObjectType_FrontCenter),
-		std::make_pair(AOUT_CHAN_LFE, AudioObjectType_LowFrequency),
-		std::make_pair(AOUT_CHAN_REARLEFT, AudioObjectType_BackLeft),
-		std::make_pair(AOUT_CHAN_REARRIGHT, AudioObjectType_BackRight),
-		std::make_pair(AOUT_CHAN_MIDDLELEFT, AudioObjectType_SideLeft),
-		std::make_pair(AOUT_CHAN_MIDDLERIGHT, AudioObjectType_SideRight)
-	};
+	StartPrebuffering(sys_, local_.get(), local_->prebuffer_.Target());
+	local_->backend_->Start();
+	GetPosition(sys_, local_.get());
+}
+
+bool AudioProcessSteps::OnStreamEvent()
+{
+	RecordWake(sys_, local_.get());
+
+	// R}h͕`̎n߂ɂ܂Ƃ߂ēKp
+	if (!ProcessCommands(sys_, local_.get()))
+		return false;
+
+	Stream(sys_, local_.get());
+
+	return true;
+}
+
+bool AudioProcessSteps::OnCommandPosted()
+{
+	// ~͕`Ȃ̂ŁAɓKpB
+	// ȃtbVł́Aݍς݂̎ĐɓOɖɂł悤A̎҂ɓKpB
+	if (local_->pause_ || sys_->fast_flush_)
+		return ProcessCommands(sys_, local_.get());
+
+	local_->commands_pending_ = true;
+
+	return true;
+}
+
+bool AudioProcessSteps::OnTimeout()
+{
+	return ProcessCommands(sys_, local_.get());
+}
 
-	// gp`lAudioObjectTypeB
-	for (auto& relation: channel_type_relations)
+bool AudioProcessSteps::CommandsPending() const
+{
+	return local_->commands_pending_;
+}
+
+RenderBackend *AudioProcessSteps::Backend() const
+{
+	return local_->backend_.get();
+}
+
+void AudioProcessSteps::Finish()
+{
+	// Ȍ̓L[Ȃ̂ŁAPlay() ҂Ȃ
+	sys_->render_failed_.store(true, std::memory_order_relaxed);
+	StreamWait(sys_, local_.get(), sys_->stop_wait_);
+	local_->backend_->Stop();
+	local_->backend_->Reset();
+	ReleaseLocalVariables(local_.get());
+}
+
+bool CreateLocalVariables(LocalVariables *local_obj, aout_sys_t *sys, std::unique_ptr<RenderBackend> backend)
+{
+	if (backend)
+		local_obj->backend_ = std::move(backend);
+	else if (BackendType::kSimulated == sys->backend_type_)
+		local_obj->backend_ = CreateSimulatedBackend(sys);
+#if defined(_WIN32)
+	else
+		local_obj->backend_ = CreateSpatialAudioBackend(sys);
+#endif
+
+	if (!local_obj->backend_)
+		return false;
+
+	local_obj->clock_model_.Reset(local_obj->backend_->DeviceFrequency());
+	local_obj->max_frames_ = local_obj->backend_->MaxFrameCount();
+	sys->period_frames_.store(local_obj->max_frames_, std::memory_order_relaxed);
+
+	if (VolumeMode::kStreamVolume != sys->volume_mode_)
+		local_obj->gain_table_.resize(local_obj->max_frames_);
+
+	if (sys->input_format_.i_rate != sys->output_format_.nSamplesPerSec)
 	{
-		if (physical_channels & relation.first)
-			avilable_channel_types.push_back(relation.second);
+		local_obj->resampling_ = local_obj->resampler_.Reset(sys->input_format_.i_rate, sys->output_format_.nSamplesPerSec,
+			sys->output_channels_, sys->resampler_quality_, DetectSimdLevel(), local_obj->max_frames_);
+
+		if (!local_obj->resampling_)
+			return false;
 	}
 
-	// AudioObjectType̒lŏׂ̏ɂƁAchannel_reorder_table_  spacial_audio_objects ̐Ƃ悤ɂĂB
-	std::sort(avilable_channel_types.begin(), avilable_channel_types.end());
+	sys->resampler_frames_.store(0, std::memory_order_relaxed);
 
-	for (int i=0; i<avilable_channel_types.size(); ++i)
-		RETURN_IF_FAILED(spatial_render_stream->ActivateSpatialAudioObject(avilable_channel_types[i], temp_spacial_audio_objects[i].put()));
+	if (sys->latency_target_frames_ && !local_obj->resampling_)
+		local_obj->trimming_ = local_obj->stretcher_.Reset(sys->input_format_.i_rate, sys->output_channels_, local_obj->max_frames_);
 
-	for (int i=0; i<avilable_channel_types.size(); ++i)
-		spacial_audio_objects[i] = temp_spacial_audio_objects[i];
+	sys->stretcher_frames_.store(0, std::memory_order_relaxed);
 
-	return S_OK;
+	return true;
 }
 
-void ReleaseSpatialAudioObjects(LocalVariables *local_obj)
+void ReleaseLocalVariables(LocalVariables *local_obj)
 {
-	for (auto& audio_obj: local_obj->spacial_audio_objects_)
+	local_obj->backend_.reset();
+}
+
+// ܂ĂR}hZēKpASĂ̊ʒmB
+// ʁE~[gEꎞ~͍Ō̎ŵ݁AtbV1񂾂KpB
+// R}h retired_commands_ ŌďõXbhɕԂAł͉ȂB
+// ~vĂ false ԂB
+bool ProcessCommands(aout_sys_t *sys, LocalVariables *local_obj)
+{
+	AudioCommand *commands = sys->commands_.TakeAll();
+	bool volume_changed = false;
+	bool pause = local_obj->pause_;
+	bool flush = false;
+	bool drain = false;
+	bool stop = false;
+
+	local_obj->commands_pending_ = false;
+
+	if (!commands)
+		return true;
+
+	for (AudioCommand *command=commands; command; command=command->next_)
+	{
+		switch (command->type)
+		{
+		case AudioCommand::kVolume:
+			local_obj->volume_ = command->volume;
+			volume_changed = true;
+			break;
+
+		case AudioCommand::kMute:
+			local_obj->mute_ = command->flag;
+			volume_changed = true;
+			break;
+
+		case AudioCommand::kPause:
+			pause = command->flag;
+			break;
+
+		case AudioCommand::kFlush:
+			flush = true;
+			break;
+
+		case AudioCommand::kDrain:
+			drain = true;
+			break;
+
+		case AudioCommand::kStop:
+			stop = true;
+			break;
+		}
+	}
+
+	HRESULT volume_result = S_OK;
+
+	// ꎞ~EtbV̍ŏ̋ŃA̒xƂĐȂ
+	if (flush || (pause != local_obj->pause_))
+		local_obj->last_wake_qpc_ = 0;
+
+	if (flush)
+		Flush(sys, local_obj);
+
+	if (drain)
+		Drain(sys, local_obj);
+
+	if (pause != local_obj->pause_)
 	{
-		if (audio_obj.get())
-			audio_obj.reset();
+		local_obj->pause_ = pause;
+		Pause(sys, local_obj);
+	}
+
+	// \tgEFAʂł́A̕` PrepareGain() Vlւ̕Ԃ
+	if (volume_changed && (VolumeMode::kStreamVolume == sys->volume_mode_))
+		volume_result = Volume(local_obj);
+
+	const LONGLONG completed_qpc = QpcNow();
+
+	while (commands)
+	{
+		AudioCommand *next = commands->next_;
+		const bool is_volume = (AudioCommand::kVolume == commands->type) || (AudioCommand::kMute == commands->type);
+
+		if (AudioCommand::kFlush == commands->type)
+			sys->statistics_.flush_latency.Record(completed_qpc - commands->posted_qpc);
+		else if (AudioCommand::kPause == commands->type)
+			sys->statistics_.pause_latency.Record(completed_qpc - commands->posted_qpc);
+
+		commands->completed.set_value(is_volume? volume_result: S_OK);
+
+		// ԂȂ΂ŉ邵ȂAPostCommand() ̓xɋɂĂ̂Ŗtɂ͂ȂȂ
+		if (!sys->retired_commands_.Push(commands))
+			delete commands;
+
+		commands = next;
 	}
+
+	return !stop;
 }
 
 void Stream(aout_sys_t *sys, LocalVariables *local_obj)
 {
-	UINT32 dynamic_objects;
+	const LONGLONG begin_qpc = QpcNow();
 	UINT32 frames;
 
-	if (SUCCEEDED(local_obj->spatial_render_stream_->BeginUpdatingAudioObjects(&dynamic_objects, &frames)))
+	if (SUCCEEDED(local_obj->backend_->BeginUpdating(&frames)))
 	{
-		std::array<float *, 8> buffers;
+		std::array<float *, kMaxForwardChannels> buffers;
 
-		for (int i=0; i<sys->input_format_.i_channels; ++i)
-		{
-			BYTE *buffer = nullptr;
-			UINT32 buffer_length = 0;
+		// mۂĂobt@Ɏ܂镪Bo͍͐őt[𒴂ԂȂB
+		frames = std::min(frames, local_obj->max_frames_);
+
+		for (int i=0; i<sys->output_channels_; ++i)
+			buffers[i] = local_obj->backend_->GetBuffer(i);
+
+		const int64_t queued_frames = sys->audio_data_frames_.load(std::memory_order_acquire);
+
+		// ؋l߂̑͑O̎܂ł̐ǂ݂̏ԂŌ߂Bǂݒ͐؋l߂ȂB
+		if (local_obj->trimming_)
+			TrimLatency(sys, local_obj, local_obj->prebuffering_? 0: queued_frames, frames);
+		else if (local_obj->resampling_ && sys->latency_target_frames_)
+			TrimResampledLatency(sys, local_obj, local_obj->prebuffering_? 0: queued_frames, frames);
 
-			if (SUCCEEDED(local_obj->spacial_audio_objects_[i]->GetBuffer(&buffer, &buffer_length)))
-				buffers[i] = reinterpret_cast<float *>(buffer);
-			else
-				buffers[i] = nullptr;
+		const bool stretching = local_obj->trimming_ && !local_obj->stretcher_.Idle();
+
+		// ǂ݂ƃL[͓̔͂̃t[ōs
+		size_t input_frames = frames;
+		if (local_obj->resampling_)
+			input_frames = local_obj->resampler_.RequiredInputFrames(frames);
+		else if (stretching)
+			input_frames = local_obj->stretcher_.RequiredInputFrames(frames);
+
+		sys->statistics_.period_frames.Record(frames);
+		sys->period_frames_.store(frames, std::memory_order_relaxed);
+		sys->render_failed_.store(false, std::memory_order_relaxed);
+		sys->statistics_.queued_frames.Record(std::max<int64_t>(queued_frames, 0));
+		sys->statistics_.queued_blocks.Record(sys->audio_data_queue_.Size());
+		local_obj->last_period_frames_ = frames;
+
+		if (local_obj->prebuffering_)
+		{
+			if (queued_frames >= std::max<int64_t>(sys->prebuffer_frames_.load(std::memory_order_relaxed), input_frames))
+			{
+				local_obj->prebuffering_ = false;
+				sys->prebuffer_frames_.store(0, std::memory_order_relaxed);
+			}
 		}
+		else
+		{
+			// ǂ݂ŗ߂ĂԂ̓́Ah炬̓vɊ܂߂Ȃ
+			local_obj->prebuffer_.Update(queued_frames - local_obj->queued_frames_, input_frames);
+		}
+
+		// o͂̉ʂ̌vBL[炻̂܂ܓ]ꍇ͓]֐ŋ߁AȊO͏񂾌ɓǂݒB
+		const bool metering = (MeterMode::kOff != sys->meter_mode_);
+		const std::array<float *, kMaxForwardChannels> period_buffers = buffers;
+		ChannelLevels levels {};
+		bool levels_fused = false;
+
+		// L[ɂ镪]AȂ͖Ŗ߂
+		const size_t available_frames = local_obj->prebuffering_? 0: static_cast<size_t>(std::clamp<int64_t>(queued_frames, 0, input_frames));
+		const LONGLONG forward_qpc = QpcNow();
+		size_t forward_frames;
 
+		if (local_obj->resampling_)
+		{
+			// ϊɎcĂ镪́Aǂݒło
+			forward_frames = ForwardResampledData(buffers.data(), sys, local_obj, frames, available_frames);
+		}
+		else if (stretching)
 		{
-			std::lock_guard lock(sys->mutex_);
+			// ԐLkɎcĂ镪Aǂݒło
+			forward_frames = ForwardStretchedData(buffers.data(), sys, local_obj, frames, available_frames);
+		}
+		else
+		{
+			forward_frames = available_frames;
 
-			if (frames <= sys->audio_data_frames_)
-				ForwardAudioData(buffers.data(), sys, frames);
-			else
-				// TimeGetł̃fBCZô߁AL[̃f[^săobt@ɏ܂Ȃꍇłframes_written_ɉZĂ
-				sys->frames_written_ += frames;
+			if (forward_frames)
+			{
+				// TimeGet() L[Ƃ̘aǂނ̂ŁA]̑OɉZĂ
+				sys->frames_written_.fetch_add(forward_frames, std::memory_order_relaxed);
+
+				// buffers ̊e|C^͓]i
+				levels_fused = metering && !sys->convert_on_play_;
+				ForwardQueuedData(buffers.data(), sys, forward_frames, PrepareGain(sys, local_obj, frames), levels_fused? &levels: nullptr);
+			}
 		}
 
-		local_obj->spatial_render_stream_->EndUpdatingAudioObjects();
-	}
-}
+		const size_t padding_frames = frames - forward_frames;
 
-void GetPosition(aout_sys_t *sys, LocalVariables *local_obj)
-{
-	HRESULT com_result;
-	UINT64 device_position;
-	UINT64 qpc_position;
+		if (forward_frames)
+		{
+			if (metering && !levels_fused)
+				sys->measure_levels_(period_buffers.data(), sys->output_channels_, forward_frames, &levels);
 
-	com_result = local_obj->audio_clock_->GetPosition(&device_position, &qpc_position);
-	sys->thread_request_result_ = com_result;
+			sys->statistics_.forward_duration.Record(QpcNow() - forward_qpc);
+		}
+		else
+		{
+			// ނ̂ŁAʂ͕Ԃɐؑւ
+			local_obj->gain_ = local_obj->mute_? 0.0f: local_obj->volume_;
+			local_obj->gain_table_constant_ = 0;
+		}
 
-	if (SUCCEEDED(com_result))
+		if (padding_frames)
+		{
+			for (int i=0; i<sys->output_channels_; ++i)
+			{
+				if (buffers[i])
+					std::fill_n(buffers[i], padding_frames, 0.0f);
+			}
+
+			// TimeGetł̃fBCZô߁AŖ߂frames_written_ɉZĂ
+			sys->frames_written_.fetch_add(padding_frames, std::memory_order_relaxed);
+
+			// o玟̍ĐɔĐǂ݂ɖ߂BXg[̏IȂ̂ŁAA_[ɂ͐ȂB
+			// JnEtbṼf[^҂A_[ɐȂB
+			if (local_obj->draining_)
+			{
+				local_obj->draining_ = false;
+				local_obj->data_started_ = false;
+				StartPrebuffering(sys, local_obj, local_obj->prebuffer_.Target());
+			}
+			else if (local_obj->data_started_)
+			{
+				if (!local_obj->underrun_)
+				{
+					sys->underruns_.fetch_add(1, std::memory_order_relaxed);
+
+					// ڕWグA̐[܂ŗߒĂĊJ
+					local_obj->prebuffer_.NotifyUnderrun();
+					StartPrebuffering(sys, local_obj, local_obj->prebuffer_.Target());
+				}
+
+				sys->padded_frames_.fetch_add(padding_frames, std::memory_order_relaxed);
+			}
+
+			local_obj->underrun_ = true;
+		}
+		else
+		{
+			local_obj->data_started_ = true;
+			local_obj->underrun_ = false;
+		}
+
+		// Ŗ߂܂߂āAŜvlɉ
+		if (metering)
+			sys->level_meter_.AddPeriod(levels, period_buffers.data(), frames);
+
+		local_obj->backend_->EndUpdating();
+		sys->trace_.Record(TraceEvent::kStream, begin_qpc, frames, queued_frames, available_frames, forward_frames, QpcNow() - begin_qpc);
+	}
+	else
 	{
-		sys->device_second_position_ =  device_position / local_obj->device_frequency_;
-		sys->device_micro_socond_position_ = ((device_position % local_obj->device_frequency_) * 1000 * 1000) / local_obj->device_frequency_;
-		sys->qpc_position = qpc_position;
+		local_obj->stream_failed_ = true;
+		sys->render_failed_.store(true, std::memory_order_relaxed);
 	}
 
-	SetEvent(sys->events_[aout_sys_t::kGetPositionCompleted]);
+	local_obj->queued_frames_ = sys->audio_data_frames_.load(std::memory_order_acquire);
+
+	GetPosition(sys, local_obj);
+	sys->statistics_.stream_duration.Record(QpcNow() - begin_qpc);
+}
+
+// TimeGet() ďõXbhŌvZł悤AĐʒu̐J
+void GetPosition(aout_sys_t *sys, LocalVariables *local_obj)
+{
+	const LONGLONG begin_qpc = QpcNow();
+	ClockSnapshot clock {};
+	UINT64 device_position = 0;
+	UINT64 qpc_position = 0;
+
+	clock.result = local_obj->backend_->GetPosition(&device_position, &qpc_position);
+	if (SUCCEEDED(clock.result))
+		local_obj->clock_model_.Update(device_position, qpc_position);
+
+	clock.estimate = local_obj->clock_model_.Current();
+	clock.drift_ppm = static_cast<float>(local_obj->clock_model_.DriftPpm());
+	clock.delay_variance = static_cast<float>(local_obj->clock_model_.DelayVariance());
+	sys->clock_snapshot_.Store(clock);
+
+	const LONGLONG duration = QpcNow() - begin_qpc;
+	sys->statistics_.position_duration.Record(duration);
+	sys->trace_.Record(TraceEvent::kPosition, begin_qpc, 0, device_position, qpc_position, clock.result, duration);
 }
 
 void Pause(aout_sys_t *sys, LocalVariables *local_obj)
 {
-	if (sys->pause_)
-		local_obj->spatial_render_stream_->Stop();
+	sys->trace_.Record(TraceEvent::kPause, QpcNow(), local_obj->pause_? 1: 0);
+
+	if (local_obj->pause_)
+		local_obj->backend_->Stop();
 	else
-		local_obj->spatial_render_stream_->Start();
+		local_obj->backend_->Start();
 
-	SetEvent(sys->events_[aout_sys_t::kPauseCompleted]);
+	local_obj->clock_model_.SetRunning(!local_obj->pause_);
+	GetPosition(sys, local_obj);
 }
 
 void Flush(aout_sys_t *sys, LocalVariables *local_obj)
 {
+	const LONGLONG begin_qpc = QpcNow();
+	const int64_t queued_frames = sys->audio_data_frames_.load(std::memory_order_acquire);
+
+	while (QueuedBlock<block_t> *front = sys->audio_data_queue_.Front())
 	{
-		std::lock_guard lock(sys->mutex_);
+		sys->audio_data_frames_.fetch_sub(front->block->i_nb_samples, std::memory_order_relaxed);
+		RetireBlock(sys, front->block);
+		sys->audio_data_queue_.Pop();
+	}
 
-		while (!sys->audio_data_queue_.empty())
-		{
-			block_Release(sys->audio_data_queue_.front());
-			sys->audio_data_queue_.pop();
-		}
+	if (sys->convert_on_play_)
+		sys->audio_data_frames_.fetch_sub(sys->planar_ring_.Clear(), std::memory_order_relaxed);
 
-		sys->audio_data_frames_ = 0;
-		sys->frames_written_ = 0;
+	if (local_obj->resampling_)
+	{
+		local_obj->resampler_.Clear();
+		local_obj->resampler_.SetTrim(0.0);
+		local_obj->resampler_trim_ = 0.0;
+		local_obj->resampler_trimmed_ = 0.0;
+		sys->resampler_frames_.store(0, std::memory_order_relaxed);
+	}
+
+	if (local_obj->trimming_)
+	{
+		local_obj->stretcher_.Clear();
+		sys->stretcher_frames_.store(0, std::memory_order_relaxed);
+	}
+
+	local_obj->data_started_ = false;
+	local_obj->underrun_ = false;
+	local_obj->draining_ = false;
+	local_obj->queued_frames_ = sys->audio_data_frames_.load(std::memory_order_acquire);
+
+	// Đŕ`̍XVȂAXg[ƃIuWFNg͂̂܂܎gB
+	// ̎̓L[Ȃ̂Ŗ܂AĐʒuA܂܂Ȃ̂ frames_written_ ߂ȂB
+	// foCXɓnς݂ł܂ĐĂȂ͖ɂ̂ŁAtbVỎ͍Đ̎̎c肾B
+	// Đ͓r؂ꂸɑĂ̂ŁAߒ̂1ɂāAVLC ܂Ƃ߂đVɏoB
+	const bool keep_stream = sys->fast_flush_ && !local_obj->pause_ && !local_obj->stream_failed_;
+	sys->trace_.Record(TraceEvent::kFlush, begin_qpc, 0, queued_frames - local_obj->queued_frames_, keep_stream? 0: 1);
+
+	if (keep_stream)
+	{
+		local_obj->backend_->SilencePending();
+		StartPrebuffering(sys, local_obj, local_obj->last_period_frames_);
+		GetPosition(sys, local_obj);
+		return;
 	}
 
+	StartPrebuffering(sys, local_obj, local_obj->prebuffer_.Target());
+
+	// ꎞ~̓foCXɓnς݂̃f[^ĊJɖĂ܂̂ŁAXg[ƃZbg
+	local_obj->stream_failed_ = false;
+	sys->frames_written_.store(0, std::memory_order_relaxed);
+
 	StreamWait(sys, local_obj, sys->flush_wait_);
-	local_obj->spatial_render_stream_->Stop();
-	local_obj->spatial_render_stream_->Reset();
+	local_obj->backend_->Stop();
+	local_obj->backend_->Reset();
 
 	// ResetSpatialAudioObjectANeBuɂȂ邽߁AēxLɂ
-	ReleaseSpatialAudioObjects(local_obj);
-	CreateSpatialAudioObjects(local_obj->spacial_audio_objects_, local_obj->spatial_render_stream_, sys->input_format_.i_physical_channels);
+	local_obj->backend_->ActivateObjects();
 	
-	local_obj->spatial_render_stream_->Start();
+	// ꎞ~̃tbVł͍ĐĊJȂ
+	if (!local_obj->pause_)
+		local_obj->backend_->Start();
 
-	SetEvent(sys->events_[aout_sys_t::kFlushCompleted]);
+	GetPosition(sys, local_obj);
 }
 
-void Volume(aout_sys_t *sys, LocalVariables *local_obj)
+// VLC Ō܂ōĐ̂҂OɑBǂݒłAL[ɂ镪 (ڕWɑȂI̕) ̂܂܏oB
+void Drain(aout_sys_t *sys, LocalVariables *local_obj)
+{
+	local_obj->draining_ = true;
+	local_obj->prebuffering_ = false;
+	sys->prebuffer_frames_.store(0, std::memory_order_relaxed);
+}
+
+HRESULT Volume(LocalVariables *local_obj)
 {
-	HRESULT com_result;
 	float volume;
-	UINT32 channels;
 
-	if (sys->mute_)
+	if (local_obj->mute_)
 		volume = 0.0f;
 	else
-		volume = sys->volume_;
+		volume = local_obj->volume_;
 
-	com_result = local_obj->audio_stream_volume_->GetChannelCount(&channels);
+	return local_obj->backend_->SetVolume(volume);
+}
 
-	if (SUCCEEDED(com_result))
+// ̎Ŋ|t[̔{pӂB
+// ʂςĂ΁AO̔{1ĐV{ɋ߂ÂB
+// {|KvȂ nullptr ԂB
+// o͐͋̎ԂƂȀꍇ͕ԂɎ̎֎z (݂ 0 ZɂȂAŌ̃t[)B
+const float *PrepareGain(const aout_sys_t *sys, LocalVariables *local_obj, size_t frames)
+{
+	if ((VolumeMode::kStreamVolume == sys->volume_mode_) || !frames)
+		return nullptr;
+
+	const float target = local_obj->mute_? 0.0f: local_obj->volume_;
+	const float current = local_obj->gain_;
+
+	// ͍őt[܂łɐ؋l߂Ă̂ŁACreateLocalVariables() Ŋmۂ傫Ɏ܂
+	frames = std::min(frames, local_obj->gain_table_.size());
+
+	float *table = local_obj->gain_table_.data();
+
+	if (current == target)
 	{
-		for (UINT32 i=0; i<channels; ++i)
+		if (1.0f == target)
+			return nullptr;
+
+		// ̔{͈x߂Ă΁Aʂς܂ŏKv͂Ȃ
+		if (local_obj->gain_table_constant_ < frames)
 		{
-			com_result = local_obj->audio_stream_volume_->SetChannelVolume(i, volume);
-			if (FAILED(com_result))
-				break;
+			std::fill(table + local_obj->gain_table_constant_, table + frames, target);
+			local_obj->gain_table_constant_ = frames;
 		}
+
+		return table;
 	}
 
-	sys->thread_request_result_ = com_result;
-	SetEvent(sys->events_[aout_sys_t::kVolumeCompleted]);
-}
+	if (VolumeMode::kLinearRamp == sys->volume_mode_)
+	{
+		const float step = (target - current) / frames;
 
-void ForwardAudioData(float *buffers[8], aout_sys_t *sys, size_t frames)
-{
-	while (frames)
+		for (size_t i=0; i<frames; ++i)
+			table[i] = current + step * (i + 1);
+	}
+	else
 	{
-		block_t *block = sys->audio_data_queue_.front();
+		const float from = std::max(current, kMinimumRampGain);
+		const float ratio = std::pow(std::max(target, kMinimumRampGain) / from, 1.0f / frames);
+		float gain = from;
 
-		while (0 == block->i_nb_samples)
+		for (size_t i=0; i<frames; ++i)
 		{
-			block_Release(block);
-			sys->audio_data_queue_.pop();
-			block = sys->audio_data_queue_.front();
+			gain *= ratio;
+			table[i] = gain;
 		}
+	}
+
+	// ۂߌ덷cȂ悤ȀI͂傤ǖڕW̔{ɂ
+	table[frames - 1] = target;
+
+	local_obj->gain_ = target;
+	local_obj->gain_table_constant_ = 0;
 
-		size_t copy_frames = std::min(frames, static_cast<size_t>(block->i_nb_samples));
+	return table;
+}
 
-		ForwardAudioDataBlock(buffers, sys, block, copy_frames);
+// L[ frames t[ (1ɖȂ1) ܂܂ŁA]~߂BTimeGet() ͂̊ԂL[̎ۂ̐[ŃfBCԂB
+// frames ͒ʏ͐ǂ݂̖ڕWŁAȃtbVł1ɂB
+void StartPrebuffering(aout_sys_t *sys, LocalVariables *local_obj, int64_t frames)
+{
+	if (sys->underrun_probability_ <= 0.0)
+		return;
 
-		// ݐ|C^̍XV
-		for (int channel=0; channel<sys->input_format_.i_channels; ++channel)
+	local_obj->prebuffering_ = true;
+	sys->prebuffer_frames_.store(frames, std::memory_order_relaxed);
+	sys->prebuffer_target_.store(local_obj->prebuffer_.Target(), std::memory_order_relaxed);
+}
+
+// L[̃ubNA܂ Play() ŕϊς݂̃O frames t[ buffers ɓ]Bbuffers ̊e|C^͓]iށB
+// levels ͓]֐ł̌vɎĝŁAOʂꍇ (convert_on_play_)  nullptr ɂ邱ƁB
+static void ForwardQueuedData(float *buffers[kMaxForwardChannels], aout_sys_t *sys, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	if (sys->convert_on_play_)
+		ForwardPlanarData(buffers, sys, frames, gain);
+	else
+		ForwardAudioData(buffers, sys, frames, gain, levels);
+}
+
+// L[ő input_frames t[ϊɑA邾̏o͂ buffers ɏB
+// ̕ϊƕւ͕ϊւ̓]ŁA{͕ϊŊ|Bbuffers ̊e|C^͏i݁At[ԂB
+// 𑬂߂Đ؋l߂ĂԂ́Aڂ̔葽͂ trimmed_frames_ ɉB
+static size_t ForwardResampledData(float *buffers[kMaxForwardChannels], aout_sys_t *sys, LocalVariables *local_obj, size_t frames, size_t input_frames)
+{
+	Resampler& resampler = local_obj->resampler_;
+	const double buffered_frames = resampler.BufferedFrames();
+
+	if (input_frames)
+	{
+		float *planes[kMaxForwardChannels];
+
+		resampler.InputPlanes(planes);
+		input_frames = std::min(input_frames, resampler.InputCapacity());
+
+		sys->resampler_frames_.fetch_add(input_frames, std::memory_order_relaxed);
+		ForwardQueuedData(planes, sys, input_frames, nullptr, nullptr);
+		resampler.CommitInput(input_frames);
+	}
+
+	const size_t output_frames = resampler.AvailableOutputFrames(frames);
+
+	if (output_frames)
+	{
+		resampler.Process(buffers, output_frames, PrepareGain(sys, local_obj, frames));
+
+		for (int i=0; i<sys->output_channels_; ++i)
 		{
-			if (buffers[channel])
-				buffers[channel] += copy_frames;
+			if (buffers[i])
+				buffers[i] += output_frames;
 		}
+	}
 
-		frames -= copy_frames;
+	sys->frames_written_.fetch_add(output_frames, std::memory_order_relaxed);
+	sys->resampler_frames_.store(std::llround(resampler.BufferedFrames()), std::memory_order_relaxed);
+
+	if (0.0 != local_obj->resampler_trim_)
+	{
+		const double consumed_frames = buffered_frames + input_frames - resampler.BufferedFrames();
+		local_obj->resampler_trimmed_ += consumed_frames - static_cast<double>(output_frames) * sys->input_format_.i_rate / sys->output_format_.nSamplesPerSec;
+
+		const int64_t trimmed_frames = static_cast<int64_t>(local_obj->resampler_trimmed_);
+		sys->trimmed_frames_.fetch_add(trimmed_frames, std::memory_order_relaxed);
+		local_obj->resampler_trimmed_ -= trimmed_frames;
 	}
+
+	return output_frames;
 }
 
-void ForwardAudioDataBlock(float *const buffers[8], aout_sys_t *sys, block_t *block, size_t frames)
+// L[x̖ڕW𒴂ė܂Ă΁AڕWɖ߂܂ŎԐLkő߂ɏB
+// ǂ݂̖ڕW󂭂ƃA_[̂ŁAڕW͐ǂ݂̖ڕW1𑫂̂󂭂ȂB
+static void TrimLatency(const aout_sys_t *sys, LocalVariables *local_obj, int64_t queued_frames, size_t frames)
 {
-	float *src = reinterpret_cast<float *>(block->p_buffer);
-	const uint8_t channels = sys->input_format_.i_channels;
+	TimeStretcher& stretcher = local_obj->stretcher_;
+	const int64_t target = std::max<int64_t>(sys->latency_target_frames_, local_obj->prebuffer_.Target() + frames);
+	const int64_t excess = queued_frames - target;
 
-	for (size_t frame=0; frame<frames; ++frame)
+	if (1.0 == stretcher.Tempo())
 	{
-		for (int channel=0; channel<channels; ++channel)
-		{
-			if (buffers[channel])
-				*(buffers[channel] + frame) = src[sys->channel_reorder_table_[channel]];
-		}
+		if (excess <= target * kTrimStartFraction)
+			return;
+	}
+	else if (excess <= 0)
+	{
+		stretcher.SetTempo(1.0);
+		return;
+	}
+
+	const double trim = std::clamp(excess / (kCatchUpSeconds * sys->input_format_.i_rate), kMinimumTrim, kMaximumTrim);
+	stretcher.SetTempo(1.0 + trim);
+}
+
+// TrimLatency() ƓڕWƎnߕŁAϊ̔𑬂߂Ēx؋l߂Bframes ͏o͂̃t[B
+// ͖ڕW𒴂 kCatchUpSeconds bŏ鑬AkMaximumResamplerTrimPpm œłɂȂB
+static void TrimResampledLatency(const aout_sys_t *sys, LocalVariables *local_obj, int64_t queued_frames, size_t frames)
+{
+	const int64_t target = std::max<int64_t>(sys->latency_target_frames_, local_obj->prebuffer_.Target() + local_obj->resampler_.RequiredInputFrames(frames));
+	const int64_t excess = queued_frames - target;
+	double trim = 0.0;
 
-		src += sys->input_format_.i_channels;
+	if (0.0 == local_obj->resampler_trim_)
+	{
+		if (excess <= target * kTrimStartFraction)
+			return;
+	}
+
+	if (excess > 0)
+		trim = std::min(excess / (kCatchUpSeconds * sys->input_format_.i_rate) * 1.0e6, kMaximumResamplerTrimPpm);
+
+	if (trim != local_obj->resampler_trim_)
+	{
+		local_obj->resampler_.SetTrim(trim);
+		local_obj->resampler_trim_ = trim;
+	}
+}
+
+// L[ő input_frames t[ԐLkɑAő frames t[̏o͂ buffers ɏB
+// {͎ԐLk̏o͂Ɋ|Bbuffers ̊e|C^͏i݁At[ԂB
+// frames_written_ ɂ͏t[𑫂̂ŁA߂ɏ̓L[fBCɕ\B
+static size_t ForwardStretchedData(float *buffers[kMaxForwardChannels], aout_sys_t *sys, LocalVariables *local_obj, size_t frames, size_t input_frames)
+{
+	TimeStretcher& stretcher = local_obj->stretcher_;
+	const int64_t trimmed_frames = stretcher.TrimmedFrames();
+
+	if (input_frames)
+	{
+		float *planes[kMaxForwardChannels];
+
+		stretcher.InputPlanes(planes);
+		input_frames = std::min(input_frames, stretcher.InputCapacity());
+
+		sys->stretcher_frames_.fetch_add(input_frames, std::memory_order_relaxed);
+		ForwardQueuedData(planes, sys, input_frames, nullptr, nullptr);
+		stretcher.CommitInput(input_frames);
 	}
 
-	block->p_buffer += sizeof(float) * channels * frames;
-	block->i_buffer -= sizeof(float) * channels * frames;
-	block->i_nb_samples -= frames;
-	sys->audio_data_frames_ -= frames;
-	sys->frames_written_ += frames;
+	const size_t output_frames = stretcher.Process(buffers, frames, PrepareGain(sys, local_obj, frames));
+
+	for (int i=0; i<sys->output_channels_; ++i)
+	{
+		if (buffers[i])
+			buffers[i] += output_frames;
+	}
+
+	sys->frames_written_.fetch_add(output_frames, std::memory_order_relaxed);
+	sys->stretcher_frames_.store(stretcher.BufferedFrames(), std::memory_order_relaxed);
+	sys->trimmed_frames_.fetch_add(stretcher.TrimmedFrames() - trimmed_frames, std::memory_order_relaxed);
+
+	return output_frames;
 }
 
 // ISpatialAudioObjectRenderStreamBase::Reset ĂŐĂ
@@ -408,20 +1051,52 @@ static void StreamWait(const aout_sys_t *sys, const LocalVariables *local_obj, i
 {
 	for (int n=0; n<wait_loops; ++n)
 	{
-		UINT32 dynamic_objects;
 		UINT32 frames;
-		BYTE *buffer;
-		UINT32 buffer_length;
 
-		if (WAIT_OBJECT_0 != WaitForSingleObject(local_obj->stream_event_.get(), sys->wait_timeout_))
+		if (WAIT_OBJECT_0 != WaitForSingleObject(local_obj->backend_->StreamEvent(), sys->wait_timeout_))
 			continue;
 
-		local_obj->spatial_render_stream_->BeginUpdatingAudioObjects(&dynamic_objects, &frames);
+		if (FAILED(local_obj->backend_->BeginUpdating(&frames)))
+			continue;
 		
-		for (int i=0; i<sys->input_format_.i_channels; ++i)
-			local_obj->spacial_audio_objects_[i]->GetBuffer(&buffer, &buffer_length);
+		for (int i=0; i<sys->output_channels_; ++i)
+			local_obj->backend_->GetBuffer(i);
+
+		local_obj->backend_->EndUpdating();
+	}
+}
+
+static LONGLONG QpcNow()
+{
+	LARGE_INTEGER count;
+
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+}
+
+// `̋NAŐNO̎̃t[̎ԂxĂ΁A̒xL^
+static void RecordWake(aout_sys_t *sys, LocalVariables *local_obj)
+{
+	const LONGLONG now = QpcNow();
+
+	if (local_obj->last_wake_qpc_ && local_obj->last_period_frames_)
+	{
+		const LONGLONG period = static_cast<LONGLONG>(local_obj->last_period_frames_) * sys->qpc_frequency_.QuadPart / sys->output_format_.nSamplesPerSec;
+		const LONGLONG lateness = now - local_obj->last_wake_qpc_ - period;
 
-		local_obj->spatial_render_stream_->EndUpdatingAudioObjects();
+		sys->statistics_.wake_lateness.Record((lateness > 0)? lateness: 0);
 	}
+
+	local_obj->last_wake_qpc_ = now;
 }
 
+static void CloseEvents(aout_sys_t *sys)
+{
+	for (auto& event: sys->events_)
+	{
+		if (event)
+			CloseHandle(event);
+
+		event = nullptr;
+	}
+}
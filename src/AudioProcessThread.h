@@ -1,6 +1,69 @@
 #pragma once
 
-#include "depends.h"
+#include "RenderBackend.h"
 #include "aout_sys.h"
 
+#include <future>
+#include <memory>
+
+struct LocalVariables;
+
 void AudioProcessThread(aout_sys_t *sys);
+
+// I[fBIXbh̏ANꂽR1ii߂́BAudioProcessThread() ̓Cxg҂ĂĂԁB
+// eXgƃx`}[ŃAXbhNɓďõXbhi߂B
+// Initialize() ȊO͕`̏Ȃ̂ŁAmہEȂB
+class AudioProcessSteps
+{
+public:
+	explicit AudioProcessSteps(aout_sys_t *sys);
+	~AudioProcessSteps();
+
+	// o͐A`Ŏgobt@mۂBsꍇ false ԂB
+	// backend ^ƁAsys->backend_type_ Ɉ˂炸o͐ɂ (x`}[Nzœo͂^̂Ɏg)B
+	bool Initialize(std::unique_ptr<RenderBackend> backend = nullptr);
+
+	// ǂ݂n߁Ao͐Đ
+	void Start();
+
+	// `̒ʒmB܂ĂR}hKpĂށB~vĂ false ԂB
+	bool OnStreamEvent();
+
+	// R}h̒ʒmB~͕`Ȃ̂łɓKpAȊO͎̕`܂ő҂B~vĂ false ԂB
+	bool OnCommandPosted();
+
+	// CommandsPending() ̊Ԃ̑҂̎Ԑ؂B܂ĂR}hKpB~vĂ false ԂB
+	bool OnTimeout();
+
+	// ̕`܂ő҂ĂR}h邩
+	bool CommandsPending() const;
+
+	RenderBackend *Backend() const;
+
+	// o͐~߂ĉ
+	void Finish();
+
+private:
+	aout_sys_t *sys_;
+	std::unique_ptr<LocalVariables> local_;
+};
+
+// o͂̌vACxgăI[fBIXbhNBXbh̏I܂ő҂Asꍇ false ԂB
+// sys ̐ݒ (tH[}bgE]֐Eo͐Ȃ) ͌ĂԑOɍς܂ĂƁB
+bool StartAudioProcessThread(aout_sys_t *sys);
+
+// I[fBIXbh~ďI҂AcR}hƃubNăCxg
+void StopAudioProcessThread(aout_sys_t *sys);
+
+// VLC ̃R[obÑXbhI[fBIXbhփR}h𑗂BɁAR}hB
+std::future<HRESULT> PostCommand(aout_sys_t *sys, AudioCommand::Type type, float volume, bool flag);
+
+// TimeGet() ̃fBC (}CNb) AQPC ̃JEg now_qpc ̎_ŋ߂BI[fBIXbhJlǂށB
+// Đʒu܂ĂȂ false ԂB
+bool GetDelay(const aout_sys_t *sys, LONGLONG now_qpc, int64_t *delay);
+
+// I[fBIXbhgIubNBreleased_blocks_ ̏҂Ȃ̂ŁAPlay() ̃Xbĥ݌ĂԂƁB
+void ReleaseRetiredBlocks(aout_sys_t *sys);
+
+// I[fBIXbhR}hBretired_commands_ ̏҂Ȃ̂ŁAVLC ̃R[obN̂݌ĂԂƁB
+void ReleaseRetiredCommands(aout_sys_t *sys);
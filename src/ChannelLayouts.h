@@ -0,0 +1,131 @@
+#pragma once
+
+#include "ForwardKernels.h"
+#include "ForwardLayouts.h"
+#include "ObjectLayout.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// VLC ̃`l\Əo͂̃IuWFNg̑ΉAэ\̐p̓]֐B
+// VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAx`}[NeXg mss.cpp Ɠ\gB
+
+// vlc_aout.h  AOUT_CHAN_* ƓlBv mss.cpp Ŋm߂ĂB
+enum : uint32_t
+{
+	kChanCenter = 0x1,
+	kChanLeft = 0x2,
+	kChanRight = 0x4,
+	kChanRearCenter = 0x10,
+	kChanRearLeft = 0x20,
+	kChanRearRight = 0x40,
+	kChanMiddleLeft = 0x100,
+	kChanMiddleRight = 0x200,
+	kChanLfe = 0x1000
+};
+
+// vlc_aout.h  AOUT_CHANS_* Ɠl
+enum : uint16_t
+{
+	kChans2_0 = kChanLeft | kChanRight,
+	kChans2_1 = kChans2_0 | kChanLfe,
+	kChans3_0 = kChans2_0 | kChanCenter,
+	kChans3_1 = kChans3_0 | kChanLfe,
+	kChans4_0 = kChans2_0 | kChanRearLeft | kChanRearRight,
+	kChans4_1 = kChans4_0 | kChanLfe,
+	kChans4CenterRear = kChans3_0 | kChanRearCenter,
+	kChans4_0Middle = kChans2_0 | kChanMiddleLeft | kChanMiddleRight,
+	kChans5_0 = kChans4_0 | kChanCenter,
+	kChans5_0Middle = kChans4_0Middle | kChanCenter,
+	kChans5_1 = kChans5_0 | kChanLfe,
+	kChans5_1Middle = kChans5_0Middle | kChanLfe,
+	kChans6_0 = kChans4_0 | kChanMiddleLeft | kChanMiddleRight,
+	kChans6_1Middle = kChans5_1Middle | kChanRearCenter,
+	kChans7_0 = kChans6_0 | kChanCenter,
+	kChans7_1 = kChans7_0 | kChanLfe,
+	kChans8_1 = kChans7_1 | kChanRearCenter
+};
+
+// VLC ̃C^[[u (pi_vlc_chan_order_wg4 Ɠ)
+constexpr uint32_t kInputChannelOrder[] =
+{
+	kChanLeft, kChanRight,
+	kChanMiddleLeft, kChanMiddleRight,
+	kChanRearLeft, kChanRearRight, kChanRearCenter,
+	kChanCenter,
+	kChanLfe
+};
+
+// o͂̃obt@̏Be`l kOutputChannelObjects ̓ʒũIuWFNgɏôŁAObjectChannel ̏ƓɂȂB
+constexpr uint32_t kOutputChannelOrder[] =
+{
+	kChanLeft, kChanRight,
+	kChanCenter,
+	kChanLfe,
+	kChanMiddleLeft, kChanMiddleRight,
+	kChanRearLeft, kChanRearRight,
+	kChanRearCenter
+};
+
+constexpr ObjectChannel kOutputChannelObjects[] =
+{
+	ObjectChannel::kFrontLeft, ObjectChannel::kFrontRight,
+	ObjectChannel::kFrontCenter,
+	ObjectChannel::kLowFrequency,
+	ObjectChannel::kSideLeft, ObjectChannel::kSideRight,
+	ObjectChannel::kBackLeft, ObjectChannel::kBackRight,
+	ObjectChannel::kBackCenter
+};
+
+static_assert(std::size(kOutputChannelOrder) == std::size(kOutputChannelObjects), "kOutputChannelOrder and kOutputChannelObjects must match");
+
+// Start() ō̂Ɠւ\A`l\ɃRpCɋ߂Ă
+template <uint16_t Mask>
+constexpr std::array<uint8_t, kMaxForwardChannels> kLayoutReorder = MakeLayoutReorder(kInputChannelOrder, kOutputChannelOrder, Mask);
+
+template <uint16_t Mask, size_t... Index>
+constexpr DeinterleaveFunction MakeLayoutDeinterleaveFunction(std::index_sequence<Index...>)
+{
+	return LayoutKernel<kLayoutReorder<Mask>[Index]...>::Deinterleave;
+}
+
+template <uint16_t Mask>
+constexpr DeinterleaveFunction kLayoutDeinterleaveFunction =
+	MakeLayoutDeinterleaveFunction<Mask>(std::make_index_sequence<CountLayoutChannels(Mask)>());
+
+struct ChannelLayout
+{
+	const char *name;
+	uint16_t mask;
+	DeinterleaveFunction deinterleave;
+};
+
+template <uint16_t Mask>
+constexpr ChannelLayout MakeChannelLayout(const char *name)
+{
+	return ChannelLayout {name, Mask, kLayoutDeinterleaveFunction<Mask>};
+}
+
+// p̓]֐`l\BAOUT_CHANS_8_1 Ɏ܂ AOUT_CHANS_* ̑SāB
+constexpr ChannelLayout kChannelLayouts[] =
+{
+	MakeChannelLayout<kChans2_0>("2.0"),
+	MakeChannelLayout<kChans2_1>("2.1"),
+	MakeChannelLayout<kChans3_0>("3.0"),
+	MakeChannelLayout<kChans3_1>("3.1"),
+	MakeChannelLayout<kChans4_0>("4.0"),
+	MakeChannelLayout<kChans4_1>("4.1"),
+	MakeChannelLayout<kChans4CenterRear>("4.0-center-rear"),
+	MakeChannelLayout<kChans4_0Middle>("4.0-middle"),
+	MakeChannelLayout<kChans5_0>("5.0"),
+	MakeChannelLayout<kChans5_0Middle>("5.0-middle"),
+	MakeChannelLayout<kChans5_1>("5.1"),
+	MakeChannelLayout<kChans5_1Middle>("5.1-middle"),
+	MakeChannelLayout<kChans6_0>("6.0"),
+	MakeChannelLayout<kChans6_1Middle>("6.1-middle"),
+	MakeChannelLayout<kChans7_0>("7.0"),
+	MakeChannelLayout<kChans7_1>("7.1"),
+	MakeChannelLayout<kChans8_1>("8.1")
+};
@@ -0,0 +1,156 @@
+#include "ClockModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+// [v̑ш (Hz)Bē̒ kInitialBandwidth ŁAkSettleSeconds ɔقǂɋ߁AkMinimumBandwidth Ŏ~߂B
+static constexpr double kInitialBandwidth = 2.0;
+static constexpr double kMinimumBandwidth = 0.05;
+static constexpr double kSettleSeconds = 1.0;
+
+// \Ƃ̍ (100ns PʁA20ms) 𒴂AsAƂ݂ȂĐ肵
+static constexpr double kRestartError = 20.0 * 1000 * 10;
+
+// htg̐̏B̐x傫ĺAɂ̂Ƃė}B
+static constexpr double kMaximumDrift = 1000.0e-6;
+
+// U̎wړς̏d
+static constexpr double kVarianceWeight = 1.0 / 256.0;
+
+// O}̏ (100ns PʁA1b)
+static constexpr int64_t kMaximumExtrapolation = kClockUnitsPerSecond;
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kFixedOne = 4294967296.0;
+
+
+ClockModel::ClockModel()
+	: device_frequency_(1),
+	running_(true),
+	started_(false),
+	qpc_(0),
+	position_(0),
+	fraction_(0.0),
+	restart_qpc_(0),
+	drift_(0.0),
+	variance_(0.0)
+{
+}
+
+void ClockModel::Reset(uint64_t device_frequency)
+{
+	device_frequency_ = std::max<int64_t>(1, static_cast<int64_t>(device_frequency));
+	running_ = true;
+	started_ = false;
+	drift_ = 0.0;
+	variance_ = 0.0;
+}
+
+void ClockModel::Update(uint64_t device_position, uint64_t qpc_position)
+{
+	const int64_t measured = ScaleTicks(static_cast<int64_t>(device_position), kClockUnitsPerSecond, device_frequency_);
+	const int64_t qpc = static_cast<int64_t>(qpc_position);
+
+	if (!started_ || (qpc <= qpc_))
+	{
+		Restart(measured, qpc);
+		return;
+	}
+
+	// ǂ̍Ɏ̂ŁAdouble ɒ̂͏ȒlɂȂ
+	const int64_t elapsed = qpc - qpc_;
+	const double predicted = fraction_ + (running_? elapsed * (1.0 + drift_): 0.0);
+	const double error = static_cast<double>(measured - position_) - predicted;
+
+	if (std::abs(error) > kRestartError)
+	{
+		Restart(measured, qpc);
+		return;
+	}
+
+	double advance = predicted;
+
+	if (running_)
+	{
+		// 2̃[v (ՊE) ̌WBXV̊Ԋuɍ킹Ė񋁂߂B
+		const double seconds = static_cast<double>(qpc - restart_qpc_) / kClockUnitsPerSecond;
+		const double bandwidth = std::max(kMinimumBandwidth, kInitialBandwidth * kSettleSeconds / (kSettleSeconds + seconds));
+		const double omega = 2.0 * kPi * bandwidth * elapsed / kClockUnitsPerSecond;
+		const double phase_gain = std::min(1.0, std::sqrt(2.0) * omega);
+		const double frequency_gain = omega * omega;
+
+		advance += phase_gain * error;
+		drift_ = std::clamp(drift_ + frequency_gain * error / elapsed, -kMaximumDrift, kMaximumDrift);
+	}
+	else
+	{
+		// ~͈ʒuȂ̂ŁAlɂ̂܂܍킹
+		advance += error;
+	}
+
+	const double whole = std::floor(advance);
+	position_ += static_cast<int64_t>(whole);
+	fraction_ = advance - whole;
+	qpc_ = qpc;
+
+	// 100ns Pʂ̍}CNbɂĂ悷
+	const double error_microseconds = error / 10.0;
+	variance_ += kVarianceWeight * (error_microseconds * error_microseconds - variance_);
+}
+
+void ClockModel::SetRunning(bool running)
+{
+	if (running_ == running)
+		return;
+
+	running_ = running;
+
+	// ~ĊJ܂ł̊ԂɈʒuǂ܂Őiނ͕Ȃ̂ŁȂ肩琄肵
+	if (running)
+		started_ = false;
+}
+
+ClockModel::Estimate ClockModel::Current() const
+{
+	Estimate estimate {};
+
+	estimate.qpc = qpc_;
+	estimate.position = position_;
+	estimate.rate = running_? static_cast<uint64_t>(std::llround((1.0 + drift_) * kFixedOne)): 0;
+
+	return estimate;
+}
+
+double ClockModel::DriftPpm() const
+{
+	return drift_ * 1.0e6;
+}
+
+double ClockModel::DelayVariance() const
+{
+	return variance_;
+}
+
+int64_t ClockModel::Extrapolate(const Estimate& estimate, int64_t qpc)
+{
+	const int64_t elapsed = std::clamp<int64_t>(qpc - estimate.qpc, 0, kMaximumExtrapolation);
+
+	// elapsed  2^24 Arate  2^33 Ȃ̂ŁAς 64 rbgɎ܂
+	return estimate.position + static_cast<int64_t>((static_cast<uint64_t>(elapsed) * estimate.rate) >> 32);
+}
+
+int64_t ClockModel::Delay(const Estimate& estimate, int64_t qpc, int64_t written_frames, int64_t output_rate, int64_t pending_frames, int64_t input_rate)
+{
+	const int64_t played = Extrapolate(estimate, qpc);
+
+	return ScaleTicks(written_frames, 1000 * 1000, output_rate) + ScaleTicks(pending_frames, 1000 * 1000, input_rate) - ScaleTicks(played, 1000 * 1000, kClockUnitsPerSecond);
+}
+
+void ClockModel::Restart(int64_t position, int64_t qpc)
+{
+	started_ = true;
+	qpc_ = qpc;
+	position_ = position;
+	fraction_ = 0.0;
+	restart_qpc_ = qpc;
+}
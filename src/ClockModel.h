@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+// ̒P (1b̒l)BIAudioClock::GetPosition  qpc_position Ɠ 100ns PʁB
+constexpr int64_t kClockUnitsPerSecond = 10 * 1000 * 1000;
+
+// from PʂŐ value  to PʂɊZBӂꂵȂ悤AbƂ̒[ɕČvZB
+// to * from  int64_t Ɏ܂邱ƁB
+constexpr int64_t ScaleTicks(int64_t value, int64_t to, int64_t from)
+{
+	return (value / from) * to + ((value % from) * to) / from;
+}
+
+// foCX̍Đʒu QPC ̑g (IAudioClock::GetPosition ̌) AĐʒu̎𐄒肷2 PLLB
+// GetPosition ̒l1񖈂ɗh炮̂ŁÂ܂ TimeGet() ɎgƃfBChAVLC ̗̓hǂĂ܂B
+// ʑƁAfoCX̎v QPC ɑ΂邸 (htg) 𐄒肵AhĐʒuJB
+// ш͍ē͍̒LAԂƂƂɋ߂Bhtg̓foCX̐Ȃ̂ŁAēĂpB
+// Jl 100ns Pʂ̐ 32.32 ̌Œ菬_̑Ȃ̂ŁAԂ̍ĐłӂꂹɊO}łB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class ClockModel
+{
+public:
+	// qpc ̎_ōĐʒu position ɂAȌ QPC  1 Pʂ rate / 2^32 iށBPʂ͂ 100nsB
+	struct Estimate
+	{
+		int64_t qpc;
+		int64_t position;
+		uint64_t rate;
+	};
+
+	ClockModel();
+
+	// device_frequency ͍Đʒu1b̒lBhtg̐̂ĂB
+	void Reset(uint64_t device_frequency);
+
+	// GetPosition() ̌ʂ^B\傫Oꂽꍇ (Zbg~ɂsA) ́A̒l琄肵B
+	void Update(uint64_t device_position, uint64_t qpc_position);
+
+	// ~͍Đʒui܂Ȃ̂ƂĈBĊJ͐肵B
+	void SetRunning(bool running);
+
+	Estimate Current() const;
+
+	// foCX̎v QPC ɑ΂邸BȂfoCXB
+	double DriftPpm() const;
+
+	// 肵ĐʒuƐƂ̍̕U (}CNb^2)B␳Ȃꍇ̃fBC̗hɑB
+	double DelayVariance() const;
+
+	//  qpc (100ns P) ̎_܂Ői߂B̎_قǌ덷傫̂ŁAO}͍ő 1 b܂łɂB
+	static int64_t Extrapolate(const Estimate& estimate, int64_t qpc);
+
+	// TimeGet() ŕԂfBC (}CNb)Bqpc (100ns P) ̎_܂łɏݍς݂ written_frames o͂ output_rate ŁA
+	// ܂łȂ pending_frames ͂ input_rate ŐA肵ĐʒuB
+	static int64_t Delay(const Estimate& estimate, int64_t qpc, int64_t written_frames, int64_t output_rate, int64_t pending_frames, int64_t input_rate);
+
+private:
+	void Restart(int64_t position, int64_t qpc);
+
+	int64_t device_frequency_;
+	bool running_;
+	bool started_;
+
+	// O̍XV̎_ qpc_ ł̐ʒuB position_ ƒ[ fraction_ ɕĎB
+	int64_t qpc_;
+	int64_t position_;
+	double fraction_;
+
+	// ē_Bш߂ĂB
+	int64_t restart_qpc_;
+
+	double drift_;
+	double variance_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+// YҁEP҂̃R}htB
+// T ͎̗vfw T *next_ ƁBvf̏L Post ŏґɈڂB
+template <typename T>
+class CommandMailbox
+{
+public:
+	CommandMailbox()
+		: head_(nullptr)
+	{
+	}
+
+	CommandMailbox(const CommandMailbox&) = delete;
+	CommandMailbox& operator=(const CommandMailbox&) = delete;
+
+	// YґB̃XbhĂł悢B
+	// t󂾂ꍇ true Ԃ̂ŁÂƂ҂N΂悢B
+	bool Post(T *command)
+	{
+		T *head = head_.load(std::memory_order_relaxed);
+
+		do
+		{
+			command->next_ = head;
+		}
+		while (!head_.compare_exchange_weak(head, command, std::memory_order_release, std::memory_order_relaxed));
+
+		return nullptr == head;
+	}
+
+	// ґB܂ĂR}h𓊔ꂽɕׂđSĎoB
+	T *TakeAll()
+	{
+		T *command = head_.exchange(nullptr, std::memory_order_acquire);
+		T *ordered = nullptr;
+
+		while (command)
+		{
+			T *next = command->next_;
+			command->next_ = ordered;
+			ordered = command;
+			command = next;
+		}
+
+		return ordered;
+	}
+
+	bool Empty() const
+	{
+		return nullptr == head_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<T *> head_;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// vZXŜŋLAfoCẌꗗƊefoCXΉtH[}bg̃LbVB
+// 񋓂 Source ɔCALbVɂȂĂŏ̖⍇ł̂ݍsB
+// Invalidate() ̓foCX̕ύXʒmĂ΂zŁAbN炸ɂ߂B
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAU Source ^ΒP̂ŎB
+template <typename Format>
+class DeviceCache
+{
+public:
+	struct Device
+	{
+		std::string id;
+		std::string description;
+	};
+
+	class Source
+	{
+	public:
+		virtual ~Source() = default;
+
+		// sꍇ false ԂBr܂ŗ񋓂ł͕ԂĂ悢ALbV͂ȂB
+		virtual bool EnumerateDevices(std::vector<Device>& devices) = 0;
+		virtual bool EnumerateFormats(const std::wstring& device_id, std::vector<Format>& formats) = 0;
+	};
+
+	explicit DeviceCache(Source *source)
+		: source_(source), generation_(1), devices_generation_(0)
+	{
+	}
+
+	DeviceCache(const DeviceCache&) = delete;
+	DeviceCache& operator=(const DeviceCache&) = delete;
+
+	std::vector<Device> Devices()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		// 񋓒ɖɂȂꍇɌÂʂLƈȂ悤A͗񋓂̑Oɓǂł
+		const uint64_t generation = generation_.load(std::memory_order_acquire);
+
+		if (devices_generation_ != generation)
+		{
+			std::vector<Device> devices;
+
+			if (!source_->EnumerateDevices(devices))
+				return devices;
+
+			devices_ = std::move(devices);
+			devices_generation_ = generation;
+		}
+
+		return devices_;
+	}
+
+	std::vector<Format> Formats(const std::wstring& device_id)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const uint64_t generation = generation_.load(std::memory_order_acquire);
+		auto found = formats_.find(device_id);
+
+		if ((formats_.end() == found) || (found->second.generation != generation))
+		{
+			std::vector<Format> formats;
+
+			if (!source_->EnumerateFormats(device_id, formats))
+				return formats;
+
+			found = formats_.insert_or_assign(device_id, FormatEntry {std::move(formats), generation}).first;
+		}
+
+		return found->second.formats;
+	}
+
+	// Cӂ̃XbhĂׂ
+	void Invalidate()
+	{
+		generation_.fetch_add(1, std::memory_order_release);
+	}
+
+	uint64_t Generation() const
+	{
+		return generation_.load(std::memory_order_acquire);
+	}
+
+private:
+	struct FormatEntry
+	{
+		std::vector<Format> formats;
+		uint64_t generation;
+	};
+
+	Source *source_;
+	std::atomic<uint64_t> generation_;
+
+	// ȉ mutex_ ŎBeオ generation_ ƈv̂LB
+	std::mutex mutex_;
+	std::vector<Device> devices_;
+	uint64_t devices_generation_;
+	std::map<std::wstring, FormatEntry> formats_;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "ForwardKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// L[ɗ܂ubNA`̃obt@ɓ]B
+// aout_sys_t  block_t ɒڈˑȂ悤ev[gɂĂ̂ŁAVLC Ȃłx`}[NgB
+// Sys  audio_data_queue_Areleased_blocks_Aaudio_data_frames_Ainput_format_Aoutput_channels_A
+// deinterleave_Achannel_reorder_table_Amix_Amix_matrix_Ascan_silence_Aoutput_sources_  aout_sys_t ƓOŎƁB
+// Play() ŕϊꍇ (ConvertAudioDataBlock / ForwardPlanarData) ́A planar_ring_ ƁB
+
+// audio_data_queue_ ̗vfBactive_objects  ScanAudioDataBlock ŋ߂Âo͂̃rbgB
+template <typename Block>
+struct QueuedBlock
+{
+	Block *block;
+	uint32_t active_objects;
+};
+
+// Play() ̃XbhŁAubN̂ 0 łȂTv܂ޏo͂̃rbg (rbg channel o channel) ߂B
+// o͂́A^̓`l (output_sources_) SĖȂ疳ɂȂB
+template <typename Sys, typename Block>
+uint32_t ScanAudioDataBlock(const Sys *sys, const Block *block)
+{
+	const uint32_t active_channels = sys->scan_silence_(block->p_buffer, sys->input_format_.i_channels, block->i_nb_samples);
+	uint32_t active_objects = 0;
+
+	for (unsigned channel=0; channel<sys->output_channels_; ++channel)
+	{
+		if (sys->output_sources_[channel] & active_channels)
+			active_objects |= 1u << channel;
+	}
+
+	return active_objects;
+}
+
+// active_objects Ɋ܂܂Ȃo͂ 0 Ŗ߁Atargets ̂̃`l nullptr ɂē]֐ɏȂB
+// SĂ̏o͂ɉ buffers ̂܂ܕԂB
+template <typename Sys>
+float *const *SkipSilentObjects(float *targets[kMaxForwardChannels], float *const buffers[kMaxForwardChannels], const Sys *sys, uint32_t active_objects, size_t frames)
+{
+	const uint32_t all_objects = (1u << sys->output_channels_) - 1;
+	if (all_objects == (active_objects & all_objects))
+		return buffers;
+
+	for (unsigned channel=0; channel<sys->output_channels_; ++channel)
+	{
+		targets[channel] = buffers[channel];
+
+		if (buffers[channel] && !(active_objects & (1u << channel)))
+		{
+			std::fill_n(buffers[channel], frames, 0.0f);
+			targets[channel] = nullptr;
+		}
+	}
+
+	return targets;
+}
+
+// gIubN Play() ̃XbhɕԂBVLC ̃AP[^`̒ŌĂ΂Ȃ߁B
+// ԋpL[ audio_data_queue_ 傫Ă̂ŁAʏ͖tɂȂȂB
+template <typename Sys, typename Block>
+void RetireBlock(Sys *sys, Block *block)
+{
+	if (!sys->released_blocks_.Push(block))
+		block_Release(block);
+}
+
+template <typename Sys, typename Block>
+void ForwardAudioDataBlock(float *const buffers[kMaxForwardChannels], Sys *sys, Block *block, uint32_t active_objects, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const uint8_t channels = sys->input_format_.i_channels;
+	const size_t bytes = static_cast<size_t>(sys->input_format_.i_bytes_per_frame) * frames;
+
+	// ̏o͂ 0 Ŗ߂邾ɂASĖȂ]֐Ă΂Ȃ
+	float *targets[kMaxForwardChannels];
+	float *const *dst = SkipSilentObjects(targets, buffers, sys, active_objects, frames);
+
+	// ͂̏ꍇ float ւ̕ϊA\tgEFAʂ̏ꍇ͔{̏ZAʂ̌vōsB
+	// `l\ςꍇ́Aւ̑ɍs|B0 Ŗ߂o͂͌vlɉȂB
+	if (active_objects)
+	{
+		if (sys->mix_)
+			sys->mix_(dst, block->p_buffer, sys->mix_matrix_.data(), channels, sys->output_channels_, frames, gain, levels);
+		else
+			sys->deinterleave_(dst, block->p_buffer, sys->channel_reorder_table_.data(), channels, frames, gain, levels);
+	}
+
+	block->p_buffer += bytes;
+	block->i_buffer -= bytes;
+	block->i_nb_samples -= frames;
+	sys->audio_data_frames_.fetch_sub(frames, std::memory_order_relaxed);
+}
+
+// frames ̓L[̃t[ȉł邱ƁBbuffers ̊e|C^͓]iށB
+// ]̌v (frames_written_ Ȃ) ͌ďoZBTimeGet() ̓L[Ƃ̘aǂނ̂ŁA
+// ꎞIɏȂȂ悤AĂԑOɉZĂƁB
+// levels  nullptr łȂ΁A]Tv̌vlo̓`lɐώZB
+template <typename Sys>
+void ForwardAudioData(float *buffers[kMaxForwardChannels], Sys *sys, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	while (frames)
+	{
+		auto *entry = sys->audio_data_queue_.Front();
+
+		while (0 == entry->block->i_nb_samples)
+		{
+			RetireBlock(sys, entry->block);
+			sys->audio_data_queue_.Pop();
+			entry = sys->audio_data_queue_.Front();
+		}
+
+		auto *block = entry->block;
+		size_t copy_frames = std::min(frames, static_cast<size_t>(block->i_nb_samples));
+
+		ForwardAudioDataBlock(buffers, sys, block, entry->active_objects, copy_frames, gain, levels);
+
+		// ݐ|C^̍XV
+		for (int channel=0; channel<sys->output_channels_; ++channel)
+		{
+			if (buffers[channel])
+				buffers[channel] += copy_frames;
+		}
+
+		if (gain)
+			gain += copy_frames;
+
+		frames -= copy_frames;
+	}
+}
+
+// Play() ̃XbhŁAubNo͂̕т float ɕϊEւ planar_ring_ ɏB
+// Ot̊Ԃ wait() ĂŁAI[fBIXbh̂҂B͏ audio_data_frames_ ɉZB
+// wait()  false Ԃc͏Ɏ̂āÂĂt[Ԃ (Sď 0)B
+// ʂ͕`Ŋ|̂ŁAł͊|ȂBactive_objects Ɋ܂܂Ȃo͂ 0 Ŗ߂B
+template <typename Sys, typename Block, typename Wait>
+size_t ConvertAudioDataBlock(Sys *sys, const Block *block, uint32_t active_objects, Wait wait)
+{
+	const uint8_t channels = sys->input_format_.i_channels;
+	const uint8_t *src = block->p_buffer;
+	size_t frames = block->i_nb_samples;
+
+	while (frames)
+	{
+		float *planes[kMaxForwardChannels];
+		const size_t copy_frames = std::min(frames, sys->planar_ring_.WritePlanes(planes));
+
+		if (!copy_frames)
+		{
+			if (!wait())
+				return frames;
+
+			continue;
+		}
+
+		float *targets[kMaxForwardChannels];
+		float *const *dst = SkipSilentObjects(targets, planes, sys, active_objects, copy_frames);
+
+		if (active_objects)
+		{
+			if (sys->mix_)
+				sys->mix_(dst, src, sys->mix_matrix_.data(), channels, sys->output_channels_, copy_frames, nullptr, nullptr);
+			else
+				sys->deinterleave_(dst, src, sys->channel_reorder_table_.data(), channels, copy_frames, nullptr, nullptr);
+		}
+
+		sys->planar_ring_.CommitWrite(copy_frames);
+		sys->audio_data_frames_.fetch_add(copy_frames, std::memory_order_release);
+
+		src += static_cast<size_t>(sys->input_format_.i_bytes_per_frame) * copy_frames;
+		frames -= copy_frames;
+	}
+
+	return 0;
+}
+
+// ConvertAudioDataBlock ŕϊς݂̃Tv`̃obt@ɎʂBIuWFNg memcpy 邾ɂȂB
+// frames ̓Õt[ȉł邱ƁBbuffers ̊e|C^͓]iށB
+template <typename Sys>
+void ForwardPlanarData(float *buffers[kMaxForwardChannels], Sys *sys, size_t frames, const float *gain)
+{
+	sys->planar_ring_.Read(buffers, frames, gain);
+	sys->audio_data_frames_.fetch_sub(frames, std::memory_order_relaxed);
+}
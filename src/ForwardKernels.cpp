@@ -0,0 +1,1311 @@
+#include "ForwardKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MSS_X86 1
+#endif
+
+#if MSS_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// MSVC ͖߃Zbg̎wȂőg݊֐g邪AGCC / Clang ͊֐PʂŎw肪Kv
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MSS_TARGET(isa)
+#else
+#define MSS_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// ͂ float ɕϊ֐Bsamples ̓`l|TvB
+typedef void (*ConvertFunction)(float *dst, const void *src, size_t samples);
+
+// ͂xɕϊTvBL1 Ɏ܂傫ɂĂB
+static constexpr size_t kConvertChunkSamples = 2048;
+
+static constexpr float kScaleS16 = 1.0f / 32768.0f;
+static constexpr float kScaleS32 = 1.0f / 2147483648.0f;
+
+// ̔ŁAS`lɉ邩m߂đŐ؂Ԋu (t[)B
+// ̂ubN͐擪łɑŐ؂悤Aŏ͒ZԊuŊm߁A4{ kScanCheckFrames ܂ŉ΂B
+static constexpr size_t kScanFirstCheckFrames = 16;
+static constexpr size_t kScanCheckFrames = 1024;
+
+// ]ȂvꍇɁA܂Ƃ߂ďt[B
+// MU[ł̓`lɂ̒i߂ĐώZlWX^ɒu܂܂ɂASSE2 ł͂̒񂾕ǂݒB
+// ͂o͂̓ǒ L1 Ɏ܂钷B
+static constexpr size_t kMeterChunkFrames = 256;
+
+static void DeinterleaveScalarRange(float *const *dst, const float *src, const uint8_t *reorder, unsigned channels, size_t begin, size_t end, const float *gain, ChannelLevels *levels);
+static void MixScalarRange(float *const *dst, const float *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t begin, size_t end, const float *gain, ChannelLevels *levels);
+static void ConvertS16Scalar(float *dst, const void *src, size_t samples);
+static void ConvertS24Scalar(float *dst, const void *src, size_t samples);
+static void ConvertS32Scalar(float *dst, const void *src, size_t samples);
+
+#if MSS_X86
+static void CpuId(int regs[4], int leaf, int sub_leaf);
+static uint64_t XGetBv(unsigned index);
+static void DeinterleaveSse2(float *const *dst, const void *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels);
+static void DeinterleaveAvx2(float *const *dst, const void *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels);
+static void DeinterleaveAvx512(float *const *dst, const void *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels);
+static void MixSse2(float *const *dst, const void *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels);
+static void MixAvx2(float *const *dst, const void *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels);
+static void ConvertS16Sse2(float *dst, const void *src, size_t samples);
+static void ConvertS32Sse2(float *dst, const void *src, size_t samples);
+static void ConvertS16Avx2(float *dst, const void *src, size_t samples);
+static void ConvertS24Avx2(float *dst, const void *src, size_t samples);
+static void ConvertS32Avx2(float *dst, const void *src, size_t samples);
+template <size_t SampleBytes, bool kFloat>
+static uint32_t ScanSilenceSse2(const void *src, unsigned channels, size_t frames);
+static void MeasureLevelsSse2(const float *const *planes, unsigned channels, size_t frames, ChannelLevels *levels);
+#endif
+
+// ͂ kConvertChunkSamples  float ɕϊÂ܂ float p̕z֐ɓnB
+// ϊʂ L1 ̈ꎞ̈ɂuȂ̂ŁAubNŜϊpX͐ȂB
+template <size_t SampleBytes, ConvertFunction Convert, DeinterleaveFunction Deinterleave>
+static void ConvertAndDeinterleave(float *const *dst, const void *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	alignas(64) float chunk[kConvertChunkSamples];
+	float *chunk_dst[kMaxForwardChannels];
+	const uint8_t *s = static_cast<const uint8_t *>(src);
+	const size_t chunk_frames = kConvertChunkSamples / channels;
+
+	for (size_t frame=0; frame<frames; )
+	{
+		const size_t copy_frames = std::min(chunk_frames, frames - frame);
+
+		Convert(chunk, s + frame * channels * SampleBytes, copy_frames * channels);
+
+		for (unsigned channel=0; channel<channels; ++channel)
+			chunk_dst[channel] = dst[channel]? dst[channel] + frame: nullptr;
+
+		Deinterleave(chunk_dst, chunk, reorder, channels, copy_frames, gain? gain + frame: nullptr, levels);
+		frame += copy_frames;
+	}
+}
+
+// ConvertAndDeinterleave ̍s
+template <size_t SampleBytes, ConvertFunction Convert, MixFunction Mix>
+static void ConvertAndMix(float *const *dst, const void *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	alignas(64) float chunk[kConvertChunkSamples];
+	float *chunk_dst[kMaxForwardChannels];
+	const uint8_t *s = static_cast<const uint8_t *>(src);
+	const size_t chunk_frames = kConvertChunkSamples / in_channels;
+
+	for (size_t frame=0; frame<frames; )
+	{
+		const size_t copy_frames = std::min(chunk_frames, frames - frame);
+
+		Convert(chunk, s + frame * in_channels * SampleBytes, copy_frames * in_channels);
+
+		for (unsigned channel=0; channel<out_channels; ++channel)
+			chunk_dst[channel] = dst[channel]? dst[channel] + frame: nullptr;
+
+		Mix(chunk_dst, chunk, matrix, in_channels, out_channels, copy_frames, gain? gain + frame: nullptr, levels);
+		frame += copy_frames;
+	}
+}
+
+// 1Tv levels ̃`l channel ɐώZ
+static inline void AccumulateLevel(ChannelLevels *levels, unsigned channel, float value)
+{
+	levels->peak[channel] = std::max(levels->peak[channel], std::fabs(value));
+	levels->energy[channel] += value * value;
+}
+
+// 1t[̃oCg̘_a row A0 łȂTv܂ރ`l̃rbg߂B
+// float ̓gGfBA̍ŏʃoCgɂ镄rbgB
+template <size_t SampleBytes, bool kFloat>
+static uint32_t ActiveChannels(const uint8_t *row, unsigned channels)
+{
+	uint32_t active = 0;
+
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const uint8_t *sample = row + channel * SampleBytes;
+		uint8_t bits = kFloat? (sample[SampleBytes - 1] & 0x7f): sample[SampleBytes - 1];
+
+		for (size_t byte=0; byte<SampleBytes - 1; ++byte)
+			bits |= sample[byte];
+
+		if (bits)
+			active |= 1u << channel;
+	}
+
+	return active;
+}
+
+// et[̃oCg̘_aA`l 0 ȊÕrbgcĂ邩B`ɂ炸ōςށB
+template <size_t SampleBytes, bool kFloat>
+static uint32_t ScanSilenceScalarImpl(const void *src, unsigned channels, size_t frames)
+{
+	if (channels > kMaxForwardChannels)
+		return ~0u;
+
+	const uint32_t all = (1u << channels) - 1;
+
+	const uint8_t *s = static_cast<const uint8_t *>(src);
+	const size_t frame_bytes = SampleBytes * channels;
+	uint8_t row[SampleBytes * kMaxForwardChannels] {};
+	size_t interval = kScanFirstCheckFrames;
+
+	for (size_t frame=0; frame<frames; interval = std::min(interval * 4, kScanCheckFrames))
+	{
+		const size_t end = std::min(frames, frame + interval);
+
+		for (; frame<end; ++frame)
+		{
+			for (size_t byte=0; byte<frame_bytes; ++byte)
+				row[byte] |= s[byte];
+
+			s += frame_bytes;
+		}
+
+		if (all == ActiveChannels<SampleBytes, kFloat>(row, channels))
+			return all;
+	}
+
+	return ActiveChannels<SampleBytes, kFloat>(row, channels);
+}
+
+
+SimdLevel DetectSimdLevel()
+{
+#if MSS_X86
+	int regs[4];
+
+	CpuId(regs, 0, 0);
+	const int max_leaf = regs[0];
+
+	CpuId(regs, 1, 0);
+	if (!(regs[3] & (1 << 26)))
+		return SimdLevel::kScalar;
+
+	// OSXSAVE  AVX ĂāAOSYMMWX^ۑꍇ̂AVXng
+	const bool os_xsave = (regs[2] & (1 << 27)) && (regs[2] & (1 << 28));
+	if (!os_xsave || (max_leaf < 7))
+		return SimdLevel::kSse2;
+
+	const uint64_t xcr0 = XGetBv(0);
+	if ((xcr0 & 0x06) != 0x06)
+		return SimdLevel::kSse2;
+
+	CpuId(regs, 7, 0);
+	const bool avx2 = regs[1] & (1 << 5);
+	const bool avx512f = regs[1] & (1 << 16);
+
+	if (avx512f && ((xcr0 & 0xe6) == 0xe6))
+		return SimdLevel::kAvx512;
+
+	if (avx2)
+		return SimdLevel::kAvx2;
+
+	return SimdLevel::kSse2;
+#else
+	return SimdLevel::kScalar;
+#endif
+}
+
+DeinterleaveFunction SelectDeinterleaveFunction(SimdLevel level, SampleFormat format)
+{
+	switch (level)
+	{
+#if MSS_X86
+	case SimdLevel::kAvx512:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndDeinterleave<2, ConvertS16Avx2, DeinterleaveAvx512>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndDeinterleave<3, ConvertS24Avx2, DeinterleaveAvx512>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndDeinterleave<4, ConvertS32Avx2, DeinterleaveAvx512>;
+
+		default:
+			return DeinterleaveAvx512;
+		}
+
+	case SimdLevel::kAvx2:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndDeinterleave<2, ConvertS16Avx2, DeinterleaveAvx2>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndDeinterleave<3, ConvertS24Avx2, DeinterleaveAvx2>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndDeinterleave<4, ConvertS32Avx2, DeinterleaveAvx2>;
+
+		default:
+			return DeinterleaveAvx2;
+		}
+
+	case SimdLevel::kSse2:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndDeinterleave<2, ConvertS16Sse2, DeinterleaveSse2>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndDeinterleave<3, ConvertS24Scalar, DeinterleaveSse2>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndDeinterleave<4, ConvertS32Sse2, DeinterleaveSse2>;
+
+		default:
+			return DeinterleaveSse2;
+		}
+#endif
+
+	default:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndDeinterleave<2, ConvertS16Scalar, DeinterleaveScalar>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndDeinterleave<3, ConvertS24Scalar, DeinterleaveScalar>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndDeinterleave<4, ConvertS32Scalar, DeinterleaveScalar>;
+
+		default:
+			return DeinterleaveScalar;
+		}
+	}
+}
+
+// s̐ς͓̓`lɔႷ邾ŁASSE2 / AVX2 ŏ\ɑ̂ AVX-512 ł݂͐Ȃ
+MixFunction SelectMixFunction(SimdLevel level, SampleFormat format)
+{
+	switch (level)
+	{
+#if MSS_X86
+	case SimdLevel::kAvx512:
+	case SimdLevel::kAvx2:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndMix<2, ConvertS16Avx2, MixAvx2>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndMix<3, ConvertS24Avx2, MixAvx2>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndMix<4, ConvertS32Avx2, MixAvx2>;
+
+		default:
+			return MixAvx2;
+		}
+
+	case SimdLevel::kSse2:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndMix<2, ConvertS16Sse2, MixSse2>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndMix<3, ConvertS24Scalar, MixSse2>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndMix<4, ConvertS32Sse2, MixSse2>;
+
+		default:
+			return MixSse2;
+		}
+#endif
+
+	default:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ConvertAndMix<2, ConvertS16Scalar, MixScalar>;
+
+		case SampleFormat::kSigned24:
+			return ConvertAndMix<3, ConvertS24Scalar, MixScalar>;
+
+		case SampleFormat::kSigned32:
+			return ConvertAndMix<4, ConvertS32Scalar, MixScalar>;
+
+		default:
+			return MixScalar;
+		}
+	}
+}
+
+// _a邾Ń̑шŌ܂̂ŁAAVX2 ȏł SSE2 łg
+ScanSilenceFunction SelectScanSilenceFunction(SimdLevel level, SampleFormat format)
+{
+	switch (level)
+	{
+#if MSS_X86
+	case SimdLevel::kAvx512:
+	case SimdLevel::kAvx2:
+	case SimdLevel::kSse2:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ScanSilenceSse2<2, false>;
+
+		case SampleFormat::kSigned24:
+			return ScanSilenceSse2<3, false>;
+
+		case SampleFormat::kSigned32:
+			return ScanSilenceSse2<4, false>;
+
+		default:
+			return ScanSilenceSse2<4, true>;
+		}
+#endif
+
+	default:
+		switch (format)
+		{
+		case SampleFormat::kSigned16:
+			return ScanSilenceScalarImpl<2, false>;
+
+		case SampleFormat::kSigned24:
+			return ScanSilenceScalarImpl<3, false>;
+
+		case SampleFormat::kSigned32:
+			return ScanSilenceScalarImpl<4, false>;
+
+		default:
+			return ScanSilenceScalar;
+		}
+	}
+}
+
+// ݍς݂̃obt@ǂނȂ̂ŁǍoƓ AVX2 ȏł SSE2 łg
+MeasureLevelsFunction SelectMeasureLevelsFunction(SimdLevel level)
+{
+	switch (level)
+	{
+#if MSS_X86
+	case SimdLevel::kAvx512:
+	case SimdLevel::kAvx2:
+	case SimdLevel::kSse2:
+		return MeasureLevelsSse2;
+#endif
+
+	default:
+		return MeasureLevelsScalar;
+	}
+}
+
+void MergeLaneLevels(ChannelLevels *levels, unsigned channel, const float *square_peak, const float *energy, size_t lanes)
+{
+	// 1̌ďo float ̂܂4{ɕď݁Aˑ̘AZBďoׂώZ double ōsB
+	float max[4] {};
+	float sum[4] {};
+	size_t lane = 0;
+
+	for (; lane + 4 <= lanes; lane += 4)
+	{
+		for (size_t i=0; i<4; ++i)
+		{
+			max[i] = std::max(max[i], square_peak[lane + i]);
+			sum[i] += energy[lane + i];
+		}
+	}
+
+	for (; lane<lanes; ++lane)
+	{
+		max[0] = std::max(max[0], square_peak[lane]);
+		sum[0] += energy[lane];
+	}
+
+	const float square = std::max(std::max(max[0], max[1]), std::max(max[2], max[3]));
+
+	levels->peak[channel] = std::max(levels->peak[channel], std::sqrt(square));
+	levels->energy[channel] += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+void DeinterleaveScalar(float *const *dst, const void *src_data, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const float *src = static_cast<const float *>(src_data);
+	for (size_t frame=0; frame<frames; ++frame)
+	{
+		const float g = gain? gain[frame]: 1.0f;
+
+		for (unsigned channel=0; channel<channels; ++channel)
+		{
+			if (!dst[channel])
+				continue;
+
+			const float value = src[reorder[channel]] * g;
+			dst[channel][frame] = value;
+
+			if (levels)
+				AccumulateLevel(levels, channel, value);
+		}
+
+		src += channels;
+	}
+}
+
+static void DeinterleaveScalarRange(float *const *dst, const float *src, const uint8_t *reorder, unsigned channels, size_t begin, size_t end, const float *gain, ChannelLevels *levels)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		if (!dst[channel])
+			continue;
+
+		const float *s = src + reorder[channel];
+
+		for (size_t frame=begin; frame<end; ++frame)
+		{
+			const float value = s[frame * channels] * (gain? gain[frame]: 1.0f);
+			dst[channel][frame] = value;
+
+			if (levels)
+				AccumulateLevel(levels, channel, value);
+		}
+	}
+}
+
+void MixScalar(float *const *dst, const void *src_data, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	MixScalarRange(dst, static_cast<const float *>(src_data), matrix, in_channels, out_channels, 0, frames, gain, levels);
+}
+
+static void MixScalarRange(float *const *dst, const float *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t begin, size_t end, const float *gain, ChannelLevels *levels)
+{
+	for (size_t frame=begin; frame<end; ++frame)
+	{
+		const float *s = src + frame * in_channels;
+		const float g = gain? gain[frame]: 1.0f;
+
+		for (unsigned out=0; out<out_channels; ++out)
+		{
+			if (!dst[out])
+				continue;
+
+			const float *row = matrix + out * in_channels;
+			float sum = 0.0f;
+
+			for (unsigned in=0; in<in_channels; ++in)
+				sum += row[in] * s[in];
+
+			const float value = sum * g;
+			dst[out][frame] = value;
+
+			if (levels)
+				AccumulateLevel(levels, out, value);
+		}
+	}
+}
+
+uint32_t ScanSilenceScalar(const void *src, unsigned channels, size_t frames)
+{
+	return ScanSilenceScalarImpl<4, true>(src, channels, frames);
+}
+
+void MeasureLevelsScalar(const float *const *planes, unsigned channels, size_t frames, ChannelLevels *levels)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		if (!planes[channel])
+			continue;
+
+		for (size_t frame=0; frame<frames; ++frame)
+			AccumulateLevel(levels, channel, planes[channel][frame]);
+	}
+}
+
+static void ConvertS16Scalar(float *dst, const void *src, size_t samples)
+{
+	const int16_t *s = static_cast<const int16_t *>(src);
+
+	for (size_t i=0; i<samples; ++i)
+		dst[i] = s[i] * kScaleS16;
+}
+
+// 24bit ͏ʂɋl߂ 32bit ƂĈ
+static inline int32_t LoadS24(const uint8_t *p)
+{
+	return static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 24));
+}
+
+static void ConvertS24Scalar(float *dst, const void *src, size_t samples)
+{
+	const uint8_t *s = static_cast<const uint8_t *>(src);
+
+	for (size_t i=0; i<samples; ++i)
+		dst[i] = LoadS24(s + i * 3) * kScaleS32;
+}
+
+static void ConvertS32Scalar(float *dst, const void *src, size_t samples)
+{
+	const int32_t *s = static_cast<const int32_t *>(src);
+
+	for (size_t i=0; i<samples; ++i)
+		dst[i] = s[i] * kScaleS32;
+}
+
+#if MSS_X86
+static void CpuId(int regs[4], int leaf, int sub_leaf)
+{
+#if defined(_MSC_VER)
+	__cpuidex(regs, leaf, sub_leaf);
+#else
+	__cpuid_count(leaf, sub_leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t XGetBv(unsigned index)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(index);
+#else
+	uint32_t eax;
+	uint32_t edx;
+
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+	return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+// e SIMD ́Aʂ|邩ǂƌv邩ǂev[gŕĐB
+// gain  levels ̗L͌ďo1񂾂肷̂ŁA{̂Ƃ͏ZAvȂƂ͐ώZcȂB
+// v̓[̓̍őƓaWX^ɐώZAďo̍ŌɃWX^ŏ (SSE2 ̕z DeinterleaveSse2 ̒ʂ)B
+
+// 4Tv̓̍őƓaώZ
+MSS_TARGET("sse2")
+static inline void AccumulateLevelsSse2(__m128 *peak, __m128 *energy, __m128 value)
+{
+	const __m128 square = _mm_mul_ps(value, value);
+
+	*peak = _mm_max_ps(*peak, square);
+	*energy = _mm_add_ps(*energy, square);
+}
+
+// 4[̐ώZl𐅕ɏŁAlevels ̃`l channel ɐώZBMergeLaneLevels ƓʂɂȂB
+MSS_TARGET("sse2")
+static inline void MergeLaneLevelsSse2(ChannelLevels *levels, unsigned channel, __m128 peak, __m128 energy)
+{
+	peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+	peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(1, 1, 1, 1)));
+	energy = _mm_add_ps(energy, _mm_movehl_ps(energy, energy));
+	energy = _mm_add_ss(energy, _mm_shuffle_ps(energy, energy, _MM_SHUFFLE(1, 1, 1, 1)));
+
+	levels->peak[channel] = std::max(levels->peak[channel], _mm_cvtss_f32(_mm_sqrt_ss(peak)));
+	levels->energy[channel] += _mm_cvtss_f32(energy);
+}
+
+// 񂾃`l̃[̐ώZl levels ɏ
+MSS_TARGET("sse2")
+static void MergeLevelsSse2(ChannelLevels *levels, float *const *dst, unsigned channels, const __m128 *peak, const __m128 *energy)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		if (dst[channel])
+			MergeLaneLevelsSse2(levels, channel, peak[channel], energy[channel]);
+	}
+}
+
+// 4t[A̓`lɕ planes o̓`lɏo
+template <bool kGain>
+MSS_TARGET("sse2")
+static inline void StorePlanesSse2(float *const *dst, const __m128 *planes, const uint8_t *reorder, unsigned channels, size_t frame, const float *gain)
+{
+	const __m128 g = kGain? _mm_loadu_ps(gain + frame): _mm_setzero_ps();
+
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		if (!dst[channel])
+			continue;
+
+		if (kGain)
+			_mm_storeu_ps(dst[channel] + frame, _mm_mul_ps(planes[reorder[channel]], g));
+		else
+			_mm_storeu_ps(dst[channel] + frame, planes[reorder[channel]]);
+	}
+}
+
+// XeI 4 ̔{̃`l (4 / 8 / 12 / 16) ̓Vbtɂ]uAȊO4t[PʂŏW߂ď
+template <bool kGain>
+MSS_TARGET("sse2")
+static void DeinterleaveSse2Impl(float *const *dst, const float *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain)
+{
+	size_t frame = 0;
+	__m128 planes[kMaxForwardChannels];
+
+	switch ((2 == channels)? 2: (channels % 4)? 1: 4)
+	{
+	case 2:
+		for (; frame + 4 <= frames; frame += 4)
+		{
+			const float *s = src + frame * 2;
+			const __m128 a = _mm_loadu_ps(s);
+			const __m128 b = _mm_loadu_ps(s + 4);
+
+			planes[0] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			planes[1] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+			StorePlanesSse2<kGain>(dst, planes, reorder, 2, frame, gain);
+		}
+		break;
+
+	// 4`lA4t[ ~ 4`l̉]u
+	case 4:
+		for (; frame + 4 <= frames; frame += 4)
+		{
+			const float *s = src + frame * channels;
+
+			for (unsigned group=0; group<channels; group += 4)
+			{
+				__m128 *p = planes + group;
+
+				p[0] = _mm_loadu_ps(s + group);
+				p[1] = _mm_loadu_ps(s + group + channels);
+				p[2] = _mm_loadu_ps(s + group + channels * 2);
+				p[3] = _mm_loadu_ps(s + group + channels * 3);
+				_MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+			}
+
+			StorePlanesSse2<kGain>(dst, planes, reorder, channels, frame, gain);
+		}
+		break;
+
+	default:
+		for (; frame + 4 <= frames; frame += 4)
+		{
+			const float *s = src + frame * channels;
+			const __m128 g = kGain? _mm_loadu_ps(gain + frame): _mm_setzero_ps();
+
+			for (unsigned channel=0; channel<channels; ++channel)
+			{
+				if (!dst[channel])
+					continue;
+
+				const float *p = s + reorder[channel];
+				__m128 value = _mm_setr_ps(p[0], p[channels], p[channels * 2], p[channels * 3]);
+
+				if (kGain)
+					value = _mm_mul_ps(value, g);
+
+				_mm_storeu_ps(dst[channel] + frame, value);
+			}
+		}
+		break;
+	}
+
+	DeinterleaveScalarRange(dst, src, reorder, channels, frame, frames, gain, nullptr);
+}
+
+// vꍇ kMeterChunkFrames ]AL1 ɎcĂ邤ɏ񂾕 MeasureLevelsSse2 œǂݒB
+// ]uł̓WX^肸AώZlɒuē]ȂώZ肱̕B
+static void DeinterleaveSse2(float *const *dst, const void *src_data, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const float *src = static_cast<const float *>(src_data);
+
+	if (!levels)
+	{
+		if (gain)
+			DeinterleaveSse2Impl<true>(dst, src, reorder, channels, frames, gain);
+		else
+			DeinterleaveSse2Impl<false>(dst, src, reorder, channels, frames, nullptr);
+		return;
+	}
+
+	float *chunk_dst[kMaxForwardChannels];
+
+	for (size_t frame=0; frame<frames; frame += kMeterChunkFrames)
+	{
+		const size_t chunk_frames = std::min(kMeterChunkFrames, frames - frame);
+
+		for (unsigned channel=0; channel<channels; ++channel)
+			chunk_dst[channel] = dst[channel]? dst[channel] + frame: nullptr;
+
+		if (gain)
+			DeinterleaveSse2Impl<true>(chunk_dst, src + frame * channels, reorder, channels, chunk_frames, gain + frame);
+		else
+			DeinterleaveSse2Impl<false>(chunk_dst, src + frame * channels, reorder, channels, chunk_frames, nullptr);
+
+		MeasureLevelsSse2(chunk_dst, channels, chunk_frames, levels);
+	}
+}
+
+MSS_TARGET("avx2")
+static inline void AccumulateLevelsAvx2(__m256 *peak, __m256 *energy, __m256 value)
+{
+	const __m256 square = _mm256_mul_ps(value, value);
+
+	*peak = _mm256_max_ps(*peak, square);
+	*energy = _mm256_add_ps(*energy, square);
+}
+
+// ㉺ 128bit ł MergeLaneLevelsSse2 ɓn
+MSS_TARGET("avx2")
+static void MergeLevelsAvx2(ChannelLevels *levels, float *const *dst, unsigned channels, const __m256 *peak, const __m256 *energy)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		if (!dst[channel])
+			continue;
+
+		const __m256 p = peak[channel];
+		const __m256 e = energy[channel];
+
+		MergeLaneLevelsSse2(levels, channel,
+			_mm_max_ps(_mm256_castps256_ps128(p), _mm256_extractf128_ps(p, 1)),
+			_mm_add_ps(_mm256_castps256_ps128(e), _mm256_extractf128_ps(e, 1)));
+	}
+}
+
+// `lɈ˂炸AMU[8t[xɏW߂B
+// vꍇ̓`lOɂ kMeterChunkFrames i߁AώZlWX^ɒu܂܂ɂB
+template <bool kGain, bool kMeter>
+MSS_TARGET("avx2")
+static void DeinterleaveAvx2Impl(float *const *dst, const float *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(channels));
+	const size_t vector_frames = frames & ~static_cast<size_t>(7);
+	size_t frame = 0;
+
+	if (kMeter)
+	{
+		__m256 peak[kMaxForwardChannels];
+		__m256 energy[kMaxForwardChannels];
+
+		std::fill_n(peak, channels, _mm256_setzero_ps());
+		std::fill_n(energy, channels, _mm256_setzero_ps());
+
+		while (frame < vector_frames)
+		{
+			const size_t end = std::min(frame + kMeterChunkFrames, vector_frames);
+
+			for (unsigned channel=0; channel<channels; ++channel)
+			{
+				float *d = dst[channel];
+				if (!d)
+					continue;
+
+				const float *s = src + reorder[channel];
+				__m256 p = peak[channel];
+				__m256 e = energy[channel];
+
+				for (size_t f=frame; f<end; f += 8)
+				{
+					__m256 value = _mm256_i32gather_ps(s + f * channels, index, 4);
+
+					if (kGain)
+						value = _mm256_mul_ps(value, _mm256_loadu_ps(gain + f));
+
+					_mm256_storeu_ps(d + f, value);
+					AccumulateLevelsAvx2(&p, &e, value);
+				}
+
+				peak[channel] = p;
+				energy[channel] = e;
+			}
+
+			frame = end;
+		}
+
+		MergeLevelsAvx2(levels, dst, channels, peak, energy);
+	}
+	else
+	{
+		for (; frame<vector_frames; frame += 8)
+		{
+			const float *s = src + frame * channels;
+			const __m256 g = kGain? _mm256_loadu_ps(gain + frame): _mm256_setzero_ps();
+
+			for (unsigned channel=0; channel<channels; ++channel)
+			{
+				if (!dst[channel])
+					continue;
+
+				__m256 value = _mm256_i32gather_ps(s + reorder[channel], index, 4);
+
+				if (kGain)
+					value = _mm256_mul_ps(value, g);
+
+				_mm256_storeu_ps(dst[channel] + frame, value);
+			}
+		}
+	}
+
+	DeinterleaveScalarRange(dst, src, reorder, channels, frame, frames, gain, levels);
+}
+
+static void DeinterleaveAvx2(float *const *dst, const void *src_data, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const float *src = static_cast<const float *>(src_data);
+
+	if (gain && levels)
+		DeinterleaveAvx2Impl<true, true>(dst, src, reorder, channels, frames, gain, levels);
+	else if (gain)
+		DeinterleaveAvx2Impl<true, false>(dst, src, reorder, channels, frames, gain, nullptr);
+	else if (levels)
+		DeinterleaveAvx2Impl<false, true>(dst, src, reorder, channels, frames, nullptr, levels);
+	else
+		DeinterleaveAvx2Impl<false, false>(dst, src, reorder, channels, frames, nullptr, nullptr);
+}
+
+// DeinterleaveAvx2Impl Ɠ\ŁA16t[W߂
+template <bool kGain, bool kMeter>
+MSS_TARGET("avx512f")
+static void DeinterleaveAvx512Impl(float *const *dst, const float *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const __m512i index = _mm512_mullo_epi32(
+		_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+		_mm512_set1_epi32(channels));
+	const size_t vector_frames = frames & ~static_cast<size_t>(15);
+	size_t frame = 0;
+
+	// GCC 12 ̃wb_ł́A}XNȂ AVX-512 ̑g݊֐̒l (_mm512_undefined_ps) ɓn̂ŁA
+	// CCWJ -Wmaybe-uninitialized oBS[̃}XN 0 ̌^`ɂ (閽߂͓)B
+	const __mmask16 all_lanes = 0xffff;
+	const __m512 zero = _mm512_setzero_ps();
+
+	if (kMeter)
+	{
+		__m512 peak[kMaxForwardChannels];
+		__m512 energy[kMaxForwardChannels];
+
+		std::fill_n(peak, channels, _mm512_setzero_ps());
+		std::fill_n(energy, channels, _mm512_setzero_ps());
+
+		while (frame < vector_frames)
+		{
+			const size_t end = std::min(frame + kMeterChunkFrames, vector_frames);
+
+			for (unsigned channel=0; channel<channels; ++channel)
+			{
+				float *d = dst[channel];
+				if (!d)
+					continue;
+
+				const float *s = src + reorder[channel];
+				__m512 p = peak[channel];
+				__m512 e = energy[channel];
+
+				for (size_t f=frame; f<end; f += 16)
+				{
+					__m512 value = _mm512_mask_i32gather_ps(zero, all_lanes, index, s + f * channels, 4);
+
+					if (kGain)
+						value = _mm512_mul_ps(value, _mm512_loadu_ps(gain + f));
+
+					_mm512_storeu_ps(d + f, value);
+
+					const __m512 square = _mm512_mul_ps(value, value);
+					p = _mm512_maskz_max_ps(all_lanes, p, square);
+					e = _mm512_add_ps(e, square);
+				}
+
+				peak[channel] = p;
+				energy[channel] = e;
+			}
+
+			frame = end;
+		}
+
+		__m256 peak256[kMaxForwardChannels];
+		__m256 energy256[kMaxForwardChannels];
+
+		// ㉺ 256bit  AVX2 Ɠ`ɂB_mm512_castps512_ps256  GCC 12 ł͒Ō̎oɂȂ̂ŁA}XŇ`ŎoB
+		for (unsigned channel=0; channel<channels; ++channel)
+		{
+			const __m512 p = peak[channel];
+			const __m512 e = energy[channel];
+
+			peak256[channel] = _mm256_max_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(p), 0)), _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(p), 1)));
+			energy256[channel] = _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(e), 0)), _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xff, _mm512_castps_pd(e), 1)));
+		}
+
+		MergeLevelsAvx2(levels, dst, channels, peak256, energy256);
+	}
+	else
+	{
+		for (; frame<vector_frames; frame += 16)
+		{
+			const float *s = src + frame * channels;
+			const __m512 g = kGain? _mm512_loadu_ps(gain + frame): _mm512_setzero_ps();
+
+			for (unsigned channel=0; channel<channels; ++channel)
+			{
+				if (!dst[channel])
+					continue;
+
+				__m512 value = _mm512_mask_i32gather_ps(zero, all_lanes, index, s + reorder[channel], 4);
+
+				if (kGain)
+					value = _mm512_mul_ps(value, g);
+
+				_mm512_storeu_ps(dst[channel] + frame, value);
+			}
+		}
+	}
+
+	DeinterleaveScalarRange(dst, src, reorder, channels, frame, frames, gain, levels);
+}
+
+static void DeinterleaveAvx512(float *const *dst, const void *src_data, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const float *src = static_cast<const float *>(src_data);
+
+	if (gain && levels)
+		DeinterleaveAvx512Impl<true, true>(dst, src, reorder, channels, frames, gain, levels);
+	else if (gain)
+		DeinterleaveAvx512Impl<true, false>(dst, src, reorder, channels, frames, gain, nullptr);
+	else if (levels)
+		DeinterleaveAvx512Impl<false, true>(dst, src, reorder, channels, frames, nullptr, levels);
+	else
+		DeinterleaveAvx512Impl<false, false>(dst, src, reorder, channels, frames, nullptr, nullptr);
+}
+
+// 4t[̓͂̓`l̃xNgɏW߁AW|đށB
+// W͌ďoɈxu[hLXgĂB
+template <bool kGain, bool kMeter>
+MSS_TARGET("sse2")
+static void MixSse2Impl(float *const *dst, const float *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	__m128 coefficients[kMaxForwardChannels * kMaxMixInputChannels];
+	__m128 planes[kMaxMixInputChannels];
+	__m128 peak[kMaxForwardChannels];
+	__m128 energy[kMaxForwardChannels];
+	size_t frame = 0;
+
+	for (unsigned i=0; i<out_channels * in_channels; ++i)
+		coefficients[i] = _mm_set1_ps(matrix[i]);
+
+	if (kMeter)
+	{
+		std::fill_n(peak, out_channels, _mm_setzero_ps());
+		std::fill_n(energy, out_channels, _mm_setzero_ps());
+	}
+
+	for (; frame + 4 <= frames; frame += 4)
+	{
+		const float *s = src + frame * in_channels;
+
+		if (2 == in_channels)
+		{
+			const __m128 a = _mm_loadu_ps(s);
+			const __m128 b = _mm_loadu_ps(s + 4);
+
+			planes[0] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			planes[1] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		}
+		else
+		{
+			for (unsigned in=0; in<in_channels; ++in)
+				planes[in] = _mm_setr_ps(s[in], s[in + in_channels], s[in + in_channels * 2], s[in + in_channels * 3]);
+		}
+
+		const __m128 g = kGain? _mm_loadu_ps(gain + frame): _mm_setzero_ps();
+
+		for (unsigned out=0; out<out_channels; ++out)
+		{
+			if (!dst[out])
+				continue;
+
+			const __m128 *row = coefficients + out * in_channels;
+			__m128 sum = _mm_mul_ps(row[0], planes[0]);
+
+			for (unsigned in=1; in<in_channels; ++in)
+				sum = _mm_add_ps(sum, _mm_mul_ps(row[in], planes[in]));
+
+			if (kGain)
+				sum = _mm_mul_ps(sum, g);
+
+			_mm_storeu_ps(dst[out] + frame, sum);
+
+			if (kMeter)
+				AccumulateLevelsSse2(peak + out, energy + out, sum);
+		}
+	}
+
+	if (kMeter)
+		MergeLevelsSse2(levels, dst, out_channels, peak, energy);
+
+	MixScalarRange(dst, src, matrix, in_channels, out_channels, frame, frames, gain, levels);
+}
+
+static void MixSse2(float *const *dst, const void *src_data, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const float *src = static_cast<const float *>(src_data);
+
+	if (gain && levels)
+		MixSse2Impl<true, true>(dst, src, matrix, in_channels, out_channels, frames, gain, levels);
+	else if (gain)
+		MixSse2Impl<true, false>(dst, src, matrix, in_channels, out_channels, frames, gain, nullptr);
+	else if (levels)
+		MixSse2Impl<false, true>(dst, src, matrix, in_channels, out_channels, frames, nullptr, levels);
+	else
+		MixSse2Impl<false, false>(dst, src, matrix, in_channels, out_channels, frames, nullptr, nullptr);
+}
+
+// ͂̓MU[8t[W߂
+template <bool kGain, bool kMeter>
+MSS_TARGET("avx2")
+static void MixAvx2Impl(float *const *dst, const float *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(in_channels));
+	__m256 coefficients[kMaxForwardChannels * kMaxMixInputChannels];
+	__m256 planes[kMaxMixInputChannels];
+	__m256 peak[kMaxForwardChannels];
+	__m256 energy[kMaxForwardChannels];
+	size_t frame = 0;
+
+	for (unsigned i=0; i<out_channels * in_channels; ++i)
+		coefficients[i] = _mm256_set1_ps(matrix[i]);
+
+	if (kMeter)
+	{
+		std::fill_n(peak, out_channels, _mm256_setzero_ps());
+		std::fill_n(energy, out_channels, _mm256_setzero_ps());
+	}
+
+	for (; frame + 8 <= frames; frame += 8)
+	{
+		const float *s = src + frame * in_channels;
+		const __m256 g = kGain? _mm256_loadu_ps(gain + frame): _mm256_setzero_ps();
+
+		for (unsigned in=0; in<in_channels; ++in)
+			planes[in] = _mm256_i32gather_ps(s + in, index, 4);
+
+		for (unsigned out=0; out<out_channels; ++out)
+		{
+			if (!dst[out])
+				continue;
+
+			const __m256 *row = coefficients + out * in_channels;
+			__m256 sum = _mm256_mul_ps(row[0], planes[0]);
+
+			for (unsigned in=1; in<in_channels; ++in)
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(row[in], planes[in]));
+
+			if (kGain)
+				sum = _mm256_mul_ps(sum, g);
+
+			_mm256_storeu_ps(dst[out] + frame, sum);
+
+			if (kMeter)
+				AccumulateLevelsAvx2(peak + out, energy + out, sum);
+		}
+	}
+
+	if (kMeter)
+		MergeLevelsAvx2(levels, dst, out_channels, peak, energy);
+
+	MixScalarRange(dst, src, matrix, in_channels, out_channels, frame, frames, gain, levels);
+}
+
+static void MixAvx2(float *const *dst, const void *src_data, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels)
+{
+	const float *src = static_cast<const float *>(src_data);
+
+	if (gain && levels)
+		MixAvx2Impl<true, true>(dst, src, matrix, in_channels, out_channels, frames, gain, levels);
+	else if (gain)
+		MixAvx2Impl<true, false>(dst, src, matrix, in_channels, out_channels, frames, gain, nullptr);
+	else if (levels)
+		MixAvx2Impl<false, true>(dst, src, matrix, in_channels, out_channels, frames, nullptr, levels);
+	else
+		MixAvx2Impl<false, false>(dst, src, matrix, in_channels, out_channels, frames, nullptr, nullptr);
+}
+
+MSS_TARGET("sse2")
+static void ConvertS16Sse2(float *dst, const void *src, size_t samples)
+{
+	const int16_t *s = static_cast<const int16_t *>(src);
+	const __m128 scale = _mm_set1_ps(kScaleS16);
+	size_t i = 0;
+
+	for (; i + 8 <= samples; i += 8)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	ConvertS16Scalar(dst + i, s + i, samples - i);
+}
+
+MSS_TARGET("sse2")
+static void ConvertS32Sse2(float *dst, const void *src, size_t samples)
+{
+	const int32_t *s = static_cast<const int32_t *>(src);
+	const __m128 scale = _mm_set1_ps(kScaleS32);
+	size_t i = 0;
+
+	for (; i + 4 <= samples; i += 4)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+	}
+
+	ConvertS32Scalar(dst + i, s + i, samples - i);
+}
+
+MSS_TARGET("avx2")
+static void ConvertS16Avx2(float *dst, const void *src, size_t samples)
+{
+	const int16_t *s = static_cast<const int16_t *>(src);
+	const __m256 scale = _mm256_set1_ps(kScaleS16);
+	size_t i = 0;
+
+	for (; i + 8 <= samples; i += 8)
+	{
+		const __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+	}
+
+	ConvertS16Scalar(dst + i, s + i, samples - i);
+}
+
+// 12oCg (4Tv) AeTv32bit̏3oCgɕבւ
+MSS_TARGET("avx2")
+static void ConvertS24Avx2(float *dst, const void *src, size_t samples)
+{
+	const uint8_t *s = static_cast<const uint8_t *>(src);
+	const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	const __m256 scale = _mm256_set1_ps(kScaleS32);
+	size_t i = 0;
+
+	// 16oCgPʂœǂނ̂ŁAzēǂ܂Ȃ悤]T
+	for (; i + 10 <= samples; i += 8)
+	{
+		const __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i * 3)), shuffle);
+		const __m128i hi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i * 3 + 12)), shuffle);
+		const __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+	}
+
+	ConvertS24Scalar(dst + i, s + i * 3, samples - i);
+}
+
+MSS_TARGET("avx2")
+static void ConvertS32Avx2(float *dst, const void *src, size_t samples)
+{
+	const int32_t *s = static_cast<const int32_t *>(src);
+	const __m256 scale = _mm256_set1_ps(kScaleS32);
+	size_t i = 0;
+
+	for (; i + 8 <= samples; i += 8)
+	{
+		const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+	}
+
+	ConvertS32Scalar(dst + i, s + i, samples - i);
+}
+
+// 16t[͂傤 (t[̃oCg) 16oCg̃xNgɂȂ̂ŁAt[̋ECɂ_aB
+// _ãxNg v ́A16t[̉̒œʒuɂoCgW߂̂ŁAŌ1t[ɏށB
+template <size_t SampleBytes, bool kFloat>
+MSS_TARGET("sse2")
+static uint32_t ScanSilenceSse2(const void *src, unsigned channels, size_t frames)
+{
+	static constexpr size_t kBlockFrames = 16;
+
+	if (channels > kMaxForwardChannels)
+		return ~0u;
+
+	const uint32_t all = (1u << channels) - 1;
+
+	const uint8_t *s = static_cast<const uint8_t *>(src);
+	const size_t frame_bytes = SampleBytes * channels;
+	__m128i sums[SampleBytes * kMaxForwardChannels];
+	alignas(16) uint8_t block[kBlockFrames * SampleBytes * kMaxForwardChannels];
+	uint8_t row[SampleBytes * kMaxForwardChannels] {};
+
+	for (size_t vector=0; vector<frame_bytes; ++vector)
+		sums[vector] = _mm_setzero_si128();
+
+	// sums  row 1t[ɏŁA`l̃rbg߂
+	auto reduce = [&]() -> uint32_t
+	{
+		for (size_t vector=0; vector<frame_bytes; ++vector)
+			_mm_store_si128(reinterpret_cast<__m128i *>(block + vector * 16), sums[vector]);
+
+		for (size_t frame=0; frame<kBlockFrames; ++frame)
+		{
+			for (size_t byte=0; byte<frame_bytes; ++byte)
+				row[byte] |= block[frame * frame_bytes + byte];
+		}
+
+		return ActiveChannels<SampleBytes, kFloat>(row, channels);
+	};
+
+	size_t frame = 0;
+	size_t interval = kScanFirstCheckFrames;
+
+	for (; frame + kBlockFrames <= frames; interval = std::min(interval * 4, kScanCheckFrames))
+	{
+		const size_t end = frame + std::min(interval, (frames - frame) / kBlockFrames * kBlockFrames);
+
+		for (; frame<end; frame += kBlockFrames)
+		{
+			for (size_t vector=0; vector<frame_bytes; ++vector)
+				sums[vector] = _mm_or_si128(sums[vector], _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + vector * 16)));
+
+			s += kBlockFrames * frame_bytes;
+		}
+
+		if (all == reduce())
+			return all;
+	}
+
+	for (; frame<frames; ++frame)
+	{
+		for (size_t byte=0; byte<frame_bytes; ++byte)
+			row[byte] |= s[byte];
+
+		s += frame_bytes;
+	}
+
+	return ActiveChannels<SampleBytes, kFloat>(row, channels);
+}
+// `lɃobt@ǂ݁A16Tv4g̐ώZlɕĐώZB1gł͉Z̒xŗB
+MSS_TARGET("sse2")
+static void MeasureLevelsSse2(const float *const *planes, unsigned channels, size_t frames, ChannelLevels *levels)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const float *plane = planes[channel];
+		if (!plane)
+			continue;
+
+		__m128 peak0 = _mm_setzero_ps(), peak1 = _mm_setzero_ps(), peak2 = _mm_setzero_ps(), peak3 = _mm_setzero_ps();
+		__m128 energy0 = _mm_setzero_ps(), energy1 = _mm_setzero_ps(), energy2 = _mm_setzero_ps(), energy3 = _mm_setzero_ps();
+		size_t frame = 0;
+
+		for (; frame + 16 <= frames; frame += 16)
+		{
+			AccumulateLevelsSse2(&peak0, &energy0, _mm_loadu_ps(plane + frame));
+			AccumulateLevelsSse2(&peak1, &energy1, _mm_loadu_ps(plane + frame + 4));
+			AccumulateLevelsSse2(&peak2, &energy2, _mm_loadu_ps(plane + frame + 8));
+			AccumulateLevelsSse2(&peak3, &energy3, _mm_loadu_ps(plane + frame + 12));
+		}
+
+		for (; frame + 4 <= frames; frame += 4)
+			AccumulateLevelsSse2(&peak0, &energy0, _mm_loadu_ps(plane + frame));
+
+		MergeLaneLevelsSse2(levels, channel,
+			_mm_max_ps(_mm_max_ps(peak0, peak1), _mm_max_ps(peak2, peak3)),
+			_mm_add_ps(_mm_add_ps(energy0, energy1), _mm_add_ps(energy2, energy3)));
+
+		for (; frame<frames; ++frame)
+			AccumulateLevel(levels, channel, plane[frame]);
+	}
+}
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// I[fBIf[^]̓[vB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+
+enum class SimdLevel
+{
+	kScalar,
+	kSse2,
+	kAvx2,
+	kAvx512
+};
+
+// ̓Tv̌`B͂lCeBuGfBAŁAS24 3oCgl߁B
+enum class SampleFormat
+{
+	kFloat32,
+	kSigned16,
+	kSigned24,
+	kSigned32
+};
+
+// `l̏BÓIIuWFNgSĎg鐔 (AudioObjectType_FrontLeft  AudioObjectType_BackCenter ܂)B
+constexpr unsigned kMaxForwardChannels = 17;
+
+// s|ꍇ̓̓`l̏ (VLC  AOUT_CHAN_MAX)
+constexpr unsigned kMaxMixInputChannels = 9;
+
+// o̓`l̉ʂ̌vlBpeak ̓Tv̐Βl̍őAenergy ͓aB
+// ]֐͏񂾒l̒lɐώẐŁAďo 0 ɂĂΉɕē]Ă悢B
+struct ChannelLevels
+{
+	float peak[kMaxForwardChannels];
+	double energy[kMaxForwardChannels];
+};
+
+// C^[[uꂽ src A`l float obt@ dst ɕzB
+// dst[channel][frame] = src[frame * channels + reorder[channel]]
+// ` src  [-1.0, 1.0) ɕϊȂ番zB
+// dst[channel]  nullptr ̃`lɂ͏܂ȂB
+// gain  nullptr łȂ΁At[̔{ gain[frame] S`lɊ|B
+// levels  nullptr łȂ΁A񂾒l ({|) `l levels ɐώZBǂݒɃWX^ŋ߂B
+typedef void (*DeinterleaveFunction)(float *const *dst, const void *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels);
+
+// C^[[uꂽ src ɍs|A`l float obt@ dst ɏB
+// dst[out][frame] =  matrix[out * in_channels + in] * src[frame * in_channels + in]
+// `̕ϊAdst[out]  nullptr ̏ꍇAgain  levels ̈ DeinterleaveFunction ƓB
+typedef void (*MixFunction)(float *const *dst, const void *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels);
+
+// C^[[uꂽ src ̂A0 łȂTv܂ރ`l̃rbg (rbg channel `l channel) ԂB
+// float ͕rbgĒׂ̂ŁA-0.0 Ƃ݂ȂBS`lɉƕ_Œׂ̂߂B
+typedef uint32_t (*ScanSilenceFunction)(const void *src, unsigned channels, size_t frames);
+
+// ݍς݂̃`l float obt@ planes ǂ݁A]֐Ɠ悤 levels ɐώZB
+// ]֐ŌvłȂoH (O̎ʂA[gϊAԐLk) ŎgBplanes[channel]  nullptr ̃`l͔΂B
+typedef void (*MeasureLevelsFunction)(const float *const *planes, unsigned channels, size_t frames, ChannelLevels *levels);
+
+// CPUID 𒲂ׁAOSΉĂ̂܂߂Ďgp\ȍŏʂ̖߃ZbgԂ
+SimdLevel DetectSimdLevel();
+DeinterleaveFunction SelectDeinterleaveFunction(SimdLevel level, SampleFormat format = SampleFormat::kFloat32);
+MixFunction SelectMixFunction(SimdLevel level, SampleFormat format = SampleFormat::kFloat32);
+ScanSilenceFunction SelectScanSilenceFunction(SimdLevel level, SampleFormat format = SampleFormat::kFloat32);
+MeasureLevelsFunction SelectMeasureLevelsFunction(SimdLevel level);
+
+// SIMD ̃[A܂̓t[ɋ߂̍őƓa (lanes ) ŁAlevels ̃`l channel ɐώZB
+// s[NŎ̂́AaƏZLĐΒl镪̖߂Ȃ߁B
+// ]֐̎ƃRpC̃CAEg (LayoutKernel) gB
+void MergeLaneLevels(ChannelLevels *levels, unsigned channel, const float *square_peak, const float *energy, size_t lanes);
+
+// rp̊ (float )
+void DeinterleaveScalar(float *const *dst, const void *src, const uint8_t *reorder, unsigned channels, size_t frames, const float *gain, ChannelLevels *levels);
+void MixScalar(float *const *dst, const void *src, const float *matrix, unsigned in_channels, unsigned out_channels, size_t frames, const float *gain, ChannelLevels *levels);
+uint32_t ScanSilenceScalar(const void *src, unsigned channels, size_t frames);
+void MeasureLevelsScalar(const float *const *planes, unsigned channels, size_t frames, ChannelLevels *levels);
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ForwardKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// `lƕւ\RpCɌŒ肵Afloat ͗p DeinterleaveFunctionB
+// ̃[v񐔂萔ɂȂ̂ŁARpCWJExNgłB
+template <uint8_t... Reorder>
+struct LayoutKernel
+{
+	static constexpr unsigned kChannels = sizeof...(Reorder);
+	static constexpr uint8_t kReorder[kChannels] = {Reorder...};
+	static constexpr size_t kBlockFrames = 16;
+
+	// 3E4 DeinterleaveFunction ƌ^𑵂邽߂̂
+	static void Deinterleave(float *const *dst, const void *src_data, const uint8_t *, unsigned, size_t frames, const float *gain, ChannelLevels *levels)
+	{
+		const float *src = static_cast<const float *>(src_data);
+
+		if (gain && levels)
+			Run<true, true>(dst, src, frames, gain, levels);
+		else if (gain)
+			Run<true, false>(dst, src, frames, gain, nullptr);
+		else if (levels)
+			Run<false, true>(dst, src, frames, nullptr, levels);
+		else
+			Run<false, false>(dst, src, frames, nullptr, nullptr);
+	}
+
+private:
+	// v̓ubÑt[ɓ̍őƓaώZB
+	// ώZlWX^Ɏ܂Ȃ̂ŁAvꍇ SIMD  (MU[) xB
+	template <bool kGain, bool kMeter>
+	static void Run(float *const *dst, const float *src, size_t frames, const float *gain, ChannelLevels *levels)
+	{
+		float peak[kChannels][kBlockFrames] {};
+		float energy[kChannels][kBlockFrames] {};
+		size_t frame = 0;
+
+		for (; frame + kBlockFrames <= frames; frame += kBlockFrames)
+		{
+			const float *s = src + frame * kChannels;
+
+			for (unsigned channel=0; channel<kChannels; ++channel)
+			{
+				float *d = dst[channel];
+				if (!d)
+					continue;
+
+				for (size_t n=0; n<kBlockFrames; ++n)
+				{
+					const float value = kGain? s[n * kChannels + kReorder[channel]] * gain[frame + n]: s[n * kChannels + kReorder[channel]];
+					d[frame + n] = value;
+
+					if (kMeter)
+					{
+						const float square = value * value;
+						peak[channel][n] = std::max(peak[channel][n], square);
+						energy[channel][n] += square;
+					}
+				}
+			}
+		}
+
+		for (; frame<frames; ++frame)
+		{
+			const float *s = src + frame * kChannels;
+			const float g = kGain? gain[frame]: 1.0f;
+
+			for (unsigned channel=0; channel<kChannels; ++channel)
+			{
+				if (!dst[channel])
+					continue;
+
+				const float value = s[kReorder[channel]] * g;
+				dst[channel][frame] = value;
+
+				if (kMeter)
+				{
+					const float square = value * value;
+					peak[channel][0] = std::max(peak[channel][0], square);
+					energy[channel][0] += square;
+				}
+			}
+		}
+
+		if (kMeter)
+		{
+			for (unsigned channel=0; channel<kChannels; ++channel)
+			{
+				if (dst[channel])
+					MergeLaneLevels(levels, channel, peak[channel], energy[channel], kBlockFrames);
+			}
+		}
+	}
+};
+
+constexpr unsigned CountLayoutChannels(uint32_t mask)
+{
+	unsigned channels = 0;
+
+	for (; mask; mask &= mask - 1)
+		++channels;
+
+	return channels;
+}
+
+// DeinterleaveFunction ̕ւ\Bin ͓͂̃C^[[uAout ͏o͂̃obt@̏ŁAmask ɂ`l݂̂ԁB
+// table[o͂̔ԍ] = ͂̔ԍ ƂȂ (aout_CheckChannelReorder ͋tȂ̂ŁÂ܂܂ł͎gȂ)B
+// RpCɂsɂgB
+template <size_t InSize, size_t OutSize>
+constexpr std::array<uint8_t, kMaxForwardChannels> MakeLayoutReorder(const uint32_t (&in)[InSize], const uint32_t (&out)[OutSize], uint32_t mask)
+{
+	std::array<uint8_t, kMaxForwardChannels> table {};
+	unsigned channels = 0;
+
+	for (size_t j=0; j<OutSize; ++j)
+	{
+		if (!(mask & out[j]))
+			continue;
+
+		uint8_t index = 0;
+		for (size_t i=0; (i < InSize) && (in[i] != out[j]); ++i)
+		{
+			if (mask & in[i])
+				++index;
+		}
+
+		table[channels++] = index;
+	}
+
+	return table;
+}
+
+// בւȂꍇ̕\B
+constexpr std::array<uint8_t, kMaxForwardChannels> MakeIdentityReorder()
+{
+	std::array<uint8_t, kMaxForwardChannels> table {};
+
+	for (unsigned channel=0; channel<kMaxForwardChannels; ++channel)
+		table[channel] = static_cast<uint8_t>(channel);
+
+	return table;
+}
@@ -0,0 +1,268 @@
+#include "LevelMeter.h"
+#include "ObjectLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+// K  (BS.1770 ̑OĩVFrOtB^ƌĩnCpXtB^) ̃AiǑ^B
+// 48kHz ̌W𒼐ڎg킸A烌[gɑoꎟϊŋ߂B
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kShelfFrequency = 1681.974450955533;
+static constexpr double kShelfGainDb = 3.999843853973347;
+static constexpr double kShelfQ = 0.7071752369554196;
+static constexpr double kShelfBandGainExponent = 0.4996667741545416;
+static constexpr double kHighPassFrequency = 38.13547087602444;
+static constexpr double kHighPassQ = 0.5003270373238773;
+
+// 敽ς烉EhlX (LUFS) ւ̊Zől
+static constexpr double kLoudnessOffset = -0.691;
+
+// tB^̏Ԃ菬Ȃ 0 ɂBƂɔ񐳋KŒxȂȂ悤ɁB
+static constexpr double kDenormalThreshold = 1.0e-25;
+
+LevelMeter::LevelMeter()
+{
+	Reset(0, 48000, false);
+}
+
+void LevelMeter::Reset(uint32_t objects, unsigned rate, bool loudness)
+{
+	channels_ = 0;
+	filter_count_ = 0;
+	for (uint32_t rest=objects; rest && (channels_ < kMaxForwardChannels); rest &= rest - 1)
+	{
+		weights_[channels_] = ObjectWeight(rest & ~(rest - 1));
+		if (0.0f != weights_[channels_])
+			filter_channels_[filter_count_++] = static_cast<uint8_t>(channels_);
+
+		++channels_;
+	}
+
+	loudness_ = loudness;
+	block_frames_ = std::max<size_t>(1, static_cast<size_t>(rate * kBlockSeconds));
+
+	const double k = std::tan(kPi * kShelfFrequency / rate);
+	const double vh = std::pow(10.0, kShelfGainDb / 20.0);
+	const double vb = std::pow(vh, kShelfBandGainExponent);
+	const double a0 = 1.0 + k / kShelfQ + k * k;
+	filters_[0] = Biquad {
+		{(vh + vb * k / kShelfQ + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / kShelfQ + k * k) / a0},
+		{1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / kShelfQ + k * k) / a0}};
+
+	const double h = std::tan(kPi * kHighPassFrequency / rate);
+	const double h0 = 1.0 + h / kHighPassQ + h * h;
+	filters_[1] = Biquad {
+		{1.0, -2.0, 1.0},
+		{1.0, 2.0 * (h * h - 1.0) / h0, (1.0 - h / kHighPassQ + h * h) / h0}};
+
+	states_.fill(FilterState {});
+	frames_ = 0;
+	levels_ = ChannelLevels {};
+	filtered_energy_.fill(0.0);
+	block_energy_.fill(0.0);
+	block_frames_history_.fill(0);
+	blocks_ = 0;
+	clipped_blocks_ = 0;
+
+	Snapshot snapshot {};
+	snapshot.channels = channels_;
+	snapshot.momentary = kSilenceLoudness;
+	snapshot.short_term = kSilenceLoudness;
+	snapshot_.Store(snapshot);
+}
+
+void LevelMeter::AddPeriod(const ChannelLevels& levels, const float *const *planes, size_t frames)
+{
+	for (unsigned channel=0; channel<channels_; ++channel)
+	{
+		levels_.peak[channel] = std::max(levels_.peak[channel], levels.peak[channel]);
+		levels_.energy[channel] += levels.energy[channel];
+	}
+
+	if (loudness_)
+		FilterPeriod(planes, frames);
+
+	frames_ += frames;
+	if (frames_ >= block_frames_)
+		CloseBlock();
+}
+
+float LevelMeter::ObjectWeight(uint32_t object_bit)
+{
+	constexpr uint32_t kSurroundObjects =
+		ObjectBit(ObjectChannel::kSideLeft)| ObjectBit(ObjectChannel::kSideRight)|
+		ObjectBit(ObjectChannel::kBackLeft)| ObjectBit(ObjectChannel::kBackRight);
+
+	if (ObjectBit(ObjectChannel::kLowFrequency) == object_bit)
+		return 0.0f;
+
+	return (kSurroundObjects & object_bit)? 1.41f: 1.0f;
+}
+
+// K ͑ÕTvɈˑ̂ŁA]֐Ƃ͕ʂ planes ǂŒʂBd݂ 0 ̃`l (LFE) ͒ʂȂB
+// kFilterLanes `lA2`l SSE2 ̃WX^ɕׂăt[ɒʂB
+// [̃[ nullptr ̃`ĺA0 ǂݑ悤ɂB
+void LevelMeter::FilterPeriod(const float *const *planes, size_t frames)
+{
+	static_assert(4 == kFilterLanes, "FilterPeriod handles two pairs of lanes");
+	static const float zero = 0.0f;
+
+	__m128d b[2][3];
+	__m128d a[2][2];
+	for (size_t i=0; i<2; ++i)
+	{
+		for (size_t j=0; j<3; ++j)
+			b[i][j] = _mm_set1_pd(filters_[i].b[j]);
+
+		a[i][0] = _mm_set1_pd(filters_[i].a[1]);
+		a[i][1] = _mm_set1_pd(filters_[i].a[2]);
+	}
+
+	for (unsigned first=0; first<filter_count_; first += kFilterLanes)
+	{
+		const unsigned lanes = std::min(kFilterLanes, filter_count_ - first);
+		const float *input[kFilterLanes];
+		size_t mask[kFilterLanes];
+		alignas(16) double z[2][2][kFilterLanes] {};	// [tB^][x][[]
+
+		for (unsigned lane=0; lane<kFilterLanes; ++lane)
+		{
+			const float *plane = (lane < lanes)? planes[filter_channels_[first + lane]]: nullptr;
+
+			input[lane] = plane? plane: &zero;
+			mask[lane] = plane? ~static_cast<size_t>(0): 0;
+
+			if (lane < lanes)
+			{
+				const FilterState& state = states_[filter_channels_[first + lane]];
+
+				for (size_t i=0; i<2; ++i)
+				{
+					z[i][0][lane] = state.z[i][0];
+					z[i][1][lane] = state.z[i][1];
+				}
+			}
+		}
+
+		// [tB^][x][[̑g]
+		__m128d state[2][2][2];
+		for (size_t i=0; i<2; ++i)
+		{
+			for (size_t delay=0; delay<2; ++delay)
+			{
+				state[i][delay][0] = _mm_load_pd(&z[i][delay][0]);
+				state[i][delay][1] = _mm_load_pd(&z[i][delay][2]);
+			}
+		}
+
+		__m128d sum[2] = {_mm_setzero_pd(), _mm_setzero_pd()};
+
+		for (size_t frame=0; frame<frames; ++frame)
+		{
+			__m128d value[2] = {
+				_mm_set_pd(input[1][frame & mask[1]], input[0][frame & mask[0]]),
+				_mm_set_pd(input[3][frame & mask[3]], input[2][frame & mask[2]])};
+
+			for (size_t i=0; i<2; ++i)
+			{
+				for (size_t pair=0; pair<2; ++pair)
+				{
+					// ÕTv̌ʂ҂̂ output ߂ĂゾɂȂ悤A͂̍ɑ
+					const __m128d feed = _mm_add_pd(_mm_mul_pd(b[i][1], value[pair]), state[i][1][pair]);
+					const __m128d output = _mm_add_pd(_mm_mul_pd(b[i][0], value[pair]), state[i][0][pair]);
+
+					state[i][0][pair] = _mm_sub_pd(feed, _mm_mul_pd(a[i][0], output));
+					state[i][1][pair] = _mm_sub_pd(_mm_mul_pd(b[i][2], value[pair]), _mm_mul_pd(a[i][1], output));
+					value[pair] = output;
+				}
+			}
+
+			sum[0] = _mm_add_pd(sum[0], _mm_mul_pd(value[0], value[0]));
+			sum[1] = _mm_add_pd(sum[1], _mm_mul_pd(value[1], value[1]));
+		}
+
+		alignas(16) double energy[kFilterLanes];
+		_mm_store_pd(&energy[0], sum[0]);
+		_mm_store_pd(&energy[2], sum[1]);
+		for (size_t i=0; i<2; ++i)
+		{
+			for (size_t delay=0; delay<2; ++delay)
+			{
+				_mm_store_pd(&z[i][delay][0], state[i][delay][0]);
+				_mm_store_pd(&z[i][delay][2], state[i][delay][1]);
+			}
+		}
+
+		for (unsigned lane=0; lane<lanes; ++lane)
+		{
+			const unsigned channel = filter_channels_[first + lane];
+			FilterState& filter_state = states_[channel];
+
+			for (size_t i=0; i<2; ++i)
+			{
+				for (size_t delay=0; delay<2; ++delay)
+					filter_state.z[i][delay] = (std::fabs(z[i][delay][lane]) < kDenormalThreshold)? 0.0: z[i][delay][lane];
+			}
+
+			filtered_energy_[channel] += energy[lane];
+		}
+	}
+}
+
+// ؂蒆̋ԂāAvlJ
+void LevelMeter::CloseBlock()
+{
+	Snapshot snapshot {};
+	bool clipped = false;
+	double energy = 0.0;
+
+	for (unsigned channel=0; channel<channels_; ++channel)
+	{
+		snapshot.peak[channel] = levels_.peak[channel];
+		snapshot.rms[channel] = static_cast<float>(std::sqrt(levels_.energy[channel] / frames_));
+		clipped |= (levels_.peak[channel] >= 1.0f);
+		energy += weights_[channel] * filtered_energy_[channel];
+	}
+
+	const size_t slot = static_cast<size_t>(blocks_ % kShortTermBlocks);
+	block_energy_[slot] = energy;
+	block_frames_history_[slot] = frames_;
+	++blocks_;
+
+	if (clipped)
+		++clipped_blocks_;
+
+	snapshot.blocks = blocks_;
+	snapshot.clipped_blocks = clipped_blocks_;
+	snapshot.channels = channels_;
+	snapshot.momentary = loudness_? Loudness(kMomentaryBlocks): kSilenceLoudness;
+	snapshot.short_term = loudness_? Loudness(kShortTermBlocks): kSilenceLoudness;
+	snapshot_.Store(snapshot);
+
+	frames_ = 0;
+	levels_ = ChannelLevels {};
+	filtered_energy_.fill(0.0);
+}
+
+//  blocks  (܂ĂȂΑ) ̋Ԃ̃EhlXB
+// dݕt̘a𑋑Ŝ̃t[ŊA`l̓敽ςɏd݂|aɂB
+float LevelMeter::Loudness(size_t blocks) const
+{
+	const size_t count = static_cast<size_t>(std::min<uint64_t>(blocks, blocks_));
+	double energy = 0.0;
+	size_t frames = 0;
+
+	for (size_t i=0; i<count; ++i)
+	{
+		const size_t slot = static_cast<size_t>((blocks_ - 1 - i) % kShortTermBlocks);
+
+		energy += block_energy_[slot];
+		frames += block_frames_history_[slot];
+	}
+
+	if (!frames || (energy <= 0.0))
+		return kSilenceLoudness;
+
+	return static_cast<float>(std::max<double>(kLoudnessOffset + 10.0 * std::log10(energy / frames), kSilenceLoudness));
+}
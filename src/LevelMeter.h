@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ForwardKernels.h"
+#include "SeqLock.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// o͂̃`l̃s[N RMSA ITU-R BS.1770 (EBU R128) ̃[^EV[g^[̃EhlX߂B
+// s[NƓa͓]֐݂̂łɋ߂ (ChannelLevels) A` AddPeriod() őށB
+// 100ms ɋ؂ČvlJAǏo͔Cӂ̃Xbh烍bN炸ɍsB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class LevelMeter
+{
+public:
+	// JvlBpeak  rms ͒߂̋Ԃ̂̂ŁAtXP[ 1.0 ƂB
+	// momentary (400ms)  short_term (3s)  LUFS ŁAEhlX߂Ȃꍇ kSilenceLoudnessB
+	struct Snapshot
+	{
+		uint64_t blocks;			// ܂łɋ؂Ԃ̐
+		uint64_t clipped_blocks;	// ̂Aꂩ̃`l̃s[N 1.0 ȏゾ
+		unsigned channels;
+		float peak[kMaxForwardChannels];
+		float rms[kMaxForwardChannels];
+		float momentary;
+		float short_term;
+	};
+
+	// J郉EhlX̉ (LUFS)B̏ꍇ̒lɂȂB
+	static constexpr float kSilenceLoudness = -120.0f;
+
+	// Ԃ̒ (b)B`̒Pʂŋ؂̂ŁAۂ̋Ԃ͍ő1ȂB
+	static constexpr double kBlockSeconds = 0.1;
+
+	// [^ƃV[g^[̑̋Ԑ
+	static constexpr size_t kMomentaryBlocks = 4;
+	static constexpr size_t kShortTermBlocks = 30;
+
+	LevelMeter();
+
+	LevelMeter(const LevelMeter&) = delete;
+	LevelMeter& operator=(const LevelMeter&) = delete;
+
+	// objects (ObjectBit ̘a) ̏ɕԏo͂ATvO[g rate ŌvB
+	// loudness  false ȂAK ̃tB^ʂs[N RMS ߂B
+	// I[fBIXbhĂȂƂɌĂԂƁB
+	void Reset(uint32_t objects, unsigned rate, bool loudness);
+
+	// `̕Blevels  planes ̐擪 frames t[v́B
+	// EhlX߂ꍇ planes ǂ K ̃tB^ɒʂBplanes[channel]  nullptr ̃`l͖Ƃ݂ȂB
+	void AddPeriod(const ChannelLevels& levels, const float *const *planes, size_t frames);
+
+	Snapshot Load() const
+	{
+		return snapshot_.Load();
+	}
+
+	// BS.1770 ̃`l̏d݁BLFE ͊܂߂Aƌ̍E 1.41 { (+1.5dB) ɂB
+	static float ObjectWeight(uint32_t object_bit);
+
+private:
+	// 2 IIR tB^ (]uڌ` II)Bb ͕qAa ͕̌W a0 = 1 ƂB
+	struct Biquad
+	{
+		double b[3];
+		double a[3];
+	};
+
+	// K ̃tB^ɂ܂Ƃ߂Ēʂ`lB1`lł1TvɑÕTv̌ʂ҂̂ŁA
+	// Ɨȃ`lt[ɕׂĒʂȂ҂Ԃ𖄂߂B
+	static constexpr unsigned kFilterLanes = 4;
+
+	struct FilterState
+	{
+		double z[2][2];		// [tB^][x]
+	};
+
+	void FilterPeriod(const float *const *planes, size_t frames);
+	void CloseBlock();
+	float Loudness(size_t blocks) const;
+
+	unsigned channels_;
+	bool loudness_;
+	size_t block_frames_;
+	std::array<float, kMaxForwardChannels> weights_;
+	std::array<uint8_t, kMaxForwardChannels> filter_channels_;	// d݂ 0 łȂ (K ̃tB^ɒʂ) `l
+	unsigned filter_count_;
+	Biquad filters_[2];		// OĩVFrOtB^ƁAĩnCpXtB^
+	std::array<FilterState, kMaxForwardChannels> states_;
+
+	// ؂蒆̋Ԃ̃t[ƌvlBfiltered_energy_  K ̃tB^ʂaB
+	size_t frames_;
+	ChannelLevels levels_;
+	std::array<double, kMaxForwardChannels> filtered_energy_;
+
+	// ؂Ԗ́AK |ȁdݕt̘aƃt[B kShortTermBlocks 񂵂ĎB
+	std::array<double, kShortTermBlocks> block_energy_;
+	std::array<size_t, kShortTermBlocks> block_frames_history_;
+	uint64_t blocks_;
+	uint64_t clipped_blocks_;
+
+	SeqLock<Snapshot> snapshot_;
+};
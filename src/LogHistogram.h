@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 2 ׂ̂ŋ؂qXgOBoPbg b ɂ [2^(b-1), 2^b) ̒l𐔂 (b = 0 ͒l 0)B
+// L^1Xbĥ݂ƂAbNt̖߂g킸ɐBǏo͔Cӂ̃XbhsB
+class LogHistogram
+{
+public:
+	static constexpr unsigned kBuckets = 40;
+
+	struct Snapshot
+	{
+		uint64_t counts[kBuckets];
+		uint64_t count;
+		uint64_t sum;
+		uint64_t max;
+
+		//  ratio ̈ʒu܂܂oPbg̏Ԃ (max 𒴂Ȃ)
+		uint64_t Percentile(double ratio) const
+		{
+			const uint64_t rank = static_cast<uint64_t>(ratio * count);
+			uint64_t seen = 0;
+
+			for (unsigned bucket=0; bucket<kBuckets; ++bucket)
+			{
+				seen += counts[bucket];
+				if (seen > rank)
+				{
+					const uint64_t upper = bucket? (uint64_t(1) << bucket) - 1: 0;
+					return (upper < max)? upper: max;
+				}
+			}
+
+			return max;
+		}
+	};
+
+	LogHistogram()
+	{
+		Reset();
+	}
+
+	LogHistogram(const LogHistogram&) = delete;
+	LogHistogram& operator=(const LogHistogram&) = delete;
+
+	// L^~܂ĂƂɌĂԂ
+	void Reset()
+	{
+		for (auto& count: counts_)
+			count.store(0, std::memory_order_relaxed);
+
+		sum_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	void Record(uint64_t value)
+	{
+		unsigned bucket = BitWidth(value);
+		if (bucket >= kBuckets)
+			bucket = kBuckets - 1;
+
+		counts_[bucket].store(counts_[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+
+		if (value > max_.load(std::memory_order_relaxed))
+			max_.store(value, std::memory_order_relaxed);
+	}
+
+	// L^ƏdȂꍇAel͏邱Ƃ
+	Snapshot Load() const
+	{
+		Snapshot snapshot {};
+
+		for (unsigned bucket=0; bucket<kBuckets; ++bucket)
+		{
+			snapshot.counts[bucket] = counts_[bucket].load(std::memory_order_relaxed);
+			snapshot.count += snapshot.counts[bucket];
+		}
+
+		snapshot.sum = sum_.load(std::memory_order_relaxed);
+		snapshot.max = max_.load(std::memory_order_relaxed);
+
+		return snapshot;
+	}
+
+private:
+	static unsigned BitWidth(uint64_t value)
+	{
+		if (!value)
+			return 0;
+
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index + 1;
+#else
+		return 64 - __builtin_clzll(value);
+#endif
+	}
+
+	std::atomic<uint64_t> counts_[kBuckets];
+	std::atomic<uint64_t> sum_;
+	std::atomic<uint64_t> max_;
+};
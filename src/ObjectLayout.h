@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+// o͂ɎgÓIIuWFNg (ISpatialAudioObject) ̎ށB
+// l AudioObjectType ̃rbgʒu 1 ̂ŁAт AudioObjectType ̏ƓB
+// Windows ̃wb_ɈˑȂ悤ɂĂ̂ŁAx`}[NgB
+enum class ObjectChannel : uint8_t
+{
+	kFrontLeft,
+	kFrontRight,
+	kFrontCenter,
+	kLowFrequency,
+	kSideLeft,
+	kSideRight,
+	kBackLeft,
+	kBackRight,
+	kTopFrontLeft,
+	kTopFrontRight,
+	kTopBackLeft,
+	kTopBackRight,
+	kBottomFrontLeft,
+	kBottomFrontRight,
+	kBottomBackLeft,
+	kBottomBackRight,
+	kBackCenter
+};
+
+constexpr unsigned kObjectChannels = 17;
+
+// IuWFNg̑ǵAeIuWFNg̃rbg̘aŕ\B1rbgɂ炷 AudioObjectType ̃}XNɂȂB
+constexpr uint32_t ObjectBit(ObjectChannel object)
+{
+	return 1u << static_cast<unsigned>(object);
+}
+
+constexpr unsigned CountObjects(uint32_t objects)
+{
+	unsigned count = 0;
+
+	for (; objects; objects &= objects - 1)
+		++count;
+
+	return count;
+}
+
+// objects ̂Aobject OɂIuWFNg̐B]̃obt@͂̏ɕԁB
+constexpr unsigned ObjectIndex(uint32_t objects, ObjectChannel object)
+{
+	return CountObjects(objects & (ObjectBit(object) - 1));
+}
+
+constexpr uint32_t kObjects7_1 =
+	ObjectBit(ObjectChannel::kFrontLeft)| ObjectBit(ObjectChannel::kFrontRight)|
+	ObjectBit(ObjectChannel::kFrontCenter)| ObjectBit(ObjectChannel::kLowFrequency)|
+	ObjectBit(ObjectChannel::kSideLeft)| ObjectBit(ObjectChannel::kSideRight)|
+	ObjectBit(ObjectChannel::kBackLeft)| ObjectBit(ObjectChannel::kBackRight);
+
+constexpr uint32_t kObjectsTop =
+	ObjectBit(ObjectChannel::kTopFrontLeft)| ObjectBit(ObjectChannel::kTopFrontRight)|
+	ObjectBit(ObjectChannel::kTopBackLeft)| ObjectBit(ObjectChannel::kTopBackRight);
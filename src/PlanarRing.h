@@ -0,0 +1,132 @@
+#pragma once
+
+#include "ForwardKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// PꐶYҁEP҂́A`lɕ float ̃TṽOobt@B
+// e`l̗̈̓LbVC̋En܂A`lԂœLbVCLȂB
+// WritePlanes / CommitWrite ͐Y҃Xbĥ݁ARead / Clear ͏҃Xbĥ݂ĂԂƁB
+// Reset ͗҂GĂȂԂɌĂԂƁB
+class PlanarRing
+{
+public:
+	static constexpr size_t kCacheLineSize = 64;
+
+	PlanarRing()
+		: read_(0), write_(0), base_(nullptr), channels_(0), capacity_(0), stride_(0)
+	{
+	}
+
+	PlanarRing(const PlanarRing&) = delete;
+	PlanarRing& operator=(const PlanarRing&) = delete;
+
+	// channels `l ~ capacity t[mۂAɂ
+	void Reset(unsigned channels, size_t capacity)
+	{
+		static constexpr size_t kLineFloats = kCacheLineSize / sizeof (float);
+
+		channels_ = channels;
+		capacity_ = capacity;
+		stride_ = (capacity + kLineFloats - 1) / kLineFloats * kLineFloats;
+		storage_.assign(stride_ * channels + kLineFloats, 0.0f);
+
+		const uintptr_t address = reinterpret_cast<uintptr_t>(storage_.data());
+		base_ = storage_.data() + ((kCacheLineSize - address % kCacheLineSize) % kCacheLineSize) / sizeof (float);
+
+		read_.store(0, std::memory_order_relaxed);
+		write_.store(0, std::memory_order_relaxed);
+	}
+
+	// YґBܕԂɏ̈̐擪 planes[channel] ɓÃt[ԂBtȂ 0 ԂB
+	size_t WritePlanes(float *planes[kMaxForwardChannels]) const
+	{
+		const size_t write = write_.load(std::memory_order_relaxed);
+		const size_t free = capacity_ - (write - read_.load(std::memory_order_acquire));
+		const size_t offset = write % capacity_;
+
+		for (unsigned channel=0; channel<channels_; ++channel)
+			planes[channel] = base_ + channel * stride_ + offset;
+
+		return std::min(free, capacity_ - offset);
+	}
+
+	void CommitWrite(size_t frames)
+	{
+		write_.store(write_.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+	}
+
+	// ґBframes (܂Ăt[ȉ) t[ dst[channel] ɎʂAdst ̊e|C^i߂B
+	// dst[channel]  nullptr ̃`l͓ǂݔ΂Bgain  nullptr łȂ΁At[̔{ gain[frame] |B
+	void Read(float *dst[kMaxForwardChannels], size_t frames, const float *gain)
+	{
+		const size_t read = read_.load(std::memory_order_relaxed);
+		const size_t offset = read % capacity_;
+		const size_t first = std::min(frames, capacity_ - offset);
+
+		// ܕԂꍇ̂݁A`l2ɕĎʂ
+		Copy(dst, offset, first, gain);
+		if (first < frames)
+			Copy(dst, 0, frames - first, gain? gain + first: nullptr);
+
+		read_.store(read + frames, std::memory_order_release);
+	}
+
+	// ґB܂Ă镪SĎ̂āÃt[ԂB
+	size_t Clear()
+	{
+		const size_t read = read_.load(std::memory_order_relaxed);
+		const size_t write = write_.load(std::memory_order_acquire);
+
+		read_.store(write, std::memory_order_release);
+
+		return write - read;
+	}
+
+	size_t Capacity() const
+	{
+		return capacity_;
+	}
+
+private:
+	void Copy(float *dst[kMaxForwardChannels], size_t offset, size_t frames, const float *gain) const
+	{
+		for (unsigned channel=0; channel<channels_; ++channel)
+		{
+			if (!dst[channel])
+				continue;
+
+			const float *src = base_ + channel * stride_ + offset;
+
+			if (gain)
+			{
+				for (size_t frame=0; frame<frames; ++frame)
+					dst[channel][frame] = src[frame] * gain[frame];
+			}
+			else
+			{
+				memcpy(dst[channel], src, frames * sizeof (float));
+			}
+
+			dst[channel] += frames;
+		}
+	}
+
+	// ҂̈
+	alignas(kCacheLineSize) std::atomic<size_t> read_;
+
+	// Y҂̈
+	alignas(kCacheLineSize) std::atomic<size_t> write_;
+
+	// ҂ǂނ̗̈
+	alignas(kCacheLineSize) std::vector<float> storage_;
+	float *base_;
+	unsigned channels_;
+	size_t capacity_;
+	size_t stride_;
+};
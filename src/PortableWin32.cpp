@@ -0,0 +1,132 @@
+#include "PortableWin32.h"
+
+#if !defined(_WIN32)
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// ̃Cxg܂Ƃ߂đ҂Ă悤ASẴCxg1 mutex ƏϐŎB
+// ҂Xbh͍X2 (I[fBIXbh VLC ̃R[obN) Ȃ̂ŁANĂ\ȂB
+struct PortableEvent
+{
+	bool manual_reset;
+	bool signaled;
+};
+
+static std::mutex event_mutex;
+static std::condition_variable event_changed;
+
+// VOiԂ̃Cxg΁AZbgȂ߂Ă̔ԍԂ
+static bool TakeSignaled(DWORD count, const HANDLE *events, DWORD *index)
+{
+	for (DWORD i=0; i<count; ++i)
+	{
+		PortableEvent *event = static_cast<PortableEvent *>(events[i]);
+
+		if (event->signaled)
+		{
+			if (!event->manual_reset)
+				event->signaled = false;
+
+			*index = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+HANDLE CreateEvent(void *attributes, BOOL manual_reset, BOOL initial_state, const char *name)
+{
+	UNREFERENCED_PARAMETER(attributes);
+	UNREFERENCED_PARAMETER(name);
+
+	return new PortableEvent {manual_reset? true: false, initial_state? true: false};
+}
+
+BOOL SetEvent(HANDLE event)
+{
+	{
+		std::lock_guard<std::mutex> lock(event_mutex);
+		static_cast<PortableEvent *>(event)->signaled = true;
+	}
+
+	event_changed.notify_all();
+
+	return TRUE;
+}
+
+BOOL ResetEvent(HANDLE event)
+{
+	std::lock_guard<std::mutex> lock(event_mutex);
+	static_cast<PortableEvent *>(event)->signaled = false;
+
+	return TRUE;
+}
+
+BOOL CloseHandle(HANDLE event)
+{
+	delete static_cast<PortableEvent *>(event);
+
+	return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE event, DWORD milliseconds)
+{
+	return WaitForMultipleObjects(1, &event, FALSE, milliseconds);
+}
+
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE *events, BOOL wait_all, DWORD milliseconds)
+{
+	if (wait_all)
+		return WAIT_FAILED;
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+	std::unique_lock<std::mutex> lock(event_mutex);
+	DWORD index;
+
+	while (!TakeSignaled(count, events, &index))
+	{
+		if (INFINITE == milliseconds)
+			event_changed.wait(lock);
+		else if (std::cv_status::timeout == event_changed.wait_until(lock, deadline))
+			return TakeSignaled(count, events, &index)? WAIT_OBJECT_0 + index: WAIT_TIMEOUT;
+	}
+
+	return WAIT_OBJECT_0 + index;
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER *count)
+{
+	count->QuadPart = std::chrono::steady_clock::now().time_since_epoch().count();
+
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency)
+{
+	frequency->QuadPart = std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+
+	return TRUE;
+}
+
+void Sleep(DWORD milliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+HRESULT CoInitializeEx(void *reserved, DWORD coinit)
+{
+	UNREFERENCED_PARAMETER(reserved);
+	UNREFERENCED_PARAMETER(coinit);
+
+	return S_OK;
+}
+
+void CoUninitialize()
+{
+}
+
+#endif
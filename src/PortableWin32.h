@@ -0,0 +1,79 @@
+#pragma once
+
+// I[fBIXbhƖ͋[o͂g Win32 APIB
+// Windows ł Windows.h ̂܂܎gBȊOł́AeXgƃx`}[NŖ͋[o͂ɑ΂ē悤A
+// gĂ镪WCuŎ (PortableWin32.cpp)B
+#if defined(_WIN32)
+
+#include "depends.h"
+
+#include <Windows.h>
+
+#else
+
+#include <cstdint>
+
+typedef int32_t HRESULT;
+typedef int BOOL;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int64_t LONGLONG;
+typedef void *HANDLE;
+
+struct LARGE_INTEGER
+{
+	LONGLONG QuadPart;
+};
+
+struct WAVEFORMATEX
+{
+	WORD wFormatTag;
+	WORD nChannels;
+	DWORD nSamplesPerSec;
+	DWORD nAvgBytesPerSec;
+	WORD nBlockAlign;
+	WORD wBitsPerSample;
+	WORD cbSize;
+};
+
+#define FALSE 0
+#define TRUE 1
+
+#define S_OK (static_cast<HRESULT>(0))
+#define E_FAIL (static_cast<HRESULT>(0x80004005u))
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+
+#define INFINITE 0xffffffffu
+#define WAIT_OBJECT_0 0u
+#define WAIT_TIMEOUT 258u
+#define WAIT_FAILED 0xffffffffu
+
+#define COINIT_MULTITHREADED 0x0
+#define COINIT_DISABLE_OLE1DDE 0x4
+
+#define UNREFERENCED_PARAMETER(parameter) ((void)(parameter))
+
+// CxgBƖO͎gȂB
+HANDLE CreateEvent(void *attributes, BOOL manual_reset, BOOL initial_state, const char *name);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+BOOL CloseHandle(HANDLE event);
+DWORD WaitForSingleObject(HANDLE event, DWORD milliseconds);
+
+// wait_all  FALSE ̂ݑΉ
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE *events, BOOL wait_all, DWORD milliseconds);
+
+// std::chrono::steady_clock ̃JEg
+BOOL QueryPerformanceCounter(LARGE_INTEGER *count);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency);
+
+void Sleep(DWORD milliseconds);
+
+// COM ͎gȂ̂ŉȂ
+HRESULT CoInitializeEx(void *reserved, DWORD coinit);
+void CoUninitialize();
+
+#endif
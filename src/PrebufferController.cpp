@@ -0,0 +1,73 @@
+#include "PrebufferController.h"
+
+#include <algorithm>
+#include <cmath>
+
+// wړς̏d݁B10ms Ŗ5b̗ɂȂB
+static constexpr double kAverageWeight = 1.0 / 512.0;
+
+// A_[ɂ悹̎̌B10ms Ŗ7bŔB
+static constexpr double kMarginDecay = 0.999;
+
+static double UpperNormalQuantile(double probability);
+
+
+PrebufferController::PrebufferController()
+	: z_(0.0),
+	maximum_frames_(0),
+	deficit_(0.0),
+	deficit_mean_(0.0),
+	deficit_variance_(0.0),
+	requested_mean_(0.0),
+	margin_(0.0)
+{
+}
+
+void PrebufferController::Reset(double underrun_probability, int64_t initial_frames, int64_t maximum_frames)
+{
+	z_ = UpperNormalQuantile(underrun_probability);
+	maximum_frames_ = maximum_frames;
+	deficit_ = 0.0;
+	deficit_mean_ = 0.0;
+	deficit_variance_ = 0.0;
+	requested_mean_ = 0.0;
+	margin_ = static_cast<double>(initial_frames);
+}
+
+void PrebufferController::Update(int64_t arrived_frames, int64_t requested_frames)
+{
+	// L[̏ԂŎn߂ĂA̎܂łɕsĂt[
+	deficit_ = std::max(0.0, deficit_ + static_cast<double>(requested_frames - arrived_frames));
+
+	const double difference = deficit_ - deficit_mean_;
+	deficit_mean_ += kAverageWeight * difference;
+	deficit_variance_ = (1.0 - kAverageWeight) * (deficit_variance_ + kAverageWeight * difference * difference);
+
+	requested_mean_ += kAverageWeight * (requested_frames - requested_mean_);
+	if (requested_mean_ < 1.0)
+		requested_mean_ = static_cast<double>(requested_frames);
+
+	margin_ *= kMarginDecay;
+}
+
+void PrebufferController::NotifyUnderrun()
+{
+	// vۂ̗h炬ɒǂ܂ŁA1]T𑝂₷
+	margin_ = std::min(margin_ + requested_mean_, static_cast<double>(maximum_frames_));
+}
+
+int64_t PrebufferController::Target() const
+{
+	const double target = std::max(requested_mean_, deficit_mean_ + z_ * std::sqrt(deficit_variance_)) + margin_;
+
+	return std::min(static_cast<int64_t>(std::ceil(target)), maximum_frames_);
+}
+
+// WKzŁA㑤m probability ƂȂ_ (Abramowitz and Stegun 26.2.23)
+static double UpperNormalQuantile(double probability)
+{
+	const double p = std::clamp(probability, 1.0e-9, 0.5);
+	const double t = std::sqrt(-2.0 * std::log(p));
+
+	return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) / (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
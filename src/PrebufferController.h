@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// ĐJnEtbVEA_[̌ɁAL[ɗ߂Ă]n߂t[ (ڕWl) ߂B
+// `ɁA͂t[Ɨvꂽt[AL[̏ԂŎn߂ꍇ
+// st[ (Lindley ̑Q) ߁A̕zw肵A_[mɎ܂ŏ̐[ڕWƂB
+// A_[Nꍇ́Avǂ܂ŗ]T悹B
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class PrebufferController
+{
+public:
+	PrebufferController();
+
+	// underrun_probability ͋eA_[mAinitial_frames ͓v܂ł̖ڕWlB
+	void Reset(double underrun_probability, int64_t initial_frames, int64_t maximum_frames);
+
+	// `ɌĂԁBarrived_frames ͑O̎L[ɓ͂t[Arequested_frames ͍vꂽt[B
+	void Update(int64_t arrived_frames, int64_t requested_frames);
+	void NotifyUnderrun();
+
+	int64_t Target() const;
+
+private:
+	double z_;
+	int64_t maximum_frames_;
+
+	// st[Ɨvt[̎wړρEU
+	double deficit_;
+	double deficit_mean_;
+	double deficit_variance_;
+	double requested_mean_;
+
+	// A_[ɂ悹
+	double margin_;
+};
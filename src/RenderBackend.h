@@ -0,0 +1,43 @@
+#pragma once
+
+#include "PortableWin32.h"
+
+// I[fBIXbh̏o͐B`Xg[EIuWFNg̃obt@EvE`̃Cxg܂Ƃ߂́B
+// ` BeginUpdating()  e`l GetBuffer()  EndUpdating() ̏ɌĂԁB
+// I[fBIXbĥݎgƁB
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() = default;
+
+	// `̓xɃVOi鎩Zbg̃Cxg
+	virtual HANDLE StreamEvent() const = 0;
+
+	// GetPosition()  device_position 1b̒l
+	virtual UINT64 DeviceFrequency() const = 0;
+
+	// 1̍őt[
+	virtual UINT32 MaxFrameCount() const = 0;
+
+	virtual HRESULT Start() = 0;
+	virtual HRESULT Stop() = 0;
+
+	// nς݂̃f[^̂āAĐʒu 0 ɖ߂B
+	// IuWFNg͔ANeBuɂȂ̂ŁAĎgꍇ ActivateObjects() ĂԂƁB
+	virtual HRESULT Reset() = 0;
+	virtual HRESULT ActivateObjects() = 0;
+
+	// Xg[~߂ɁAnς݂ł܂ĐĂȂ𖳉ɂ (ȃtbV)B̎n͌ɖ߂B
+	virtual HRESULT SilencePending() = 0;
+
+	// channel ͏o͂̕ (channel_reorder_table_ ŕւ) ̔ԍBsꍇ nullptr ԂB
+	virtual HRESULT BeginUpdating(UINT32 *frames) = 0;
+	virtual float *GetBuffer(unsigned channel) = 0;
+	virtual HRESULT EndUpdating() = 0;
+
+	// IAudioClock::GetPosition Ɠ
+	virtual HRESULT GetPosition(UINT64 *device_position, UINT64 *qpc_position) = 0;
+
+	// S`l̉ (VolumeMode::kStreamVolume ̏ꍇ)
+	virtual HRESULT SetVolume(float volume) = 0;
+};
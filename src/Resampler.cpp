@@ -0,0 +1,376 @@
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MSS_X86 1
+#endif
+
+#if MSS_X86
+#include <immintrin.h>
+#endif
+
+// MSVC ͖߃Zbg̎wȂőg݊֐g邪AGCC / Clang ͊֐PʂŎw肪Kv
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MSS_TARGET(isa)
+#else
+#define MSS_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// ĩtB^̐ݒB^bv͊g厞̒lŁAk͔ɍ킹đ₷B
+struct ResamplerPreset
+{
+	unsigned taps;
+	unsigned phases;
+	double beta;		// Kaiser ̌`
+	double rolloff;		// ʉ߈̒[ (iCLXggɑ΂)
+};
+
+static constexpr ResamplerPreset kResamplerPresets[] =
+{
+	{16, 64, 6.0, 0.85},
+	{32, 128, 8.0, 0.90},
+	{64, 256, 10.0, 0.945}
+};
+
+// SIMD ̕ɍ킹A^bv͂̔{ɂ
+static constexpr unsigned kTapAlignment = 8;
+
+static constexpr double kFixedOne = 4294967296.0;
+static constexpr double kPi = 3.14159265358979323846;
+
+static double BesselI0(double x);
+static void ResampleFrameScalar(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps);
+
+#if MSS_X86
+static void ResampleFrameSse2(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps);
+static void ResampleFrameAvx2(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps);
+#endif
+
+
+Resampler::Resampler()
+	: resample_frame_(ResampleFrameScalar),
+	kernel_level_(SimdLevel::kScalar),
+	channels_(0),
+	taps_(0),
+	phases_(0),
+	step_(0),
+	nominal_step_(0),
+	position_(0),
+	capacity_(0),
+	write_(0)
+{
+}
+
+bool Resampler::SupportsRates(unsigned input_rate, unsigned output_rate)
+{
+	return input_rate && output_rate && (input_rate <= output_rate * 4ull) && (output_rate <= input_rate * 4ull);
+}
+
+bool Resampler::Reset(unsigned input_rate, unsigned output_rate, unsigned channels, ResamplerQuality quality, SimdLevel level, size_t max_output_frames)
+{
+	if ((ResamplerQuality::kOff == quality) || (channels > kMaxForwardChannels) || !SupportsRates(input_rate, output_rate))
+		return false;
+
+	const double ratio = static_cast<double>(input_rate) / output_rate;
+
+	const ResamplerPreset& preset = kResamplerPresets[static_cast<int>(quality) - 1];
+
+	// k͎Ւfg镪^bv𑝂₵AJڑш͑̕ő
+	const unsigned taps = static_cast<unsigned>(std::ceil(preset.taps * std::max(1.0, ratio) / kTapAlignment)) * kTapAlignment;
+	const double cutoff = 0.5 * preset.rolloff * std::min(1.0, 1.0 / ratio);
+	const double half = taps / 2.0;
+	const double window_scale = 1.0 / BesselI0(preset.beta);
+
+	channels_ = channels;
+	taps_ = taps;
+	phases_ = preset.phases;
+	coefficients_.assign(static_cast<size_t>(phases_ + 1) * taps_, 0.0f);
+	differences_.assign(static_cast<size_t>(phases_ + 1) * taps_, 0.0f);
+
+	std::vector<double> values(taps_);
+
+	// ʑ phase ́Ao͂̎ŏ̃^bv (taps / 2 - 1 + phase / phases) t[ɂ邱Ƃ\
+	for (unsigned phase=0; phase<=phases_; ++phase)
+	{
+		const double offset = static_cast<double>(phase) / phases_;
+		float *row = coefficients_.data() + static_cast<size_t>(phase) * taps_;
+		double sum = 0.0;
+
+		for (unsigned tap=0; tap<taps_; ++tap)
+		{
+			const double distance = tap - (half - 1.0) - offset;
+			const double x = 2.0 * cutoff * distance;
+			const double sinc = (0.0 == x)? 1.0: std::sin(kPi * x) / (kPi * x);
+			const double r = distance / half;
+			const double window = (std::abs(r) < 1.0)? BesselI0(preset.beta * std::sqrt(1.0 - r * r)) * window_scale: 0.0;
+
+			values[tap] = 2.0 * cutoff * sinc * window;
+			sum += values[tap];
+		}
+
+		// ʑɒ̗ 1 ɑ
+		for (unsigned tap=0; tap<taps_; ++tap)
+			row[tap] = static_cast<float>(values[tap] / sum);
+	}
+
+	for (unsigned phase=0; phase<phases_; ++phase)
+	{
+		const float *row = coefficients_.data() + static_cast<size_t>(phase) * taps_;
+		float *difference = differences_.data() + static_cast<size_t>(phase) * taps_;
+
+		for (unsigned tap=0; tap<taps_; ++tap)
+			difference[tap] = row[taps_ + tap] - row[tap];
+	}
+
+	nominal_step_ = static_cast<uint64_t>(std::llround(ratio * kFixedOne));
+	step_ = nominal_step_;
+
+	// Process() 1񕪂̓ (̔̕܂) ƁȂÕ^bv܂΂悢
+	capacity_ = 2 * static_cast<size_t>(taps_) + static_cast<size_t>(std::ceil(max_output_frames * ratio * 1.01)) + kTapAlignment;
+	for (unsigned channel=0; channel<kMaxForwardChannels; ++channel)
+		buffers_[channel].assign((channel < channels_)? capacity_: 0, 0.0f);
+
+	switch (level)
+	{
+#if MSS_X86
+	case SimdLevel::kAvx512:
+	case SimdLevel::kAvx2:
+		resample_frame_ = ResampleFrameAvx2;
+		kernel_level_ = SimdLevel::kAvx2;
+		break;
+
+	case SimdLevel::kSse2:
+		resample_frame_ = ResampleFrameSse2;
+		kernel_level_ = SimdLevel::kSse2;
+		break;
+#endif
+
+	default:
+		resample_frame_ = ResampleFrameScalar;
+		kernel_level_ = SimdLevel::kScalar;
+		break;
+	}
+
+	Clear();
+
+	return true;
+}
+
+void Resampler::Clear()
+{
+	for (unsigned channel=0; channel<channels_; ++channel)
+		std::fill(buffers_[channel].begin(), buffers_[channel].end(), 0.0f);
+
+	// ŏ̏o͂̎͂̐擪ɗ悤ȂÕ^bv̕𖳉Ŗ߂Ă
+	write_ = taps_ / 2 - 1;
+	position_ = 0;
+}
+
+void Resampler::SetTrim(double ppm)
+{
+	step_ = static_cast<uint64_t>(std::llround(nominal_step_ * (1.0 + ppm * 1.0e-6)));
+}
+
+size_t Resampler::RequiredInputFrames(size_t output_frames) const
+{
+	if (!output_frames)
+		return 0;
+
+	const uint64_t last = position_ + (output_frames - 1) * step_;
+	const size_t end = static_cast<size_t>(last >> 32) + taps_;
+
+	return (end > write_)? end - write_: 0;
+}
+
+void Resampler::InputPlanes(float *planes[kMaxForwardChannels])
+{
+	Compact();
+
+	for (unsigned channel=0; channel<kMaxForwardChannels; ++channel)
+		planes[channel] = (channel < channels_)? buffers_[channel].data() + write_: nullptr;
+}
+
+size_t Resampler::InputCapacity() const
+{
+	return capacity_ - write_;
+}
+
+void Resampler::CommitInput(size_t frames)
+{
+	write_ += frames;
+}
+
+size_t Resampler::AvailableOutputFrames(size_t frames) const
+{
+	if (write_ < taps_)
+		return 0;
+
+	// ŏ̃^bv̈ʒu̐ write_ - taps_ ȉȂ
+	const uint64_t limit = static_cast<uint64_t>(write_ - taps_ + 1) << 32;
+	if (position_ >= limit)
+		return 0;
+
+	return static_cast<size_t>(std::min<uint64_t>((limit - position_ - 1) / step_ + 1, frames));
+}
+
+void Resampler::Process(float *const *dst, size_t frames, const float *gain)
+{
+	const float *planes[kMaxForwardChannels];
+	float values[kMaxForwardChannels];
+
+	for (unsigned channel=0; channel<channels_; ++channel)
+		planes[channel] = buffers_[channel].data();
+
+	for (size_t frame=0; frame<frames; ++frame)
+	{
+		const size_t start = static_cast<size_t>(position_ >> 32);
+		const uint64_t phase_position = (position_ & 0xffffffffu) * phases_;
+		const size_t phase = static_cast<size_t>(phase_position >> 32);
+		const float fraction = static_cast<float>((phase_position & 0xffffffffu) / kFixedOne);
+
+		resample_frame_(values, planes, start, channels_, coefficients_.data() + phase * taps_, differences_.data() + phase * taps_, fraction, taps_);
+
+		const float g = gain? gain[frame]: 1.0f;
+
+		for (unsigned channel=0; channel<channels_; ++channel)
+		{
+			if (dst[channel])
+				dst[channel][frame] = values[channel] * g;
+		}
+
+		position_ += step_;
+	}
+}
+
+double Resampler::BufferedFrames() const
+{
+	const double now = position_ / kFixedOne + (taps_ / 2 - 1);
+
+	return std::max(0.0, write_ - now);
+}
+
+unsigned Resampler::Taps() const
+{
+	return taps_;
+}
+
+SimdLevel Resampler::KernelLevel() const
+{
+	return kernel_level_;
+}
+
+// gI͂̂āAobt@̐擪ɋl߂
+void Resampler::Compact()
+{
+	const size_t start = static_cast<size_t>(position_ >> 32);
+	if (!start)
+		return;
+
+	const size_t keep = (write_ > start)? write_ - start: 0;
+
+	for (unsigned channel=0; channel<channels_; ++channel)
+		memmove(buffers_[channel].data(), buffers_[channel].data() + start, keep * sizeof (float));
+
+	write_ = keep;
+	position_ -= static_cast<uint64_t>(start) << 32;
+}
+
+// 1ό`xbZ֐ I0 (WJ)
+static double BesselI0(double x)
+{
+	const double quarter_square = x * x / 4.0;
+	double term = 1.0;
+	double sum = 1.0;
+
+	for (int k=1; k<64; ++k)
+	{
+		term *= quarter_square / (static_cast<double>(k) * k);
+		sum += term;
+		if (term < sum * 1.0e-17)
+			break;
+	}
+
+	return sum;
+}
+
+static void ResampleFrameScalar(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const float *x = planes[channel] + start;
+		float base = 0.0f;
+		float slope = 0.0f;
+
+		for (size_t tap=0; tap<taps; ++tap)
+		{
+			base += coefficients[tap] * x[tap];
+			slope += differences[tap] * x[tap];
+		}
+
+		out[channel] = base + fraction * slope;
+	}
+}
+
+#if MSS_X86
+MSS_TARGET("sse2")
+static inline float HorizontalSumSse2(__m128 v)
+{
+	const __m128 high = _mm_movehl_ps(v, v);
+	const __m128 pair = _mm_add_ps(v, high);
+
+	return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+}
+
+// taps  kTapAlignment ̔{
+MSS_TARGET("sse2")
+static void ResampleFrameSse2(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const float *x = planes[channel] + start;
+		__m128 base0 = _mm_setzero_ps();
+		__m128 base1 = _mm_setzero_ps();
+		__m128 slope0 = _mm_setzero_ps();
+		__m128 slope1 = _mm_setzero_ps();
+
+		for (size_t tap=0; tap<taps; tap += 8)
+		{
+			const __m128 x0 = _mm_loadu_ps(x + tap);
+			const __m128 x1 = _mm_loadu_ps(x + tap + 4);
+
+			base0 = _mm_add_ps(base0, _mm_mul_ps(_mm_loadu_ps(coefficients + tap), x0));
+			base1 = _mm_add_ps(base1, _mm_mul_ps(_mm_loadu_ps(coefficients + tap + 4), x1));
+			slope0 = _mm_add_ps(slope0, _mm_mul_ps(_mm_loadu_ps(differences + tap), x0));
+			slope1 = _mm_add_ps(slope1, _mm_mul_ps(_mm_loadu_ps(differences + tap + 4), x1));
+		}
+
+		const __m128 sum = _mm_add_ps(_mm_add_ps(base0, base1), _mm_mul_ps(_mm_set1_ps(fraction), _mm_add_ps(slope0, slope1)));
+		out[channel] = HorizontalSumSse2(sum);
+	}
+}
+
+MSS_TARGET("avx2")
+static void ResampleFrameAvx2(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps)
+{
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const float *x = planes[channel] + start;
+		__m256 base = _mm256_setzero_ps();
+		__m256 slope = _mm256_setzero_ps();
+
+		for (size_t tap=0; tap<taps; tap += 8)
+		{
+			const __m256 value = _mm256_loadu_ps(x + tap);
+
+			base = _mm256_add_ps(base, _mm256_mul_ps(_mm256_loadu_ps(coefficients + tap), value));
+			slope = _mm256_add_ps(slope, _mm256_mul_ps(_mm256_loadu_ps(differences + tap), value));
+		}
+
+		const __m256 sum = _mm256_add_ps(base, _mm256_mul_ps(_mm256_set1_ps(fraction), slope));
+		out[channel] = HorizontalSumSse2(_mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
+	}
+}
+#endif
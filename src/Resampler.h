@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ForwardKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// iƒx̑gBl͐ݒ mss-resampler ƑΉA0 ͓̕ϊgȂ (VLC ɔC)B
+enum class ResamplerQuality
+{
+	kOff,
+	kLowLatency,	// 16 ^bv
+	kBalanced,		// 32 ^bv
+	kHigh			// 64 ^bv
+};
+
+// 1o̓t[̃tB^Bplanes[channel]  taps ǂ݁A
+// (coefficients + fraction * differences) Ƃ̓ς out[channel] ɏB
+typedef void (*ResampleFrameFunction)(float *out, const float *const *planes, size_t start, unsigned channels, const float *coefficients, const float *differences, float fraction, size_t taps);
+
+//  FIR ɂTvO[gϊBW Kaiser  sinc ŁA׍ʑ̊Ԃ͐`ɕԂB
+// ͂̓`l̗obt@ɁA]֐ (DeinterleaveFunction) ŒڏށB
+// ւƐ̕ϊ͓]֐A{ Process() ŝŁAʂ̃tB^ޏꍇǂݏ1񂸂ȂB
+//  ppm PʂŔłAfoCX̎v̂ẑɎgB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class Resampler
+{
+public:
+	Resampler();
+
+	// 䂪 1/4  4 ͈̔͂ɂ邩
+	static bool SupportsRates(unsigned input_rate, unsigned output_rate);
+
+	// max_output_frames 1 Process() ōő̃t[Bobt@͂ŊmۂAȌ͊mۂȂB
+	// SupportsRates() 𖞂Ȃ false ԂB
+	bool Reset(unsigned input_rate, unsigned output_rate, unsigned channels, ResamplerQuality quality, SimdLevel level, size_t max_output_frames);
+
+	// 𖳉ɂAʑ߂ (tbVp)
+	void Clear();
+
+	// ͂̏ ppm ߂ () ܂͒x ()BI[fBIXbh͒x̐؋l (Latency Target) ɎgB
+	void SetTrim(double ppm);
+
+	// output_frames t[̂ɁAƉt[̓͂v邩
+	size_t RequiredInputFrames(size_t output_frames) const;
+
+	// ͂̏ݐBplanes[channel]  InputCapacity() t[܂ŏACommitInput() Ŋm肷B
+	void InputPlanes(float *planes[kMaxForwardChannels]);
+	size_t InputCapacity() const;
+	void CommitInput(size_t frames);
+
+	// ܂͂Aő frames t[̂t[
+	size_t AvailableOutputFrames(size_t frames) const;
+
+	// frames (AvailableOutputFrames() ȉ) t[Adst[channel] ɏBdst[channel]  nullptr ̃`lɂ͏ȂB
+	// gain  nullptr łȂ΁At[̔{ gain[frame] |B
+	void Process(float *const *dst, size_t frames, const float *gain);
+
+	// ͂̂A܂o͂̎ɒBĂȂt[BTimeGet() ̃fBCɊ܂߂B
+	double BufferedFrames() const;
+
+	unsigned Taps() const;
+
+	// ϊɎۂɎg֐̖߃ZbgBAVX-512 ɂ͐p̊֐Ȃ̂ŁAReset()  kAvx512 nĂ kAvx2 ɂȂB
+	SimdLevel KernelLevel() const;
+
+private:
+	void Compact();
+
+	ResampleFrameFunction resample_frame_;
+	SimdLevel kernel_level_;
+	unsigned channels_;
+	unsigned taps_;
+	unsigned phases_;
+
+	// ʑ̌WƁÄʑƂ̍B(phases_ + 1) * taps_ B
+	std::vector<float> coefficients_;
+	std::vector<float> differences_;
+
+	// ͈ʒu 32.32 ̌Œ菬_Bposition_ ͎̐Ɏgŏ̃^bṽobt@̈ʒuB
+	uint64_t step_;
+	uint64_t nominal_step_;
+	uint64_t position_;
+
+	// `l̗obt@B[0, write_) ɓ͂Acapacity_ t[܂ŏB
+	std::vector<float> buffers_[kMaxForwardChannels];
+	size_t capacity_;
+	size_t write_;
+};
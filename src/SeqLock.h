@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// ݑ1Xbĥ݂ seqlockB
+// ݑ͑҂ꂸAǏo͏݂ƏdȂꍇ̂ݓǂݒB
+// l̓[hPʂ atomic ɕĕێ̂ŁAǂݏdȂĂf[^ɂ͂ȂȂB
+template <typename T>
+class SeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+	SeqLock()
+		: sequence_(0)
+	{
+		for (auto& word: words_)
+			word.store(0, std::memory_order_relaxed);
+	}
+
+	SeqLock(const SeqLock&) = delete;
+	SeqLock& operator=(const SeqLock&) = delete;
+
+	void Store(const T& value)
+	{
+		uint64_t words[kWords] {};
+		std::memcpy(words, &value, sizeof (T));
+
+		const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+		sequence_.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i=0; i<kWords; ++i)
+			words_[i].store(words[i], std::memory_order_relaxed);
+
+		sequence_.store(sequence + 2, std::memory_order_release);
+	}
+
+	T Load() const
+	{
+		uint64_t words[kWords];
+		uint32_t before;
+		uint32_t after;
+
+		do
+		{
+			before = sequence_.load(std::memory_order_acquire);
+
+			for (size_t i=0; i<kWords; ++i)
+				words[i] = words_[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence_.load(std::memory_order_relaxed);
+		}
+		while ((before & 1) || (before != after));
+
+		T value;
+		std::memcpy(&value, words, sizeof (T));
+
+		return value;
+	}
+
+private:
+	static constexpr size_t kWords = (sizeof (T) + sizeof (uint64_t) - 1) / sizeof (uint64_t);
+
+	std::atomic<uint32_t> sequence_;
+	std::atomic<uint64_t> words_[kWords];
+};
@@ -0,0 +1,357 @@
+#include "SimulatedBackend.h"
+#include "VirtualAudioDevice.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// zvԂ speed {Ői߂Bspeed  0 ȂA`݂̏I莟A̎ʒmB
+// GetPosition()  qpc_position  IAudioClock Ɠ 100ns PʂŕԂB
+class SimulatedBackend : public RenderBackend
+{
+public:
+	SimulatedBackend(const aout_sys_t *sys, HANDLE stream_event, FILE *capture);
+	~SimulatedBackend() override;
+
+	HANDLE StreamEvent() const override;
+	UINT64 DeviceFrequency() const override;
+	UINT32 MaxFrameCount() const override;
+
+	HRESULT Start() override;
+	HRESULT Stop() override;
+	HRESULT Reset() override;
+	HRESULT ActivateObjects() override;
+	HRESULT SilencePending() override;
+
+	HRESULT BeginUpdating(UINT32 *frames) override;
+	float *GetBuffer(unsigned channel) override;
+	HRESULT EndUpdating() override;
+
+	HRESULT GetPosition(UINT64 *device_position, UINT64 *qpc_position) override;
+	HRESULT SetVolume(float volume) override;
+
+private:
+	void PacingThread();
+	bool WaitUntil(std::unique_lock<std::mutex>& lock, double time);
+	LONGLONG VirtualTimeToQpc(double time) const;
+	double VirtualTimeNow() const;
+
+	const double speed_;
+	const UINT64 device_frequency_;
+	LARGE_INTEGER qpc_frequency_;
+	HANDLE stream_event_;
+	FILE *capture_;
+
+	// device_ ƈȉ̏Ԃ mutex_ ŎBԂς pacing_changed_ Ŏ̑NB
+	std::mutex mutex_;
+	std::condition_variable pacing_changed_;
+	VirtualAudioDevice device_;
+	bool quit_;
+
+	// z anchor_time_  QPC  anchor_qpc_ ɑΉBStart() ̓xɎ蒼B
+	// ~͉zv stop_time_ Ŏ~߂ĂAĊJ炻i߂B
+	// speed_  0 ̏ꍇ́Ai߂ QPC  position_qpc_ ɎcB
+	double anchor_time_;
+	double stop_time_;
+	LONGLONG anchor_qpc_;
+	LONGLONG position_qpc_;
+
+	std::thread pacing_thread_;
+};
+
+static VirtualAudioDeviceParameters MakeDeviceParameters(const aout_sys_t *sys);
+static LONGLONG QpcNow();
+
+
+std::unique_ptr<RenderBackend> CreateSimulatedBackend(const aout_sys_t *sys)
+{
+	FILE *capture = nullptr;
+	if (!sys->simulation_.capture_path.empty())
+	{
+		capture = fopen(sys->simulation_.capture_path.c_str(), "wb");
+		if (!capture)
+			return nullptr;
+	}
+
+	HANDLE stream_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (!stream_event)
+	{
+		if (capture)
+			fclose(capture);
+
+		return nullptr;
+	}
+
+	return std::make_unique<SimulatedBackend>(sys, stream_event, capture);
+}
+
+SimulatedBackend::SimulatedBackend(const aout_sys_t *sys, HANDLE stream_event, FILE *capture)
+	: speed_(sys->simulation_.speed),
+	device_frequency_(sys->output_format_.nSamplesPerSec),
+	stream_event_(stream_event),
+	capture_(capture),
+	device_(MakeDeviceParameters(sys)),
+	quit_(false),
+	anchor_time_(0.0),
+	stop_time_(0.0),
+	anchor_qpc_(0),
+	position_qpc_(0)
+{
+	QueryPerformanceFrequency(&qpc_frequency_);
+	device_.SetCapture(capture_);
+	position_qpc_ = QpcNow();
+
+	if (speed_ > 0.0)
+		pacing_thread_ = std::thread(&SimulatedBackend::PacingThread, this);
+}
+
+SimulatedBackend::~SimulatedBackend()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+
+	pacing_changed_.notify_all();
+	if (pacing_thread_.joinable())
+		pacing_thread_.join();
+
+	if (capture_)
+		fclose(capture_);
+
+	CloseHandle(stream_event_);
+}
+
+HANDLE SimulatedBackend::StreamEvent() const
+{
+	return stream_event_;
+}
+
+UINT64 SimulatedBackend::DeviceFrequency() const
+{
+	return device_frequency_;
+}
+
+UINT32 SimulatedBackend::MaxFrameCount() const
+{
+	return device_.MaxPeriodFrames();
+}
+
+HRESULT SimulatedBackend::Start()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (device_.Running())
+			return S_OK;
+
+		device_.Start(stop_time_);
+		anchor_time_ = stop_time_;
+		anchor_qpc_ = QpcNow();
+
+		// ~߂Oɒʒm܂܂ĂȂ΁A߂Ēʒm
+		if (0.0 == speed_)
+		{
+			if (!device_.PeriodWritable())
+				device_.AdvancePeriod();
+
+			position_qpc_ = QpcNow();
+			SetEvent(stream_event_);
+		}
+		else if (device_.PeriodWritable())
+		{
+			SetEvent(stream_event_);
+		}
+	}
+
+	pacing_changed_.notify_all();
+
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (device_.Running())
+		{
+			stop_time_ = VirtualTimeNow();
+			device_.Stop(stop_time_);
+		}
+
+		// ʒmς݂̎́A~߂foCXł͏߂ȂBĊJƂɉ߂ĒʒmB
+		ResetEvent(stream_event_);
+	}
+
+	pacing_changed_.notify_all();
+
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	device_.Reset();
+
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::ActivateObjects()
+{
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::SilencePending()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	device_.SilencePending();
+
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::BeginUpdating(UINT32 *frames)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (!device_.Running())
+		return E_FAIL;
+
+	*frames = device_.PeriodFrames();
+
+	return S_OK;
+}
+
+// ݐ͎̑ƋLȂ̂ŁAbN͗vȂ
+float *SimulatedBackend::GetBuffer(unsigned channel)
+{
+	return device_.Buffer(channel);
+}
+
+HRESULT SimulatedBackend::EndUpdating()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	device_.CommitPeriod();
+
+	if ((0.0 == speed_) && device_.Running())
+	{
+		device_.AdvancePeriod();
+		position_qpc_ = QpcNow();
+		SetEvent(stream_event_);
+	}
+	else
+	{
+		// ĊJ̒ʒmɏ񂾏ꍇ (tbVł̃Zbg) ɁA2xNȂ悤ʒm
+		ResetEvent(stream_event_);
+	}
+
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::GetPosition(UINT64 *device_position, UINT64 *qpc_position)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	const LONGLONG qpc = (0.0 == speed_)? position_qpc_: VirtualTimeToQpc(device_.PositionTime());
+	const LONGLONG frequency = qpc_frequency_.QuadPart;
+
+	*device_position = device_.Position();
+	*qpc_position = (qpc / frequency) * 10000000 + ((qpc % frequency) * 10000000) / frequency;
+
+	return S_OK;
+}
+
+HRESULT SimulatedBackend::SetVolume(float volume)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	device_.SetGain(volume);
+
+	return S_OK;
+}
+
+// ̎n߂܂ő҂Ă牼zvi߁Ah炬̕ɑ҂Ăʒm
+void SimulatedBackend::PacingThread()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	while (!quit_)
+	{
+		if (!device_.Running())
+		{
+			pacing_changed_.wait(lock);
+			continue;
+		}
+
+		if (!WaitUntil(lock, device_.NextPeriodTime()))
+			continue;
+
+		const double wake_time = device_.AdvancePeriod();
+
+		if (!WaitUntil(lock, wake_time))
+			continue;
+
+		SetEvent(stream_event_);
+	}
+}
+
+// z time ܂ő҂BrŒ~EĊJEIꍇ false ԂB
+bool SimulatedBackend::WaitUntil(std::unique_lock<std::mutex>& lock, double time)
+{
+	const LONGLONG anchor_qpc = anchor_qpc_;
+	const LONGLONG target = VirtualTimeToQpc(time);
+
+	while (true)
+	{
+		if (quit_ || !device_.Running() || (anchor_qpc != anchor_qpc_))
+			return false;
+
+		const LONGLONG now = QpcNow();
+		if (now >= target)
+			return true;
+
+		pacing_changed_.wait_for(lock, std::chrono::microseconds((target - now) * 1000 * 1000 / qpc_frequency_.QuadPart + 1));
+	}
+}
+
+LONGLONG SimulatedBackend::VirtualTimeToQpc(double time) const
+{
+	return anchor_qpc_ + static_cast<LONGLONG>((time - anchor_time_) / speed_ * qpc_frequency_.QuadPart);
+}
+
+// speed_  0 Ȃ牼zv͎̎n߂ɂȂ̂ŁA߂̎̎n߂Ƃ
+double SimulatedBackend::VirtualTimeNow() const
+{
+	if (0.0 == speed_)
+		return device_.PositionTime();
+
+	return anchor_time_ + static_cast<double>(QpcNow() - anchor_qpc_) / qpc_frequency_.QuadPart * speed_;
+}
+
+static VirtualAudioDeviceParameters MakeDeviceParameters(const aout_sys_t *sys)
+{
+	VirtualAudioDeviceParameters parameters;
+
+	parameters.rate = sys->output_format_.nSamplesPerSec;
+	parameters.channels = sys->output_channels_;
+	parameters.period_frames = sys->simulation_.period_frames;
+	parameters.period_variation = sys->simulation_.period_variation;
+	parameters.jitter = sys->simulation_.jitter;
+	parameters.drift_ppm = sys->simulation_.drift_ppm;
+	parameters.seed = 1;
+
+	return parameters;
+}
+
+static LONGLONG QpcNow()
+{
+	LARGE_INTEGER count;
+
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "aout_sys.h"
+
+#include <memory>
+
+// VirtualAudioDevice ɂ͋[o͐Bݒ sys->simulation_ ɏ]B
+// sꍇ nullptr ԂB
+std::unique_ptr<RenderBackend> CreateSimulatedBackend(const aout_sys_t *sys);
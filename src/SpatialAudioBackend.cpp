@@ -0,0 +1,238 @@
+#include "SpatialAudioBackend.h"
+
+#include <array>
+
+#include <wil/com.h>
+
+class SpatialAudioBackend : public RenderBackend
+{
+public:
+	SpatialAudioBackend(const aout_sys_t *sys);
+
+	HANDLE StreamEvent() const override;
+	UINT64 DeviceFrequency() const override;
+	UINT32 MaxFrameCount() const override;
+
+	HRESULT Start() override;
+	HRESULT Stop() override;
+	HRESULT Reset() override;
+	HRESULT ActivateObjects() override;
+	HRESULT SilencePending() override;
+
+	HRESULT BeginUpdating(UINT32 *frames) override;
+	float *GetBuffer(unsigned channel) override;
+	HRESULT EndUpdating() override;
+
+	HRESULT GetPosition(UINT64 *device_position, UINT64 *qpc_position) override;
+	HRESULT SetVolume(float volume) override;
+
+private:
+	void ReleaseObjects();
+	HRESULT SetChannelVolumes(float volume);
+
+	uint32_t objects_;
+	wil::com_ptr<IMMDevice> device_;
+	wil::com_ptr<ISpatialAudioClient> spatioal_audio_client_;
+	wil::com_ptr<ISpatialAudioObjectRenderStream> spatial_render_stream_;
+	std::array<wil::com_ptr<ISpatialAudioObject>, kObjectChannels> spacial_audio_objects_;
+	wil::unique_handle stream_event_;
+	wil::com_ptr<IAudioClock> audio_clock_;
+	wil::com_ptr<IAudioStreamVolume> audio_stream_volume_;
+	UINT64 device_frequency_;
+	UINT32 max_frames_;
+
+	// SilencePending() ŖɂĂԂ SetVolume() ꂽʂ́Avolume_ ɎcĖ߂ƂɊ|
+	float volume_;
+	bool silenced_;
+};
+
+
+std::unique_ptr<RenderBackend> CreateSpatialAudioBackend(const aout_sys_t *sys)
+{
+	try
+	{
+		return std::make_unique<SpatialAudioBackend>(sys);
+	}
+	catch (wil::ResultException& e)
+	{
+		return nullptr;
+	}
+}
+
+SpatialAudioBackend::SpatialAudioBackend(const aout_sys_t *sys)
+	: objects_(sys->output_objects_),
+	volume_(1.0f),
+	silenced_(false)
+{
+	wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
+	PROPVARIANT stream_property;
+	SpatialAudioObjectRenderStreamActivationParams stream_parameter {};
+
+	device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>(CLSCTX_INPROC_SERVER);
+	THROW_IF_FAILED(device_enumerator->GetDevice(sys->device_id_.c_str(), &device_));
+	THROW_IF_FAILED(device_->Activate(__uuidof(ISpatialAudioClient), CLSCTX_INPROC_SERVER, nullptr, spatioal_audio_client_.put_void()));
+
+	stream_event_.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+	THROW_IF_NULL_ALLOC(stream_event_.get());
+
+	stream_parameter.ObjectFormat = &sys->output_format_;
+	// gIuWFNgvBObjectChannel  AudioObjectType ̃rbgʒu1炵́B
+	stream_parameter.StaticObjectTypeMask = static_cast<AudioObjectType>(objects_ << 1);
+	stream_parameter.MinDynamicObjectCount = 0;
+	stream_parameter.MaxDynamicObjectCount = 0;
+	stream_parameter.Category = AudioCategory_Movie;
+	stream_parameter.EventHandle = stream_event_.get();
+	stream_parameter.NotifyObject = nullptr;
+
+	PropVariantInit(&stream_property);
+	stream_property.vt = VT_BLOB;
+	stream_property.blob.cbSize = sizeof (stream_parameter);
+	stream_property.blob.pBlobData = reinterpret_cast<BYTE *>(&stream_parameter);
+
+	THROW_IF_FAILED(spatioal_audio_client_->ActivateSpatialAudioStream(&stream_property, IID_PPV_ARGS(&spatial_render_stream_)));
+	THROW_IF_FAILED(spatioal_audio_client_->GetMaxFrameCount(&sys->output_format_, &max_frames_));
+
+	THROW_IF_FAILED(spatial_render_stream_->GetService(IID_PPV_ARGS(&audio_clock_)));
+	THROW_IF_FAILED(audio_clock_->GetFrequency(&device_frequency_));
+	THROW_IF_FAILED(spatial_render_stream_->GetService(IID_PPV_ARGS(&audio_stream_volume_)));
+	THROW_IF_FAILED(ActivateObjects());
+}
+
+HANDLE SpatialAudioBackend::StreamEvent() const
+{
+	return stream_event_.get();
+}
+
+UINT64 SpatialAudioBackend::DeviceFrequency() const
+{
+	return device_frequency_;
+}
+
+UINT32 SpatialAudioBackend::MaxFrameCount() const
+{
+	return max_frames_;
+}
+
+HRESULT SpatialAudioBackend::Start()
+{
+	return spatial_render_stream_->Start();
+}
+
+HRESULT SpatialAudioBackend::Stop()
+{
+	return spatial_render_stream_->Stop();
+}
+
+HRESULT SpatialAudioBackend::Reset()
+{
+	HRESULT com_result = spatial_render_stream_->Reset();
+
+	// ResetSpatialAudioObjectANeBuɂȂ邽߁AێĂ͎̂
+	ReleaseObjects();
+
+	return com_result;
+}
+
+HRESULT SpatialAudioBackend::ActivateObjects()
+{
+	std::array<wil::com_ptr<ISpatialAudioObject>, kObjectChannels> temp_spacial_audio_objects;
+	unsigned objects = 0;
+
+	// AudioObjectType̒lŏׂ̏ɂƁAchannel_reorder_table_  mix_matrix_ ̏o͂̏ spacial_audio_objects_ ̐Ƃ悤ɂĂB
+	for (unsigned object=0; object<kObjectChannels; ++object)
+	{
+		if (!(objects_ & ObjectBit(static_cast<ObjectChannel>(object))))
+			continue;
+
+		const AudioObjectType type = static_cast<AudioObjectType>(ObjectBit(static_cast<ObjectChannel>(object)) << 1);
+		RETURN_IF_FAILED(spatial_render_stream_->ActivateSpatialAudioObject(type, temp_spacial_audio_objects[objects++].put()));
+	}
+
+	for (unsigned i=0; i<objects; ++i)
+		spacial_audio_objects_[i] = temp_spacial_audio_objects[i];
+
+	return S_OK;
+}
+
+// Xg[̉ʂ̓GWƂɊ|̂ŁAnς݂ł܂ĂȂɂB
+// ̎n΁AO͍̎ς݂Ȃ̂ŁAEndUpdating() Ō̉ʂɖ߂B
+HRESULT SpatialAudioBackend::SilencePending()
+{
+	silenced_ = true;
+
+	return SetChannelVolumes(0.0f);
+}
+
+void SpatialAudioBackend::ReleaseObjects()
+{
+	for (auto& audio_obj: spacial_audio_objects_)
+	{
+		if (audio_obj.get())
+			audio_obj.reset();
+	}
+}
+
+HRESULT SpatialAudioBackend::BeginUpdating(UINT32 *frames)
+{
+	UINT32 dynamic_objects;
+
+	return spatial_render_stream_->BeginUpdatingAudioObjects(&dynamic_objects, frames);
+}
+
+float *SpatialAudioBackend::GetBuffer(unsigned channel)
+{
+	BYTE *buffer = nullptr;
+	UINT32 buffer_length = 0;
+
+	if (!spacial_audio_objects_[channel] || FAILED(spacial_audio_objects_[channel]->GetBuffer(&buffer, &buffer_length)))
+		return nullptr;
+
+	return reinterpret_cast<float *>(buffer);
+}
+
+HRESULT SpatialAudioBackend::EndUpdating()
+{
+	const HRESULT com_result = spatial_render_stream_->EndUpdatingAudioObjects();
+
+	if (silenced_)
+	{
+		silenced_ = false;
+		SetChannelVolumes(volume_);
+	}
+
+	return com_result;
+}
+
+HRESULT SpatialAudioBackend::GetPosition(UINT64 *device_position, UINT64 *qpc_position)
+{
+	return audio_clock_->GetPosition(device_position, qpc_position);
+}
+
+HRESULT SpatialAudioBackend::SetVolume(float volume)
+{
+	volume_ = volume;
+	if (silenced_)
+		return S_OK;
+
+	return SetChannelVolumes(volume);
+}
+
+HRESULT SpatialAudioBackend::SetChannelVolumes(float volume)
+{
+	HRESULT com_result;
+	UINT32 channels;
+
+	com_result = audio_stream_volume_->GetChannelCount(&channels);
+
+	if (SUCCEEDED(com_result))
+	{
+		for (UINT32 i=0; i<channels; ++i)
+		{
+			com_result = audio_stream_volume_->SetChannelVolume(i, volume);
+			if (FAILED(com_result))
+				break;
+		}
+	}
+
+	return com_result;
+}
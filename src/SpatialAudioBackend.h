@@ -0,0 +1,13 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "aout_sys.h"
+
+#include <mmdeviceapi.h>
+#include <spatialaudioclient.h>
+
+#include <memory>
+
+// ISpatialAudioObjectRenderStream ɂo͐B
+// COM ͌ďõXbhŏĂƁBsꍇ nullptr ԂB
+std::unique_ptr<RenderBackend> CreateSpatialAudioBackend(const aout_sys_t *sys);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// PꐶYҁEP҂̌Œ蒷Oobt@B
+// Push ͐Y҃Xbĥ݁AFront / Pop ͏҃Xbĥ݂ĂԂƁB
+// ̑bN炸AXebvŊB
+template <typename T>
+class SpscQueue
+{
+public:
+	static constexpr size_t kCacheLineSize = 64;
+
+	explicit SpscQueue(size_t capacity)
+		: head_(0), cached_tail_(0), tail_(0), cached_head_(0)
+	{
+		// CfbNX}XNŐ܂Ԃ悤A2ׂ̂ɐ؂グ
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+
+		buffer_.reset(new T[size]);
+		mask_ = size - 1;
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// YґBtȂ false ԂAȂB
+	bool Push(const T& value)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+
+		if (tail - cached_head_ > mask_)
+		{
+			cached_head_ = head_.load(std::memory_order_acquire);
+			if (tail - cached_head_ > mask_)
+				return false;
+		}
+
+		buffer_[tail & mask_] = value;
+		tail_.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// ґBȂ nullptr ԂB
+	// Ԃvf Pop ܂ŏ҂Ă悢B
+	T *Front()
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+
+		if (head == cached_tail_)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if (head == cached_tail_)
+				return nullptr;
+		}
+
+		return &buffer_[head & mask_];
+	}
+
+	// ґBFront  nullptr ȊOԂɂ̂݌ĂԂƁB
+	void Pop()
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+
+		head_.store(head + 1, std::memory_order_release);
+	}
+
+	bool Empty() const
+	{
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+	// ̃XbhĂ񂾏ꍇ͊TZlƂȂ
+	size_t Size() const
+	{
+		const size_t head = head_.load(std::memory_order_acquire);
+		const size_t tail = tail_.load(std::memory_order_acquire);
+
+		return tail - head;
+	}
+
+	size_t Capacity() const
+	{
+		return mask_ + 1;
+	}
+
+private:
+	// ҂̈
+	alignas(kCacheLineSize) std::atomic<size_t> head_;
+	size_t cached_tail_;
+
+	// Y҂̈
+	alignas(kCacheLineSize) std::atomic<size_t> tail_;
+	size_t cached_head_;
+
+	// ҂ǂނ̗̈
+	alignas(kCacheLineSize) std::unique_ptr<T[]> buffer_;
+	size_t mask_;
+};
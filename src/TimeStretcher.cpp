@@ -0,0 +1,322 @@
+#include "TimeStretcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Ԃ̊Ԋu (~b)Bd˂鑋̒͂2{ɂȂB
+static constexpr unsigned kHopMilliseconds = 10;
+
+// ڂ̈ʒuOɒT͈ (~b)BႢ1 (80Hz  12.5ms) ̔قǂ΂悢B
+static constexpr unsigned kSearchMilliseconds = 7;
+
+// eTł́Aʒuς̊ԊuŊԈBŗǂ̈ʒȗOゾ1t[PʂŒTB
+static constexpr size_t kCoarseStep = 4;
+
+static constexpr double kPi = 3.14159265358979323846;
+
+static void CopyFrames(float *dst, const float *src, size_t frames, const float *gain);
+static double Similarity(const float *target, const float *candidate, size_t frames, size_t step);
+
+
+TimeStretcher::TimeStretcher()
+	: channels_(0),
+	hop_(0),
+	search_(0),
+	tempo_(1.0),
+	tail_(0),
+	nominal_(0.0),
+	output_read_(0),
+	trimmed_(0),
+	capacity_(0),
+	write_(0)
+{
+}
+
+bool TimeStretcher::Reset(unsigned rate, unsigned channels, size_t max_output_frames)
+{
+	if (!rate || (channels > kMaxForwardChannels))
+		return false;
+
+	channels_ = channels;
+	hop_ = std::max<size_t>(kCoarseStep * 4, rate * kHopMilliseconds / 1000);
+	search_ = std::max<size_t>(kCoarseStep, rate * kSearchMilliseconds / 1000);
+
+	rise_.resize(hop_);
+	for (size_t n=0; n<hop_; ++n)
+		rise_[n] = static_cast<float>(0.5 - 0.5 * std::cos(kPi * n / hop_));
+
+	target_.assign(hop_, 0.0f);
+	candidates_.assign(2 * search_ + 1 + hop_, 0.0f);
+
+	// Process() 1񕪂̓͂ő̑ŏ镪ƁAT͈̔͂ƁAd˂2Ԃ܂΂悢
+	capacity_ = static_cast<size_t>(std::ceil((max_output_frames + hop_) * kMaximumTempo)) + 4 * hop_ + 4 * search_;
+	for (unsigned channel=0; channel<kMaxForwardChannels; ++channel)
+	{
+		buffers_[channel].assign((channel < channels_)? capacity_: 0, 0.0f);
+		output_[channel].assign((channel < channels_)? hop_: 0, 0.0f);
+	}
+
+	trimmed_ = 0;
+	Clear();
+
+	return true;
+}
+
+void TimeStretcher::Clear()
+{
+	tempo_ = 1.0;
+	write_ = 0;
+	tail_ = 0;
+	nominal_ = -static_cast<double>(hop_);
+	output_read_ = hop_;
+}
+
+void TimeStretcher::SetTempo(double tempo)
+{
+	tempo_ = std::clamp(tempo, kMinimumTempo, kMaximumTempo);
+}
+
+double TimeStretcher::Tempo() const
+{
+	return tempo_;
+}
+
+bool TimeStretcher::Idle() const
+{
+	return (1.0 == tempo_) && (tail_ == write_) && (output_read_ == hop_);
+}
+
+size_t TimeStretcher::RequiredInputFrames(size_t output_frames) const
+{
+	const size_t pending = hop_ - output_read_;
+	if (output_frames <= pending)
+		return 0;
+
+	const size_t remain = output_frames - pending;
+
+	// oԂ́AȂ̂܂ܑfʂ
+	if (1.0 == tempo_)
+		return (remain > write_ - tail_)? remain - (write_ - tail_): 0;
+
+	// MakeHop() ƓŌ̋Ԃɂċ߂Bڂ̈ʒu͑Zd˂ċ߂̂ŁAۂ߂̈Ⴂ̕1t[ĂB
+	const size_t hops = (remain + hop_ - 1) / hop_;
+	const double last = nominal_ + tempo_ * hop_ * hops;
+	const int64_t end = std::max<int64_t>(0, std::llround(last)) + static_cast<int64_t>(search_ + 2 * hop_ + 1);
+
+	return (end > static_cast<int64_t>(write_))? static_cast<size_t>(end) - write_: 0;
+}
+
+void TimeStretcher::InputPlanes(float *planes[kMaxForwardChannels])
+{
+	Compact();
+
+	for (unsigned channel=0; channel<kMaxForwardChannels; ++channel)
+		planes[channel] = (channel < channels_)? buffers_[channel].data() + write_: nullptr;
+}
+
+size_t TimeStretcher::InputCapacity() const
+{
+	return capacity_ - write_;
+}
+
+void TimeStretcher::CommitInput(size_t frames)
+{
+	write_ += frames;
+}
+
+size_t TimeStretcher::Process(float *const *dst, size_t frames, const float *gain)
+{
+	size_t done = 0;
+
+	while (done < frames)
+	{
+		// 肩̋Ԃ̎cɏo
+		if (output_read_ < hop_)
+		{
+			const size_t n = std::min(frames - done, hop_ - output_read_);
+
+			for (unsigned channel=0; channel<channels_; ++channel)
+			{
+				if (dst[channel])
+					CopyFrames(dst[channel] + done, output_[channel].data() + output_read_, n, gain? gain + done: nullptr);
+			}
+
+			output_read_ += n;
+			done += n;
+			continue;
+		}
+
+		if (1.0 != tempo_)
+		{
+			if (!MakeHop())
+				break;
+
+			continue;
+		}
+
+		// ŐԂ̌㔼A~̑|ɂ̂܂ܑB̋Ԃ𖼖ڂǂ̈ʒuɒuďd˂ꍇƓɂȂB
+		const size_t n = std::min(frames - done, write_ - tail_);
+		if (!n)
+			break;
+
+		for (unsigned channel=0; channel<channels_; ++channel)
+		{
+			if (dst[channel])
+				CopyFrames(dst[channel] + done, buffers_[channel].data() + tail_, n, gain? gain + done: nullptr);
+		}
+
+		tail_ += n;
+		nominal_ = static_cast<double>(tail_) - hop_;
+		done += n;
+	}
+
+	return done;
+}
+
+size_t TimeStretcher::BufferedFrames() const
+{
+	return (write_ - tail_) + (hop_ - output_read_);
+}
+
+int64_t TimeStretcher::TrimmedFrames() const
+{
+	return trimmed_;
+}
+
+// ̋ԂIсAŐԂ̌㔼Əd˂1ԕ̏o͂B͂Ȃ false ԂB
+bool TimeStretcher::MakeHop()
+{
+	const double nominal = nominal_ + tempo_ * hop_;
+	const int64_t center = std::max<int64_t>(0, std::llround(nominal));
+	const size_t lower = static_cast<size_t>(std::max<int64_t>(0, center - static_cast<int64_t>(search_)));
+	const size_t upper = static_cast<size_t>(center) + search_;
+
+	// I񂾋Ԃ̌㔼A̋ԂƏd˂Ƃ܂őĂKv
+	if ((upper + 2 * hop_ > write_) || (tail_ + hop_ > write_))
+		return false;
+
+	const size_t start = Search(lower, upper, static_cast<size_t>(center));
+	const float *rise = rise_.data();
+
+	for (unsigned channel=0; channel<channels_; ++channel)
+	{
+		const float *previous = buffers_[channel].data() + tail_;
+		const float *next = buffers_[channel].data() + start;
+		float *out = output_[channel].data();
+
+		for (size_t n=0; n<hop_; ++n)
+			out[n] = previous[n] + (next[n] - previous[n]) * rise[n];
+	}
+
+	// 1Ԃ hop_ t[o͂AŐԂ̌㔼̎n܂肩 start + hop_ ܂ł̓͂
+	trimmed_ += static_cast<int64_t>(start) - static_cast<int64_t>(tail_);
+
+	tail_ = start + hop_;
+	nominal_ = nominal;
+	output_read_ = 0;
+
+	return true;
+}
+
+// [lower, upper] ̂AŐԂ̌㔼ƍłĂԂ̎n܂ԂBĂxȂ preferred IԁB
+size_t TimeStretcher::Search(size_t lower, size_t upper, size_t preferred)
+{
+	float *target = target_.data();
+	float *candidates = candidates_.data();
+	const size_t length = upper - lower + hop_;
+
+	// ʑ̑̓`l̘aŔׂ
+	std::fill_n(target, hop_, 0.0f);
+	std::fill_n(candidates, length, 0.0f);
+
+	for (unsigned channel=0; channel<channels_; ++channel)
+	{
+		const float *buffer = buffers_[channel].data();
+
+		for (size_t n=0; n<hop_; ++n)
+			target[n] += buffer[tail_ + n];
+
+		for (size_t n=0; n<length; ++n)
+			candidates[n] += buffer[lower + n];
+	}
+
+	size_t best = preferred;
+	double best_score = Similarity(target, candidates + (preferred - lower), hop_, kCoarseStep);
+
+	for (size_t position=lower; position<=upper; position += kCoarseStep)
+	{
+		const double score = Similarity(target, candidates + (position - lower), hop_, kCoarseStep);
+
+		if (score > best_score)
+		{
+			best = position;
+			best_score = score;
+		}
+	}
+
+	// eTőI񂾈ʒȗOAԈɔג
+	const size_t fine_lower = std::max(lower, best - std::min(best, kCoarseStep - 1));
+	const size_t fine_upper = std::min(upper, best + kCoarseStep - 1);
+
+	best_score = Similarity(target, candidates + (best - lower), hop_, 1);
+
+	for (size_t position=fine_lower; position<=fine_upper; ++position)
+	{
+		const double score = Similarity(target, candidates + (position - lower), hop_, 1);
+
+		if (score > best_score)
+		{
+			best = position;
+			best_score = score;
+		}
+	}
+
+	return best;
+}
+
+// gI͂̂āAobt@̐擪ɋl߂B̒TŖ߂蓾ʒuO͗vȂB
+void TimeStretcher::Compact()
+{
+	const int64_t lowest = static_cast<int64_t>(std::floor(nominal_ + kMinimumTempo * hop_)) - static_cast<int64_t>(search_) - 1;
+	const size_t start = std::min(tail_, static_cast<size_t>(std::max<int64_t>(0, lowest)));
+	if (!start)
+		return;
+
+	const size_t keep = write_ - start;
+
+	for (unsigned channel=0; channel<channels_; ++channel)
+		memmove(buffers_[channel].data(), buffers_[channel].data() + start, keep * sizeof (float));
+
+	write_ = keep;
+	tail_ -= start;
+	nominal_ -= static_cast<double>(start);
+}
+
+static void CopyFrames(float *dst, const float *src, size_t frames, const float *gain)
+{
+	if (gain)
+	{
+		for (size_t frame=0; frame<frames; ++frame)
+			dst[frame] = src[frame] * gain[frame];
+	}
+	else
+	{
+		memcpy(dst, src, frames * sizeof (float));
+	}
+}
+
+// KݑցBȖ傫ł͂Ȃg`̌`Ŕׂ̂ŁAʂ̕ωɈȂB
+static double Similarity(const float *target, const float *candidate, size_t frames, size_t step)
+{
+	double correlation = 0.0;
+	double energy = 0.0;
+
+	for (size_t n=0; n<frames; n += step)
+	{
+		correlation += static_cast<double>(target[n]) * candidate[n];
+		energy += static_cast<double>(candidate[n]) * candidate[n];
+	}
+
+	return (energy > 0.0)? correlation / std::sqrt(energy): 0.0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ForwardKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// WSOLA (g`̗ގxŌpڂIԏdZ) ɂ鎞ԐLkBςɁA͂ tempo {̑ŏB
+// o͂ hop_ t[ɁAŐԂ̌㔼 (~̑) Ǝ̋Ԃ̑O (㏸̑) d˂čB
+// ̋Ԃ̈ʒúAڂ̈ʒȗO search_ t[̒AŐԂ̎RȑƍłĂ鏊IԂ̂ŁA
+// IȔg`̈ʑApڂŉr؂ꂽ肵ɂB
+// tempo  1 ̊Ԃ͗܂Ă͂̂܂܏oAɂȂ Idle() Ԃ̂ŁAďo͑fʂɖ߂B
+// ͂̓`l̗obt@ɁA]֐ (DeinterleaveFunction) ŒڏށB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class TimeStretcher
+{
+public:
+	// t tempo ͈̔
+	static constexpr double kMinimumTempo = 0.5;
+	static constexpr double kMaximumTempo = 2.0;
+
+	TimeStretcher();
+
+	// max_output_frames 1 Process() ōő̃t[Bobt@͂ŊmۂAȌ͊mۂȂB
+	bool Reset(unsigned rate, unsigned channels, size_t max_output_frames);
+
+	// ܂Ă͂ƁA肩̏o͂̂Ă (tbVp)
+	void Clear();
+
+	// ͂鑬B1 傫Βxk߁AΐL΂B1 Ȃ痭܂Ă镪oB
+	void SetTempo(double tempo);
+	double Tempo() const;
+
+	// LkĂ炸A܂Ă͂o͂
+	bool Idle() const;
+
+	// output_frames t[̂ɁAƉt[̓͂v邩
+	size_t RequiredInputFrames(size_t output_frames) const;
+
+	// ͂̏ݐBplanes[channel]  InputCapacity() t[܂ŏACommitInput() Ŋm肷B
+	void InputPlanes(float *planes[kMaxForwardChannels]);
+	size_t InputCapacity() const;
+	void CommitInput(size_t frames);
+
+	// ő frames t[Adst[channel] ɏāAt[ԂBdst[channel]  nullptr ̃`lɂ͏ȂB
+	// gain  nullptr łȂ΁At[̔{ gain[frame] |B
+	size_t Process(float *const *dst, size_t frames, const float *gain);
+
+	// ͂̂A܂o͂ĂȂt[BTimeGet() ̃fBCɊ܂߂B
+	size_t BufferedFrames() const;
+
+	// ܂łɏo͂葽͂̃t[BL΂ꍇ͕ɂȂB
+	int64_t TrimmedFrames() const;
+
+private:
+	bool MakeHop();
+	size_t Search(size_t lower, size_t upper, size_t preferred);
+	void Compact();
+
+	unsigned channels_;
+	size_t hop_;
+	size_t search_;
+	double tempo_;
+
+	// d˂鑋̑O (㏸)B~ 1 - rise_ Ȃ̂ŁAd˂a͏ 1 ɂȂB
+	std::vector<float> rise_;
+
+	// ͂̈ʒu̓obt@̃t[B
+	// tail_ ͑ŐԂ̌㔼̎n܂ŁAO͏o͍ς݁Bnominal_ ͑ŐԂ̖ڂ̎n܂B
+	size_t tail_;
+	double nominal_;
+
+	// 1ԕ̏óB[output_read_, hop_) ܂oĂȂB
+	std::vector<float> output_[kMaxForwardChannels];
+	size_t output_read_;
+
+	// ގx߂A`l̘a
+	std::vector<float> target_;
+	std::vector<float> candidates_;
+
+	int64_t trimmed_;
+
+	// `l̗obt@B[0, write_) ɓ͂Acapacity_ t[܂ŏB
+	std::vector<float> buffers_[kMaxForwardChannels];
+	size_t capacity_;
+	size_t write_;
+};
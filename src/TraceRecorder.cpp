@@ -0,0 +1,132 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+TraceRecorder::TraceRecorder()
+	: mask_(0),
+	next_(0)
+{
+	start_.Store(StartRecord {kNoStart, {}});
+}
+
+void TraceRecorder::Reset(size_t capacity)
+{
+	slots_.reset();
+	mask_ = 0;
+	next_.store(0, std::memory_order_relaxed);
+	start_.Store(StartRecord {kNoStart, {}});
+
+	if (!capacity)
+		return;
+
+	// CfbNX}XNŐ܂Ԃ悤A2ׂ̂ɐ؂グ
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	slots_.reset(new Slot[size]);
+	mask_ = size - 1;
+
+	// ʂԍ 0 ̏ݍς݂̒l (2) Ƌʂł悤A0 ɂĂ
+	for (size_t i=0; i<size; ++i)
+	{
+		slots_[i].sequence.store(0, std::memory_order_relaxed);
+
+		for (auto& word: slots_[i].words)
+			word.store(0, std::memory_order_relaxed);
+	}
+}
+
+bool TraceRecorder::Dump(const char *path, int64_t qpc_frequency) const
+{
+	if (!slots_)
+		return false;
+
+	const uint64_t head = next_.load(std::memory_order_acquire);
+	const uint64_t first = (head > mask_ + 1)? head - (mask_ + 1): 0;
+	std::vector<std::pair<uint64_t, TraceRecord>> records;
+
+	records.reserve(static_cast<size_t>(head - first) + 1);
+
+	for (uint64_t index=first; index<head; ++index)
+	{
+		const Slot& slot = slots_[index & mask_];
+		uint64_t words[kWords];
+
+		// ݒAɎ̎ŏ㏑ĂΓǂ܂Ȃ
+		const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+		if (index * 2 + 2 != before)
+			continue;
+
+		for (size_t i=0; i<kWords; ++i)
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != before)
+			continue;
+
+		TraceRecord record;
+		std::memcpy(&record, words, sizeof (TraceRecord));
+		records.emplace_back(index, record);
+	}
+
+	const uint64_t lost_records = head - records.size();
+
+	// Jn̋L^ǂ߂Ȃꍇ́AʂɎĉ₤BĐ`Ȃƍč\łȂ߁B
+	const StartRecord start = start_.Load();
+	if ((kNoStart != start.index) && std::none_of(records.begin(), records.end(), [&start](const std::pair<uint64_t, TraceRecord>& r) { return r.first == start.index; }))
+	{
+		const auto position = std::lower_bound(records.begin(), records.end(), start.index,
+			[](const std::pair<uint64_t, TraceRecord>& r, uint64_t index) { return r.first < index; });
+
+		records.insert(position, std::make_pair(start.index, start.record));
+	}
+
+	TraceFileHeader header {};
+	std::memcpy(header.magic, kMagic, sizeof (header.magic));
+	header.version = kVersion;
+	header.record_size = sizeof (TraceRecord);
+	header.qpc_frequency = qpc_frequency;
+	header.record_count = records.size();
+	header.lost_records = lost_records;
+
+	FILE *file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	bool succeeded = (1 == fwrite(&header, sizeof (header), 1, file));
+
+	for (const auto& record: records)
+	{
+		if (!succeeded)
+			break;
+
+		succeeded = (1 == fwrite(&record.second, sizeof (TraceRecord), 1, file));
+	}
+
+	return (0 == fclose(file)) && succeeded;
+}
+
+bool TraceRecorder::Load(const char *path, TraceFileHeader *header, std::vector<TraceRecord> *records)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	bool succeeded = (1 == fread(header, sizeof (TraceFileHeader), 1, file))
+		&& (0 == memcmp(header->magic, kMagic, sizeof (kMagic)))
+		&& (kVersion == header->version)
+		&& (sizeof (TraceRecord) == header->record_size);
+
+	if (succeeded)
+	{
+		records->resize(static_cast<size_t>(header->record_count));
+		succeeded = records->empty() || (records->size() == fread(records->data(), sizeof (TraceRecord), records->size(), file));
+	}
+
+	fclose(file);
+
+	return succeeded;
+}
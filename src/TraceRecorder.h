@@ -0,0 +1,121 @@
+#pragma once
+
+#include "SeqLock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// g[X̎ނƁATraceRecord  frames / values ̈ӖB qpc  QPC ̃JEgB
+enum class TraceEvent : uint32_t
+{
+	kStart,		// I[fBIXbh̊JnBframes ͏o͂̃IuWFNgAvalues  {͂̃[g, o͂̃[g, GetPosition 1b̒l, eA_[m (ppm)}
+	kStop,		// Stop()
+	kPlay,		// Play() ւ̓Bframes ̓ubÑt[Avalues  {pts (}CNb), ̃L[̃t[}
+	kStream,	// `Bframes ͗vꂽt[Avalues  {̎n߂̃L[̃t[, ]łt[ (͂̃[g), ]t[ (o͂̃[gAc͖), GetPosition v (QPC)}
+	kPosition,	// GetPosition()Bvalues  {device_position, qpc_position, HRESULT, v (QPC)}
+	kFlush,		// tbVBvalues  {̂Ăt[, Xg[Zbg 1}
+	kPause		// ꎞ~EĊJBframes ͈ꎞ~Ȃ 1
+};
+
+struct TraceRecord
+{
+	int64_t qpc;
+	TraceEvent event;
+	uint32_t frames;
+	int64_t values[4];
+};
+
+// t@C̐擪B record_count  TraceRecord ʂԍ̏ɕԁB
+struct TraceFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	int64_t qpc_frequency;
+	uint64_t record_count;
+	uint64_t lost_records;		// ㏑ꂽAoɏ܂Ăēǂ߂ȂL^̐
+};
+
+// Œ蒷̃OɃg[XL^BtɂȂÂ̂㏑B
+// L^ Play() ̃XbhƃI[fBIXbh̗Ăł悭AbN炸ɈXebvŊB
+// o͔Cӂ̃XbhsAoɏ㏑ꂽL^͎̂ĂB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class TraceRecorder
+{
+public:
+	static constexpr char kMagic[8] = {'M', 'S', 'S', 'T', 'R', 'A', 'C', 'E'};
+	static constexpr uint32_t kVersion = 1;
+
+	TraceRecorder();
+
+	TraceRecorder(const TraceRecorder&) = delete;
+	TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+	// capacity  (2ׂ̂ɐ؏グ) ̃OmۂB0 ȂL^ȂB
+	// L^Eo~܂ĂƂɌĂԂƁB
+	void Reset(size_t capacity);
+
+	bool Enabled() const
+	{
+		return nullptr != slots_;
+	}
+
+	void Record(TraceEvent event, int64_t qpc, uint32_t frames, int64_t value0 = 0, int64_t value1 = 0, int64_t value2 = 0, int64_t value3 = 0)
+	{
+		if (!slots_)
+			return;
+
+		const TraceRecord record {qpc, event, frames, {value0, value1, value2, value3}};
+		const uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+		Slot& slot = slots_[index & mask_];
+
+		uint64_t words[kWords];
+		std::memcpy(words, &record, sizeof (TraceRecord));
+
+		// ݒ͊A݌ (ʂԍ + 1) * 2 ɂ
+		slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i=0; i<kWords; ++i)
+			slot.words[i].store(words[i], std::memory_order_relaxed);
+
+		slot.sequence.store(index * 2 + 2, std::memory_order_release);
+
+		// Jn̋L^̓OĂo悤AʂɎcĂBL^̂̓I[fBIXbĥ݁B
+		if (TraceEvent::kStart == event)
+			start_.Store(StartRecord {index, record});
+	}
+
+	// OɂL^ path ɏoBs false ԂB
+	bool Dump(const char *path, int64_t qpc_frequency) const;
+
+	// Dump() ŏot@CǂށBs false ԂB
+	static bool Load(const char *path, TraceFileHeader *header, std::vector<TraceRecord> *records);
+
+private:
+	static constexpr size_t kWords = (sizeof (TraceRecord) + sizeof (uint64_t) - 1) / sizeof (uint64_t);
+
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence;
+		std::atomic<uint64_t> words[kWords];
+	};
+
+	// index ͋L^̒ʂԍB܂L^Ȃ kNoStartB
+	struct StartRecord
+	{
+		uint64_t index;
+		TraceRecord record;
+	};
+
+	static constexpr uint64_t kNoStart = ~uint64_t(0);
+
+	std::unique_ptr<Slot[]> slots_;
+	uint64_t mask_;
+	std::atomic<uint64_t> next_;
+	SeqLock<StartRecord> start_;
+};
@@ -0,0 +1,210 @@
+#include "VirtualAudioDevice.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+VirtualAudioDevice::VirtualAudioDevice(const VirtualAudioDeviceParameters& parameters)
+	: parameters_(parameters),
+	random_(parameters.seed),
+	jitter_(0.0, 1.0),
+	variation_(0, static_cast<unsigned>(parameters.period_frames * std::clamp(parameters.period_variation, 0.0, 0.9))),
+	time_(0.0),
+	frame_rate_(parameters.rate * (1.0 + parameters.drift_ppm * 1.0e-6)),
+	stop_time_(0.0),
+	running_(false),
+	position_(0),
+	playing_(false),
+	pending_(false),
+	committed_(false),
+	playing_frames_(parameters.period_frames),
+	pending_frames_(parameters.period_frames),
+	buffers_(static_cast<size_t>(parameters.channels) * parameters.period_frames, 0.0f),
+	interleaved_(static_cast<size_t>(parameters.channels) * parameters.period_frames, 0.0f),
+	gain_(1.0f),
+	capture_(nullptr),
+	committed_frames_(0),
+	missed_periods_(0)
+{
+}
+
+// ~ĂԂ͍Đi܂Ȃ̂ŁAzv̕ɑ
+void VirtualAudioDevice::Start(double time)
+{
+	if (running_)
+		return;
+
+	running_ = true;
+	time_ += std::max(0.0, time - stop_time_);
+}
+
+// Đ͓̎rŎ~܂AĊJɎcĐBʒmς݂͍̎ĊJ߂B
+void VirtualAudioDevice::Stop(double time)
+{
+	if (!running_)
+		return;
+
+	running_ = false;
+	stop_time_ = time;
+}
+
+bool VirtualAudioDevice::Running() const
+{
+	return running_;
+}
+
+void VirtualAudioDevice::Reset()
+{
+	position_ = 0;
+	playing_ = false;
+	committed_ = false;
+}
+
+double VirtualAudioDevice::AdvancePeriod()
+{
+	// ʒmς݂̎΁A̕vi݁A̎̍Đn܂
+	if (pending_)
+	{
+		time_ += PeriodTime(playing_? playing_frames_: pending_frames_);
+
+		if (playing_)
+			position_ += playing_frames_;
+
+		if (committed_)
+			Capture();
+		else
+			++missed_periods_;
+
+		playing_ = true;
+		playing_frames_ = pending_frames_;
+	}
+
+	// ̒Ȃ痐Ah炬̌nςȂ
+	pending_ = true;
+	committed_ = false;
+	pending_frames_ = parameters_.period_frames;
+
+	if (parameters_.period_variation > 0.0)
+		pending_frames_ -= variation_(random_);
+
+	// N͑܂炸Axꂾh炮̂Ƃ
+	if (parameters_.jitter <= 0.0)
+		return time_;
+
+	return time_ + std::abs(jitter_(random_)) * parameters_.jitter;
+}
+
+double VirtualAudioDevice::NextPeriodTime() const
+{
+	if (!pending_)
+		return time_;
+
+	return time_ + PeriodTime(playing_? playing_frames_: pending_frames_);
+}
+
+bool VirtualAudioDevice::PeriodWritable() const
+{
+	return pending_ && !committed_;
+}
+
+unsigned VirtualAudioDevice::PeriodFrames() const
+{
+	return pending_frames_;
+}
+
+unsigned VirtualAudioDevice::MaxPeriodFrames() const
+{
+	return parameters_.period_frames;
+}
+
+float *VirtualAudioDevice::Buffer(unsigned channel)
+{
+	return buffers_.data() + static_cast<size_t>(channel) * parameters_.period_frames;
+}
+
+void VirtualAudioDevice::CommitPeriod()
+{
+	if (!pending_ || committed_)
+		return;
+
+	committed_ = true;
+	committed_frames_ += pending_frames_;
+}
+
+void VirtualAudioDevice::SilencePending()
+{
+	if (pending_ && committed_)
+		std::fill(buffers_.begin(), buffers_.end(), 0.0f);
+}
+
+// ݍς݂̎̍Đn܂ƂɁA̎_̔{|ďo
+void VirtualAudioDevice::Capture()
+{
+	if (!capture_)
+		return;
+
+	const unsigned channels = parameters_.channels;
+	const unsigned frames = pending_frames_;
+
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const float *plane = Buffer(channel);
+
+		for (unsigned frame=0; frame<frames; ++frame)
+			interleaved_[static_cast<size_t>(frame) * channels + channel] = plane[frame] * gain_;
+	}
+
+	fwrite(interleaved_.data(), sizeof (float), static_cast<size_t>(frames) * channels, capture_);
+
+	// ꂸɎ捞܂ (~Ȏ҂Ȃ) ́AO̎JԂɖƂďo
+	std::fill(buffers_.begin(), buffers_.end(), 0.0f);
+}
+
+void VirtualAudioDevice::SetGain(float gain)
+{
+	gain_ = gain;
+}
+
+uint64_t VirtualAudioDevice::Position() const
+{
+	return position_;
+}
+
+double VirtualAudioDevice::PositionTime() const
+{
+	return time_;
+}
+
+// ~͎~߂i܂ȂBĐ̎𒴂Ă͐i܂ȂB
+double VirtualAudioDevice::PlayedFrames(double time) const
+{
+	if (!playing_)
+		return static_cast<double>(position_);
+
+	if (!running_)
+		time = std::min(time, stop_time_);
+
+	const double elapsed = std::clamp(time - time_, 0.0, PeriodTime(playing_frames_));
+
+	return position_ + elapsed * frame_rate_;
+}
+
+void VirtualAudioDevice::SetCapture(FILE *file)
+{
+	capture_ = file;
+}
+
+uint64_t VirtualAudioDevice::CommittedFrames() const
+{
+	return committed_frames_;
+}
+
+uint64_t VirtualAudioDevice::MissedPeriods() const
+{
+	return missed_periods_;
+}
+
+double VirtualAudioDevice::PeriodTime(unsigned frames) const
+{
+	return frames / frame_rate_;
+}
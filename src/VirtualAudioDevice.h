@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+struct VirtualAudioDeviceParameters
+{
+	unsigned rate;				// TvO[g
+	unsigned channels;			// IuWFNg
+	unsigned period_frames;		// 1̃t[ (ő)
+	double period_variation;	// Ƀt[炷ő̊B0 ȂB
+	double jitter;				// N̒x̕W΍ (b)
+	double drift_ppm;			// zvɑ΂foCX̎v̐i (ppm)BȂfoCXB
+	uint32_t seed;				// h炬̗̎
+};
+
+// `œo̓foCXAzv̏Ŗ͂́B
+// ͎ԂƊ֌WȂ AdvancePeriod() ̌ďoł̂ݐiނ̂ŁAƌďoȂ猋ʂɂȂB
+// ܂ꂽf[^1xōĐꂽ̂ƂAĐʒu̓foCX̎vŐB
+// Windows / VLC ̃wb_ɈˑȂ悤ɂĂ̂ŁAP̂ŃrhłB
+class VirtualAudioDevice
+{
+public:
+	explicit VirtualAudioDevice(const VirtualAudioDeviceParameters& parameters);
+
+	VirtualAudioDevice(const VirtualAudioDevice&) = delete;
+	VirtualAudioDevice& operator=(const VirtualAudioDevice&) = delete;
+
+	// ~͎i܂AĐʒu~܂BĊJ͎~߂ĐAʒmς݂̎̂܂܏߂B
+	// time ͒~EĊJz (b)B~ĂԂzv炷B
+	void Start(double time = 0.0);
+	void Stop(double time = 0.0);
+	bool Running() const;
+
+	// Đʒu 0 ɖ߂Aݍς݂ŖĐ̃f[^̂ĂBʒmς݂̎͏ݑOɖ߂B
+	void Reset();
+
+	// zv̎̎n߂܂Ői߁A̎ʒm鎞 (h炬܂މzAb) ԂB
+	// O̎ CommitPeriod() ĂȂ΁AĐ̂ƂĐB
+	double AdvancePeriod();
+
+	//  AdvancePeriod() Ă񂾂Ƃ̎̎n߂̉z (h炬܂܂ȂAb)
+	double NextPeriodTime() const;
+
+	// `̏݁BBuffer() ̒g CommitPeriod() Ŏ捞܂A̎̍Đn܂ƂɏoĖɖ߂B
+	// PeriodWritable() ͒ʒmς݂ł܂łȂ邩B
+	// PeriodFrames() ͒ʒmς݂̎̃t[ŁAMaxPeriodFrames() 𒴂ȂB
+	bool PeriodWritable() const;
+	unsigned PeriodFrames() const;
+	unsigned MaxPeriodFrames() const;
+	float *Buffer(unsigned channel);
+	void CommitPeriod();
+
+	// ݍς݂ōĐO̎𖳉ɂBĐ̎͂̂܂ܖB
+	void SilencePending();
+
+	// of[^Ɋ|{B̍Đn܂ƂɊ|B
+	void SetGain(float gain);
+
+	// ߂̎̎n߂ł̍Đʒu (t[) ƁẢz (b)
+	uint64_t Position() const;
+	double PositionTime() const;
+
+	// z time (߂̎̎n߈ȍ~) ܂łɎۂɍĐt[B̓r܂ސ^̒lB
+	double PlayedFrames(double time) const;
+
+	// 捞񂾃f[^ float ̃C^[[uŏoBnullptr Ȃ珑oȂB
+	void SetCapture(FILE *file);
+
+	uint64_t CommittedFrames() const;
+	uint64_t MissedPeriods() const;
+
+private:
+	VirtualAudioDeviceParameters parameters_;
+	std::mt19937 random_;
+	std::normal_distribution<double> jitter_;
+	std::uniform_int_distribution<unsigned> variation_;
+
+	double PeriodTime(unsigned frames) const;
+	void Capture();
+
+	// zvBframe_rate_ ͉z1bɍĐt[ŁAfoCX̎v̐i݂܂ށB
+	// stop_time_ ͒~zB
+	double time_;
+	double frame_rate_;
+	double stop_time_;
+	bool running_;
+
+	// playing_ ͍Đ̎邩Apending_ ͒ʒmς݂ōĐO̎邩Acommitted_ ͂̎܂ꂽB
+	// playing_frames_, pending_frames_ ͂ꂼ̎̃t[B
+	uint64_t position_;
+	bool playing_;
+	bool pending_;
+	bool committed_;
+	unsigned playing_frames_;
+	unsigned pending_frames_;
+
+	std::vector<float> buffers_;
+	std::vector<float> interleaved_;
+	float gain_;
+	FILE *capture_;
+
+	uint64_t committed_frames_;
+	uint64_t missed_periods_;
+};
@@ -1,73 +1,262 @@
 #pragma once
 
-#include "depends.h"
-
-#include <Windows.h>
-#include <mmdeviceapi.h>
-#include <spatialaudioclient.h>
+#include "PortableWin32.h"
+#include "ClockModel.h"
+#include "CommandMailbox.h"
+#include "ForwardAudioData.h"
+#include "ForwardKernels.h"
+#include "LevelMeter.h"
+#include "LogHistogram.h"
+#include "ObjectLayout.h"
+#include "PlanarRing.h"
+#include "Resampler.h"
+#include "SeqLock.h"
+#include "SpscQueue.h"
+#include "TraceRecorder.h"
 
 #include <array>
-#include <mutex>
-#include <queue>
+#include <atomic>
+#include <future>
+#include <initializer_list>
 #include <string>
 #include <thread>
 
+#if defined(_MSC_VER)
 #pragma warning(disable: 4996)
+#endif
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 
+// I[fBIXbh Stream() ̓xɌJAIAudioClock::GetPosition ̌ʂ琄肵ĐʒuƂ̓v
+struct ClockSnapshot
+{
+	HRESULT result;
+	ClockModel::Estimate estimate;
+	float drift_ppm;
+	float delay_variance;
+};
+
+// ʂ̓Kp@Bl͐ݒ mss-volume-mode ƑΉB
+enum class VolumeMode
+{
+	kStreamVolume,		// IAudioStreamVolume ɔC
+	kLinearRamp,		// ]Ɋ|Aω1Đ`ɕԂ
+	kExponentialRamp	// ]Ɋ|Aω1ĎwIɕԂ
+};
+
+// `l\̕ϊBl͐ݒ mss-mix ƑΉB
+enum class MixMode
+{
+	kOff,			// ÓIIuWFNgɖ`l VLC ɔC
+	kFoldDown,		// Eɏݍ
+	kStereoUpmix,	// āAXeI 7.1 ɍL
+	kHeightUpmix	// āAOƌ4IuWFNg (7.1.4)
+};
+
+// o͂̉ʂ̌vBl͐ݒ mss-meter ƑΉB
+enum class MeterMode
+{
+	kOff,
+	kLevels,		// `l̃s[N RMS
+	kLoudness		// āAK |[^ƃV[g^[̃EhlX
+};
+
+// o͐Bl͐ݒ mss-backend ƑΉB
+enum class BackendType
+{
+	kSpatialAudio,		// ISpatialAudioObjectRenderStream
+	kSimulated			// VirtualAudioDevice ɂ͋[o
+};
+
+// ͋[o͂̐ݒ
+struct SimulationSettings
+{
+	unsigned period_frames;
+	double period_variation;	// Ƀt[炷ő̊
+	double jitter;				// `̒ʒm̒x̕W΍ (b)
+	double drift_ppm;			// foCX̎v̐i (ppm)
+	double speed;				// Ԃɑ΂鑬B0 Ȃ珑݂I莟A̎ɐiށB
+	std::string capture_path;	// o͂ float ̃C^[[uŏot@CBȂ珑oȂB
+};
+
+// VLC ̃R[obNI[fBIXbh֑R}h
+struct AudioCommand
+{
+	enum Type
+	{
+		kVolume,
+		kMute,
+		kPause,
+		kFlush,
+		kDrain,
+		kStop
+	};
+
+	Type type;
+	float volume;
+	bool flag;
+	std::promise<HRESULT> completed;
+	LONGLONG posted_qpc;
+	AudioCommand *next_;
+};
+
+// I[fBIXbȟvlBԂ QPC ̃JEgŋL^B
+struct AudioThreadStatistics
+{
+	LogHistogram stream_duration;		// Stream() S
+	LogHistogram forward_duration;		// ForwardAudioData()
+	LogHistogram position_duration;		// GetPosition()
+	LogHistogram wake_lateness;			// `̋NAŐN1xꂽ
+	LogHistogram period_frames;			// `ɗvꂽt[
+	LogHistogram queued_frames;			// `̎n߂̃L[̃t[
+	LogHistogram queued_blocks;			// `̎n߂̃L[̃ubN
+	LogHistogram flush_latency;			// tbV̗v犮܂
+	LogHistogram pause_latency;			// ꎞ~EĊJ̗v犮܂
+
+	void Reset()
+	{
+		for (LogHistogram *histogram: {&stream_duration, &forward_duration, &position_duration, &wake_lateness, &period_frames, &queued_frames, &queued_blocks, &flush_latency, &pause_latency})
+			histogram->Reset();
+	}
+};
+
 struct aout_sys_t
 {
 	enum
 	{
 		kThreadInitialized,
-		kStopRequest,
-		kGetPositionRequest,
-		kGetPositionCompleted,
-		kPauseRequest,
-		kPauseCompleted,
-		kFlushRequest,
-		kFlushCompleted,
-		kVolumeRequest,
-		kVolumeCompleted,
+		kCommandPosted,
 		kEventsNum
 	};
 
-	std::mutex mutex_;
+	// audio_data_queue_ ɐς߂ block_t ̍ő吔
+	static constexpr size_t kAudioDataQueueCapacity = 4096;
+
+	// released_blocks_ ̑傫BPlay() ̓xɋɂ̂ŁÅԂ audio_data_queue_ o鐔傫΂悢B
+	static constexpr size_t kReleasedBlocksCapacity = kAudioDataQueueCapacity * 2;
+
+	// retired_commands_ ̑傫BPostCommand() ̓xɋɂ̂ŁAxɑꂤR}h̐傫΂悢B
+	static constexpr size_t kRetiredCommandsCapacity = 64;
+
+	// planar_ring_ ɗ߂͂̕b
+	static constexpr unsigned kPlanarRingSeconds = 2;
 
 	audio_sample_format_t input_format_;
 	WAVEFORMATEX output_format_;
-	std::array<uint8_t, 8> channel_reorder_table_;
+	std::array<uint8_t, kMaxForwardChannels> channel_reorder_table_;
+	DeinterleaveFunction deinterleave_;
+
+	// o͂ÓIIuWFNg (ObjectBit ̘a) Ƃ̐Bs|Ȃꍇ͓͂̃`lɑΉ́B
+	// ]̃obt@ ObjectChannel ̏ɕԁB
+	// mix_  nullptr łȂ΁Adeinterleave_ ̑ mix_matrix_ (o̓`l ~ ̓`l) |ē]B
+	MixMode mix_mode_;
+	uint32_t output_objects_;
+	uint8_t output_channels_;
+	MixFunction mix_;
+	std::array<float, kMaxForwardChannels * kMaxMixInputChannels> mix_matrix_;
+
+	// ̌oBPlay()  scan_silence_ ŃubÑ`l 0 łȂTv邩𒲂ׁA
+	// ̏o͓͂]̑ 0 Ŗ߂Boutput_sources_[channel] ͏o channel Ɋ^̓`l̃rbgB
+	// played_samples_  silent_samples_  Play() Ao͂̃Tv (t[ ~ IuWFNg) Ƃ̂B
+	ScanSilenceFunction scan_silence_;
+	std::array<uint32_t, kMaxForwardChannels> output_sources_;
+	int64_t played_samples_;
+	int64_t silent_samples_;
 
+	// ̃TvO[gϊBLȂ input_format_  output_format_ ̃[gقȂ肤B
+	ResamplerQuality resampler_quality_;
+
+	BackendType backend_type_;
+	SimulationSettings simulation_;
 	std::wstring device_id_;
 	DWORD wait_timeout_;
+	bool fast_flush_;
 	int flush_wait_;
 	int stop_wait_;
 
 	// audio data frame
-	std::queue<block_t *> audio_data_queue_;
-	int64_t audio_data_frames_;
+	// Play() YҁAI[fBIXbh҂ƂȂ
+	SpscQueue<QueuedBlock<block_t>> audio_data_queue_ {kAudioDataQueueCapacity};
+
+	// gI block_t
+	// I[fBIXbhYҁAPlay() ҂ƂȂAblock_Release()  Play() ̃XbhŌĂ
+	SpscQueue<block_t *> released_blocks_ {kReleasedBlocksCapacity};
+	std::atomic<int64_t> audio_data_frames_;
+
+	// Play() t̃L[ő҂ɎgBI[fBIXbhJB
+	// period_frames_ ͒߂̕`̃t[ (o͂̃[g)Arender_failed_ ͕`̍XVɎsĂ邩 (~ true)B
+	// dropped_blocks_ ́Ai܂ Play() ̂ĂubN̐B
+	std::atomic<UINT32> period_frames_;
+	std::atomic<bool> render_failed_;
+	int64_t dropped_blocks_;
+
+	// convert_on_play_ ȂAPlay() ubNo͂̕т float ɕϊ planar_ring_ ɏAɉB
+	// ̏ꍇ audio_data_queue_ ͎g킸Aaudio_data_frames_  planar_ring_ ̃t[ɂȂB
+	bool convert_on_play_;
+	PlanarRing planar_ring_;
+
+	// ǂ
+	// prebuffer_frames_ ͐ǂݒɗ߂t[ (ȃtbV̌1) ŁAǂݒłȂ 0Bprebuffer_target_ ͒߂̖ڕWt[B
+	double underrun_probability_;
+	std::atomic<int64_t> prebuffer_frames_;
+	std::atomic<int64_t> prebuffer_target_;
+
+	// x̐؋l
+	// L[ latency_target_frames_ (0 Ȃ؋l߂Ȃ) 𒴂ė܂AԐLkő߂ɏĖڕW܂Ŗ߂B
+	// trimmed_frames_ ͂܂łɏo͂葽͂̃t[B
+	int64_t latency_target_frames_;
+	std::atomic<int64_t> trimmed_frames_;
 
 	// audio process thread
 	bool thread_initialized_;
 	std::thread audio_process_thread_;
-	HRESULT thread_request_result_;
 	std::array<HANDLE, aout_sys_t::kEventsNum> events_;
+	CommandMailbox<AudioCommand> commands_;
+
+	// R}h
+	// I[fBIXbhYҁAPostCommand()  Stop() ҂ƂȂAR}h std::promise ̋LԂ͌ďõXbhŉB
+	// VLC ̃R[obN͏o͂̃bN̉ŌĂ΂̂ŁA҂2ɂȂ邱Ƃ͂ȂB
+	SpscQueue<AudioCommand *> retired_commands_ {kRetiredCommandsCapacity};
 
 	// TimeGet
-	int64_t frames_written_;
+	// frames_written_ ͏o͂̃[gAresampler_frames_  stretcher_frames_ ͕ϊƎԐLkɗ܂Ă͂̃[gł̃t[
+	std::atomic<int64_t> frames_written_;
+	std::atomic<int64_t> resampler_frames_;
+	std::atomic<int64_t> stretcher_frames_;
 	LARGE_INTEGER qpc_frequency_;
-	int64_t device_second_position_;
-	int64_t device_micro_socond_position_;
-	UINT64 qpc_position;
+	SeqLock<ClockSnapshot> clock_snapshot_;
+
+	// A_[̓vBI[fBIXbhZAPlay()  VLC ̕ϐɔfB
+	std::atomic<int64_t> underruns_;
+	std::atomic<int64_t> padded_frames_;
+	int64_t reported_underruns_;
+	int64_t reported_padded_frames_;
+	int64_t reported_prebuffer_target_;
+
+	// vlBI[fBIXbhL^APlay() I VLC ̕ϐƃOɏoB
+	AudioThreadStatistics statistics_;
+	LONGLONG next_statistics_report_;
 
-	// Pause
-	bool pause_;
+	// o͂̉ʂ̌vBI[fBIXbh` level_meter_ ɉAPlay()  VLC ̕ϐɔfB
+	// ]֐ŌvłȂoHł́A񂾌 measure_levels_ œǂݒB
+	MeterMode meter_mode_;
+	MeasureLevelsFunction measure_levels_;
+	LevelMeter level_meter_;
+	uint64_t reported_meter_blocks_;
+
+	// g[XBOpen() ŊmۂAPlay() ̃XbhƃI[fBIXbhL^B
+	// Stop() ƕϐ mss-trace-dump ̓x trace_path_ (Ȃ珑oȂ) ֏oB
+	TraceRecorder trace_;
+	std::string trace_path_;
 
 	// VolumeSet / MuteSet
+	VolumeMode volume_mode_;
 	float volume_;
 
 	// MuteSet
 	bool mute_;
+
+	// ŌɑʁE~[g̃R}h̊B͑҂A VolumeSet / MuteSet Ōʂm߂B
+	std::future<HRESULT> volume_result_;
 };
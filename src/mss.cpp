@@ -1,32 +1,188 @@
 #include "mss.h"
+#include "AudioDeviceCache.h"
 #include "AudioProcessThread.h"
-
-#include <functiondiscoverykeys_devpkey.h>
+#include "ChannelLayouts.h"
+#include "ForwardAudioData.h"
+#include "ForwardLayouts.h"
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <future>
 #include <memory>
-#include <mutex>
 #include <string>
-#include <thread>
+#include <utility>
 #include <vector>
 
-#include <wil/com.h>
-
 static const char *kVolumeSaveConfig = "volume-save";
 static const char *kDeviceConfig = "mss-audio-device";
 static const char *kVolumeConfig = "mss-volume";
+static const char *kVolumeModeConfig = "mss-volume-mode";
 static const char *kMuteConfig = "mss-mute";
 static const char *kWaitTimeoutConfig = "mss-wait-timeout";
+static const char *kFastFlushConfig = "mss-fast-flush";
 static const char *kFlushWaitConfig = "mss-flush-wait";
 static const char *kStopWaitConfig = "mss-stop-wait";
+static const char *kUnderrunProbabilityConfig = "mss-underrun-probability";
+static const char *kBackendConfig = "mss-backend";
+static const char *kSimulationPeriodConfig = "mss-simulation-period";
+static const char *kSimulationPeriodVariationConfig = "mss-simulation-period-variation";
+static const char *kSimulationJitterConfig = "mss-simulation-jitter";
+static const char *kSimulationDriftConfig = "mss-simulation-drift";
+static const char *kSimulationSpeedConfig = "mss-simulation-speed";
+static const char *kSimulationCaptureConfig = "mss-simulation-capture";
+static const char *kResamplerConfig = "mss-resampler";
+static const char *kMixConfig = "mss-mix";
+static const char *kConvertOnPlayConfig = "mss-convert-on-play";
+static const char *kLatencyTargetConfig = "mss-latency-target";
+static const char *kMeterConfig = "mss-meter";
+static const char *kTraceSizeConfig = "mss-trace-size";
+static const char *kTraceFileConfig = "mss-trace-file";
+
+// vJ VLC ̕ϐ
+static const char *kUnderrunsVariable = "mss-underruns";
+static const char *kPaddedFramesVariable = "mss-padded-frames";
+static const char *kPrebufferFramesVariable = "mss-prebuffer-frames";
+static const char *kClockDriftVariable = "mss-clock-drift";
+static const char *kDelayVarianceVariable = "mss-delay-variance";
+static const char *kTrimmedFramesVariable = "mss-trimmed-frames";
+static const char *kSilentRatioVariable = "mss-silent-ratio";
+static const char *kDroppedBlocksVariable = "mss-dropped-blocks";
+
+// o͂̉ʂJ VLC ̕ϐBs[N RMS ͏o͂̕ (ObjectChannel ̏)  dBFS 󔒂ŋ؂AEhlX LUFSB
+static const char *kPeakVariable = "mss-peak";
+static const char *kRmsVariable = "mss-rms";
+static const char *kMomentaryLoudnessVariable = "mss-loudness-momentary";
+static const char *kShortTermLoudnessVariable = "mss-loudness-short-term";
+static const char *kClippedBlocksVariable = "mss-clipped-blocks";
+
+// gKƃg[Xo VLC ̕ϐ
+static const char *kTraceDumpVariable = "mss-trace-dump";
+
+// I[fBIXbȟvlJ VLC ̕ϐBQPC Ōvl̓}CNbɊZďoB
+struct StatisticsVariable
+{
+	const char *name;
+	LogHistogram AudioThreadStatistics::*histogram;
+	bool qpc;
+};
+
+static const StatisticsVariable kStatisticsVariables[] =
+{
+	{"mss-stream-duration", &AudioThreadStatistics::stream_duration, true},
+	{"mss-forward-duration", &AudioThreadStatistics::forward_duration, true},
+	{"mss-position-duration", &AudioThreadStatistics::position_duration, true},
+	{"mss-wake-lateness", &AudioThreadStatistics::wake_lateness, true},
+	{"mss-period-frames", &AudioThreadStatistics::period_frames, false},
+	{"mss-queued-frames", &AudioThreadStatistics::queued_frames, false},
+	{"mss-queued-blocks", &AudioThreadStatistics::queued_blocks, false},
+	{"mss-flush-latency", &AudioThreadStatistics::flush_latency, true},
+	{"mss-pause-latency", &AudioThreadStatistics::pause_latency, true}
+};
+
+// vlϐƃOɏoԊu (b)
+static constexpr LONGLONG kStatisticsReportSeconds = 10;
+
+// mss-volume-mode ̑IBVolumeMode ̕тƑΉB
+static const int kVolumeModeValues[] = {0, 1, 2};
+static const char *const kVolumeModeTexts[] = {"Stream volume", "Software (linear ramp)", "Software (exponential ramp)"};
+
+// mss-backend ̑IBBackendType ̕тƑΉB
+static const int kBackendValues[] = {0, 1};
+static const char *const kBackendTexts[] = {"Spatial sound", "Simulated"};
+
+// mss-mix ̑IBMixMode ̕тƑΉB
+static const int kMixValues[] = {0, 1, 2, 3};
+static const char *const kMixTexts[] = {"Off", "Fold down", "Fold down and stereo upmix", "Fold down, stereo and height upmix (7.1.4)"};
+
+// mss-meter ̑IBMeterMode ̕тƑΉB
+static const int kMeterValues[] = {0, 1, 2};
+static const char *const kMeterTexts[] = {"Off", "Peak and RMS", "Peak, RMS and loudness"};
+
+// šWB̓`l input IuWFNg output  gain |đB
+struct MixTerm
+{
+	uint32_t input;
+	ObjectChannel output;
+	float gain;
+};
+
+// ̌WBIuWFNg source Ɋ|̂ output ɂ gain |đBsource  fallback gB
+struct HeightTerm
+{
+	ObjectChannel source;
+	ObjectChannel fallback;
+	ObjectChannel output;
+	float gain;
+};
+
+static constexpr float kMinus3dB = 0.70710678f;
+
+// ́AEɓU蕪
+static constexpr MixTerm kFoldDownTerms[] =
+{
+	{AOUT_CHAN_REARCENTER, ObjectChannel::kBackLeft, kMinus3dB},
+	{AOUT_CHAN_REARCENTER, ObjectChannel::kBackRight, kMinus3dB}
+};
 
-static unsigned MakeChannelReorderTable(uint8_t *table, uint16_t physical_channels);
-static void MakeDeviceIdTable(std::vector<std::string>& ids, std::vector<std::string>& descs);
-static std::string CreateUtf8StringFromWideCharString(LPCWCH wide_char_string);
+// OE͂̂܂܎cAɂ͘aAɂ͊e`lAɂ͍ (t̐) U蕪󓮓Iȍs
+static constexpr MixTerm kStereoUpmixTerms[] =
+{
+	{AOUT_CHAN_LEFT, ObjectChannel::kFrontCenter, 0.5f * kMinus3dB},
+	{AOUT_CHAN_RIGHT, ObjectChannel::kFrontCenter, 0.5f * kMinus3dB},
+	{AOUT_CHAN_LEFT, ObjectChannel::kSideLeft, 0.5f},
+	{AOUT_CHAN_RIGHT, ObjectChannel::kSideRight, 0.5f},
+	{AOUT_CHAN_LEFT, ObjectChannel::kBackLeft, 0.5f * kMinus3dB},
+	{AOUT_CHAN_RIGHT, ObjectChannel::kBackLeft, -0.5f * kMinus3dB},
+	{AOUT_CHAN_LEFT, ObjectChannel::kBackRight, -0.5f * kMinus3dB},
+	{AOUT_CHAN_RIGHT, ObjectChannel::kBackRight, 0.5f * kMinus3dB}
+};
+
+// Oɂ͑OEAɂ͌E (ΑE)  -6dB ŐU蕪
+static constexpr HeightTerm kHeightUpmixTerms[] =
+{
+	{ObjectChannel::kFrontLeft, ObjectChannel::kFrontLeft, ObjectChannel::kTopFrontLeft, 0.5f},
+	{ObjectChannel::kFrontRight, ObjectChannel::kFrontRight, ObjectChannel::kTopFrontRight, 0.5f},
+	{ObjectChannel::kBackLeft, ObjectChannel::kSideLeft, ObjectChannel::kTopBackLeft, 0.5f},
+	{ObjectChannel::kBackRight, ObjectChannel::kSideRight, ObjectChannel::kTopBackRight, 0.5f}
+};
+
+// mss-resampler ̑IBResamplerQuality ̕тƑΉB
+static const int kResamplerValues[] = {0, 1, 2, 3};
+static const char *const kResamplerTexts[] = {"Off", "Low latency", "Balanced", "High quality"};
+
+// ChannelLayouts.h ̕\ VLC ̃wb_ȂŏĂ̂ŁAlv邱Ƃm߂
+static_assert((kChanCenter == AOUT_CHAN_CENTER) && (kChanLeft == AOUT_CHAN_LEFT) && (kChanRight == AOUT_CHAN_RIGHT)
+	&& (kChanRearCenter == AOUT_CHAN_REARCENTER) && (kChanRearLeft == AOUT_CHAN_REARLEFT) && (kChanRearRight == AOUT_CHAN_REARRIGHT)
+	&& (kChanMiddleLeft == AOUT_CHAN_MIDDLELEFT) && (kChanMiddleRight == AOUT_CHAN_MIDDLERIGHT) && (kChanLfe == AOUT_CHAN_LFE),
+	"kChan* must match AOUT_CHAN_*");
+static_assert((kChans2_0 == AOUT_CHANS_2_0) && (kChans2_1 == AOUT_CHANS_2_1) && (kChans3_0 == AOUT_CHANS_3_0) && (kChans3_1 == AOUT_CHANS_3_1)
+	&& (kChans4_0 == AOUT_CHANS_4_0) && (kChans4_1 == AOUT_CHANS_4_1) && (kChans4CenterRear == AOUT_CHANS_4_CENTER_REAR)
+	&& (kChans4_0Middle == AOUT_CHANS_4_0_MIDDLE) && (kChans5_0 == AOUT_CHANS_5_0) && (kChans5_0Middle == AOUT_CHANS_5_0_MIDDLE)
+	&& (kChans5_1 == AOUT_CHANS_5_1) && (kChans5_1Middle == AOUT_CHANS_5_1_MIDDLE) && (kChans6_0 == AOUT_CHANS_6_0)
+	&& (kChans6_1Middle == AOUT_CHANS_6_1_MIDDLE) && (kChans7_0 == AOUT_CHANS_7_0) && (kChans7_1 == AOUT_CHANS_7_1) && (kChans8_1 == AOUT_CHANS_8_1),
+	"kChans* must match AOUT_CHANS_*");
+
+static uint32_t ChannelsToObjects(uint16_t physical_channels);
+static DeinterleaveFunction SelectLayoutDeinterleaveFunction(uint16_t physical_channels);
+static bool MakeMixMatrix(MixMode mode, uint16_t input_channels, uint32_t *output_objects, float *matrix);
+static int TakeVolumeResult(audio_output_t *aout);
+static bool WaitForConsumer(aout_sys_t *sys, LONGLONG *deadline_qpc, int64_t *queued_frames);
+static void DropBlock(audio_output_t *aout, unsigned frames, bool render_failed);
+static void ReportStatistics(audio_output_t *aout);
+static std::string FormatHistogram(const LogHistogram::Snapshot& snapshot, LONGLONG qpc_frequency);
+static std::string FormatLevels(const float *levels, unsigned channels);
+static int TraceDumpCallback(vlc_object_t *obj, const char *name, vlc_value_t old_value, vlc_value_t new_value, void *data);
+static void DumpTrace(audio_output_t *aout);
+static LONGLONG QpcNow();
 static std::wstring CreateWideCharStringFromUtf8String(LPCCH Utf8_string);
-static void GetSupportedFormats(std::vector<WAVEFORMATEX>& formats, const std::wstring& device_id);
+static void GetSimulatedFormats(std::vector<WAVEFORMATEX>& formats, unsigned rate);
+static void InheritSimulationSettings(audio_output_t *aout, SimulationSettings *settings);
 static vlc_fourcc_t WaveFormatToVlcFourcc(const WAVEFORMATEX& wave_format);
+static bool VlcFourccToSampleFormat(vlc_fourcc_t fourcc, SampleFormat *format);
 
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
@@ -59,8 +215,32 @@ VLC_EXTERN int Open(vlc_object_t *obj)
 	sys->thread_initialized_ = false;
 	sys->volume_ = var_InheritFloat(aout, kVolumeConfig);
 	sys->mute_ = var_InheritBool(aout, kMuteConfig);
+	AcquireAudioDeviceCache();
 	MakeDeviceIdTable(device_ids, device_descriptions);
 
+	var_Create(aout, kUnderrunsVariable, VLC_VAR_INTEGER);
+	var_Create(aout, kPaddedFramesVariable, VLC_VAR_INTEGER);
+	var_Create(aout, kPrebufferFramesVariable, VLC_VAR_INTEGER);
+	var_Create(aout, kClockDriftVariable, VLC_VAR_FLOAT);
+	var_Create(aout, kDelayVarianceVariable, VLC_VAR_FLOAT);
+	var_Create(aout, kTrimmedFramesVariable, VLC_VAR_INTEGER);
+	var_Create(aout, kSilentRatioVariable, VLC_VAR_FLOAT);
+	var_Create(aout, kDroppedBlocksVariable, VLC_VAR_INTEGER);
+	for (const auto& variable: kStatisticsVariables)
+		var_Create(aout, variable.name, VLC_VAR_STRING);
+	var_Create(aout, kPeakVariable, VLC_VAR_STRING);
+	var_Create(aout, kRmsVariable, VLC_VAR_STRING);
+	var_Create(aout, kMomentaryLoudnessVariable, VLC_VAR_FLOAT);
+	var_Create(aout, kShortTermLoudnessVariable, VLC_VAR_FLOAT);
+	var_Create(aout, kClippedBlocksVariable, VLC_VAR_INTEGER);
+
+	// g[X̃O͍Đ̓xɍ蒼AStop() ܂ŋL^
+	sys->trace_.Reset(static_cast<size_t>(var_InheritInteger(aout, kTraceSizeConfig)));
+	vlc_value_t trace_path;
+	var_Inherit(aout, kTraceFileConfig, VLC_VAR_STRING, &trace_path);
+	sys->trace_path_ = trace_path.psz_string? trace_path.psz_string: "";
+	msvcrt_free(trace_path.psz_string);
+
 	aout->sys = sys;
 	aout->start = Start;
 	aout->volume_set = VolumeSet;
@@ -70,6 +250,9 @@ VLC_EXTERN int Open(vlc_object_t *obj)
 	for (size_t i=0; i<device_ids.size(); ++i)
 		aout_HotplugReport(aout, device_ids[i].c_str(), device_descriptions[i].c_str());
 
+	var_Create(aout, kTraceDumpVariable, VLC_VAR_VOID| VLC_VAR_ISCOMMAND);
+	var_AddCallback(aout, kTraceDumpVariable, TraceDumpCallback, nullptr);
+
 	aout_VolumeReport(aout, sys->volume_);
 	aout_MuteReport(aout, sys->mute_);
 
@@ -88,6 +271,26 @@ VLC_EXTERN void Close(vlc_object_t *obj)
 	audio_output_t *aout = reinterpret_cast<audio_output_t *>(obj);
 	aout_sys_t *sys = aout->sys;
 
+	// õR[obNÎ҂Ăj
+	var_DelCallback(aout, kTraceDumpVariable, TraceDumpCallback, nullptr);
+	var_Destroy(aout, kTraceDumpVariable);
+
+	var_Destroy(aout, kUnderrunsVariable);
+	var_Destroy(aout, kPaddedFramesVariable);
+	var_Destroy(aout, kPrebufferFramesVariable);
+	var_Destroy(aout, kClockDriftVariable);
+	var_Destroy(aout, kDelayVarianceVariable);
+	var_Destroy(aout, kTrimmedFramesVariable);
+	var_Destroy(aout, kSilentRatioVariable);
+	for (const auto& variable: kStatisticsVariables)
+		var_Destroy(aout, variable.name);
+	var_Destroy(aout, kPeakVariable);
+	var_Destroy(aout, kRmsVariable);
+	var_Destroy(aout, kMomentaryLoudnessVariable);
+	var_Destroy(aout, kShortTermLoudnessVariable);
+	var_Destroy(aout, kClippedBlocksVariable);
+
+	ReleaseAudioDeviceCache();
 	delete aout->sys;
 }
 
@@ -121,12 +324,25 @@ VLC_EXTERN int Start(audio_output_t *aout, audio_sample_format_t *fmt)
 {
 	aout_sys_t *sys = aout->sys;
 
+	// foCẌꗗƃtH[}bg̃LbVĂ邩m߂悤AvԂOɏo
+	LARGE_INTEGER start_qpc;
+	QueryPerformanceCounter(&start_qpc);
+
 	vlc_fourcc_t input_fourcc = fmt->i_format;
 	vlc_fourcc_t output_fourcc = VLC_CODEC_UNKNOWN;
 	WAVEFORMATEX output_format;
 	std::vector<WAVEFORMATEX> output_formats;
 
-	GetSupportedFormats(output_formats, sys->device_id_);
+	sys->backend_type_ = static_cast<BackendType>(std::clamp<int64_t>(var_InheritInteger(aout, kBackendConfig), 0, 1));
+	if (BackendType::kSimulated == sys->backend_type_)
+	{
+		InheritSimulationSettings(aout, &sys->simulation_);
+		GetSimulatedFormats(output_formats, fmt->i_rate);
+	}
+	else
+	{
+		GetSupportedFormats(output_formats, sys->device_id_);
+	}
 	
 	// o̓tH[}bg肷
 	for (const auto& format: output_formats)
@@ -144,35 +360,85 @@ VLC_EXTERN int Start(audio_output_t *aout, audio_sample_format_t *fmt)
 	if (VLC_CODEC_UNKNOWN == output_fourcc)
 		return VLC_EGENERIC;
 
-	// ̓tH[}bgƏo̓tH[}bgقȂꍇVLC_EGENERICԂƂŁA
+	// float o͂ɑ΂ S16N / S24N / S32N ͂́A]ɃvOCŕϊB
+	// ȊOœ̓tH[}bgƏo̓tH[}bgقȂꍇVLC_EGENERICԂƂŁA
 	// ̌ďoɃtH[}bgϊ}ł邱Ƃ҂B
+	SampleFormat input_sample_format = SampleFormat::kFloat32;
 	if (input_fourcc != output_fourcc)
-		return VLC_EGENERIC;
+	{
+		if ((VLC_CODEC_FL32 != output_fourcc) || !VlcFourccToSampleFormat(input_fourcc, &input_sample_format))
+			return VLC_EGENERIC;
+	}
 
 	// TvO[gƍ\`lƁA
 	// {̑ŏ肭ϊĂ悤B
-	fmt->i_format = output_fourcc;
-	fmt->i_rate = output_format.nSamplesPerSec;
-	fmt->i_physical_channels &= AOUT_CHANS_7_1;
+	// ̕ϊgꍇ́A[g͏ɓ]ɕϊB
+	sys->resampler_quality_ = static_cast<ResamplerQuality>(std::clamp<int64_t>(var_InheritInteger(aout, kResamplerConfig), 0, 3));
+	if ((ResamplerQuality::kOff == sys->resampler_quality_) || !Resampler::SupportsRates(fmt->i_rate, output_format.nSamplesPerSec))
+		fmt->i_rate = output_format.nSamplesPerSec;
+
+	// s|ꍇ͍\`lAVLC ̃`lϊȂB
+	sys->mix_mode_ = static_cast<MixMode>(std::clamp<int64_t>(var_InheritInteger(aout, kMixConfig), 0, 3));
+	sys->mix_ = nullptr;
+	if (MakeMixMatrix(sys->mix_mode_, fmt->i_physical_channels, &sys->output_objects_, sys->mix_matrix_.data()))
+		sys->mix_ = SelectMixFunction(DetectSimdLevel(), input_sample_format);
+	else
+	{
+		fmt->i_physical_channels &= AOUT_CHANS_8_1;
+		sys->output_objects_ = ChannelsToObjects(fmt->i_physical_channels);
+	}
+
+	fmt->i_format = input_fourcc;
 	fmt->channel_type = AUDIO_CHANNEL_TYPE_BITMAP;
 	aout_FormatPrepare(fmt);
 
 	sys->input_format_ = *fmt;
 	sys->output_format_ = output_format;
-	MakeChannelReorderTable(sys->channel_reorder_table_.data(), fmt->i_physical_channels);
+	sys->output_channels_ = static_cast<uint8_t>(CountObjects(sys->output_objects_));
+
+	// o͂̉ʂ̌vB]֐ŌvłȂoHł measure_levels_ œǂݒB
+	sys->meter_mode_ = static_cast<MeterMode>(std::clamp<int64_t>(var_InheritInteger(aout, kMeterConfig), 0, 2));
+	sys->measure_levels_ = SelectMeasureLevelsFunction(DetectSimdLevel());
+	sys->level_meter_.Reset(sys->output_objects_, output_format.nSamplesPerSec, MeterMode::kLoudness == sys->meter_mode_);
+	sys->reported_meter_blocks_ = 0;
+
+	// CPUɍėp̓]֐gBm̃`l\̐p̓]֐̓XJ[̃[vȂ̂ŁASSE2 ȏ̔ėp̓]֐
+	// SĂ̍\Œx (bench/ForwardBench.cpp  layout)ASIMD gȂ CPU  float ͂vɓ]ꍇgB
+	// p̓]֐͌v̐ώZlWX^ɒuȂ̂ŁAvꍇėp̓]֐gBvɂ鑝 bench/ForwardBench.cpp œ]֐̌v̗LׂđB
+	// s|ꍇ͍s񂪕ւ˂̂ŁAւ\͍ȂB
+	sys->deinterleave_ = nullptr;
+	if (!sys->mix_)
+	{
+		sys->channel_reorder_table_ = MakeLayoutReorder(kInputChannelOrder, kOutputChannelOrder, fmt->i_physical_channels);
 
-	std::array<wil::unique_handle, aout_sys_t::kEventsNum> handles;
-	for (auto& handle: handles)
+		if ((SampleFormat::kFloat32 == input_sample_format) && (SimdLevel::kScalar == DetectSimdLevel()) && (MeterMode::kOff == sys->meter_mode_))
+			sys->deinterleave_ = SelectLayoutDeinterleaveFunction(fmt->i_physical_channels);
+		if (!sys->deinterleave_)
+			sys->deinterleave_ = SelectDeinterleaveFunction(DetectSimdLevel(), input_sample_format);
+	}
+
+	// ̌ô߁Ao͖Ɋ^̓`l߂Ă
+	sys->scan_silence_ = SelectScanSilenceFunction(DetectSimdLevel(), input_sample_format);
+	sys->output_sources_.fill(0);
+	for (unsigned out=0; out<sys->output_channels_; ++out)
 	{
-		HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-		if (!event)
-			return VLC_EGENERIC;
+		if (!sys->mix_)
+		{
+			sys->output_sources_[out] = 1u << sys->channel_reorder_table_[out];
+			continue;
+		}
 
-		handle.reset(event);
+		for (unsigned in=0; in<fmt->i_channels; ++in)
+		{
+			if (0.0f != sys->mix_matrix_[out * fmt->i_channels + in])
+				sys->output_sources_[out] |= 1u << in;
+		}
 	}
 
-	for (int i=0; i<aout_sys_t::kEventsNum; ++i)
-		sys->events_[i] = handles[i].release();
+	// Play() ŕϊꍇ́A`ł͎ʂōςނ悤Ao͂̕т̃OmۂĂ
+	sys->convert_on_play_ = var_InheritBool(aout, kConvertOnPlayConfig);
+	if (sys->convert_on_play_)
+		sys->planar_ring_.Reset(sys->output_channels_, static_cast<size_t>(fmt->i_rate) * aout_sys_t::kPlanarRingSeconds);
 
 	aout->stop = Stop;
 	aout->time_get = TimeGet;
@@ -181,32 +447,45 @@ VLC_EXTERN int Start(audio_output_t *aout, audio_sample_format_t *fmt)
 	aout->flush = Flush;
 
 	sys->wait_timeout_ = var_InheritInteger(aout, kWaitTimeoutConfig);
+	sys->fast_flush_ = var_InheritBool(aout, kFastFlushConfig);
 	sys->flush_wait_ = var_InheritInteger(aout, kFlushWaitConfig);
 	sys->stop_wait_ = var_InheritInteger(aout, kStopWaitConfig);
-
-	sys->audio_data_frames_ = 0;
-	sys->frames_written_ = 0;
-	QueryPerformanceFrequency(&sys->qpc_frequency_);
-
-	sys->thread_initialized_ = false;
-	sys->audio_process_thread_ = std::thread(AudioProcessThread, sys);
-	WaitForSingleObject(sys->events_[aout_sys_t::kThreadInitialized], INFINITE);
-
-	if (!sys->thread_initialized_)
-	{
-		sys->audio_process_thread_.join();
-		std::for_each(sys->events_.begin(), sys->events_.end(),
-			[](HANDLE h)
-			{
-				CloseHandle(h);
-			}
-		);
+	sys->underrun_probability_ = var_InheritFloat(aout, kUnderrunProbabilityConfig);
+	sys->latency_target_frames_ = std::max<int64_t>(0, var_InheritInteger(aout, kLatencyTargetConfig)) * fmt->i_rate / 1000;
+	sys->volume_mode_ = static_cast<VolumeMode>(std::clamp<int64_t>(var_InheritInteger(aout, kVolumeModeConfig), 0, 2));
+
+	sys->played_samples_ = 0;
+	sys->silent_samples_ = 0;
+	sys->dropped_blocks_ = 0;
+	sys->reported_underruns_ = 0;
+	sys->reported_padded_frames_ = 0;
+	sys->reported_prebuffer_target_ = 0;
+	var_SetInteger(aout, kUnderrunsVariable, 0);
+	var_SetInteger(aout, kPaddedFramesVariable, 0);
+	var_SetInteger(aout, kPrebufferFramesVariable, 0);
+	var_SetFloat(aout, kClockDriftVariable, 0.0f);
+	var_SetFloat(aout, kDelayVarianceVariable, 0.0f);
+	var_SetInteger(aout, kTrimmedFramesVariable, 0);
+	var_SetFloat(aout, kSilentRatioVariable, 0.0f);
+	var_SetInteger(aout, kDroppedBlocksVariable, 0);
+	var_SetString(aout, kPeakVariable, "");
+	var_SetString(aout, kRmsVariable, "");
+	var_SetFloat(aout, kMomentaryLoudnessVariable, LevelMeter::kSilenceLoudness);
+	var_SetFloat(aout, kShortTermLoudnessVariable, LevelMeter::kSilenceLoudness);
+	var_SetInteger(aout, kClippedBlocksVariable, 0);
+
+	if (!StartAudioProcessThread(sys))
 		return VLC_EGENERIC;
-	}
+
+	sys->next_statistics_report_ = QpcNow() + kStatisticsReportSeconds * sys->qpc_frequency_.QuadPart;
 
 	VolumeSet(aout, sys->volume_);
 	MuteSet(aout, sys->mute_);
 
+	LARGE_INTEGER end_qpc;
+	QueryPerformanceCounter(&end_qpc);
+	msg_Dbg(aout, "started in %" PRId64 "us", static_cast<int64_t>((end_qpc.QuadPart - start_qpc.QuadPart) * 1000 * 1000 / sys->qpc_frequency_.QuadPart));
+
 	return VLC_SUCCESS;
 }
 
@@ -214,53 +493,24 @@ VLC_EXTERN void Stop(audio_output_t *aout)
 {
 	aout_sys_t *sys = aout->sys;
 
-	SetEvent(sys->events_[aout_sys_t::kStopRequest]);
-	sys->audio_process_thread_.join();
+	sys->trace_.Record(TraceEvent::kStop, QpcNow(), 0);
+	StopAudioProcessThread(sys);
 
-	while (!sys->audio_data_queue_.empty())
-	{
-		block_Release(sys->audio_data_queue_.front());
-		sys->audio_data_queue_.pop();
-	}
+	// ~ɓ͂R}h͊Ȃ܂ܔĵŁAʂ͊m߂Ȃ
+	sys->volume_result_ = std::future<HRESULT>();
 
-	std::for_each(sys->events_.begin(), sys->events_.end(),
-		[](HANDLE h)
-		{
-			CloseHandle(h);
-		}
-	);
+	DumpTrace(aout);
 }
 
 VLC_EXTERN int TimeGet(audio_output_t *aout, mtime_t *delay)
 {
 	aout_sys_t *sys = aout->sys;
+	int64_t value;
 
-	SetEvent(sys->events_[aout_sys_t::kGetPositionRequest]);
-	WaitForSingleObject(sys->events_[aout_sys_t::kGetPositionCompleted], INFINITE);
-	if (FAILED(sys->thread_request_result_))
+	if (!GetDelay(sys, QpcNow(), &value))
 		return VLC_EGENERIC;
 
-	sys->mutex_.lock();
-	const int64_t total_frames = sys->frames_written_ + sys->audio_data_frames_;
-	sys->mutex_.unlock();
-
-	const int64_t frequency = sys->input_format_.i_rate;
-	const int64_t total_sec = total_frames / frequency;
-	const int64_t total_micro_sec = ((total_frames % frequency) * 1000 * 1000) / frequency;
-
-	*delay = (total_sec - sys->device_second_position_) * 1000 * 1000;
-	*delay += total_micro_sec;
-	*delay -= sys->device_micro_socond_position_;
-
-	LARGE_INTEGER perf_count;
-	QueryPerformanceCounter(&perf_count);
-	if (perf_count.QuadPart <= sys->qpc_position)
-		return VLC_SUCCESS;
-
-	const UINT64 between_qpc = perf_count.QuadPart - sys->qpc_position;
-	const UINT64 between_delay = (between_qpc * 1000 * 1000) / sys->qpc_frequency_.QuadPart;
-
-	*delay -= between_delay;
+	*delay = value;
 
 	return VLC_SUCCESS;
 }
@@ -269,12 +519,56 @@ VLC_EXTERN void Play(audio_output_t *aout, block_t *block)
 {
 	aout_sys_t *sys = aout->sys;
 
+	const unsigned frames = block->i_nb_samples;
+	const mtime_t pts = block->i_pts;
+	const LONGLONG arrival_qpc = sys->trace_.Enabled()? QpcNow(): 0;
+
+	ReleaseRetiredBlocks(sys);
+
+	// ̏o͂́A]̑ 0 Ŗ߂
+	const uint32_t active_objects = ScanAudioDataBlock(sys, block);
+	sys->played_samples_ += static_cast<int64_t>(frames) * sys->output_channels_;
+	sys->silent_samples_ += static_cast<int64_t>(frames) * (sys->output_channels_ - CountObjects(active_objects));
+
+	// ϊăOɏAubN͂vȂBOt̂Ƃ́AI[fBIXbh܂ő҂B
+	// L[ƓAi܂ȂΏȂĉĂĖ߂B
+	if (sys->convert_on_play_)
+	{
+		LONGLONG deadline_qpc = 0;
+		int64_t waited_frames = 0;
+		const size_t dropped_frames = ConvertAudioDataBlock(sys, block, active_objects, [&]() { return WaitForConsumer(sys, &deadline_qpc, &waited_frames); });
+
+		block_Release(block);
+		if (dropped_frames)
+			DropBlock(aout, static_cast<unsigned>(dropped_frames), sys->render_failed_.load(std::memory_order_relaxed));
+
+		sys->trace_.Record(TraceEvent::kPlay, arrival_qpc, frames, pts, sys->audio_data_frames_.load(std::memory_order_relaxed));
+		ReportStatistics(aout);
+		return;
+	}
+
+	// L[t̂Ƃ́AI[fBIXbh܂ő҂Bi܂Ȃ΁AubN̂ĂĖ߂B
+	LONGLONG deadline_qpc = 0;
+	int64_t waited_frames = 0;
+
+	while (!sys->audio_data_queue_.Push(QueuedBlock<block_t> {block, active_objects}))
 	{
-		std::lock_guard lock(sys->mutex_);
+		if (!WaitForConsumer(sys, &deadline_qpc, &waited_frames))
+		{
+			block_Release(block);
+			DropBlock(aout, frames, sys->render_failed_.load(std::memory_order_relaxed));
+			ReportStatistics(aout);
+			return;
+		}
 
-		sys->audio_data_queue_.push(block);
-		sys->audio_data_frames_ += block->i_nb_samples;
+		ReleaseRetiredBlocks(sys);
 	}
+
+	// Push  block ̏LI[fBIXbhɈڂ邽߁At[ pts ͎OɎ擾Ă
+	const int64_t queued_frames = sys->audio_data_frames_.fetch_add(frames, std::memory_order_release) + frames;
+	sys->trace_.Record(TraceEvent::kPlay, arrival_qpc, frames, pts, queued_frames);
+
+	ReportStatistics(aout);
 }
 
 VLC_EXTERN void Pause(audio_output_t *aout, bool pause, mtime_t date)
@@ -282,9 +576,7 @@ VLC_EXTERN void Pause(audio_output_t *aout, bool pause, mtime_t date)
 	UNREFERENCED_PARAMETER(date);
 	aout_sys_t *sys = aout->sys;
 
-	sys->pause_ = pause;
-	SetEvent(sys->events_[aout_sys_t::kPauseRequest]);
-	WaitForSingleObject(sys->events_[aout_sys_t::kPauseCompleted], INFINITE);
+	PostCommand(sys, AudioCommand::kPause, 0.0f, pause);
 }
 
 VLC_EXTERN void Flush(audio_output_t *aout, bool wait)
@@ -293,6 +585,9 @@ VLC_EXTERN void Flush(audio_output_t *aout, bool wait)
 
 	if (wait)
 	{
+		// ǂ݂̖ڕWɑȂI̕o悤A҂Oɒm点
+		PostCommand(sys, AudioCommand::kDrain, 0.0f, false).wait();
+
 		mtime_t delay = 0;
 
 		if ((VLC_SUCCESS == TimeGet(aout, &delay)) && delay)
@@ -300,8 +595,11 @@ VLC_EXTERN void Flush(audio_output_t *aout, bool wait)
 	}
 	else
 	{
-		SetEvent(sys->events_[aout_sys_t::kFlushRequest]);
-		WaitForSingleObject(sys->events_[aout_sys_t::kFlushCompleted], INFINITE);
+		// Ȍ Play() Őς܂ꂽubN̂ĂȂ悤AtbV̊͑҂
+		PostCommand(sys, AudioCommand::kFlush, 0.0f, false).wait();
+
+		// ̂ĂubN͎ Play() ҂ɉ
+		ReleaseRetiredBlocks(sys);
 	}
 }
 
@@ -318,13 +616,11 @@ VLC_EXTERN int VolumeSet(audio_output_t *aout, float volume)
 	if (!sys->thread_initialized_)
 		return VLC_EGENERIC;
 
-	SetEvent(sys->events_[aout_sys_t::kVolumeRequest]);
-	WaitForSingleObject(sys->events_[aout_sys_t::kVolumeCompleted], INFINITE);
+	// ʂ̕ύX͎̕`œKp̂ŁA͑҂ȂBs͎ VolumeSet / MuteSet ŕԂB
+	const int result = TakeVolumeResult(aout);
+	sys->volume_result_ = PostCommand(sys, AudioCommand::kVolume, sys->volume_, false);
 
-	if (FAILED(sys->thread_request_result_))
-		return VLC_EGENERIC;
-
-	return VLC_SUCCESS;
+	return result;
 }
 
 VLC_EXTERN int MuteSet(audio_output_t *aout, bool mute)
@@ -340,13 +636,10 @@ VLC_EXTERN int MuteSet(audio_output_t *aout, bool mute)
 	if (!sys->thread_initialized_)
 		return VLC_EGENERIC;
 
-	SetEvent(sys->events_[aout_sys_t::kVolumeRequest]);
-	WaitForSingleObject(sys->events_[aout_sys_t::kVolumeCompleted], INFINITE);
+	const int result = TakeVolumeResult(aout);
+	sys->volume_result_ = PostCommand(sys, AudioCommand::kMute, 0.0f, sys->mute_);
 
-	if (FAILED(sys->thread_request_result_))
-		return VLC_EGENERIC;
-
-	return VLC_SUCCESS;
+	return result;
 }
 
 VLC_EXTERN int DeviceSelect(audio_output_t *aout, const char *id)
@@ -362,73 +655,321 @@ VLC_EXTERN int DeviceSelect(audio_output_t *aout, const char *id)
 	return VLC_SUCCESS;
 }
 
-static unsigned MakeChannelReorderTable(uint8_t *table, uint16_t physical_channels)
+// VLC ̍\`lɑΉÓIIuWFNg
+static uint32_t ChannelsToObjects(uint16_t physical_channels)
+{
+	uint32_t objects = 0;
+
+	for (size_t i=0; i<std::size(kOutputChannelOrder); ++i)
+	{
+		if (physical_channels & kOutputChannelOrder[i])
+			objects |= ObjectBit(kOutputChannelObjects[i]);
+	}
+
+	return objects;
+}
+
+static DeinterleaveFunction SelectLayoutDeinterleaveFunction(uint16_t physical_channels)
+{
+	for (const auto& layout: kChannelLayouts)
+	{
+		if (layout.mask == physical_channels)
+			return layout.deinterleave;
+	}
+
+	return nullptr;
+}
+
+// ͂̍\`lɑ΂sAo͂IuWFNgԂB
+// s͏o͂IuWFNg̏ (ObjectChannel ̏)A kInputChannelOrder (VLC ̃C^[[u) ̂Aꂼꑶ݂̂̏ɕԁB
+// s|KvȂ false ԂB
+static bool MakeMixMatrix(MixMode mode, uint16_t input_channels, uint32_t *output_objects, float *matrix)
 {
-	static constexpr uint32_t output_order[] =
+	const bool fold_down = (MixMode::kOff != mode) && (input_channels & AOUT_CHAN_REARCENTER);
+	const bool upmix = (MixMode::kStereoUpmix <= mode) && (AOUT_CHANS_2_0 == (input_channels & ~AOUT_CHAN_LFE));
+	const bool height = (MixMode::kHeightUpmix == mode) && (AOUT_CHANS_2_0 == (input_channels & AOUT_CHANS_2_0));
+
+	if (!fold_down && !upmix && !height)
+		return false;
+
+	uint32_t objects = ChannelsToObjects(input_channels);
+
+	if (fold_down)
+		objects = (objects & ~ObjectBit(ObjectChannel::kBackCenter))| ObjectBit(ObjectChannel::kBackLeft)| ObjectBit(ObjectChannel::kBackRight);
+	if (upmix)
+		objects |= kObjects7_1 & ~ObjectBit(ObjectChannel::kLowFrequency);
+	if (height)
+		objects |= kObjectsTop;
+
+	const unsigned in_count = CountLayoutChannels(input_channels);
+	auto row = [&](ObjectChannel object)
 	{
-		AOUT_CHAN_LEFT, AOUT_CHAN_RIGHT,
-		AOUT_CHAN_CENTER,
-		AOUT_CHAN_LFE,
-		AOUT_CHAN_REARLEFT, AOUT_CHAN_REARRIGHT,
-		AOUT_CHAN_MIDDLELEFT, AOUT_CHAN_MIDDLERIGHT
+		return matrix + ObjectIndex(objects, object) * in_count;
 	};
+	auto column = [&](uint32_t channel)
+	{
+		unsigned index = 0;
+
+		for (uint32_t c: kInputChannelOrder)
+		{
+			if (c == channel)
+				break;
+
+			if (input_channels & c)
+				++index;
+		}
+
+		return index;
+	};
+
+	std::fill_n(matrix, CountObjects(objects) * in_count, 0.0f);
+
+	// o͂ɂ`l͂̂܂ܒʂ
+	for (size_t i=0; i<std::size(kOutputChannelOrder); ++i)
+	{
+		if ((input_channels & kOutputChannelOrder[i]) && (objects & ObjectBit(kOutputChannelObjects[i])))
+			row(kOutputChannelObjects[i])[column(kOutputChannelOrder[i])] += 1.0f;
+	}
+
+	if (fold_down)
+	{
+		for (const auto& term: kFoldDownTerms)
+			row(term.output)[column(term.input)] += term.gain;
+	}
 
-	return aout_CheckChannelReorder(nullptr, output_order, physical_channels, table);
+	if (upmix)
+	{
+		for (const auto& term: kStereoUpmixTerms)
+			row(term.output)[column(term.input)] += term.gain;
+	}
+
+	// ́ÃIuWFNg̍sĂ
+	if (height)
+	{
+		for (const auto& term: kHeightUpmixTerms)
+		{
+			const ObjectChannel source = (objects & ObjectBit(term.source))? term.source: term.fallback;
+			if (!(objects & ObjectBit(source)))
+				continue;
+
+			const float *source_row = row(source);
+			float *output_row = row(term.output);
+
+			for (unsigned in=0; in<in_count; ++in)
+				output_row[in] += source_row[in] * term.gain;
+		}
+	}
+
+	*output_objects = objects;
+
+	return true;
+}
+
+// O񑗂ʁE~[g̃R}hĂ΁ǍʂԂB
+// ĂȂΑ҂ VLC_SUCCESS ԂB܂ĂȂΎ̃R}hƂ܂Ƃ߂ēKpAʂɂȂB
+static int TakeVolumeResult(audio_output_t *aout)
+{
+	aout_sys_t *sys = aout->sys;
+
+	if (!sys->volume_result_.valid() || (std::future_status::ready != sys->volume_result_.wait_for(std::chrono::seconds(0))))
+		return VLC_SUCCESS;
+
+	const HRESULT result = sys->volume_result_.get();
+	if (SUCCEEDED(result))
+		return VLC_SUCCESS;
+
+	msg_Err(aout, "failed to set the volume (0x%08lx)", static_cast<unsigned long>(result));
+
+	return VLC_EGENERIC;
+}
+
+// Play() ŃL[⃊O󂭂̂1 (1ms) ҂B deadline_qpc  queued_frames  0 ɂČĂԂƁB
+// `̍XVɎsĂꍇƁA1 Wait Timeout ̊Ԃɏi܂Ȃꍇ (o͂̒~Eꎞ~) ́A҂ false ԂB
+// ҂ VLC ̏o͂̃Xbh߂ꂸAStop() Ă΂ȂȂB
+static bool WaitForConsumer(aout_sys_t *sys, LONGLONG *deadline_qpc, int64_t *queued_frames)
+{
+	if (sys->render_failed_.load(std::memory_order_relaxed))
+		return false;
+
+	const LONGLONG now = QpcNow();
+	const int64_t queued = sys->audio_data_frames_.load(std::memory_order_relaxed);
+
+	// iޓxɊ΂
+	if (!*deadline_qpc || (queued < *queued_frames))
+	{
+		const LONGLONG frequency = sys->qpc_frequency_.QuadPart;
+		const LONGLONG period = static_cast<LONGLONG>(sys->period_frames_.load(std::memory_order_relaxed)) * frequency / sys->output_format_.nSamplesPerSec;
+
+		*deadline_qpc = now + period + static_cast<LONGLONG>(sys->wait_timeout_) * frequency / 1000;
+	}
+	else if (now >= *deadline_qpc)
+	{
+		return false;
+	}
+
+	*queued_frames = queued;
+	Sleep(1);
+
+	return true;
+}
+
+// I[fBIXbhȂ߂ɐς߂Ȃ frames t[̂ĂƂAO VLC ̕ϐɏo
+static void DropBlock(audio_output_t *aout, unsigned frames, bool render_failed)
+{
+	aout_sys_t *sys = aout->sys;
+
+	++sys->dropped_blocks_;
+	msg_Warn(aout, "dropped %u frames: the audio thread %s", frames, render_failed? "failed to render": "stopped consuming");
+	var_SetInteger(aout, kDroppedBlocksVariable, sys->dropped_blocks_);
 }
 
-static void MakeDeviceIdTable(std::vector<std::string>& ids, std::vector<std::string>& descs)
+// I[fBIXbhvAωƂ VLC ̕ϐɔf
+static void ReportStatistics(audio_output_t *aout)
 {
-	std::thread t([&]()
+	aout_sys_t *sys = aout->sys;
+
+	const int64_t underruns = sys->underruns_.load(std::memory_order_relaxed);
+	if (underruns != sys->reported_underruns_)
+	{
+		sys->reported_underruns_ = underruns;
+		var_SetInteger(aout, kUnderrunsVariable, underruns);
+	}
+
+	const int64_t padded_frames = sys->padded_frames_.load(std::memory_order_relaxed);
+	if (padded_frames != sys->reported_padded_frames_)
+	{
+		sys->reported_padded_frames_ = padded_frames;
+		var_SetInteger(aout, kPaddedFramesVariable, padded_frames);
+	}
+
+	const int64_t prebuffer_target = sys->prebuffer_target_.load(std::memory_order_relaxed);
+	if (prebuffer_target != sys->reported_prebuffer_target_)
+	{
+		sys->reported_prebuffer_target_ = prebuffer_target;
+		var_SetInteger(aout, kPrebufferFramesVariable, prebuffer_target);
+	}
+
+	// o͂̉ʂ́AI[fBIXbhԂ؂x (100ms ) ɔf
+	if (MeterMode::kOff != sys->meter_mode_)
+	{
+		const LevelMeter::Snapshot levels = sys->level_meter_.Load();
+		if (levels.blocks != sys->reported_meter_blocks_)
 		{
-			if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED| COINIT_DISABLE_OLE1DDE)))
-				return;
-
-			try
-			{
-				wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
-				wil::com_ptr<IMMDeviceCollection> device_collection;
-				UINT devices;
-
-				device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>();
-				THROW_IF_FAILED(device_enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, device_collection.put()));
-				THROW_IF_FAILED(device_collection->GetCount(&devices));
-
-				for (UINT item_index=0; item_index<devices; ++item_index)
-				{
-					wil::com_ptr<IMMDevice> device;
-					wil::unique_cotaskmem_string device_id;
-					wil::com_ptr<IPropertyStore> properties;
-					wil::unique_prop_variant friendly_name;
-
-					THROW_IF_FAILED(device_collection->Item(item_index, &device));
-					THROW_IF_FAILED(device->GetId(device_id.put()));
-					THROW_IF_FAILED(device->OpenPropertyStore(STGM_READ, properties.put()));
-					THROW_IF_FAILED(properties->GetValue(PKEY_Device_FriendlyName, &friendly_name));
-
-					ids.push_back(CreateUtf8StringFromWideCharString(device_id.get()));
-					descs.push_back(CreateUtf8StringFromWideCharString(friendly_name.pwszVal));
-				}
-			}
-			catch (wil::ResultException& e)
-			{
-			}
-
-			CoUninitialize();
-		});
-
-	t.join();
+			sys->reported_meter_blocks_ = levels.blocks;
+			var_SetString(aout, kPeakVariable, FormatLevels(levels.peak, levels.channels).c_str());
+			var_SetString(aout, kRmsVariable, FormatLevels(levels.rms, levels.channels).c_str());
+			var_SetFloat(aout, kMomentaryLoudnessVariable, levels.momentary);
+			var_SetFloat(aout, kShortTermLoudnessVariable, levels.short_term);
+			var_SetInteger(aout, kClippedBlocksVariable, static_cast<int64_t>(levels.clipped_blocks));
+		}
+	}
+
+	// qXgȌWv͏d̂ŁAԊuł̂ݍs
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	if (now.QuadPart < sys->next_statistics_report_)
+		return;
+
+	sys->next_statistics_report_ = now.QuadPart + kStatisticsReportSeconds * sys->qpc_frequency_.QuadPart;
+
+	for (const auto& variable: kStatisticsVariables)
+	{
+		const LogHistogram::Snapshot snapshot = (sys->statistics_.*variable.histogram).Load();
+		const std::string summary = FormatHistogram(snapshot, variable.qpc? sys->qpc_frequency_.QuadPart: 0);
+
+		var_SetString(aout, variable.name, summary.c_str());
+		msg_Dbg(aout, "%s: %s", variable.name, summary.c_str());
+	}
+
+	const ClockSnapshot clock = sys->clock_snapshot_.Load();
+	var_SetFloat(aout, kClockDriftVariable, clock.drift_ppm);
+	var_SetFloat(aout, kDelayVarianceVariable, clock.delay_variance);
+
+	const int64_t trimmed_frames = sys->trimmed_frames_.load(std::memory_order_relaxed);
+	var_SetInteger(aout, kTrimmedFramesVariable, trimmed_frames);
+
+	// ] 0 Ŗ߂o͂̃Tv̊
+	const float silent_ratio = sys->played_samples_? static_cast<float>(static_cast<double>(sys->silent_samples_) / sys->played_samples_): 0.0f;
+	var_SetFloat(aout, kSilentRatioVariable, silent_ratio);
+
+	msg_Dbg(aout, "underruns: %" PRId64 ", padded frames: %" PRId64 ", prebuffer frames: %" PRId64 ", clock drift: %.2fppm, delay variance: %.1fus^2, trimmed frames: %" PRId64 ", silent: %.1f%%",
+		underruns, padded_frames, prebuffer_target, clock.drift_ppm, clock.delay_variance, trimmed_frames, silent_ratio * 100.0f);
+}
+
+// EρElE99p[Z^CEől1sɂ܂Ƃ߂B
+// qpc_frequency  0 łȂ΁AQPC ̃JEg}CNbɊZB
+// p[Z^C̓oPbg̏Ȃ̂ŁAۂ̒lȏɂȂB
+static std::string FormatHistogram(const LogHistogram::Snapshot& snapshot, LONGLONG qpc_frequency)
+{
+	auto convert = [qpc_frequency](uint64_t value) -> uint64_t
+	{
+		return qpc_frequency? (value * 1000 * 1000) / qpc_frequency: value;
+	};
+
+	char summary[160];
+	snprintf(summary, sizeof (summary), "n=%" PRIu64 " mean=%" PRIu64 " p50<=%" PRIu64 " p99<=%" PRIu64 " max=%" PRIu64 "%s",
+		snapshot.count,
+		snapshot.count? convert(snapshot.sum / snapshot.count): 0,
+		convert(snapshot.Percentile(0.5)),
+		convert(snapshot.Percentile(0.99)),
+		convert(snapshot.max),
+		qpc_frequency? "us": "");
+
+	return summary;
+}
+
+// tXP[ 1.0 Ƃ`l̒lAdBFS (1) 󔒂ŋ؂ɂB LevelMeter::kSilenceLoudness ƓɂB
+static std::string FormatLevels(const float *levels, unsigned channels)
+{
+	std::string text;
+
+	for (unsigned channel=0; channel<channels; ++channel)
+	{
+		const float db = (levels[channel] > 0.0f)? std::max(20.0f * std::log10(levels[channel]), LevelMeter::kSilenceLoudness): LevelMeter::kSilenceLoudness;
+		char value[16];
+
+		snprintf(value, sizeof (value), channel? " %.1f": "%.1f", db);
+		text += value;
+	}
+
+	return text;
+}
+
+static int TraceDumpCallback(vlc_object_t *obj, const char *name, vlc_value_t old_value, vlc_value_t new_value, void *data)
+{
+	UNREFERENCED_PARAMETER(name);
+	UNREFERENCED_PARAMETER(old_value);
+	UNREFERENCED_PARAMETER(new_value);
+	UNREFERENCED_PARAMETER(data);
+
+	DumpTrace(reinterpret_cast<audio_output_t *>(obj));
+
+	return VLC_SUCCESS;
 }
 
-static std::string CreateUtf8StringFromWideCharString(LPCWCH wide_char_string)
+// g[X mss-trace-file ɏoBL^ƕsČĂł悢B
+static void DumpTrace(audio_output_t *aout)
 {
-	int result_chars = WideCharToMultiByte(CP_UTF8, 0, wide_char_string, -1, nullptr, 0, nullptr, nullptr);
-	if (!result_chars)
-		return std::string();
+	aout_sys_t *sys = aout->sys;
+
+	if (!sys->trace_.Enabled() || sys->trace_path_.empty())
+		return;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	if (sys->trace_.Dump(sys->trace_path_.c_str(), frequency.QuadPart))
+		msg_Dbg(aout, "trace written to %s", sys->trace_path_.c_str());
+	else
+		msg_Err(aout, "failed to write trace to %s", sys->trace_path_.c_str());
+}
 
-	std::unique_ptr<CHAR []> buffer(new CHAR[result_chars]);
-	WideCharToMultiByte(CP_UTF8, 0, wide_char_string, -1, buffer.get(), result_chars, nullptr, nullptr);
+static LONGLONG QpcNow()
+{
+	LARGE_INTEGER count;
 
-	return std::string(buffer.get());
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
 }
 
 static std::wstring CreateWideCharStringFromUtf8String(LPCCH utf8_string)
@@ -443,43 +984,34 @@ static std::wstring CreateWideCharStringFromUtf8String(LPCCH utf8_string)
 	return std::wstring(buffer.get());
 }
 
-static void GetSupportedFormats(std::vector<WAVEFORMATEX>& formats, const std::wstring& device_id)
+// ͋[o͓͂͂̃TvO[ĝ܂܁AIuWFNg float ̃mŎ
+static void GetSimulatedFormats(std::vector<WAVEFORMATEX>& formats, unsigned rate)
 {
-	std::thread t([&]()
-		{
-			if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED| COINIT_DISABLE_OLE1DDE)))
-				return;
-
-			try
-			{
-				wil::com_ptr<IMMDeviceEnumerator> device_enumerator;
-				wil::com_ptr<IMMDevice> device;
-				wil::com_ptr<ISpatialAudioClient> client;
-				wil::com_ptr<IAudioFormatEnumerator> enumerator;
-				UINT32 format_counts;
-
-				device_enumerator = wil::CoCreateInstance<MMDeviceEnumerator, IMMDeviceEnumerator>(CLSCTX_INPROC_SERVER);
-				THROW_IF_FAILED(device_enumerator->GetDevice(device_id.c_str(), device.put()));
-				THROW_IF_FAILED(device->Activate(__uuidof(ISpatialAudioClient), CLSCTX_INPROC_SERVER, nullptr, client.put_void()));
-				THROW_IF_FAILED(client->GetSupportedAudioObjectFormatEnumerator(enumerator.put()));
-				THROW_IF_FAILED(enumerator->GetCount(&format_counts));
-
-				for (UINT32 index=0; index<format_counts; ++index)
-				{
-					WAVEFORMATEX *format;
-
-					if (SUCCEEDED(enumerator->GetFormat(index, &format)))
-						formats.push_back(*format);
-				}
-			}
-			catch (wil::ResultException& e)
-			{
-			}
-		
-			CoUninitialize();
-		});
-
-	t.join();
+	WAVEFORMATEX format {};
+
+	format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+	format.nChannels = 1;
+	format.nSamplesPerSec = rate;
+	format.wBitsPerSample = 32;
+	format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+	format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+	format.cbSize = 0;
+
+	formats.push_back(format);
+}
+
+static void InheritSimulationSettings(audio_output_t *aout, SimulationSettings *settings)
+{
+	settings->period_frames = static_cast<unsigned>(var_InheritInteger(aout, kSimulationPeriodConfig));
+	settings->period_variation = var_InheritFloat(aout, kSimulationPeriodVariationConfig);
+	settings->jitter = var_InheritInteger(aout, kSimulationJitterConfig) / (1000.0 * 1000.0);
+	settings->drift_ppm = var_InheritFloat(aout, kSimulationDriftConfig);
+	settings->speed = var_InheritFloat(aout, kSimulationSpeedConfig);
+
+	vlc_value_t value;
+	var_Inherit(aout, kSimulationCaptureConfig, VLC_VAR_STRING, &value);
+	settings->capture_path = value.psz_string? value.psz_string: "";
+	msvcrt_free(value.psz_string);
 }
 
 static vlc_fourcc_t WaveFormatToVlcFourcc(const WAVEFORMATEX& wave_format)
@@ -514,6 +1046,30 @@ static vlc_fourcc_t WaveFormatToVlcFourcc(const WAVEFORMATEX& wave_format)
 	return vlc_fourcc;
 }
 
+static bool VlcFourccToSampleFormat(vlc_fourcc_t fourcc, SampleFormat *format)
+{
+	switch (fourcc)
+	{
+	case VLC_CODEC_FL32:
+		*format = SampleFormat::kFloat32;
+		return true;
+
+	case VLC_CODEC_S16N:
+		*format = SampleFormat::kSigned16;
+		return true;
+
+	case VLC_CODEC_S24N:
+		*format = SampleFormat::kSigned24;
+		return true;
+
+	case VLC_CODEC_S32N:
+		*format = SampleFormat::kSigned32;
+		return true;
+	}
+
+	return false;
+}
+
 
 vlc_module_begin()
 set_shortname("MSS")
@@ -525,8 +1081,30 @@ set_subcategory(SUBCAT_AUDIO_AOUT)
 add_string(kDeviceConfig, nullptr, "Output device", "", false)
 change_string_cb(ReloadAudioDevices)
 add_float_with_range(kVolumeConfig, 0.5f, 0.0f, 1.0f, "Audio volume", "", false)
+add_integer(kVolumeModeConfig, 0, "Volume mode", "Stream volume leaves the volume to the OS mixer. The software modes apply it while forwarding the audio data and ramp every change over one device period.", false)
+change_integer_list(kVolumeModeValues, kVolumeModeTexts)
 add_bool(kMuteConfig, false, "Audio mute", "", false)
 add_integer_with_range(kWaitTimeoutConfig, 10, 1, 100, "Wait Timeout Value", "", false)
+add_bool(kFastFlushConfig, true, "Fast Flush", "Keep the stream running on flush and only drop the queued data. The flush is applied without waiting for the next period, and the period already submitted but not yet playing is silenced through the stream volume; only the rest of the playing period is still heard. Only one period is prebuffered again afterwards. The stream is still reset while paused or after a device error.", false)
 add_integer_with_range(kFlushWaitConfig, 0, 0, 100, "Flush Wait", "Number of times the buffer is cleared when the callback function flush is called.", false)
 add_integer_with_range(kStopWaitConfig, 10, 0, 100, "Stop Wait", "Number of times the buffer is cleared when the callback function stop is called.", false)
+add_float_with_range(kUnderrunProbabilityConfig, 0.001f, 0.0f, 0.5f, "Underrun Probability", "Acceptable probability of an underrun per device period. The prebuffer depth is adapted to keep it. 0 disables prebuffering.", false)
+add_integer(kMixConfig, 0, "Channel mixing", "Mix channel layouts inside the plugin instead of leaving it to VLC. Fold down maps the rear center to the rear pair. Stereo upmix also spreads stereo over all 7.1 objects. Height upmix also feeds the four top objects (7.1.4) from the front and rear pairs.", false)
+change_integer_list(kMixValues, kMixTexts)
+add_integer(kResamplerConfig, 0, "Resampler", "Convert the sample rate to the device rate while forwarding instead of leaving it to VLC. Low latency, Balanced and High quality use 16, 32 and 64 tap filters.", false)
+change_integer_list(kResamplerValues, kResamplerTexts)
+add_bool(kConvertOnPlayConfig, false, "Convert on Play", "Convert and reorder samples when VLC delivers them and release the blocks at once. The audio thread then only copies each object per device period.", false)
+add_integer_with_range(kLatencyTargetConfig, 0, 0, 5000, "Latency Target", "Milliseconds of queued audio to keep. When the queue grows beyond it, playback is sped up by up to 10% without changing the pitch until the queue is back at the target. 0 disables it. With the built-in resampler the conversion ratio is raised by up to 0.2% instead, so the queue shrinks more slowly.", false)
+add_integer(kBackendConfig, 0, "Backend", "Simulated replaces the spatial sound stream with a virtual device for throughput and latency testing. Nothing is audible.", false)
+change_integer_list(kBackendValues, kBackendTexts)
+add_integer_with_range(kSimulationPeriodConfig, 480, 16, 48000, "Simulation Period", "Number of frames per device period of the simulated backend.", false)
+add_float_with_range(kSimulationPeriodVariationConfig, 0.0f, 0.0f, 0.9f, "Simulation Period Variation", "Maximum fraction by which each device period of the simulated backend is shortened at random. 0 keeps every period at Simulation Period.", false)
+add_integer_with_range(kSimulationJitterConfig, 0, 0, 100000, "Simulation Jitter", "Standard deviation in microseconds of the delay added to each device period of the simulated backend.", false)
+add_float_with_range(kSimulationDriftConfig, 0.0f, -1000.0f, 1000.0f, "Simulation Drift", "Clock drift of the simulated device in ppm. Positive values make the device run fast.", false)
+add_float_with_range(kSimulationSpeedConfig, 1.0f, 0.0f, 1000.0f, "Simulation Speed", "Speed of the simulated device relative to real time. 0 starts the next period as soon as the previous one is written.", false)
+add_string(kSimulationCaptureConfig, nullptr, "Simulation Capture", "File that receives the output of the simulated backend as interleaved 32-bit float. Empty disables capturing.", false)
+add_integer(kMeterConfig, 0, "Output meter", "Measure the per-object peak and RMS of the output and publish them every 100 ms in the mss-peak, mss-rms and mss-clipped-blocks variables. On AVX2 and AVX-512 CPUs they are measured while forwarding at a small cost; on older CPUs and with Convert on Play, the resampler or the latency target the output is read again, adding roughly 30-100% to the forwarding time. The loudness mode also computes the EBU R128 momentary and short-term loudness (mss-loudness-momentary, mss-loudness-short-term), which takes several times longer than the forwarding itself.", false)
+change_integer_list(kMeterValues, kMeterTexts)
+add_integer_with_range(kTraceSizeConfig, 0, 0, 16777216, "Trace Size", "Number of events kept in the binary trace ring (Play arrivals, device periods, positions, flushes and pauses). Older events are overwritten. 0 disables tracing.", false)
+add_string(kTraceFileConfig, nullptr, "Trace File", "File that receives the binary trace on stop and whenever the mss-trace-dump variable is triggered. Empty disables writing.", false)
 vlc_module_end()
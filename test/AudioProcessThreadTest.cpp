@@ -0,0 +1,263 @@
+// I[fBIXbh͋[o͂ɑ΂ēeXgB
+// Windows / VLC ȂŃrhł (Win32 API  PortableWin32.cppAVLC  test/vlc ̑g)B
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc -Itest/vlc test/AudioProcessThreadTest.cpp src/AudioProcessThread.cpp src/SimulatedBackend.cpp src/PortableWin32.cpp src/VirtualAudioDevice.cpp src/ClockModel.cpp src/PrebufferController.cpp src/Resampler.cpp src/TimeStretcher.cpp src/ForwardKernels.cpp src/LevelMeter.cpp src/TraceRecorder.cpp -o audio_process_thread_test
+//   ./audio_process_thread_test
+//
+// Start() / Stop() Ɠ StartAudioProcessThread() / StopAudioProcessThread() ŃXbh𓮂APlay() Ɠ悤ɃubNςŁA
+// SẴTvɏo͂邱ƁAʁEꎞ~EtbVEhC̃R}h邱ƁAꎞ~͏o͂i܂ȂƁA
+// SẴubN邱Ƃm߂Bo͖͂͋[o͂̏oœǂݒB
+// sΓeo͂ 1 ԂB
+
+#include "AudioProcessThread.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr unsigned kRate = 48000;
+static constexpr unsigned kChannels = 2;
+static constexpr unsigned kBlockFrames = 480;
+
+// ߂̋Ԃ̃Tv 1 AtbVŎ̂ĂԂ̃Tv kFlushedBase 琔
+static constexpr unsigned kPlayedBlocks = 50;
+static constexpr float kFlushedBase = 1000000.0f;
+
+static int failures = 0;
+static int released_blocks = 0;
+
+void block_Release(block_t *)
+{
+	++released_blocks;
+}
+
+static void Check(bool condition, const char *what, unsigned line)
+{
+	if (condition)
+		return;
+
+	printf("line %u: %s\n", line, what);
+	++failures;
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+// ͋[o͂Ԃ4{Ői߂BStart() ̐ݒōŝƓݒɂB
+static void Configure(aout_sys_t *sys, const std::string& capture_path)
+{
+	const SimdLevel level = DetectSimdLevel();
+
+	sys->input_format_ = {};
+	sys->input_format_.i_rate = kRate;
+	sys->input_format_.i_channels = kChannels;
+	sys->input_format_.i_bytes_per_frame = kChannels * sizeof(float);
+	sys->output_format_ = {};
+	sys->output_format_.nSamplesPerSec = kRate;
+	sys->output_format_.nChannels = kChannels;
+
+	sys->mix_mode_ = MixMode::kOff;
+	sys->mix_ = nullptr;
+	sys->output_objects_ = ObjectBit(ObjectChannel::kFrontLeft)| ObjectBit(ObjectChannel::kFrontRight);
+	sys->output_channels_ = kChannels;
+	sys->channel_reorder_table_ = {0, 1};
+	sys->deinterleave_ = SelectDeinterleaveFunction(level, SampleFormat::kFloat32);
+	sys->scan_silence_ = SelectScanSilenceFunction(level, SampleFormat::kFloat32);
+	sys->output_sources_ = {1, 2};
+	sys->convert_on_play_ = false;
+	sys->resampler_quality_ = ResamplerQuality::kOff;
+
+	sys->meter_mode_ = MeterMode::kLevels;
+	sys->measure_levels_ = SelectMeasureLevelsFunction(level);
+	sys->level_meter_.Reset(sys->output_objects_, kRate, false);
+
+	sys->backend_type_ = BackendType::kSimulated;
+	sys->simulation_ = SimulationSettings {kBlockFrames, 0.0, 0.0, 0.0, 4.0, capture_path};
+	sys->wait_timeout_ = 10;
+	sys->fast_flush_ = true;
+	sys->flush_wait_ = 0;
+	sys->stop_wait_ = 10;
+	sys->underrun_probability_ = 0.001;
+	sys->latency_target_frames_ = 0;
+	sys->volume_mode_ = VolumeMode::kLinearRamp;
+	sys->volume_ = 1.0f;
+	sys->mute_ = false;
+}
+
+// Play() Ɠ菇ŃubNς
+static void Play(aout_sys_t *sys, block_t *block)
+{
+	ReleaseRetiredBlocks(sys);
+
+	const uint32_t active_objects = ScanAudioDataBlock(sys, block);
+	while (!sys->audio_data_queue_.Push(QueuedBlock<block_t> {block, active_objects}))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	sys->audio_data_frames_.fetch_add(block->i_nb_samples, std::memory_order_release);
+}
+
+// Play() ̃XbhƂăubNȂA܂ōő 5 b҂
+static bool WaitUntil(aout_sys_t *sys, const std::function<bool()>& condition)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		ReleaseRetiredBlocks(sys);
+		if (condition())
+			return true;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return false;
+}
+
+// first 琔TvubNB`l 1 ̓`l 0 ̕𔽓]́B
+static void MakeBlocks(std::vector<block_t>& blocks, std::vector<float>& samples, float first)
+{
+	samples.resize(blocks.size() * kBlockFrames * kChannels);
+
+	for (size_t i=0; i<samples.size() / kChannels; ++i)
+	{
+		samples[i * kChannels] = first + static_cast<float>(i);
+		samples[i * kChannels + 1] = -(first + static_cast<float>(i));
+	}
+
+	for (size_t i=0; i<blocks.size(); ++i)
+	{
+		blocks[i] = {};
+		blocks[i].p_buffer = reinterpret_cast<uint8_t *>(samples.data() + i * kBlockFrames * kChannels);
+		blocks[i].i_buffer = kBlockFrames * kChannels * sizeof(float);
+		blocks[i].i_nb_samples = kBlockFrames;
+	}
+}
+
+// oꂽo͂珉߂̋Ԃ̃TvEA1 珇Ɍɕł邱Ƃm߂B
+// ǂ݂ƃA_[̖AtbVŎ̂ĂԂ̃Tv͔΂B
+static void CheckCapture(const std::string& path)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	CHECK(nullptr != file);
+	if (!file)
+		return;
+
+	float frame[kChannels];
+	float expected = 1.0f;
+	bool ordered = true;
+
+	while (kChannels == fread(frame, sizeof(float), kChannels, file))
+	{
+		if ((0.0f == frame[0]) || (frame[0] >= kFlushedBase))
+			continue;
+
+		if ((frame[0] != expected) || (frame[1] != -expected))
+		{
+			if (ordered)
+				printf("captured %g / %g where %g was expected\n", frame[0], frame[1], expected);
+
+			ordered = false;
+		}
+
+		expected = frame[0] + 1.0f;
+	}
+
+	fclose(file);
+	std::remove(path.c_str());
+
+	CHECK(ordered);
+	CHECK((kPlayedBlocks + 1) * kBlockFrames + 1 == expected);
+}
+
+int main()
+{
+	const std::string capture_path = (std::filesystem::temp_directory_path() / "audio_process_thread_test.f32").string();
+	std::unique_ptr<aout_sys_t> sys = std::make_unique<aout_sys_t>();
+	std::vector<block_t> played(kPlayedBlocks);
+	std::vector<block_t> flushed(kPlayedBlocks);
+	std::vector<block_t> tail(1);
+	std::vector<float> played_samples;
+	std::vector<float> flushed_samples;
+	std::vector<float> tail_samples;
+
+	MakeBlocks(played, played_samples, 1.0f);
+	MakeBlocks(flushed, flushed_samples, kFlushedBase);
+	MakeBlocks(tail, tail_samples, kPlayedBlocks * kBlockFrames + 1.0f);
+	Configure(sys.get(), capture_path);
+
+	if (!StartAudioProcessThread(sys.get()))
+	{
+		printf("the audio thread failed to start\n");
+		return 1;
+	}
+
+	// ̊ʒmAĐn߂ GetPosition() ōĐʒuJ
+	CHECK(WaitUntil(sys.get(), [&]() { return SUCCEEDED(sys->clock_snapshot_.Load().result); }));
+
+	for (auto& block: played)
+		Play(sys.get(), &block);
+
+	// g؂ubN͎̓]tbVŉ̂ŁAŌ1͂܂L[ɎcĂĂ悢
+	CHECK(WaitUntil(sys.get(), [&]() { return 0 == sys->audio_data_frames_.load(); }));
+	CHECK(released_blocks >= static_cast<int>(kPlayedBlocks) - 1);
+	CHECK(sys->frames_written_.load() >= static_cast<int64_t>(kPlayedBlocks * kBlockFrames));
+
+	// ݍς݂͍̎Đn܂ƂɏôŁAŌ̎̌2܂ő҂Ăꎞ~EtbV
+	CHECK(WaitUntil(sys.get(), [&]() { return sys->frames_written_.load() >= static_cast<int64_t>((kPlayedBlocks + 2) * kBlockFrames); }));
+
+	// ʂ̕ύX͎̕`Ŋ
+	std::future<HRESULT> volume = PostCommand(sys.get(), AudioCommand::kVolume, 0.5f, false);
+	CHECK(std::future_status::ready == volume.wait_for(std::chrono::seconds(5)));
+	CHECK(S_OK == volume.get());
+	PostCommand(sys.get(), AudioCommand::kVolume, 1.0f, false).wait();
+
+	// ꎞ~͕`Ȃ̂ŁAR}h͂ɓKpAo͂͐i܂Ȃ
+	PostCommand(sys.get(), AudioCommand::kPause, 0.0f, true).wait();
+	const int64_t paused_frames = sys->frames_written_.load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(paused_frames == sys->frames_written_.load());
+
+	// ꎞ~̃tbV̓Xg[ƃZbgAς񂾃ubNSĎ̂Ă
+	for (auto& block: flushed)
+		Play(sys.get(), &block);
+
+	PostCommand(sys.get(), AudioCommand::kFlush, 0.0f, false).wait();
+	ReleaseRetiredBlocks(sys.get());
+	CHECK(0 == sys->audio_data_frames_.load());
+	CHECK(0 == sys->frames_written_.load());
+	CHECK(2 * kPlayedBlocks == released_blocks);
+
+	PostCommand(sys.get(), AudioCommand::kPause, 0.0f, false).wait();
+	CHECK(WaitUntil(sys.get(), [&]() { return sys->frames_written_.load() > 0; }));
+
+	// tbV̐ǂ݂̖ڕWɑȂÍ̕Â܂܂ł̓L[ɎcAhCŏo
+	CHECK(sys->prebuffer_frames_.load() > static_cast<int64_t>(kBlockFrames));
+	const int64_t underruns = sys->underruns_.load();
+	Play(sys.get(), &tail[0]);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(kBlockFrames == sys->audio_data_frames_.load());
+
+	PostCommand(sys.get(), AudioCommand::kDrain, 0.0f, false).wait();
+	CHECK(WaitUntil(sys.get(), [&]() { return 0 == sys->audio_data_frames_.load(); }));
+	CHECK(underruns == sys->underruns_.load());
+
+	StopAudioProcessThread(sys.get());
+	CHECK(!sys->thread_initialized_);
+	CHECK(2 * kPlayedBlocks + 1 == released_blocks);
+
+	CheckCapture(capture_path);
+
+	if (failures)
+	{
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
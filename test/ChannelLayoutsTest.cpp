@@ -0,0 +1,229 @@
+// `l\̐p̓]֐ (ChannelLayouts.h  kChannelLayouts) ̒P̃eXgB
+// Windows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -Isrc test/ChannelLayoutsTest.cpp src/ForwardKernels.cpp -o channel_layouts_test
+//   ./channel_layouts_test
+//
+// e\ɂāAm߂B
+// - o k ɁAkOutputChannelOrder  k Ԗڂɂ VLC ̃`l̃Tv͂Ã`l̃IuWFNgo͐̃IuWFNg k ԖڂɂȂ邱ƁB
+//   ͂̒l̓`l̃rbĝŁAւ\̌o͂̏ႦΈvȂB
+// - ȍ\̕ւ\Aŏ\ƈv邱ƁB
+// - ]֐Aւ\n DeinterleaveScalar ƃrbgPʂňv邱 (̃t[Anullptr ̏óA{ƌv̗L܂)B
+// sΓeo͂ 1 ԂB
+
+#include "ChannelLayouts.h"
+#include "ForwardKernels.h"
+#include "ObjectLayout.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+static constexpr size_t kFrames = 37;
+static constexpr size_t kCompareFrameCounts[] = {1, 15, 16, 17, 33, 1021};
+static constexpr size_t kMaxFrames = 1021;
+
+// ŏւ\BVLC ̃C^[[u (L R Ml Mr Rl Rr Rc C LFE) o͂̏ (FL FR FC LFE SL SR BL BR BC) ւ̑ΉB
+struct ExpectedReorder
+{
+	uint16_t mask;
+	std::initializer_list<uint8_t> table;
+};
+
+static const ExpectedReorder kExpectedReorders[] =
+{
+	//  L R C                 -> o FL FR FC
+	{kChans3_0, {0, 1, 2}},
+	//  L R Rl Rr LFE         -> o FL FR LFE BL BR
+	{kChans4_1, {0, 1, 4, 2, 3}},
+	//  L R Rl Rr C           -> o FL FR FC BL BR
+	{kChans5_0, {0, 1, 4, 2, 3}},
+	//  L R Rl Rr C LFE       -> o FL FR FC LFE BL BR
+	{kChans5_1, {0, 1, 4, 5, 2, 3}},
+	//  L R Ml Mr C LFE       -> o FL FR FC LFE SL SR
+	{kChans5_1Middle, {0, 1, 4, 5, 2, 3}},
+	//  L R Ml Mr Rl Rr C LFE -> o FL FR FC LFE SL SR BL BR
+	{kChans7_1, {0, 1, 6, 7, 2, 3, 4, 5}},
+	//  L R Ml Mr Rl Rr Rc C LFE -> o FL FR FC LFE SL SR BL BR BC
+	{kChans8_1, {0, 1, 7, 8, 2, 3, 4, 5, 6}}
+};
+
+static int failures = 0;
+
+static void Fail(const ChannelLayout& layout, const char *what)
+{
+	printf("%s: %s\n", layout.name, what);
+	++failures;
+}
+
+// `l̃rbgƃt[Aǂ̃`l̂ǂ̃t[l
+static float ChannelSample(uint32_t channel, size_t frame)
+{
+	return static_cast<float>(channel) + static_cast<float>(frame) / 64.0f;
+}
+
+static void CheckRouting(const ChannelLayout& layout)
+{
+	const unsigned channels = CountLayoutChannels(layout.mask);
+	std::vector<float> input;
+	std::vector<float> output(channels * kFrames);
+	float *dst[kMaxForwardChannels] {};
+	uint32_t objects = 0;
+
+	// VLC ̃C^[[uɕׂ
+	for (size_t frame=0; frame<kFrames; ++frame)
+	{
+		for (uint32_t channel: kInputChannelOrder)
+		{
+			if (layout.mask & channel)
+				input.push_back(ChannelSample(channel, frame));
+		}
+	}
+
+	for (unsigned channel=0; channel<channels; ++channel)
+		dst[channel] = output.data() + channel * kFrames;
+
+	for (size_t i=0; i<std::size(kOutputChannelOrder); ++i)
+	{
+		if (layout.mask & kOutputChannelOrder[i])
+			objects |= ObjectBit(kOutputChannelObjects[i]);
+	}
+
+	if (CountObjects(objects) != channels)
+		Fail(layout, "the number of objects differs from the number of channels");
+
+	const std::array<uint8_t, kMaxForwardChannels> reorder = MakeLayoutReorder(kInputChannelOrder, kOutputChannelOrder, layout.mask);
+	layout.deinterleave(dst, input.data(), reorder.data(), channels, kFrames, nullptr, nullptr);
+
+	unsigned out = 0;
+	for (size_t i=0; i<std::size(kOutputChannelOrder); ++i)
+	{
+		const uint32_t channel = kOutputChannelOrder[i];
+		if (!(layout.mask & channel))
+			continue;
+
+		// o out ́AANeBuɂIuWFNĝ out Ԗڂ̂̂ɏ
+		if (ObjectIndex(objects, kOutputChannelObjects[i]) != out)
+			Fail(layout, "output order differs from the object order");
+
+		for (size_t frame=0; frame<kFrames; ++frame)
+		{
+			if (output[out * kFrames + frame] != ChannelSample(channel, frame))
+			{
+				printf("%s: output %u (channel 0x%x) got %g at frame %zu\n", layout.name, out, channel, output[out * kFrames + frame], frame);
+				++failures;
+				break;
+			}
+		}
+
+		++out;
+	}
+}
+
+static void CheckExpectedReorders()
+{
+	for (const auto& expected: kExpectedReorders)
+	{
+		const std::array<uint8_t, kMaxForwardChannels> reorder = MakeLayoutReorder(kInputChannelOrder, kOutputChannelOrder, expected.mask);
+		size_t index = 0;
+
+		for (uint8_t value: expected.table)
+		{
+			if (reorder[index] != value)
+			{
+				printf("reorder table for 0x%x: [%zu] is %u, expected %u\n", expected.mask, index, reorder[index], value);
+				++failures;
+			}
+
+			++index;
+		}
+	}
+}
+
+static void CompareWithScalar(const ChannelLayout& layout, std::mt19937& random)
+{
+	const unsigned channels = CountLayoutChannels(layout.mask);
+	const std::array<uint8_t, kMaxForwardChannels> reorder = MakeLayoutReorder(kInputChannelOrder, kOutputChannelOrder, layout.mask);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<float> input(kMaxFrames * channels);
+	std::vector<float> gain(kMaxFrames);
+	std::vector<float> expected(kMaxFrames * channels);
+	std::vector<float> actual(kMaxFrames * channels);
+
+	for (auto& value: input)
+		value = distribution(random);
+	for (auto& value: gain)
+		value = 0.5f * (distribution(random) + 1.0f);
+
+	for (size_t frames: kCompareFrameCounts)
+	{
+		for (bool null_first: {false, true})
+		{
+			for (const float *g: {static_cast<const float *>(nullptr), static_cast<const float *>(gain.data())})
+			{
+				for (bool meter: {false, true})
+				{
+					float *expected_dst[kMaxForwardChannels] {};
+					float *actual_dst[kMaxForwardChannels] {};
+					ChannelLevels expected_levels {};
+					ChannelLevels actual_levels {};
+
+					for (unsigned channel=(null_first? 1: 0); channel<channels; ++channel)
+					{
+						expected_dst[channel] = expected.data() + channel * kMaxFrames;
+						actual_dst[channel] = actual.data() + channel * kMaxFrames;
+					}
+
+					std::fill(expected.begin(), expected.end(), 0.0f);
+					std::fill(actual.begin(), actual.end(), 0.0f);
+
+					DeinterleaveScalar(expected_dst, input.data(), reorder.data(), channels, frames, g, meter? &expected_levels: nullptr);
+					layout.deinterleave(actual_dst, input.data(), reorder.data(), channels, frames, g, meter? &actual_levels: nullptr);
+
+					bool matched = (0 == memcmp(expected.data(), actual.data(), expected.size() * sizeof(float)));
+
+					for (unsigned channel=0; matched && meter && (channel<channels); ++channel)
+					{
+						matched = (actual_levels.peak[channel] == expected_levels.peak[channel])
+							&& (std::fabs(actual_levels.energy[channel] - expected_levels.energy[channel]) <= expected_levels.energy[channel] * 1.0e-5);
+					}
+
+					if (!matched)
+					{
+						printf("%s: differs from DeinterleaveScalar, %zu frames%s%s%s\n", layout.name, frames,
+							null_first? ", first output null": "", g? ", gain": "", meter? ", meter": "");
+						++failures;
+					}
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 random(1);
+
+	CheckExpectedReorders();
+
+	for (const auto& layout: kChannelLayouts)
+	{
+		CheckRouting(layout);
+		CompareWithScalar(layout, random);
+	}
+
+	if (failures)
+	{
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("%zu layouts routed correctly\n", std::size(kChannelLayouts));
+	return 0;
+}
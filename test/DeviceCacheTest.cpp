@@ -0,0 +1,318 @@
+// DeviceCache ̒P̃eXgBWindows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc test/DeviceCacheTest.cpp -o device_cache_test
+//   ./device_cache_test
+//
+// MMDevice API ̑ɁA񋓂̉񐔂𐔂U Source ^āA
+// ꗗƃfoCX̃tH[}bgɂȂ܂ŗ񋓂ȂƁAInvalidate() ̌1x񋓂ƁA
+// s񋓂̓LbVȂƁA񋓒ɖɂȂʂ͎̖⍇ŗ񋓂Ƃm߂B
+// āA⍇ Invalidate() ʃXbhsčsAÂ̌ʂcȂƂm߂B
+// ŌɁAStart()  GetSupportedFormats() s⍇̎ԂALbVLȏꍇƁALbVÔ悤ɖXbhŗ񋓂ꍇŏo͂B
+// sΓeo͂ 1 ԂB
+
+#include "DeviceCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool condition, const char *what, unsigned line)
+{
+	if (condition)
+		return;
+
+	printf("line %u: %s\n", line, what);
+	++failures;
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+// WAVEFORMATEX ̑B񋓂Ƃ̔łAǂ̗񋓂̌ʂB
+struct FakeFormat
+{
+	unsigned rate;
+	unsigned version;
+};
+
+typedef DeviceCache<FakeFormat> FakeCache;
+
+// 񋓂̉񐔂𐔂U SourceBversion ͗񋓂̌ʂɖޔłŁAeXgςāufoCX̕ωvƂB
+class FakeSource : public FakeCache::Source
+{
+public:
+	bool EnumerateDevices(std::vector<FakeCache::Device>& devices) override
+	{
+		++device_enumerations;
+
+		const unsigned v = version.load();
+		devices.push_back({"speakers", "Speakers v" + std::to_string(v)});
+
+		if (fail_devices)
+			return false;
+
+		devices.push_back({"headphones", "Headphones v" + std::to_string(v)});
+
+		if (during_enumeration)
+			during_enumeration();
+
+		return true;
+	}
+
+	bool EnumerateFormats(const std::wstring& device_id, std::vector<FakeFormat>& formats) override
+	{
+		++format_enumerations;
+
+		const unsigned v = version.load();
+		formats.push_back({(L"speakers" == device_id)? 48000u: 44100u, v});
+
+		if (fail_formats)
+			return false;
+
+		formats.push_back({96000, v});
+
+		return true;
+	}
+
+	std::atomic<int> device_enumerations {0};
+	std::atomic<int> format_enumerations {0};
+	std::atomic<unsigned> version {1};
+	bool fail_devices = false;
+	bool fail_formats = false;
+	std::function<void()> during_enumeration;
+};
+
+static void TestCaching()
+{
+	FakeSource source;
+	FakeCache cache(&source);
+
+	const std::vector<FakeCache::Device> devices = cache.Devices();
+	CHECK(2 == devices.size());
+	CHECK("Speakers v1" == devices[0].description);
+	CHECK(1 == source.device_enumerations);
+
+	// 2xڈȍ~͗񋓂Ȃ
+	CHECK(2 == cache.Devices().size());
+	CHECK(1 == source.device_enumerations);
+
+	// tH[}bg̓foCX1x񋓂
+	CHECK(48000 == cache.Formats(L"speakers")[0].rate);
+	CHECK(44100 == cache.Formats(L"headphones")[0].rate);
+	CHECK(48000 == cache.Formats(L"speakers")[0].rate);
+	CHECK(2 == source.format_enumerations);
+	CHECK(1 == source.device_enumerations);
+}
+
+static void TestInvalidate()
+{
+	FakeSource source;
+	FakeCache cache(&source);
+
+	cache.Devices();
+	cache.Formats(L"speakers");
+	cache.Formats(L"headphones");
+
+	const uint64_t generation = cache.Generation();
+	source.version = 2;
+	cache.Invalidate();
+	CHECK(generation + 1 == cache.Generation());
+
+	// ɂ̍ŏ̖⍇ł񋓂AVʂԂ
+	CHECK("Speakers v2" == cache.Devices()[0].description);
+	CHECK("Speakers v2" == cache.Devices()[0].description);
+	CHECK(2 == source.device_enumerations);
+
+	CHECK(2 == cache.Formats(L"speakers")[0].version);
+	CHECK(2 == cache.Formats(L"speakers")[0].version);
+	CHECK(3 == source.format_enumerations);
+
+	// ⍇ĂȂfoCXAɖ⍇Ƃɗ񋓂
+	CHECK(2 == cache.Formats(L"headphones")[0].version);
+	CHECK(4 == source.format_enumerations);
+
+	// ĉxɂĂA񋓂͎̖̂⍇1x
+	cache.Invalidate();
+	cache.Invalidate();
+	cache.Invalidate();
+	cache.Devices();
+	cache.Devices();
+	CHECK(3 == source.device_enumerations);
+}
+
+static void TestFailure()
+{
+	FakeSource source;
+	FakeCache cache(&source);
+
+	// sĂr܂ł̌ʂ͕ԂALbVȂ
+	source.fail_devices = true;
+	CHECK(1 == cache.Devices().size());
+	CHECK(1 == cache.Devices().size());
+	CHECK(2 == source.device_enumerations);
+
+	source.fail_devices = false;
+	CHECK(2 == cache.Devices().size());
+	CHECK(2 == cache.Devices().size());
+	CHECK(3 == source.device_enumerations);
+
+	source.fail_formats = true;
+	CHECK(1 == cache.Formats(L"speakers").size());
+	CHECK(1 == cache.Formats(L"speakers").size());
+	CHECK(2 == source.format_enumerations);
+
+	source.fail_formats = false;
+	CHECK(2 == cache.Formats(L"speakers").size());
+	CHECK(2 == cache.Formats(L"speakers").size());
+	CHECK(3 == source.format_enumerations);
+}
+
+static void TestInvalidateDuringEnumeration()
+{
+	FakeSource source;
+	FakeCache cache(&source);
+
+	// 񋓂̓rŕύXʒm͂ꍇǍʂ͕ԂA̖⍇ŗ񋓂
+	source.during_enumeration = [&]()
+	{
+		source.during_enumeration = nullptr;
+		source.version = 2;
+		cache.Invalidate();
+	};
+
+	CHECK("Speakers v1" == cache.Devices()[0].description);
+	CHECK("Speakers v2" == cache.Devices()[0].description);
+	CHECK(2 == source.device_enumerations);
+
+	CHECK("Speakers v2" == cache.Devices()[0].description);
+	CHECK(2 == source.device_enumerations);
+}
+
+// ⍇̃XbhƁAύXʒm̑ɔłグĖɂXbhsēB
+// ⍇̌ʂ́A̖⍇n߂OɌJꂽłÂĂ͂ȂȂB
+static void TestConcurrent()
+{
+	static constexpr int kQueryThreads = 3;
+	static constexpr int kQueries = 20000;
+	static constexpr unsigned kInvalidations = 2000;
+
+	FakeSource source;
+	FakeCache cache(&source);
+	std::atomic<unsigned> published {1};
+	std::atomic<int> stale {0};
+	std::vector<std::thread> threads;
+
+	for (int t=0; t<kQueryThreads; ++t)
+	{
+		threads.emplace_back([&]()
+		{
+			for (int i=0; i<kQueries; ++i)
+			{
+				const unsigned minimum = published.load();
+				const std::vector<FakeFormat> formats = cache.Formats(L"speakers");
+
+				if ((2 != formats.size()) || (formats[0].version < minimum) || (formats[0].version != formats[1].version))
+					++stale;
+
+				const std::vector<FakeCache::Device> devices = cache.Devices();
+				if (2 != devices.size())
+					++stale;
+			}
+		});
+	}
+
+	threads.emplace_back([&]()
+	{
+		for (unsigned v=2; v<=kInvalidations + 1; ++v)
+		{
+			// ʒmƓAfoCXςĂ疳ɂ
+			source.version = v;
+			cache.Invalidate();
+			published = v;
+			std::this_thread::yield();
+		}
+	});
+
+	for (auto& thread: threads)
+		thread.join();
+
+	CHECK(0 == stale);
+
+	// Ō̖̌́AŐV̔łX1x񋓂 (⍇̃Xbhɗ񋓂Ă΁A񋓂Ȃ)
+	const int enumerations = source.format_enumerations;
+	CHECK(kInvalidations + 1 == cache.Formats(L"speakers")[0].version);
+	CHECK(kInvalidations + 1 == cache.Formats(L"speakers")[0].version);
+	CHECK(source.format_enumerations - enumerations <= 1);
+}
+
+// LbVO Start() ƓA⍇̓xɕʃXbhŗ񋓂 SourceB
+// MMDeviceSource ̃XbĥACOM ̏ ISpatialAudioClient ̊͊܂܂ȂB
+class ThreadedSource : public FakeSource
+{
+public:
+	bool EnumerateFormats(const std::wstring& device_id, std::vector<FakeFormat>& formats) override
+	{
+		bool result = false;
+
+		std::thread([&]() { result = FakeSource::EnumerateFormats(device_id, formats); }).join();
+
+		return result;
+	}
+};
+
+// Start()  GetSupportedFormats() ɑ⍇̎ԂALbVLȏꍇƁA񋓂ꍇ (LbVO Start()) ŏo͂B
+// 񋓂ꍇ̓Xbh̋NƏI܂ł̉ŁA@ł͂ COM ̏ ISpatialAudioClient ̊B
+static void ReportLookupTime()
+{
+	static constexpr int kLookups = 2000;
+
+	ThreadedSource source;
+	FakeCache cache(&source);
+	cache.Formats(L"speakers");
+
+	auto measure = [&](bool invalidate)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+
+		for (int i=0; i<kLookups; ++i)
+		{
+			if (invalidate)
+				cache.Invalidate();
+
+			cache.Formats(L"speakers");
+		}
+
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / kLookups;
+	};
+
+	const double cached = measure(false);
+	const double enumerated = measure(true);
+
+	printf("formats lookup: %.2f us cached, %.2f us enumerating on a thread every time (lower bound without COM)\n", cached, enumerated);
+	CHECK(kLookups + 1 == source.format_enumerations);
+}
+
+int main()
+{
+	TestCaching();
+	TestInvalidate();
+	TestFailure();
+	TestInvalidateDuringEnumeration();
+	TestConcurrent();
+	ReportLookupTime();
+
+	if (failures)
+	{
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,225 @@
+// ]֐ (DeinterleaveFunction)  SIMD Ɠʂo̒P̃eXgB
+// Windows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -Isrc test/ForwardKernelsTest.cpp src/ForwardKernels.cpp -o forward_kernels_test
+//   ./forward_kernels_test
+//
+// CPUŎg SSE2 / AVX2 / AVX-512 ̊e]֐A͌` (F32 / S16 / S24 / S32)A`l 1`17A
+// ܂ރt[Anullptr ̏o͂̒uA{ƌv̗L̑SĂ̑gŁA`̃XJ[ƔׂB
+// 񂾒l̓rbgPʂňvȂ΂Ȃ炸Ao͈͂̔͊O nullptr ̏o͂̃`lɏĂ͂ȂȂB
+// vl̃s[N͈vAa͐ώZ̏ɂ덷͈̔͂ňvȂ΂ȂȂB
+// sΓeo͂ 1 ԂB
+
+#include "ForwardKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Format
+{
+	const char *name;
+	SampleFormat format;
+	unsigned sample_bytes;
+};
+
+static const Format kFormats[] =
+{
+	{"fl32", SampleFormat::kFloat32, 4},
+	{"s16n", SampleFormat::kSigned16, 2},
+	{"s24n", SampleFormat::kSigned24, 3},
+	{"s32n", SampleFormat::kSigned32, 4}
+};
+
+static const char *kSimdLevelNames[] = {"scalar", "sse2", "avx2", "avx512"};
+
+// xNg̕ (4 / 8 / 16) ƃubN̒[ׂ悤A𒆐SɑI
+static const size_t kFrameCounts[] = {1, 2, 3, 5, 7, 15, 16, 17, 31, 33, 63, 65, 127, 129, 1021};
+static constexpr size_t kMaxFrames = 1021;
+
+// o͂̌ɒuԕB܂͂̂ȂlɂĂB
+static constexpr size_t kGuardFrames = 16;
+static constexpr uint32_t kGuardBits = 0x7fc0dead;
+
+// nullptr ɂo͂̑Iѕ
+enum class NullPattern
+{
+	kNone,
+	kFirst,
+	kLast,
+	kOdd
+};
+
+static const char *kNullPatternNames[] = {"none", "first", "last", "odd"};
+
+static bool IsNull(NullPattern pattern, unsigned channel, unsigned channels)
+{
+	switch (pattern)
+	{
+	case NullPattern::kFirst:
+		return 0 == channel;
+	case NullPattern::kLast:
+		return channels - 1 == channel;
+	case NullPattern::kOdd:
+		return 1 == (channel & 1);
+	default:
+		return false;
+	}
+}
+
+// ͂Bfloat  [-1, 1) ̗ɁA[̒l -0.0 B͑Srbg𗐐ɂāAŏlEőlB
+static void MakeInput(std::vector<uint8_t>& input, const Format& format, std::mt19937& random)
+{
+	const size_t samples = kMaxFrames * kMaxForwardChannels;
+
+	input.assign(samples * format.sample_bytes, 0);
+
+	if (SampleFormat::kFloat32 == format.format)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		static const float kSpecials[] = {1.0f, -1.0f, 0.0f, -0.0f, 1.0e-30f, -0.999999f};
+
+		for (size_t i=0; i<samples; ++i)
+		{
+			const float value = (0 == i % 97)? kSpecials[(i / 97) % 6]: distribution(random);
+			memcpy(input.data() + i * 4, &value, 4);
+		}
+
+		return;
+	}
+
+	for (auto& byte: input)
+		byte = static_cast<uint8_t>(random());
+
+	// ŏl (0x80..00) ƍől (0x7f..ff)BgGfBAȂ̂ōŏʃoCgŌB
+	for (size_t i=0; i<samples; i+=89)
+	{
+		uint8_t *sample = input.data() + i * format.sample_bytes;
+		const bool minimum = (0 == (i / 89) % 2);
+
+		memset(sample, minimum? 0x00: 0xff, format.sample_bytes);
+		sample[format.sample_bytes - 1] = minimum? 0x80: 0x7f;
+	}
+}
+
+int main()
+{
+	const SimdLevel top_level = DetectSimdLevel();
+	std::mt19937 random(1);
+	std::vector<uint8_t> input;
+	std::vector<float> gain(kMaxFrames);
+	std::vector<uint8_t> reorder(kMaxForwardChannels);
+	const size_t stride = kMaxFrames + kGuardFrames;
+	std::vector<float> expected(kMaxForwardChannels * stride);
+	std::vector<float> actual(kMaxForwardChannels * stride);
+	unsigned long long cases = 0;
+	int failures = 0;
+
+	printf("simd level: %s\n", kSimdLevelNames[static_cast<int>(top_level)]);
+	if (SimdLevel::kScalar == top_level)
+		printf("no SIMD kernels to check on this CPU\n");
+
+	// 0  1 傤ǁA1 𒴂l
+	std::uniform_real_distribution<float> gain_distribution(0.0f, 1.5f);
+	for (size_t frame=0; frame<kMaxFrames; ++frame)
+		gain[frame] = (0 == frame % 50)? 0.0f: (1 == frame % 50)? 1.0f: gain_distribution(random);
+
+	auto fill_guard = [](std::vector<float>& buffer)
+	{
+		float guard;
+		memcpy(&guard, &kGuardBits, 4);
+		std::fill(buffer.begin(), buffer.end(), guard);
+	};
+
+	for (const auto& format: kFormats)
+	{
+		MakeInput(input, format, random);
+		const DeinterleaveFunction reference = SelectDeinterleaveFunction(SimdLevel::kScalar, format.format);
+
+		for (int level=1; level<=static_cast<int>(top_level); ++level)
+		{
+			const DeinterleaveFunction deinterleave = SelectDeinterleaveFunction(static_cast<SimdLevel>(level), format.format);
+			int reported = 0;
+
+			for (unsigned channels=1; channels<=kMaxForwardChannels; ++channels)
+			{
+				// ւƓɈm߂邽߁AtɂĂ
+				for (unsigned channel=0; channel<channels; ++channel)
+					reorder[channel] = static_cast<uint8_t>(channels - 1 - channel);
+
+				for (size_t frames: kFrameCounts)
+				{
+					for (int null_pattern=0; null_pattern<4; ++null_pattern)
+					{
+						for (const float *g: {static_cast<const float *>(nullptr), static_cast<const float *>(gain.data())})
+						{
+							for (bool meter: {false, true})
+							{
+								float *expected_dst[kMaxForwardChannels] {};
+								float *actual_dst[kMaxForwardChannels] {};
+								ChannelLevels expected_levels {};
+								ChannelLevels actual_levels {};
+
+								for (unsigned channel=0; channel<channels; ++channel)
+								{
+									if (IsNull(static_cast<NullPattern>(null_pattern), channel, channels))
+										continue;
+
+									expected_dst[channel] = expected.data() + channel * stride;
+									actual_dst[channel] = actual.data() + channel * stride;
+								}
+
+								fill_guard(expected);
+								fill_guard(actual);
+
+								reference(expected_dst, input.data(), reorder.data(), channels, frames, g, meter? &expected_levels: nullptr);
+								deinterleave(actual_dst, input.data(), reorder.data(), channels, frames, g, meter? &actual_levels: nullptr);
+								++cases;
+
+								// nullptr ̏o̗͂̈܂߂đŜׂ̂ŁAԕ̂܂܎cĂ邩Ɋm߂
+								bool matched = (0 == memcmp(expected.data(), actual.data(), expected.size() * sizeof(float)));
+								const char *what = "samples";
+
+								for (unsigned channel=0; matched && meter && (channel<channels); ++channel)
+								{
+									const double tolerance = expected_levels.energy[channel] * 1.0e-5;
+
+									if ((actual_levels.peak[channel] != expected_levels.peak[channel])
+										|| (std::fabs(actual_levels.energy[channel] - expected_levels.energy[channel]) > tolerance)
+										|| (!actual_dst[channel] && ((0.0f != actual_levels.peak[channel]) || (0.0 != actual_levels.energy[channel]))))
+									{
+										matched = false;
+										what = "levels";
+									}
+								}
+
+								if (matched)
+									continue;
+
+								++failures;
+								if (reported++ < 10)
+								{
+									printf("%s mismatch: %s %s %u channels %zu frames, null %s%s%s\n", what, kSimdLevelNames[level], format.name, channels, frames,
+										kNullPatternNames[null_pattern], g? ", gain": "", meter? ", meter": "");
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (failures)
+	{
+		printf("%d of %llu case(s) failed\n", failures, cases);
+		return 1;
+	}
+
+	printf("%llu cases matched\n", cases);
+	return 0;
+}
@@ -0,0 +1,355 @@
+// I[fBIXbh̕`̏AԂŃq[vgȂƂm߂eXgB
+// Windows / VLC ȂŃrhł (Win32 API  PortableWin32.cppAVLC  test/vlc ̑g)B
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc -Itest/vlc test/RenderPathAllocationTest.cpp src/AudioProcessThread.cpp src/SimulatedBackend.cpp src/PortableWin32.cpp src/VirtualAudioDevice.cpp src/ClockModel.cpp src/PrebufferController.cpp src/Resampler.cpp src/TimeStretcher.cpp src/ForwardKernels.cpp src/LevelMeter.cpp src/TraceRecorder.cpp -o render_path_allocation_test
+//   ./render_path_allocation_test
+//
+// I[fBIXbhƓ AudioProcessSteps A͋[o (speed 0: ޓxɎ̎ʒm) ̃Cxgɏ]ẴXbhi߂B
+// ̍Ԃ Play() Ɠ菇ŃubNς݁AʁE~[g̃R}h𖈎Aꎞ~EtbVEL[̌͊ށB
+// AudioProcessSteps ĂłԂ operator new / delete  block_Release 𐔂A1łΎsƂB
+// ʂ̔{̕ (`Ew)A]֐ł̌vEEhlXATv (ɂx̋l߂܂)Ax̋l߁APlay() ł̕ϊ̊eݒōsB
+// sΓeo͂ 1 ԂB
+
+#include "AudioProcessThread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static constexpr unsigned kOutputRate = 48000;
+static constexpr unsigned kChannels = 2;
+static constexpr unsigned kPeriodFrames = 480;
+static constexpr unsigned kPoolBlocks = 64;
+static constexpr unsigned kCyclePeriods = 600;
+static constexpr unsigned kPeriods = 6 * kCyclePeriods;
+
+static int failures = 0;
+
+// q[v̉񐔁BAudioProcessSteps ĂłԂB
+static std::atomic<bool> count_heap_operations;
+static std::atomic<uint64_t> heap_operations;
+
+static void CountHeapOperation()
+{
+	if (count_heap_operations.load(std::memory_order_relaxed))
+		heap_operations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *operator new(size_t size)
+{
+	CountHeapOperation();
+
+	if (void *p = malloc(size? size: 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	if (p)
+		CountHeapOperation();
+
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+// gIubN̓v[ɖ߂Ďg񂷁BVLC ł free ɑ̂ŁAq[vƂĐB
+static std::vector<block_t *> free_blocks;
+
+void block_Release(block_t *block)
+{
+	CountHeapOperation();
+	free_blocks.push_back(block);
+}
+
+static void Check(bool condition, const char *what, unsigned line)
+{
+	if (condition)
+		return;
+
+	printf("line %u: %s\n", line, what);
+	++failures;
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+struct Variant
+{
+	const char *name;
+	VolumeMode volume_mode;
+	MeterMode meter_mode;
+	unsigned input_rate;
+	ResamplerQuality resampler_quality;
+	int64_t latency_target_frames;
+	bool convert_on_play;
+};
+
+static const Variant kVariants[] =
+{
+	{"linear ramp, levels", VolumeMode::kLinearRamp, MeterMode::kLevels, 48000, ResamplerQuality::kOff, 0, false},
+	{"exponential ramp, loudness, 44.1k > 48k", VolumeMode::kExponentialRamp, MeterMode::kLoudness, 44100, ResamplerQuality::kBalanced, 0, false},
+	{"44.1k > 48k, latency trim", VolumeMode::kLinearRamp, MeterMode::kOff, 44100, ResamplerQuality::kLowLatency, 2205, false},
+	{"latency trim", VolumeMode::kLinearRamp, MeterMode::kOff, 48000, ResamplerQuality::kOff, 2400, false},
+	{"convert on play, levels", VolumeMode::kLinearRamp, MeterMode::kLevels, 48000, ResamplerQuality::kOff, 0, true},
+};
+
+// Start() ŝƓݒɂB͋[o͂͏oAޓxɎ̎ʒmB
+static void Configure(aout_sys_t *sys, const Variant& variant)
+{
+	const SimdLevel level = DetectSimdLevel();
+
+	sys->input_format_ = {};
+	sys->input_format_.i_rate = variant.input_rate;
+	sys->input_format_.i_channels = kChannels;
+	sys->input_format_.i_bytes_per_frame = kChannels * sizeof(float);
+	sys->output_format_ = {};
+	sys->output_format_.nSamplesPerSec = kOutputRate;
+	sys->output_format_.nChannels = kChannels;
+
+	sys->mix_mode_ = MixMode::kOff;
+	sys->mix_ = nullptr;
+	sys->output_objects_ = ObjectBit(ObjectChannel::kFrontLeft)| ObjectBit(ObjectChannel::kFrontRight);
+	sys->output_channels_ = kChannels;
+	sys->channel_reorder_table_ = {0, 1};
+	sys->deinterleave_ = SelectDeinterleaveFunction(level, SampleFormat::kFloat32);
+	sys->scan_silence_ = SelectScanSilenceFunction(level, SampleFormat::kFloat32);
+	sys->output_sources_ = {1, 2};
+	sys->convert_on_play_ = variant.convert_on_play;
+	sys->resampler_quality_ = variant.resampler_quality;
+
+	if (variant.convert_on_play)
+		sys->planar_ring_.Reset(kChannels, static_cast<size_t>(variant.input_rate) * aout_sys_t::kPlanarRingSeconds);
+
+	sys->meter_mode_ = variant.meter_mode;
+	sys->measure_levels_ = SelectMeasureLevelsFunction(level);
+	sys->level_meter_.Reset(sys->output_objects_, kOutputRate, MeterMode::kLoudness == variant.meter_mode);
+
+	sys->backend_type_ = BackendType::kSimulated;
+	sys->simulation_ = SimulationSettings {kPeriodFrames, 0.0, 0.0, 0.0, 0.0, ""};
+	sys->wait_timeout_ = 10;
+	sys->fast_flush_ = true;
+	sys->flush_wait_ = 0;
+	sys->stop_wait_ = 0;
+	sys->underrun_probability_ = 0.001;
+	sys->latency_target_frames_ = variant.latency_target_frames;
+	sys->volume_mode_ = variant.volume_mode;
+	sys->volume_ = 1.0f;
+	sys->mute_ = false;
+	sys->trace_.Reset(4096);
+
+	QueryPerformanceFrequency(&sys->qpc_frequency_);
+	sys->clock_snapshot_.Store(ClockSnapshot {E_FAIL, {}, 0.0f, 0.0f});
+	sys->statistics_.Reset();
+
+	for (auto& event: sys->events_)
+		event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+}
+
+// Play() Ɠ菇ŃubNςށBL[tȂς܂ false ԂB
+// O 2 bAςނ̂͐ubN܂łȂ̂ŁAPlay() ŕϊꍇɑ҂Ƃ͂ȂB
+static bool Play(aout_sys_t *sys, block_t *block)
+{
+	const uint32_t active_objects = ScanAudioDataBlock(sys, block);
+
+	if (sys->convert_on_play_)
+	{
+		ConvertAudioDataBlock(sys, block, active_objects, []() { return true; });
+		block_Release(block);
+		return true;
+	}
+
+	if (!sys->audio_data_queue_.Push(QueuedBlock<block_t> {block, active_objects}))
+		return false;
+
+	sys->audio_data_frames_.fetch_add(block->i_nb_samples, std::memory_order_release);
+	return true;
+}
+
+// AudioProcessSteps 1iAq[v𐔂Ȃi߂
+template<typename Step>
+static bool Counted(Step step)
+{
+	count_heap_operations.store(true, std::memory_order_relaxed);
+	const bool result = step();
+	count_heap_operations.store(false, std::memory_order_relaxed);
+
+	return result;
+}
+
+static void Run(const Variant& variant)
+{
+	const unsigned block_frames = variant.input_rate / 100;
+	std::vector<float> samples(static_cast<size_t>(kPoolBlocks) * block_frames * kChannels);
+	std::vector<block_t> blocks(kPoolBlocks);
+	std::vector<std::future<HRESULT>> completed;
+
+	// 1kHz ̐gB`l 1 ̓`l 0 ̕𔽓]́B
+	for (size_t i=0; i<samples.size() / kChannels; ++i)
+	{
+		const float value = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * 1000.0 * i / variant.input_rate));
+		samples[i * kChannels] = value;
+		samples[i * kChannels + 1] = -value;
+	}
+
+	free_blocks.clear();
+	free_blocks.reserve(kPoolBlocks);
+	for (size_t i=0; i<blocks.size(); ++i)
+		free_blocks.push_back(&blocks[i]);
+
+	completed.reserve(2 * kPeriods);
+
+	aout_sys_t *sys = new aout_sys_t();
+	Configure(sys, variant);
+
+	{
+		AudioProcessSteps steps(sys);
+		CHECK(steps.Initialize());
+		steps.Start();
+
+		HANDLE stream_event = steps.Backend()->StreamEvent();
+		HANDLE command_event = sys->events_[aout_sys_t::kCommandPosted];
+		const uint64_t operations = heap_operations.load();
+
+		// xl߂ݒł͖ڕW葽߁AȊO͐ǂ݂̖ڕW𖞂xɕۂ
+		const int64_t queue_target = variant.latency_target_frames? 4 * variant.latency_target_frames: 8 * block_frames;
+		bool paused = false;
+		bool muted = false;
+		bool starving = false;
+		int64_t underruns = 0;
+
+		for (unsigned period=0; period<kPeriods; ++period)
+		{
+			const unsigned phase = period % kCyclePeriods;
+
+			//  Play()  VLC ̃R[obÑXbh̑Bq[v͐ȂB
+			ReleaseRetiredBlocks(sys);
+
+			// 400 ڂ̓A_[N܂ŃL[͂炷
+			if (400 == phase)
+			{
+				starving = true;
+				underruns = sys->underruns_.load();
+			}
+			else if (starving && (sys->underruns_.load() > underruns))
+			{
+				starving = false;
+			}
+
+			if (!starving)
+			{
+				// A_[̓xɐǂ݂̖ڕWオ̂ŁA𒴂܂Őςœ]ĊJ
+				const int64_t target = std::max(queue_target, sys->prebuffer_target_.load(std::memory_order_relaxed) + 2 * block_frames);
+
+				while ((sys->audio_data_frames_.load(std::memory_order_acquire) < target) && !free_blocks.empty())
+				{
+					block_t *block = free_blocks.back();
+					const size_t index = block - blocks.data();
+
+					*block = {};
+					block->p_buffer = reinterpret_cast<uint8_t *>(samples.data() + index * block_frames * kChannels);
+					block->i_buffer = block_frames * kChannels * sizeof(float);
+					block->i_nb_samples = block_frames;
+
+					free_blocks.pop_back();
+					if (!Play(sys, block))
+					{
+						free_blocks.push_back(block);
+						break;
+					}
+				}
+			}
+
+			completed.push_back(PostCommand(sys, AudioCommand::kVolume, (period & 1)? 0.3f: 0.9f, false));
+
+			if (0 == period % 37)
+			{
+				muted = !muted;
+				completed.push_back(PostCommand(sys, AudioCommand::kMute, 0.0f, muted));
+			}
+
+			// Đ̃tbV (Xg[g) ƁAꎞ~̃tbV (Xg[Zbg) ̗ʂ
+			if ((250 == phase) || (570 == phase))
+				completed.push_back(PostCommand(sys, AudioCommand::kFlush, 0.0f, false));
+
+			if ((560 == phase) || (580 == phase))
+			{
+				paused = (560 == phase);
+				completed.push_back(PostCommand(sys, AudioCommand::kPause, 0.0f, paused));
+			}
+
+			// ̓I[fBIXbh̑BAudioProcessThread() ƓANꂽR1ii߂B
+			if (WAIT_OBJECT_0 == WaitForSingleObject(command_event, 0))
+				CHECK(Counted([&]() { return steps.OnCommandPosted(); }));
+
+			if (WAIT_OBJECT_0 == WaitForSingleObject(stream_event, 0))
+				CHECK(Counted([&]() { return steps.OnStreamEvent(); }));
+			else if (steps.CommandsPending())
+				CHECK(Counted([&]() { return steps.OnTimeout(); }));
+		}
+
+		const uint64_t render_operations = heap_operations.load() - operations;
+		if (render_operations)
+			printf("%s: %llu heap operation(s) on the render path\n", variant.name, static_cast<unsigned long long>(render_operations));
+
+		printf("%s: %lld underruns, %lld frames trimmed\n", variant.name, static_cast<long long>(sys->underruns_.load()), static_cast<long long>(sys->trimmed_frames_.load()));
+
+		CHECK(0 == render_operations);
+		CHECK(!paused);
+		CHECK(sys->frames_written_.load() > 0);
+		CHECK(!starving);
+		CHECK(sys->underruns_.load() == kPeriods / kCyclePeriods);
+
+		if (variant.latency_target_frames)
+			CHECK(sys->trimmed_frames_.load() > 0);
+
+		steps.Finish();
+	}
+
+	// ꎞ~łR}h͓ďo̒ŊĂ
+	for (auto& future: completed)
+	{
+		CHECK(std::future_status::ready == future.wait_for(std::chrono::seconds(0)));
+		CHECK(S_OK == future.get());
+	}
+
+	while (QueuedBlock<block_t> *front = sys->audio_data_queue_.Front())
+	{
+		block_Release(front->block);
+		sys->audio_data_queue_.Pop();
+	}
+
+	ReleaseRetiredBlocks(sys);
+	ReleaseRetiredCommands(sys);
+	CHECK(kPoolBlocks == free_blocks.size());
+
+	for (auto& event: sys->events_)
+		CloseHandle(event);
+
+	delete sys;
+}
+
+int main()
+{
+	for (const auto& variant: kVariants)
+		Run(variant);
+
+	if (failures)
+	{
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,208 @@
+// SpscQueue ̒P̃eXgBWindows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc test/SpscQueueTest.cpp -o spsc_queue_test
+//   ./spsc_queue_test
+//
+// PXbh Push / Front / PopA܂ԂAtEASize m߂A
+// Y҂Ə҂ʃXbhɂāASĂ̒lԂǂ茇ɓ͂Ƃm߂B
+// sΓeo͂ 1 ԂB
+
+#include "SpscQueue.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+static int failures = 0;
+
+static void Check(bool condition, const char *what, unsigned line)
+{
+	if (condition)
+		return;
+
+	printf("line %u: %s\n", line, what);
+	++failures;
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+static void TestCapacity()
+{
+	// 2ׂ̂ɐ؂グ
+	CHECK(1 == SpscQueue<int>(1).Capacity());
+	CHECK(4 == SpscQueue<int>(3).Capacity());
+	CHECK(8 == SpscQueue<int>(8).Capacity());
+	CHECK(4096 == SpscQueue<int>(4000).Capacity());
+}
+
+static void TestPushFrontPop()
+{
+	SpscQueue<int> queue(4);
+
+	CHECK(queue.Empty());
+	CHECK(0 == queue.Size());
+	CHECK(nullptr == queue.Front());
+
+	CHECK(queue.Push(10));
+	CHECK(!queue.Empty());
+	CHECK(1 == queue.Size());
+
+	// Front  Pop ܂œvfԂA̗vf͏Ă悢
+	int *front = queue.Front();
+	CHECK(front && (10 == *front));
+	CHECK(front == queue.Front());
+	*front = 11;
+
+	CHECK(queue.Push(20));
+	CHECK(2 == queue.Size());
+	CHECK(11 == *queue.Front());
+
+	queue.Pop();
+	CHECK(1 == queue.Size());
+	CHECK(20 == *queue.Front());
+
+	queue.Pop();
+	CHECK(queue.Empty());
+	CHECK(0 == queue.Size());
+	CHECK(nullptr == queue.Front());
+}
+
+static void TestFull()
+{
+	SpscQueue<int> queue(4);
+
+	for (int i=0; i<4; ++i)
+		CHECK(queue.Push(i));
+
+	// tȂ false ԂAg͕ςȂ
+	CHECK(!queue.Push(100));
+	CHECK(4 == queue.Size());
+	CHECK(0 == *queue.Front());
+
+	// 1󂯂΂܂
+	queue.Pop();
+	CHECK(queue.Push(4));
+	CHECK(!queue.Push(101));
+
+	for (int i=1; i<=4; ++i)
+	{
+		int *front = queue.Front();
+		CHECK(front && (i == *front));
+		queue.Pop();
+	}
+
+	CHECK(queue.Empty());
+	CHECK(nullptr == queue.Front());
+}
+
+static void TestWraparound()
+{
+	SpscQueue<int> queue(4);
+	int pushed = 0;
+	int popped = 0;
+
+	// eʂ蔼[ȐoꂵāA݈ʒuƓǏoʒu܂Ԃ
+	for (int round=0; round<1000; ++round)
+	{
+		const int count = 1 + (round % 4);
+
+		for (int i=0; i<count; ++i)
+		{
+			if (queue.Size() == queue.Capacity())
+			{
+				CHECK(!queue.Push(-1));
+				break;
+			}
+
+			CHECK(queue.Push(pushed++));
+		}
+
+		CHECK(static_cast<size_t>(pushed - popped) == queue.Size());
+
+		for (int i=0; i<(count + 1) / 2; ++i)
+		{
+			int *front = queue.Front();
+			if (!front)
+				break;
+
+			CHECK(popped == *front);
+			++popped;
+			queue.Pop();
+		}
+	}
+
+	for (int *front; (front = queue.Front()); queue.Pop())
+		CHECK(popped++ == *front);
+
+	CHECK(pushed == popped);
+	CHECK(queue.Empty());
+}
+
+static void TestTwoThreads()
+{
+	static constexpr uint64_t kCount = 2000000;
+	SpscQueue<uint64_t> queue(64);
+	uint64_t producer_full = 0;
+
+	// L[ŖtƋpɂɋNALbV葤̈ʒuxǂݒ
+	std::thread producer([&queue, &producer_full]()
+	{
+		for (uint64_t value=0; value<kCount; ++value)
+		{
+			while (!queue.Push(value))
+			{
+				++producer_full;
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint64_t expected = 0;
+	uint64_t mismatches = 0;
+
+	while (expected < kCount)
+	{
+		uint64_t *front = queue.Front();
+		if (!front)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		if (queue.Size() > queue.Capacity())
+			++mismatches;
+
+		if (*front != expected)
+			++mismatches;
+
+		++expected;
+		queue.Pop();
+	}
+
+	producer.join();
+
+	CHECK(0 == mismatches);
+	CHECK(queue.Empty());
+	CHECK(nullptr == queue.Front());
+
+	printf("two threads: %llu values, producer saw a full queue %llu times\n",
+		static_cast<unsigned long long>(kCount), static_cast<unsigned long long>(producer_full));
+}
+
+int main()
+{
+	TestCapacity();
+	TestPushFrontPop();
+	TestFull();
+	TestWraparound();
+	TestTwoThreads();
+
+	if (failures)
+	{
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
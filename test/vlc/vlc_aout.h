@@ -0,0 +1,18 @@
+#pragma once
+
+// eXgp VLC ̑ (vlc_common.h Q)
+#include "vlc_common.h"
+
+struct audio_sample_format_t
+{
+	vlc_fourcc_t i_format;
+	unsigned i_rate;
+	uint16_t i_physical_channels;
+	uint16_t i_chan_mode;
+	int channel_type;
+	unsigned i_bytes_per_frame;
+	unsigned i_frame_length;
+	unsigned i_bitspersample;
+	unsigned i_blockalign;
+	uint8_t i_channels;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+// eXgp VLC ̑Baout_sys.h ƃI[fBIXbhg^Ɗ֐AVLC 3 ƓOŐ錾B
+// block_Release() ̓eXg̑Œ`B
+//
+//   g++ ... -Isrc -Itest/vlc ...
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int64_t mtime_t;
+typedef uint32_t vlc_fourcc_t;
+
+#define VLC_SUCCESS 0
+#define VLC_EGENERIC (-1)
+
+struct block_t
+{
+	block_t *p_next;
+	uint8_t *p_buffer;
+	size_t i_buffer;
+	unsigned i_nb_samples;
+	mtime_t i_pts;
+	mtime_t i_length;
+};
+
+void block_Release(block_t *block);
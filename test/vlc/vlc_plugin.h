@@ -0,0 +1,4 @@
+#pragma once
+
+// eXgp VLC ̑ (vlc_common.h Q)
+#include "vlc_common.h"
@@ -0,0 +1,437 @@
+// g[X (TraceRecorder  mss-trace-file ɏo) ǂ݁AL[̐[ƒx̎nč\B
+// Windows / VLC ȂŃrhłB
+//
+//   g++ -O2 -std=c++17 -Isrc tools/TraceReplay.cpp src/TraceRecorder.cpp src/PrebufferController.cpp src/ClockModel.cpp -o trace_replay
+//   ./trace_replay trace.bin
+//   ./trace_replay trace.bin --replay [A_[m...]
+//
+// O҂ Play() ւ̓E`EtbVEꎞ~1sA^u؂ŕWo͂ɏB
+// L[̃t[ƁAL^ GetPosition() ̌ʂ ClockModel ɒʂ TimeGet() Ɠ@ŋ߂fBC܂ށB
+// ŌɁA`̏vԂƋN̒xÅԊuAA_[̗vWG[o͂ɏB
+// ҂́AL^ƕ`̗vŁAI[fBIXbhƓǂ݂̐ (PrebufferController) 𓮂A
+// w肵A_[mɁAN͂̃A_[Ɛǂ݂̐[L^ƕׂďo͂B
+
+#include "ClockModel.h"
+#include "PrebufferController.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+// Jn̋L^番Đ̌`
+struct TraceFormat
+{
+	unsigned channels;
+	int64_t input_rate;
+	int64_t output_rate;
+	int64_t device_frequency;
+	double underrun_probability;
+};
+
+// `̋L^琔A_[BAudioProcessThread  Stream() ƓA
+// JnEtbV1O̕s͐AsԂ1ƐB
+struct UnderrunCounter
+{
+	bool data_started;
+	bool underrun;
+	int64_t underruns;
+	int64_t padded_frames;
+
+	// sāAVȃA_[ƂĐ true Ԃ
+	bool Update(int64_t padding_frames)
+	{
+		bool counted = false;
+
+		if (padding_frames)
+		{
+			if (data_started)
+			{
+				counted = !underrun;
+				underruns += counted? 1: 0;
+				padded_frames += padding_frames;
+			}
+
+			underrun = true;
+		}
+		else
+		{
+			data_started = true;
+			underrun = false;
+		}
+
+		return counted;
+	}
+
+	void Restart()
+	{
+		data_started = false;
+		underrun = false;
+	}
+};
+
+static const char *kEventNames[] = {"start", "stop", "play", "stream", "position", "flush", "pause"};
+
+static bool ReadFormat(const TraceRecord& record, TraceFormat *format);
+static int PrintTimeline(const TraceFileHeader& header, const std::vector<TraceRecord>& records);
+static int Replay(const std::vector<TraceRecord>& records, const std::vector<double>& probabilities);
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s trace [--replay [probability...]]\n", argv[0]);
+		return 2;
+	}
+
+	TraceFileHeader header;
+	std::vector<TraceRecord> records;
+
+	if (!TraceRecorder::Load(argv[1], &header, &records))
+	{
+		fprintf(stderr, "cannot read trace: %s\n", argv[1]);
+		return 1;
+	}
+
+	// L^͒ʂԍ̏Ȃ̂ŁA2̃Xbh̋L^OサĂ邱ƂB̏ɕגB
+	std::stable_sort(records.begin(), records.end(), [](const TraceRecord& a, const TraceRecord& b) { return a.qpc < b.qpc; });
+
+	if (records.empty() || (TraceEvent::kStart != records.front().event))
+	{
+		fprintf(stderr, "trace does not begin with a start record\n");
+		return 1;
+	}
+
+	if ((argc > 2) && (0 == strcmp(argv[2], "--replay")))
+	{
+		std::vector<double> probabilities;
+
+		for (int i=3; i<argc; ++i)
+			probabilities.push_back(atof(argv[i]));
+
+		return Replay(records, probabilities);
+	}
+
+	return PrintTimeline(header, records);
+}
+
+static bool ReadFormat(const TraceRecord& record, TraceFormat *format)
+{
+	format->channels = record.frames;
+	format->input_rate = record.values[0];
+	format->output_rate = record.values[1];
+	format->device_frequency = record.values[2];
+	format->underrun_probability = record.values[3] / 1.0e6;
+
+	return (format->input_rate > 0) && (format->output_rate > 0) && (format->device_frequency > 0);
+}
+
+// TimeGet() ƓAݍς݂̕͏o͂́AL[͓͂̃̕[gŐA肵ĐʒuB
+// ϊƎԐLkɗ܂Ă镪ƁAǂݒ̖ڕW͋L^ĂȂ̂Ŋ܂߂ȂB
+static double DelayMilliseconds(const TraceFormat& format, const ClockModel& clock, int64_t qpc_frequency, int64_t qpc, int64_t written_frames, int64_t queued_frames)
+{
+	const int64_t now = ScaleTicks(qpc, kClockUnitsPerSecond, qpc_frequency);
+	const int64_t played = ClockModel::Extrapolate(clock.Current(), now);
+
+	return 1000.0 * written_frames / format.output_rate + 1000.0 * queued_frames / format.input_rate - played / 10000.0;
+}
+
+static int PrintTimeline(const TraceFileHeader& header, const std::vector<TraceRecord>& records)
+{
+	const int64_t qpc_frequency = header.qpc_frequency;
+	const int64_t origin = records.front().qpc;
+	TraceFormat format {};
+	ClockModel clock;
+	bool clock_valid = false;
+	int64_t written_frames = 0;
+	int64_t queued_frames = 0;
+	UnderrunCounter underruns {};
+
+	// vp
+	int64_t periods = 0;
+	int64_t arrivals = 0;
+	int64_t failed_positions = 0;
+	double stream_sum_us = 0.0;
+	double stream_max_us = 0.0;
+	double lateness_max_ms = 0.0;
+	int64_t late_periods = 0;
+	double arrival_gap_max_ms = 0.0;
+	int64_t queue_max = 0;
+	double delay_min_ms = 0.0;
+	double delay_max_ms = 0.0;
+	bool delay_seen = false;
+	int64_t last_stream_qpc = 0;
+	uint32_t last_stream_frames = 0;
+	int64_t last_arrival_qpc = 0;
+
+	auto milliseconds = [qpc_frequency](int64_t ticks)
+	{
+		return 1000.0 * ticks / qpc_frequency;
+	};
+
+	printf("time_ms\tevent\tframes\tqueued\tavailable\tforwarded\tduration_us\tdelay_ms\n");
+
+	for (const TraceRecord& record: records)
+	{
+		const double time = milliseconds(record.qpc - origin);
+		const char *name = (static_cast<size_t>(record.event) < std::size(kEventNames))? kEventNames[static_cast<size_t>(record.event)]: "unknown";
+
+		switch (record.event)
+		{
+		case TraceEvent::kStart:
+			if (!ReadFormat(record, &format))
+			{
+				fprintf(stderr, "invalid start record at %.3fms\n", time);
+				return 1;
+			}
+
+			clock.Reset(format.device_frequency);
+			clock_valid = false;
+			written_frames = 0;
+			queued_frames = 0;
+			underruns.Restart();
+			last_stream_qpc = 0;
+			printf("%.3f\t%s\t%u\t-\t-\t-\t-\t-\n", time, name, record.frames);
+			continue;
+
+		case TraceEvent::kPosition:
+			// s GetPosition()  ClockModel ɓnȂ
+			if (record.values[2] < 0)
+			{
+				++failed_positions;
+				continue;
+			}
+
+			clock.Update(static_cast<uint64_t>(record.values[0]), static_cast<uint64_t>(record.values[1]));
+			clock_valid = true;
+			continue;
+
+		case TraceEvent::kPause:
+			clock.SetRunning(!record.frames);
+			last_stream_qpc = 0;
+			printf("%.3f\t%s\t%u\t-\t-\t-\t-\t-\n", time, name, record.frames);
+			continue;
+
+		case TraceEvent::kFlush:
+			queued_frames -= record.values[0];
+			if (record.values[1])
+				written_frames = 0;
+
+			underruns.Restart();
+			last_stream_qpc = 0;
+			printf("%.3f\t%s\t%" PRId64 "\t%" PRId64 "\t-\t-\t-\t-\n", time, name, record.values[0], queued_frames);
+			continue;
+
+		case TraceEvent::kStop:
+			printf("%.3f\t%s\t-\t-\t-\t-\t-\t-\n", time, name);
+			continue;
+
+		case TraceEvent::kPlay:
+			if (last_arrival_qpc)
+				arrival_gap_max_ms = std::max(arrival_gap_max_ms, milliseconds(record.qpc - last_arrival_qpc));
+
+			last_arrival_qpc = record.qpc;
+			queued_frames = record.values[1];
+			++arrivals;
+			printf("%.3f\t%s\t%u\t%" PRId64 "\t-\t-\t-\t", time, name, record.frames, queued_frames);
+			break;
+
+		case TraceEvent::kStream:
+		{
+			const double duration_us = 1000.0 * milliseconds(record.values[3]);
+
+			// N̒x́AO̎̎n߂O̎̃t[̎Ԃ𒴂
+			if (last_stream_qpc)
+			{
+				const double lateness = milliseconds(record.qpc - last_stream_qpc) - 1000.0 * last_stream_frames / format.output_rate;
+
+				lateness_max_ms = std::max(lateness_max_ms, lateness);
+				late_periods += (lateness > 1000.0 * last_stream_frames / format.output_rate)? 1: 0;
+			}
+
+			last_stream_qpc = record.qpc;
+			last_stream_frames = record.frames;
+			written_frames += record.frames;
+			queued_frames = record.values[0] - record.values[1];
+			stream_sum_us += duration_us;
+			stream_max_us = std::max(stream_max_us, duration_us);
+			++periods;
+
+			if (underruns.Update(record.frames - record.values[2]))
+				fprintf(stderr, "underrun at %.3fms: %" PRId64 " of %u frames forwarded\n", time, record.values[2], record.frames);
+
+			printf("%.3f\t%s\t%u\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%.1f\t", time, name, record.frames, record.values[0], record.values[1], record.values[2], duration_us);
+			break;
+		}
+
+		default:
+			continue;
+		}
+
+		// ƕ`̍sɂ́A̎_̃fBCt
+		queue_max = std::max(queue_max, queued_frames);
+
+		if (!clock_valid)
+		{
+			printf("-\n");
+			continue;
+		}
+
+		const double delay = DelayMilliseconds(format, clock, qpc_frequency, record.qpc, written_frames, queued_frames);
+
+		delay_min_ms = delay_seen? std::min(delay_min_ms, delay): delay;
+		delay_max_ms = delay_seen? std::max(delay_max_ms, delay): delay;
+		delay_seen = true;
+		printf("%.3f\n", delay);
+	}
+
+	fprintf(stderr, "records: %zu (%" PRIu64 " lost), span: %.3fs\n", records.size(), header.lost_records, milliseconds(records.back().qpc - origin) / 1000.0);
+	fprintf(stderr, "format: %u objects, %" PRId64 "Hz -> %" PRId64 "Hz\n", format.channels, format.input_rate, format.output_rate);
+	fprintf(stderr, "periods: %" PRId64 ", stream mean: %.1fus, max: %.1fus, max wake lateness: %.3fms, periods late by more than one period: %" PRId64 "\n",
+		periods, periods? stream_sum_us / periods: 0.0, stream_max_us, lateness_max_ms, late_periods);
+	fprintf(stderr, "arrivals: %" PRId64 ", max gap: %.3fms, max queue: %" PRId64 " frames\n", arrivals, arrival_gap_max_ms, queue_max);
+	fprintf(stderr, "underruns: %" PRId64 ", padded frames: %" PRId64 ", failed positions: %" PRId64 "\n", underruns.underruns, underruns.padded_frames, failed_positions);
+
+	if (delay_seen)
+		fprintf(stderr, "delay: %.3fms - %.3fms\n", delay_min_ms, delay_max_ms);
+
+	return 0;
+}
+
+// L^ƕ`̗vAprobability ̐ǂ݂̐ŏB
+// I[fBIXbh Stream() ƓAǂݒ͖ڕW܂܂œ]AA_[̓xɖڕWグėߒB
+static void ReplayWithProbability(const std::vector<TraceRecord>& records, double probability, UnderrunCounter *underruns, double *target_mean_ms, double *target_max_ms)
+{
+	TraceFormat format {};
+	PrebufferController prebuffer;
+	bool prebuffering = false;
+	int64_t queued_frames = 0;
+	int64_t last_queued_frames = 0;
+	double target_sum_ms = 0.0;
+	int64_t periods = 0;
+
+	*underruns = UnderrunCounter {};
+	*target_max_ms = 0.0;
+
+	auto start_prebuffering = [&]()
+	{
+		prebuffering = probability > 0.0;
+	};
+
+	for (const TraceRecord& record: records)
+	{
+		switch (record.event)
+		{
+		case TraceEvent::kStart:
+			ReadFormat(record, &format);
+			prebuffer.Reset(probability, format.input_rate / 50, format.input_rate / 2);
+			queued_frames = 0;
+			last_queued_frames = 0;
+			underruns->Restart();
+			start_prebuffering();
+			break;
+
+		case TraceEvent::kFlush:
+			queued_frames = 0;
+			last_queued_frames = 0;
+			underruns->Restart();
+			start_prebuffering();
+			break;
+
+		case TraceEvent::kPlay:
+			queued_frames += record.frames;
+			break;
+
+		case TraceEvent::kStream:
+		{
+			// v͓͂̃[gɊZBԐLkɂ͍̑lȂB
+			const int64_t input_frames = static_cast<int64_t>(std::llround(static_cast<double>(record.frames) * format.input_rate / format.output_rate));
+
+			if (prebuffering)
+			{
+				if (queued_frames >= std::max<int64_t>(prebuffer.Target(), input_frames))
+					prebuffering = false;
+			}
+			else
+			{
+				prebuffer.Update(queued_frames - last_queued_frames, input_frames);
+			}
+
+			const int64_t available_frames = prebuffering? 0: std::clamp<int64_t>(queued_frames, 0, input_frames);
+			queued_frames -= available_frames;
+
+			if (underruns->Update(input_frames - available_frames))
+			{
+				prebuffer.NotifyUnderrun();
+				start_prebuffering();
+			}
+
+			last_queued_frames = queued_frames;
+
+			// ǂ݂Ȃꍇ͖ڕWgȂ
+			const double target_ms = (probability > 0.0)? 1000.0 * prebuffer.Target() / format.input_rate: 0.0;
+			target_sum_ms += target_ms;
+			*target_max_ms = std::max(*target_max_ms, target_ms);
+			++periods;
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	*target_mean_ms = periods? target_sum_ms / periods: 0.0;
+}
+
+static int Replay(const std::vector<TraceRecord>& records, const std::vector<double>& probabilities)
+{
+	TraceFormat format {};
+	UnderrunCounter recorded {};
+
+	// L^ꂽA_[
+	for (const TraceRecord& record: records)
+	{
+		if (TraceEvent::kStart == record.event)
+		{
+			ReadFormat(record, &format);
+			recorded.Restart();
+		}
+		else if (TraceEvent::kFlush == record.event)
+		{
+			recorded.Restart();
+		}
+		else if (TraceEvent::kStream == record.event)
+		{
+			recorded.Update(record.frames - record.values[2]);
+		}
+	}
+
+	printf("%-12s %10s %12s %12s %12s\n", "probability", "underruns", "padded(ms)", "target(ms)", "max(ms)");
+	printf("%-12s %10" PRId64 " %12.1f %12s %12s\n", "recorded", recorded.underruns, 1000.0 * recorded.padded_frames / format.output_rate, "-", "-");
+
+	// mw肵Ȃ΁AL^Đł̐ݒœ
+	std::vector<double> replayed = probabilities;
+	if (replayed.empty())
+		replayed.push_back(format.underrun_probability);
+
+	for (double probability: replayed)
+	{
+		UnderrunCounter underruns;
+		double target_mean_ms;
+		double target_max_ms;
+		char label[32];
+
+		ReplayWithProbability(records, probability, &underruns, &target_mean_ms, &target_max_ms);
+		snprintf(label, sizeof (label), "%g", probability);
+		printf("%-12s %10" PRId64 " %12.1f %12.1f %12.1f\n", label, underruns.underruns, 1000.0 * underruns.padded_frames / format.input_rate, target_mean_ms, target_max_ms);
+	}
+
+	return 0;
+}